@@ -10,14 +10,25 @@
 #include <dx12/sampler.h>
 #include <dx12/shader.h>
 
+#include <scene/animation_asset.h>
 #include <scene/assimp.h>
+#include <scene/bone_palette.h>
 #include <scene/camera.h>
+#include <scene/cluster.h>
+#include <scene/compressed_animation.h>
+#include <scene/cull_simulator.h>
 #include <scene/light.h>
 #include <scene/mesh.h>
+#include <scene/mesh_cache.h>
 #include <scene/model.h>
 #include <scene/model.h>
+#include <scene/model_loader.h>
+#include <scene/pose.h>
+#include <scene/scene_package.h>
 #include <scene/skinned_animation.h>
 #include <scene/texture.h>
+#include <scene/texture_cache.h>
+#include <scene/texture_streamer.h>
 #include <scene/timer.h>
 
 #include <render_pass/cull_pass.h>
@@ -34,10 +45,18 @@
 #include <render_pass/tone_mapping_pass.h>
 #include <render_pass/utils_pass.h>
 
+#include <utils/binary.h>
 #include <utils/bitset.h>
 #include <utils/buddy.h>
+#include <utils/cook_stats.h>
+#include <utils/directory_listing.h>
 #include <utils/exception.h>
 #include <utils/d3dx12.h>
+#include <utils/hash.h>
+#include <utils/mapped_file.h>
+#include <utils/mip_chain.h>
+#include <utils/shader_archive.h>
+#include <utils/thread_pool.h>
 
 #include <renderer.h>
 #include <global.h>
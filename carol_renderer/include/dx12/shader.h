@@ -1,6 +1,5 @@
 #pragma once
 #include <d3d12.h>
-#include <dxcapi.h>
 #include <vector>
 #include <string>
 #include <string_view>
@@ -11,23 +10,35 @@
 
 namespace Carol
 {
+	class ShaderArchive;
+
+	// Either a view into the mapped shader archive or a loose file read into mBlob
 	class Shader
 	{
 	public:
 		Shader(std::string_view path);
+		Shader(std::span<const uint8_t> bytecode, uint64_t hash);
 		void* GetBufferPointer()const;
 		size_t GetBufferSize()const;
+		// Hash of the bytecode, equal bytecode gives equal hashes across runs
+		uint64_t GetHash()const;
 	private:
-		std::vector<std::byte> mBlob;
+		std::vector<uint8_t> mBlob;
+		std::span<const uint8_t> mBytecode;
+		uint64_t mHash = 0;
 	};
 
+	// Shaders come from the archive when it holds them and fall back to the loose .dxil files otherwise
 	class ShaderManager
 	{
 	public:
-		ShaderManager();
+		ShaderManager(std::string_view archivePath = "shader/shader.pack");
+		~ShaderManager();
 		Shader* LoadShader(std::string_view path);
+		uint32_t GetArchiveShaderCount()const;
 
 	private:
-		std::unordered_map<std::string, std::unique_ptr<Shader>> mShaders;
+		std::unique_ptr<ShaderArchive> mArchive;
+		std::unordered_map<uint64_t, std::unique_ptr<Shader>> mShaders;
 	};
 }
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 #include <d3d12.h>
+#ifdef _WIN32
 #include <dxgi1_6.h>
-#include <dxcapi.h>
+#endif
 #include <wrl/client.h>
 #include <memory>
 
@@ -14,11 +15,15 @@ namespace Carol
 	class HeapManager;
 	class ShaderManager;
 	class TextureManager;
+	class AnimationAssetManager;
 	class ModelManager;
 	class Renderer;
+	class ThreadPool;
 
 	extern Microsoft::WRL::ComPtr<ID3D12Debug> gDebugLayer;
+#ifdef _WIN32
 	extern Microsoft::WRL::ComPtr<IDXGIFactory> gDxgiFactory;
+#endif
 	extern Microsoft::WRL::ComPtr<ID3D12Device> gDevice;
 	extern Microsoft::WRL::ComPtr<ID3D12CommandQueue> gCommandQueue;
 	extern Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> gGraphicsCommandList;
@@ -30,10 +35,12 @@ namespace Carol
 	extern uint64_t gCpuFenceValue;
 	extern uint64_t gGpuFenceValue;
 
+	extern std::unique_ptr<ThreadPool> gThreadPool;
 	extern std::unique_ptr<DescriptorManager> gDescriptorManager;
 	extern std::unique_ptr<HeapManager> gHeapManager;
 	extern std::unique_ptr<ShaderManager> gShaderManager;
 	extern std::unique_ptr<TextureManager> gTextureManager;
+	extern std::unique_ptr<AnimationAssetManager> gAnimationAssetManager;
 	extern std::unique_ptr<ModelManager> gModelManager;
 
 	extern std::unique_ptr<Renderer> gRenderer;
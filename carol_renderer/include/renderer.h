@@ -2,10 +2,12 @@
 #include <scene/light.h>
 #include <d3d12.h>
 #include <wrl/client.h>
+#include <future>
 #include <memory>
 #include <unordered_map>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #define MAX_MAIN_LIGHT_SPLIT_LEVEL 8
 #define MAX_POINT_LIGHTS 64
@@ -17,6 +19,7 @@ namespace Carol
 	class Camera;
 	class Timer;
 	class Scene;
+	class ModelLoader;
 	class CullPass;
 	class DisplayPass;
 	class GeometryPass;
@@ -140,6 +143,11 @@ namespace Carol
 		bool IsResizing();
 
         void LoadModel(std::string_view path, std::string_view textureDir, std::string_view modelName, DirectX::XMMATRIX world, bool isSkinned);
+        // The model is drawn from the first frame after all of its uploads have completed
+        std::future<void> LoadModelAsync(std::string_view path, std::string_view textureDir, std::string_view modelName, DirectX::XMMATRIX world, bool isSkinned);
+        // Loads the models of a scene package written by carol-cook under the names and transforms they were cooked with.
+        // An invalid package yields a single future holding the error.
+        std::vector<std::future<void>> LoadSceneAsync(std::string_view path);
         void UnloadModel(std::string_view modelName);
         std::vector<std::string_view> GetAnimationNames(std::string_view modelName);
         void SetAnimation(std::string_view modelName, std::string_view animationName);
@@ -155,6 +163,7 @@ namespace Carol
 		void InitRootSignature();
 		void InitCommandSignature();
 
+		void InitThreadPool();
 		void InitHeapManager();
 		void InitDescriptorManager();
 		void InitShaderManager();
@@ -212,6 +221,8 @@ namespace Carol
 		std::unique_ptr<ToneMappingPass> mToneMappingPass;
 		std::unique_ptr<UtilsPass> mUtilsPass;
 
+		std::unique_ptr<ModelLoader> mModelLoader;
+
 		std::unique_ptr<FrameConstants> mFrameConstants;
         std::unique_ptr<FastConstantBufferAllocator> mFrameCBAllocator;
 		D3D12_GPU_VIRTUAL_ADDRESS mFrameCBAddr;
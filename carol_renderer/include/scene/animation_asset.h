@@ -0,0 +1,59 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace Carol
+{
+	class CompressedAnimationClip;
+
+	// Parents precede their children in Hierarchy, Offsets map bind space to the space of each bone
+	class Skeleton
+	{
+	public:
+		Skeleton(
+			std::span<const int> hierarchy,
+			std::span<const DirectX::XMFLOAT4X4> offsets,
+			uint64_t hash);
+
+		static uint64_t Hash(
+			std::span<const int> hierarchy,
+			std::span<const DirectX::XMFLOAT4X4> offsets);
+
+		std::vector<int> Hierarchy;
+		std::vector<DirectX::XMFLOAT4X4> Offsets;
+		uint64_t ContentHash = 0;
+	};
+
+	// Skeletons and clips are keyed by content hash and shared by every model loaded from the same rig.
+	// Models own the assets, the manager only tracks them, so an asset goes away with its last model.
+	class AnimationAssetManager
+	{
+	public:
+		AnimationAssetManager();
+		AnimationAssetManager(const AnimationAssetManager&) = delete;
+		AnimationAssetManager(AnimationAssetManager&&) = delete;
+		AnimationAssetManager& operator=(const AnimationAssetManager&) = delete;
+
+		std::shared_ptr<const Skeleton> LoadSkeleton(
+			std::span<const int> hierarchy,
+			std::span<const DirectX::XMFLOAT4X4> offsets);
+		std::shared_ptr<const CompressedAnimationClip> FindAnimationClip(uint64_t sourceHash);
+		// Returns the clip already registered under the same source hash if there is one
+		std::shared_ptr<const CompressedAnimationClip> AddAnimationClip(std::unique_ptr<CompressedAnimationClip> clip);
+
+		uint32_t GetSkeletonsCount();
+		uint32_t GetAnimationClipsCount();
+
+	protected:
+		void ReleaseExpired();
+
+		std::mutex mAssetMutex;
+		std::unordered_map<uint64_t, std::weak_ptr<const Skeleton>> mSkeletons;
+		std::unordered_map<uint64_t, std::weak_ptr<const CompressedAnimationClip>> mAnimationClips;
+	};
+}
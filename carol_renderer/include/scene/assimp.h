@@ -1,17 +1,23 @@
 #pragma once
 #include <scene/model.h>
+#include <scene/texture.h>
+#include <utils/directory_listing.h>
 #include <assimp/scene.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <span>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace Carol
 {
 	class ModelNode;
 	class HeapManager;
 	class DescriptorManager;
+	class MeshCacheWriter;
 
 	class AssimpModel : public Model
 	{
@@ -20,21 +26,39 @@ namespace Carol
 			ModelNode* rootNode,
 		    std::string_view path,
 			std::string_view textureDir,
-			bool isSkinned);
+			bool isSkinned,
+			MeshCacheWriter* cacheWriter = nullptr);
+		// Reads a scene imported elsewhere or built in memory, it is not used after construction
+		AssimpModel(
+			ModelNode* rootNode,
+			const aiScene* scene,
+			std::string_view textureDir,
+			bool isSkinned,
+			MeshCacheWriter* cacheWriter = nullptr);
 		AssimpModel(const AssimpModel&) = delete;
 		AssimpModel(AssimpModel&&) = delete;
 		AssimpModel& operator=(const AssimpModel&) = delete;
 
 	protected:
+		void ReadScene(
+			ModelNode* rootNode,
+			const aiScene* scene,
+			std::string_view textureDir,
+			bool isSkinned,
+			std::span<const std::string> dependencies);
 		void ProcessNode(
 			aiNode* node,
 			ModelNode* sceneNode,
 			const aiScene* scene);
-		Mesh* ProcessMesh(
-			aiMesh* mesh,
-			const aiScene* scene);
+		void CollectMeshes(
+			aiNode* node,
+			const aiScene* scene,
+			std::vector<aiMesh*>& meshes,
+			std::unordered_set<std::string>& meshNames);
+		void ProcessMeshes(const aiScene* scene);
 		
-		void ReadBoneHierachy(aiNode* node);
+		bool FindSkeletonNodes(const aiNode* node, const aiScene* scene, std::unordered_set<const aiNode*>& skeletonNodes);
+		void ReadBoneHierachy(aiNode* node, const std::unordered_set<const aiNode*>& skeletonNodes);
 		void ReadBoneOffsets(const aiScene* scene);
 		void ReadAnimations(const aiScene* scene);
 
@@ -43,18 +67,24 @@ namespace Carol
 			std::vector<uint32_t>& indices,
 			aiMesh* mesh);
 		void ReadMeshMaterialAndTextures(
-			Mesh* mesh,
 			aiMesh* aimesh,
-			const aiScene* scene);
+			const aiScene* scene,
+			std::span<std::string> texturePaths);
 		void ReadMeshBones(std::vector<Vertex>& vertices, aiMesh* mesh);
 		void InsertBoneWeightToVertex(Vertex& vertex, uint32_t boneIndex, float boneWeight);
 
-		void LoadTexture(
-			Mesh* mesh,
+		// Falls back to the default texture of the usage when the file is not in the texture directory
+		std::string ReadTexturePath(
 			aiString aiPath,
-			aiTextureType type);
+			TextureUsage usage);
 
 	protected:
+		// Import-time copies of the skeleton, the model keeps the shared one
+		std::vector<int> mBoneHierarchy;
+		std::vector<DirectX::XMFLOAT4X4> mBoneOffsets;
 		std::unordered_map<std::string, uint32_t> mBoneIndices;
+		MeshCacheWriter* mCacheWriter = nullptr;
+		// Listed once per import instead of probing the file system for every texture of every mesh
+		std::unique_ptr<DirectoryListing> mTexDirListing;
 	};
 }
@@ -0,0 +1,20 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <span>
+
+namespace Carol
+{
+	// Matrices are stored as 3 float4 rows of the transposed affine transform,
+	// dual quaternions as a real and a dual float4 and only hold rotation and translation
+	enum BonePaletteFormat
+	{
+		BONE_PALETTE_MATRIX,
+		BONE_PALETTE_DUAL_QUATERNION,
+		BONE_PALETTE_FORMAT_COUNT
+	};
+
+	uint32_t GetBonePaletteStride(BonePaletteFormat format);
+	bool IsRigidBonePalette(std::span<const DirectX::XMFLOAT4X4> transforms, float tolerance = 1e-3f);
+	void PackBonePalette(std::span<const DirectX::XMFLOAT4X4> transforms, BonePaletteFormat format, std::span<DirectX::XMFLOAT4> palette);
+}
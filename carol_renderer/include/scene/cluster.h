@@ -0,0 +1,67 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+#include <span>
+
+namespace Carol
+{
+	class Cluster
+	{
+	public:
+		std::vector<uint32_t> Indices;
+
+		// LodBounds/LodError describe the group this cluster was simplified from,
+		// ParentLodBounds/ParentLodError the group that simplifies this cluster.
+		// Both are monotonic along the DAG so a per-cluster test yields a crack-free cut.
+		DirectX::BoundingSphere LodBounds;
+		DirectX::BoundingSphere ParentLodBounds;
+		float LodError = 0.f;
+		float ParentLodError = FLT_MAX;
+
+		uint32_t Level = 0;
+	};
+
+	class ClusterDag
+	{
+	public:
+		ClusterDag(
+			std::span<const DirectX::XMFLOAT3> positions,
+			std::span<const uint32_t> indices,
+			uint32_t maxVertices = 64,
+			uint32_t maxPrims = 126,
+			uint32_t groupSize = 8,
+			uint32_t maxLevels = 16);
+		ClusterDag(const ClusterDag&) = delete;
+		ClusterDag(ClusterDag&&) = delete;
+		ClusterDag& operator=(const ClusterDag&) = delete;
+
+		const std::vector<Cluster>& GetClusters()const;
+		uint32_t GetLevelCount()const;
+
+	protected:
+		void SplitClusters(
+			std::span<const uint32_t> indices,
+			uint32_t level,
+			std::vector<uint32_t>& clusterIds);
+		std::vector<std::vector<uint32_t>> GroupClusters(std::span<const uint32_t> clusterIds)const;
+		void LockVertices(
+			std::span<const std::vector<uint32_t>> groups,
+			std::span<const uint32_t> rootIds);
+		bool SimplifyGroup(
+			std::span<const uint32_t> group,
+			std::vector<uint32_t>& indices,
+			float& error)const;
+
+		std::span<const DirectX::XMFLOAT3> mPositions;
+		std::vector<Cluster> mClusters;
+		std::vector<uint8_t> mLocked;
+
+		uint32_t mMaxVertices;
+		uint32_t mMaxPrims;
+		uint32_t mGroupSize;
+		uint32_t mLevelCount = 0;
+	};
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Carol
+{
+	class AnimationClip;
+	class AnimationCursor;
+	class LocalPose;
+
+	class AnimationCompressionSettings
+	{
+	public:
+		float TranslationError = 1e-3f;
+		float RotationError = 1e-3f;
+		float ScaleError = 1e-3f;
+		float BlockDuration = 1.f;
+	};
+
+	// SourceHash identifies the raw keys and the settings the clip was compressed from
+	class CompressedClipHeader
+	{
+	public:
+		uint64_t SourceHash = 0;
+		uint32_t BoneCount = 0;
+		uint32_t BlockCount = 0;
+		float StartTime = 0.f;
+		float EndTime = 0.f;
+		float BlockDuration = 1.f;
+	};
+
+	class CompressedTrackRange
+	{
+	public:
+		DirectX::XMFLOAT3 TranslationMin;
+		DirectX::XMFLOAT3 TranslationScale;
+		DirectX::XMFLOAT3 ScaleMin;
+		DirectX::XMFLOAT3 ScaleScale;
+	};
+
+	// Keys of track k = bone * 3 + { translation, rotation, scale } are [KeyOffsets[k], KeyOffsets[k + 1]).
+	// A track holds its keys inside the block plus one key on each side, so sampling never leaves the block.
+	class CompressedBlock
+	{
+	public:
+		std::span<const uint32_t> KeyOffsets;
+		std::span<const uint16_t> Times;
+		std::span<const uint16_t> Values[3];
+	};
+
+	// Key-reduced, 16-bit quantized clip laid out in time-sorted SoA blocks.
+	// Rotations use smallest-three in 48 bits, translations and scales are relative to the per-track range.
+	class CompressedAnimationClip
+	{
+	public:
+		CompressedAnimationClip(const AnimationClip& clip, const AnimationCompressionSettings& settings = {});
+		CompressedAnimationClip(std::span<const uint8_t> data);
+		CompressedAnimationClip(const CompressedAnimationClip&) = delete;
+		CompressedAnimationClip(CompressedAnimationClip&&) = delete;
+		CompressedAnimationClip& operator=(const CompressedAnimationClip&) = delete;
+
+		float GetClipStartTime()const;
+		float GetClipEndTime()const;
+		uint32_t GetBoneCount()const;
+		std::span<const uint8_t> GetData()const;
+		uint64_t GetSourceHash()const;
+
+		static uint64_t HashSource(const AnimationClip& clip, const AnimationCompressionSettings& settings = {});
+		static uint64_t ReadSourceHash(std::span<const uint8_t> data);
+
+		void Interpolate(float t, std::span<DirectX::XMFLOAT4X4> boneTransforms)const;
+		void Interpolate(float t, AnimationCursor& cursor, std::span<DirectX::XMFLOAT4X4> boneTransforms)const;
+		void Sample(float t, AnimationCursor& cursor, LocalPose& pose)const;
+
+	protected:
+		void LoadBlocks();
+
+		std::vector<uint8_t> mData;
+		CompressedClipHeader mHeader;
+		std::span<const CompressedTrackRange> mTrackRanges;
+		std::vector<CompressedBlock> mBlocks;
+	};
+}
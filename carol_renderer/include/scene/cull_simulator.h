@@ -0,0 +1,43 @@
+#pragma once
+#include <DirectXMath.h>
+#include <span>
+#include <string_view>
+
+namespace Carol
+{
+	class Camera;
+	class CullData;
+	class Mesh;
+
+	class CullStats
+	{
+	public:
+		uint32_t MeshletCount = 0;
+		uint32_t FrustumCulledCount = 0;
+		uint32_t NormalConeCulledCount = 0;
+	};
+
+	// Runs the meshlet frustum and normal cone tests of cull_as.hlsl on the CPU,
+	// used to measure how many meshlets the culling data rejects for a given view
+	class CullSimulator
+	{
+	public:
+		CullSimulator(const Camera* camera);
+		CullSimulator(DirectX::FXMMATRIX viewProj, const DirectX::XMFLOAT3& eyePos);
+
+		void Cull(const Mesh* mesh, std::string_view clipName, DirectX::FXMMATRIX world);
+		void Cull(std::span<const CullData> cullData, DirectX::FXMMATRIX world);
+		void Reset();
+
+		const CullStats& GetStats()const;
+		float GetCulledRatio()const;
+
+	protected:
+		bool FrustumCull(const CullData& cullData, DirectX::FXMMATRIX worldViewProj)const;
+		bool NormalConeCull(const CullData& cullData, DirectX::FXMMATRIX world)const;
+
+		DirectX::XMFLOAT4X4 mViewProj;
+		DirectX::XMFLOAT3 mEyePos;
+		CullStats mStats;
+	};
+}
@@ -64,6 +64,11 @@ namespace Carol
 		uint32_t NormalTextureIdx = 0;
 		uint32_t EmissiveTextureIdx = 0;
 		uint32_t MetallicRoughnessTextureIdx = 0;
+
+		uint32_t LodDataBufferIdx = 0;
+		uint32_t LodLevelCount = 0;
+		float MeshPad2;
+		float MeshPad3;
 	};
 
 	class Vertex
@@ -93,18 +98,62 @@ namespace Carol
 		DirectX::XMFLOAT3 Extent;
 		DirectX::PackedVector::XMCOLOR NormalCone;
 		float ApexOffset = 0.f;
+		DirectX::XMFLOAT4 BoundingSphere;
+	};
+
+	class ClusterLodData
+	{
+	public:
+		DirectX::XMFLOAT4 LodBounds;
+		DirectX::XMFLOAT4 ParentLodBounds;
+		float LodError = 0.f;
+		float ParentLodError = 0.f;
+		float LodPad0;
+		float LodPad1;
+	};
+
+	class BoneBounds
+	{
+	public:
+		uint32_t BoneIdx;
+		DirectX::XMFLOAT3 BoxMin;
+		DirectX::XMFLOAT3 BoxMax;
+		DirectX::XMFLOAT3 NormalBoxMin;
+		DirectX::XMFLOAT3 NormalBoxMax;
+		DirectX::XMFLOAT3 NormalCone;
+		float ConeSpread;
 	};
 
+	class ClipCullData
+	{
+	public:
+		std::string_view ClipName;
+		std::span<const CullData> MeshletCullData;
+		DirectX::BoundingBox BoundingBox;
+	};
+
+	// Constructors only cook or copy meshlets and cull data on the CPU, which is safe to run for several meshes
+	// in parallel and off the render thread. Upload then creates the GPU buffers, the vertices must stay alive until it.
 	class Mesh
 	{
 	public:
 		Mesh(
 			std::span<Vertex> vertices,
-			std::span<std::pair<std::string, std::vector<std::vector<Vertex>>>> skinnedVertices,
+			const std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>>& frameTransforms,
 			std::span<uint32_t> indices,
 			bool isSkinned,
 			bool isTransparent);
+		Mesh(
+			std::span<const Vertex> vertices,
+			std::span<const Meshlet> meshlets,
+			std::span<const ClusterLodData> lodData,
+			uint32_t lodLevelCount,
+			std::span<const ClipCullData> cullData,
+			bool isSkinned,
+			bool isTransparent);
 
+		void Upload();
+		uint64_t GetUploadSize()const;
 		uint32_t GetMeshletSize()const;
 
 		void SetDiffuseTextureIdx(uint32_t idx);
@@ -124,30 +173,40 @@ namespace Carol
 		bool IsSkinned()const;
 		bool IsTransparent()const;
 
+		std::span<const Meshlet> GetMeshlets()const;
+		std::span<const ClusterLodData> GetLodData()const;
+		std::vector<ClipCullData> GetCullData()const;
+
 	protected:
-		void LoadVertices();
+		void LoadVertices(std::span<const Vertex> vertices);
 		void LoadMeshlets();
-		void LoadCullData();
+		void LoadMeshlets(std::span<const uint32_t> indices);
+		void LoadClusterLod();
+		void LoadCullData(const std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>>& frameTransforms);
+		void LoadStaticCullData(std::string_view clipName);
+		void LoadSkinnedCullData(std::string_view clipName, std::span<const std::vector<DirectX::XMFLOAT4X4>> frameTransforms);
+		void LoadMeshletBoneBounds(const Meshlet& meshlet, std::vector<BoneBounds>& boneBounds);
+		void UploadMeshlets(std::span<const Meshlet> meshlets);
+		void UploadLodData(std::span<const ClusterLodData> lodData, uint32_t lodLevelCount);
+		void UploadCullData(std::string_view clipName, std::span<const CullData> cullData, const DirectX::BoundingBox& boundingBox);
 		void InitCullMark();
 		void ReleaseIntermediateBuffer();
 
-		void LoadMeshletBoundingBox(std::string_view clipName, std::span<std::vector<Vertex>> vertices);
-		void LoadMeshletNormalCone(std::string_view clipName, std::span<std::vector<Vertex>> vertices);
+		DirectX::BoundingBox LoadMeshBoundingBox(std::span<const CullData> cullData);
 	
-		DirectX::XMVECTOR LoadConeCenter(const Meshlet& meshlet, std::span<std::vector<Vertex>> vertices);
-		float LoadConeSpread(const Meshlet& meshlet, const DirectX::XMVECTOR& normalCone, std::span<std::vector<Vertex>> vertices);
-		float LoadConeBottomDist(const Meshlet& meshlet, const DirectX::XMVECTOR& normalCone, std::span<std::vector<Vertex>> vertices);
-		float LoadBottomRadius(const Meshlet& meshlet, const DirectX::XMVECTOR& center, const DirectX::XMVECTOR& normalCone, float tanConeSpread, std::span<std::vector<Vertex>> vertices);
+		DirectX::XMVECTOR LoadConeAxis(std::span<const DirectX::XMFLOAT3> normals);
+		float LoadConeSpread(const DirectX::XMVECTOR& normalCone, std::span<const DirectX::XMFLOAT3> normals);
 
-		std::span<Vertex> mVertices;
-		std::span<std::pair<std::string, std::vector<std::vector<Vertex>>>> mSkinnedVertices;
-		std::span<uint32_t> mIndices;
+		std::span<const Vertex> mVertices;
+		std::span<const uint32_t> mIndices;
 
 		std::vector<Meshlet> mMeshlets;
+		std::vector<ClusterLodData> mLodData;
 		std::unordered_map<std::string, std::vector<CullData>> mCullData;
 
 		std::unique_ptr<StructuredBuffer> mVertexBuffer;
 		std::unique_ptr<StructuredBuffer> mMeshletBuffer;
+		std::unique_ptr<StructuredBuffer> mLodDataBuffer;
 		std::unordered_map<std::string, std::unique_ptr<StructuredBuffer>> mCullDataBuffer;
 
 		std::unique_ptr<RawBuffer> mMeshletFrustumCulledMarkBuffer;
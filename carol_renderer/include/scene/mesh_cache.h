@@ -0,0 +1,87 @@
+#pragma once
+#include <scene/model.h>
+#include <utils/binary.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <span>
+#include <unordered_map>
+
+namespace Carol
+{
+	class MappedFile;
+	class Mesh;
+	class CompressedAnimationClip;
+
+	// Bump whenever the layout of the cache or of any serialized class changes
+	constexpr uint32_t MESH_CACHE_MAGIC = 0x48534d43;
+	constexpr uint32_t MESH_CACHE_VERSION = 8;
+
+	class MeshCacheHeader
+	{
+	public:
+		uint32_t Magic = MESH_CACHE_MAGIC;
+		uint32_t Version = MESH_CACHE_VERSION;
+		uint64_t SourceHash = 0;
+		uint32_t Skinned = 0;
+		uint32_t MeshCount = 0;
+	};
+
+	uint64_t GetMeshCacheKey(
+		std::string_view path,
+		std::string_view textureDir,
+		bool isSkinned);
+	std::string GetMeshCachePath(uint64_t key);
+	bool IsMeshCacheValid(std::span<const uint8_t> data, uint64_t key);
+	// Whether the files the import read besides the source, such as glTF buffers or OBJ materials, still hold
+	// the content the cache was written from. Packages skip it since they ship without their sources.
+	bool IsMeshCacheCurrent(std::span<const uint8_t> data);
+
+	class MeshCacheWriter
+	{
+	public:
+		MeshCacheWriter(uint64_t key, bool isSkinned);
+		MeshCacheWriter(const MeshCacheWriter&) = delete;
+		MeshCacheWriter(MeshCacheWriter&&) = delete;
+		MeshCacheWriter& operator=(const MeshCacheWriter&) = delete;
+
+		// Comes first after the header
+		void WriteDependencies(std::span<const std::string> paths);
+		void WriteSkeleton(
+			std::span<const int> boneHierarchy,
+			std::span<const DirectX::XMFLOAT4X4> boneOffsets);
+		void WriteAnimationClips(const std::unordered_map<std::string, std::shared_ptr<const CompressedAnimationClip>>& animationClips);
+		void WriteMesh(
+			std::string_view name,
+			std::span<const Vertex> vertices,
+			const Mesh* mesh,
+			std::span<const std::string> texturePaths);
+		void WriteNodeMesh(const Mesh* mesh);
+
+		bool Save(std::string_view path);
+
+	protected:
+		BinaryWriter mWriter;
+		std::unordered_map<const Mesh*, uint32_t> mMeshIndices;
+		std::vector<uint32_t> mNodeMeshes;
+	};
+
+	// Vertices are read in place, data has to outlive the uploads of the model.
+	// A cache with a valid header can still be truncated or corrupt, the model is invalid then and adds no meshes to rootNode.
+	// So do meshlets indexing past their vertices and LOD or cull data that does not cover every meshlet.
+	class CachedModel : public Model
+	{
+	public:
+		CachedModel(
+			ModelNode* rootNode,
+			std::span<const uint8_t> data);
+		CachedModel(const CachedModel&) = delete;
+		CachedModel(CachedModel&&) = delete;
+		CachedModel& operator=(const CachedModel&) = delete;
+
+		bool IsValid()const;
+
+	protected:
+		bool mValid = false;
+	};
+}
@@ -1,5 +1,7 @@
 #pragma once
+#include <scene/bone_palette.h>
 #include <scene/mesh.h>
+#include <scene/texture.h>
 #include <utils/d3dx12.h>
 #include <DirectXMath.h>
 #include <DirectXCollision.h>
@@ -13,7 +15,11 @@
 
 namespace Carol
 {
-	class AnimationClip;
+	class AnimationCursor;
+	class CompressedAnimationClip;
+	class MappedFile;
+	class Skeleton;
+	class Texture;
 	class TextureManager;
 	class Timer;
 	class Mesh;
@@ -21,11 +27,85 @@ namespace Carol
 	class StructuredBuffer;
 	class FrameBufferAllocator;
 	
+	// Bone palettes live in a structured buffer shared by all skinned models of the frame
 	class SkinnedConstants
 	{
 	public:
-		DirectX::XMFLOAT4X4 FinalTransforms[256] = {};
-		DirectX::XMFLOAT4X4 HistFinalTransforms[256] = {};
+		uint32_t BonePaletteBufferIdx = 0;
+		uint32_t BonePaletteOffset = 0;
+		uint32_t HistBonePaletteOffset = 0;
+		uint32_t BonePaletteFormat = BONE_PALETTE_MATRIX;
+	};
+
+	// Screen height fractions below which poses are evaluated every 2nd, every 4th frame or frozen,
+	// and the number of bones evaluated per frame over all models
+	class AnimationLodSettings
+	{
+	public:
+		float HalfRateScreenSize = 0.2f;
+		float QuarterRateScreenSize = 0.08f;
+		float FrozenScreenSize = 0.01f;
+		uint32_t BoneBudget = 16384;
+	};
+
+	// Intervals are halved until joint positions deviate from their linear reconstruction by less than
+	// Tolerance times the bind skeleton radius, or until they reach MinInterval
+	class PoseSamplingSettings
+	{
+	public:
+		float Tolerance = 1e-2f;
+		float MinInterval = 1.f / 60.f;
+		float MaxInterval = 0.5f;
+	};
+
+	// MaxDeviation is the largest joint distance from the linear reconstruction at accepted interval midpoints
+	class PoseSamplingStats
+	{
+	public:
+		uint32_t SampleCount = 0;
+		float MaxDeviation = 0.f;
+	};
+
+	enum AnimationLayerMode
+	{
+		ANIMATION_LAYER_OVERRIDE,
+		ANIMATION_LAYER_ADDITIVE,
+		ANIMATION_LAYER_MODE_COUNT
+	};
+
+	// Weights move towards TargetWeight by FadeSpeed per second. Override layers blend over the layers below,
+	// additive layers add their difference from ReferencePose, the first frame of their clip.
+	class AnimationLayer
+	{
+	public:
+		std::string ClipName;
+		const CompressedAnimationClip* Clip = nullptr;
+		AnimationLayerMode Mode = ANIMATION_LAYER_OVERRIDE;
+		float TimePos = 0.f;
+		float Weight = 1.f;
+		float TargetWeight = 1.f;
+		float FadeSpeed = 0.f;
+		std::vector<float> ReferencePose;
+		std::unique_ptr<AnimationCursor> Cursor;
+	};
+
+	// A single texture when Target is null, a mesh and the textures it samples otherwise, in the order
+	// diffuse, normal, emissive, metallic roughness. Vertices owns the vertices of imported meshes until the upload,
+	// cached meshes read them from the cache file.
+	class ModelUpload
+	{
+	public:
+		Mesh* Target = nullptr;
+		Texture* Textures[4] = {};
+		std::vector<Vertex> Vertices;
+	};
+
+	// Models acquire their textures in linear color space under the usage of the slot sampling them
+	class ModelTexture
+	{
+	public:
+		std::string Path;
+		TextureUsage Usage = TEXTURE_USAGE_UNKNOWN;
 	};
 
 	class ModelNode
@@ -50,39 +130,95 @@ namespace Carol
 		const Mesh* GetMesh(std::string_view meshName)const;
 		const std::unordered_map<std::string, std::unique_ptr<Mesh>>& GetMeshes()const;
 
+		// Models are built without touching the GPU and decode their textures on the thread pool, one task per texture.
+		// Each upload then creates one texture or one mesh.
+		void DecodeTextures();
+		uint32_t GetUploadCount()const;
+		uint64_t GetUploadSize(uint32_t idx)const;
+		void Upload(uint32_t idx);
+		// Textures the model holds a reference to, once for every mesh sampling them
+		std::span<const ModelTexture> GetTextures()const;
+
 		std::vector<std::string_view> GetAnimationClips()const;
-		void SetAnimationClip(std::string_view clipName);
+		void SetAnimationClip(std::string_view clipName, float fadeDuration = 0.f);
+		void SetAdditiveClip(std::string_view clipName, float weight, float fadeDuration = 0.f);
 
-		const SkinnedConstants* GetSkinnedConstants()const;
+		std::span<const DirectX::XMFLOAT4> GetBonePalette()const;
+		BonePaletteFormat GetBonePaletteFormat()const;
+		void SetBonePaletteFormat(BonePaletteFormat format);
 		void SetMeshCBAddress(std::string_view meshName, D3D12_GPU_VIRTUAL_ADDRESS addr);
 		void SetSkinnedCBAddress(D3D12_GPU_VIRTUAL_ADDRESS addr);
 
+		float GetScreenSize(const Camera* camera)const;
+		// Requests the mips each mesh needs from the texture streamer and refreshes the texture indices
+		void UpdateTextures(const Camera* camera);
+		uint32_t GetBoneCount()const;
+		const Skeleton* GetSkeleton()const;
+		uint32_t GetFramesSinceEvaluation()const;
+		bool IsPoseDue()const;
+		void SetAnimationUpdatePeriod(uint32_t period);
+		void DeferPoseEvaluation();
+
 		void Update(Timer* timer);
-		void GetFinalTransforms(std::string_view clipName, float t, std::vector<DirectX::XMFLOAT4X4>& toRootTransforms);
-		void GetSkinnedVertices(std::string_view clipName, std::span<Vertex> vertices, std::vector<std::vector<Vertex>>& skinnedVertices)const;
+		void GetFinalTransforms(const CompressedAnimationClip* clip, float t, AnimationCursor& cursor, std::span<DirectX::XMFLOAT4X4> finalTransforms)const;
+		PoseSamplingStats SamplePoses(
+			const CompressedAnimationClip* clip,
+			const PoseSamplingSettings& settings,
+			std::vector<std::vector<DirectX::XMFLOAT4X4>>& frameTransforms)const;
+		const PoseSamplingStats* GetPoseSamplingStats(std::string_view clipName)const;
 
 	protected:
+		void AdvanceAnimationLayers(float deltaTime);
+		void EvaluatePose(float lookahead, std::span<DirectX::XMFLOAT4X4> finalTransforms);
+		void ResolveBoneHierarchy(std::span<const DirectX::XMFLOAT4X4> toParentTransforms, std::span<DirectX::XMFLOAT4X4> finalTransforms)const;
+		void AddMeshUpload(Mesh* mesh, std::span<const std::string> texturePaths, std::vector<Vertex> vertices = {});
+
 		std::string mModelName;
 		std::string mTexDir;
 		std::unordered_map<std::string, std::unique_ptr<Mesh>> mMeshes;
 
-		std::vector<Vertex> mVertices;
-		std::vector<uint32_t> mIndices;
-
 		bool mSkinned = false;
-		float mTimePos = 0.f;
-		std::string mClipName;
+		// Override layers come first, the first of them is the base pose
+		std::vector<AnimationLayer> mAnimationLayers;
 
-		std::vector<int> mBoneHierarchy;
-		std::vector<DirectX::XMFLOAT4X4> mBoneOffsets;
-
-		std::unordered_map<std::string, std::unique_ptr<AnimationClip>> mAnimationClips;
+		// Shared with every model loaded from the same rig
+		std::shared_ptr<const Skeleton> mSkeleton;
+		std::unordered_map<std::string, std::shared_ptr<const CompressedAnimationClip>> mAnimationClips;
 		std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>> mFrameTransforms;
-		std::unique_ptr<SkinnedConstants> mSkinnedConstants;
+		std::unordered_map<std::string, PoseSamplingStats> mPoseSamplingStats;
+		// Poses between evaluations are interpolated from the displayed pose towards one sampled ahead,
+		// a period of 0 freezes the pose
+		uint32_t mAnimationUpdatePeriod = 1;
+		uint32_t mFramesSinceEvaluation = 0;
+		bool mPoseEvaluationDeferred = false;
+		std::vector<DirectX::XMFLOAT4X4> mKeyPoses[2];
+
+		std::vector<DirectX::XMFLOAT4X4> mFinalTransforms;
+		std::vector<DirectX::XMFLOAT4X4> mHistFinalTransforms;
+		std::vector<DirectX::XMFLOAT4> mBonePalette;
+		BonePaletteFormat mBonePaletteFormat = BONE_PALETTE_MATRIX;
+		BonePaletteFormat mPackedBonePaletteFormat = BONE_PALETTE_MATRIX;
 
-		std::vector<std::string> mTexturePath;
+		std::vector<ModelUpload> mUploads;
+		std::vector<ModelTexture> mTextures;
 	};
 
+	// Reads the model from the mesh cache if it is valid and imports it otherwise, safe to call from loading threads.
+	// Vertices of cached models stay in the cache file, which must outlive the uploads.
+	std::unique_ptr<Model> ImportModel(
+		ModelNode* rootNode,
+		std::string_view path,
+		std::string_view textureDir,
+		bool isSkinned,
+		std::unique_ptr<MappedFile>& cacheFile);
+
+	// Sets the update period of each skinned model from its screen size, then defers the pose evaluations past the bone budget.
+	// Requests is scratch memory kept by the caller across frames.
+	void ScheduleAnimations(
+		std::span<const std::pair<float, Model*>> models,
+		const AnimationLodSettings& settings,
+		std::vector<std::pair<float, Model*>>& requests);
+
 	class ModelManager
 	{
 	public:
@@ -102,14 +238,19 @@ namespace Carol
 			std::string_view path,
 			std::string_view textureDir,
 			bool isSkinned);
+		// Registers a model whose uploads have completed, the node carries its name and world transform
+		void AddModel(std::unique_ptr<ModelNode> node, std::unique_ptr<Model> model);
 		void UnloadModel(std::string_view modelName);
 
 		uint32_t GetMeshesCount(MeshType type)const;
 		uint32_t GetModelsCount()const;
 
 		void SetWorld(std::string_view modelName, DirectX::XMMATRIX world);
-		void SetAnimationClip(std::string_view modelName, std::string_view clipName);
-		void Update(Timer* timer, uint64_t cpuFenceValue, uint64_t completedFenceValue);
+		void SetAnimationClip(std::string_view modelName, std::string_view clipName, float fadeDuration = 0.f);
+		void SetAdditiveClip(std::string_view modelName, std::string_view clipName, float weight, float fadeDuration = 0.f);
+		void SetBonePaletteFormat(BonePaletteFormat format);
+		void SetAnimationLodSettings(const AnimationLodSettings& settings);
+		void Update(Timer* timer, const Camera* camera, uint64_t cpuFenceValue, uint64_t completedFenceValue);
 
 		uint32_t GetMeshBufferIdx(MeshType type)const;
 		uint32_t GetCommandBufferIdx(MeshType type)const;
@@ -119,26 +260,34 @@ namespace Carol
 
 	protected:
 		void ProcessNode(ModelNode* node, DirectX::XMMATRIX parentToRoot);
+		void ScheduleAnimations(const Camera* camera);
 		void InitBuffers();
 	
 		std::unique_ptr<ModelNode> mRootNode;
 
 		std::unordered_map<std::string, std::unique_ptr<Model>> mModels;
+		std::vector<Model*> mUpdateModels;
+		std::vector<std::pair<float, Model*>> mAnimatedModels;
+		std::vector<std::pair<float, Model*>> mPoseRequests;
+		AnimationLodSettings mAnimationLodSettings;
 		std::vector<std::unordered_map<std::string, Mesh*>> mMeshes;
 
 		std::vector<std::unique_ptr<StructuredBuffer>> mIndirectCommandBuffer;
 		std::vector<std::unique_ptr<StructuredBuffer>> mMeshBuffer;
 		std::unique_ptr<StructuredBuffer> mSkinnedBuffer;
+		std::unique_ptr<StructuredBuffer> mBonePaletteBuffer;
 
 		std::unique_ptr<FrameBufferAllocator> mIndirectCommandBufferAllocator;
 		std::unique_ptr<FrameBufferAllocator> mMeshBufferAllocator;
 		std::unique_ptr<FrameBufferAllocator> mSkinnedBufferAllocator;
+		std::unique_ptr<FrameBufferAllocator> mBonePaletteBufferAllocator;
 
 		std::vector<std::unique_ptr<RawBuffer>> mInstanceFrustumCulledMarkBuffer;
 		std::vector<std::unique_ptr<RawBuffer>> mInstanceOcclusionCulledMarkBuffer;
 		std::vector<std::unique_ptr<RawBuffer>> mInstanceCulledMarkBuffer;
 
 		uint32_t mMeshStartOffset[MESH_TYPE_COUNT];
+		BonePaletteFormat mBonePaletteFormat = BONE_PALETTE_MATRIX;
 	};
 
 }
@@ -0,0 +1,90 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Carol
+{
+	class MappedFile;
+	class Model;
+	class ModelNode;
+	class ScenePackage;
+
+	// Where the loader sends uploads and finished models, the renderer records them on the GPU
+	class ModelUploader
+	{
+	public:
+		virtual ~ModelUploader();
+
+		virtual void Upload(Model* model, uint32_t idx) = 0;
+		virtual void AddModel(std::unique_ptr<ModelNode> node, std::unique_ptr<Model> model) = 0;
+	};
+
+	class GpuModelUploader : public ModelUploader
+	{
+	public:
+		virtual void Upload(Model* model, uint32_t idx)override;
+		virtual void AddModel(std::unique_ptr<ModelNode> node, std::unique_ptr<Model> model)override;
+	};
+
+	class ModelLoadJob
+	{
+	public:
+		std::string Path;
+		std::string TextureDir;
+		bool Skinned = false;
+
+		std::unique_ptr<ModelNode> Node;
+		std::unique_ptr<Model> ImportedModel;
+		std::unique_ptr<MappedFile> CacheFile;
+		std::shared_ptr<const ScenePackage> Package;
+
+		std::future<void> Import;
+		bool ImportDone = false;
+		bool Failed = false;
+		uint32_t NextUpload = 0;
+		// Fence value the last upload completes at, 0 while uploads are pending
+		uint64_t UploadFenceValue = 0;
+		std::promise<void> Loaded;
+	};
+
+	// Imports models on the thread pool and streams their meshes and textures to the GPU within a per-frame byte budget.
+	// A model is only handed to the uploader once the GPU has finished its last upload, so it never draws partially.
+	class ModelLoader
+	{
+	public:
+		ModelLoader(
+			std::unique_ptr<ModelUploader> uploader,
+			uint64_t uploadBudget = 32 << 20);
+		ModelLoader(const ModelLoader&) = delete;
+		ModelLoader(ModelLoader&&) = delete;
+		ModelLoader& operator=(const ModelLoader&) = delete;
+		~ModelLoader();
+
+		std::future<void> LoadModel(
+			std::string_view name,
+			std::string_view path,
+			std::string_view textureDir,
+			DirectX::XMMATRIX world,
+			bool isSkinned);
+		// Loads every model of the package like LoadModel, their meshes and textures are read from the package in place
+		std::vector<std::future<void>> LoadScene(std::shared_ptr<const ScenePackage> package);
+
+		// Called while the command list of the frame ending at cpuFenceValue + 1 is recording, returns the uploaded bytes
+		uint64_t Upload(uint64_t cpuFenceValue);
+		void Update(uint64_t completedFenceValue);
+
+		uint32_t GetPendingCount()const;
+		void SetUploadBudget(uint64_t uploadBudget);
+
+	protected:
+		std::unique_ptr<ModelUploader> mUploader;
+		std::deque<std::unique_ptr<ModelLoadJob>> mJobs;
+		uint64_t mUploadBudget;
+	};
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <span>
+
+namespace Carol
+{
+	class FrameArena;
+
+	enum PoseChannel
+	{
+		POSE_TRANSLATION_X, POSE_TRANSLATION_Y, POSE_TRANSLATION_Z,
+		POSE_ROTATION_X, POSE_ROTATION_Y, POSE_ROTATION_Z, POSE_ROTATION_W,
+		POSE_SCALE_X, POSE_SCALE_Y, POSE_SCALE_Z,
+		POSE_CHANNEL_COUNT
+	};
+
+	// Local bone transforms in SoA over storage owned elsewhere, every channel is padded to a multiple of 4 bones.
+	// Poses built during evaluation take their storage from the frame arena of the evaluating thread.
+	class LocalPose
+	{
+	public:
+		LocalPose(std::span<float> data, uint32_t boneCount);
+		LocalPose(FrameArena& arena, uint32_t boneCount);
+
+		static uint32_t GetSize(uint32_t boneCount);
+
+		uint32_t BoneCount = 0;
+		uint32_t PaddedCount = 0;
+		float* Channels[POSE_CHANNEL_COUNT] = {};
+	};
+
+	// Results may alias the first pose. Rotations are nlerped along the shorter arc.
+	void BlendPoses(const LocalPose& pose0, const LocalPose& pose1, float weight, LocalPose& result);
+	// Adds the difference between additive and reference on top of base, weighted by weight
+	void AddPose(const LocalPose& base, const LocalPose& additive, const LocalPose& reference, float weight, LocalPose& result);
+	void BuildLocalTransforms(const LocalPose& pose, std::span<DirectX::XMFLOAT4X4> transforms);
+}
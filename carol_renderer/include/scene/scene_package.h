@@ -0,0 +1,130 @@
+#pragma once
+#include <scene/texture.h>
+#include <utils/binary.h>
+#include <utils/mapped_file.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Carol
+{
+	constexpr uint32_t SCENE_PACKAGE_MAGIC = 0x4e435343;
+	constexpr uint32_t SCENE_PACKAGE_VERSION = 1;
+	// The default placement alignment of D3D12 heaps, a blob never shares a page with its neighbours
+	constexpr uint64_t SCENE_PACKAGE_ALIGNMENT = 64 << 10;
+
+	enum ScenePackageBlobType
+	{
+		SCENE_BLOB_INDEX,
+		SCENE_BLOB_MODEL,
+		SCENE_BLOB_TEXTURE,
+		SCENE_BLOB_TYPE_COUNT
+	};
+
+	class ScenePackageHeader
+	{
+	public:
+		uint32_t Magic = SCENE_PACKAGE_MAGIC;
+		uint32_t Version = SCENE_PACKAGE_VERSION;
+		uint32_t BlobCount = 0;
+		uint32_t Reserved = 0;
+	};
+
+	// Key is the mesh cache key of a model and the texture cache key of a texture.
+	// Offsets are from the start of the file and aligned to SCENE_PACKAGE_ALIGNMENT.
+	class ScenePackageBlob
+	{
+	public:
+		uint32_t Type = SCENE_BLOB_INDEX;
+		uint32_t Reserved = 0;
+		uint64_t Key = 0;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+	};
+
+	// Data is a model in the mesh cache format, it is drawn under the root with the World transform
+	class ScenePackageModel
+	{
+	public:
+		std::string_view Name;
+		DirectX::XMFLOAT4X4 World;
+		std::span<const uint8_t> Data;
+	};
+
+	// Data is the cooked DDS of the source at Path, shared by every path whose source has the same content
+	class ScenePackageTexture
+	{
+	public:
+		std::string_view Path;
+		uint64_t ContentHash = 0;
+		TextureUsage Usage = TEXTURE_USAGE_UNKNOWN;
+		std::span<const uint8_t> Data;
+	};
+
+	// Blobs are written in the order they are added. The cooker adds the new textures of a model ahead of the model,
+	// which is the order the loader reads them in, so a load streams through the file once.
+	class ScenePackageWriter
+	{
+	public:
+		ScenePackageWriter();
+		ScenePackageWriter(const ScenePackageWriter&) = delete;
+		ScenePackageWriter(ScenePackageWriter&&) = delete;
+		ScenePackageWriter& operator=(const ScenePackageWriter&) = delete;
+
+		// Instances of a model share its blob and only add their names and transforms
+		void AddModel(
+			std::string_view name,
+			const DirectX::XMFLOAT4X4& world,
+			uint64_t meshCacheKey,
+			std::string_view meshCachePath);
+		// Paths whose texture is already in the package only add an index entry
+		void AddTexture(
+			std::string_view path,
+			uint64_t contentHash,
+			TextureUsage usage,
+			std::string_view textureCachePath);
+
+		uint32_t GetModelCount()const;
+		uint32_t GetTextureCount()const;
+		// Blobs are copied from their files one after another, the package is never held in memory whole
+		bool Save(std::string_view path);
+
+	protected:
+		uint32_t AddBlob(ScenePackageBlobType type, uint64_t key, std::string_view sourcePath);
+
+		std::vector<ScenePackageBlob> mBlobs;
+		std::vector<std::string> mSourcePaths;
+		BinaryWriter mModels;
+		BinaryWriter mTextures;
+		uint32_t mModelCount = 0;
+		uint32_t mTextureCount = 0;
+		std::unordered_map<uint64_t, uint32_t> mModelBlobs;
+		std::unordered_map<uint64_t, uint32_t> mTextureBlobs;
+	};
+
+	// Maps the package for its lifetime, models and textures are views into the mapping
+	class ScenePackage
+	{
+	public:
+		ScenePackage(std::string_view path);
+		ScenePackage(const ScenePackage&) = delete;
+		ScenePackage(ScenePackage&&) = delete;
+		ScenePackage& operator=(const ScenePackage&) = delete;
+
+		bool IsValid()const;
+		std::span<const ScenePackageModel> GetModels()const;
+		std::span<const ScenePackageTexture> GetTextures()const;
+
+	protected:
+		bool ReadIndex(std::span<const ScenePackageBlob> blobs);
+
+		MappedFile mFile;
+		std::vector<ScenePackageModel> mModels;
+		std::vector<ScenePackageTexture> mTextures;
+		bool mValid = false;
+	};
+}
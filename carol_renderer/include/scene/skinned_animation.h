@@ -29,6 +29,21 @@ namespace Carol
 		DirectX::XMFLOAT4 RotationQuat;
 	};
 
+	class BoneAnimationCursor
+	{
+	public:
+		uint32_t TranslationIdx = 0;
+		uint32_t ScaleIdx = 0;
+		uint32_t RotationQuatIdx = 0;
+	};
+
+	// Remembers the last keyframe segment of every bone for one playback
+	class AnimationCursor
+	{
+	public:
+		std::vector<BoneAnimationCursor> BoneCursors;
+	};
+
 	class BoneAnimation
 	{
 	public:
@@ -40,6 +55,11 @@ namespace Carol
 		DirectX::XMVECTOR InterpolateQuat(float t) const;
 		void Interpolate(float t, DirectX::XMFLOAT4X4& M)const;
 
+		DirectX::XMVECTOR InterpolateTranslation(float t, uint32_t& cursor) const;
+		DirectX::XMVECTOR InterpolateScale(float t, uint32_t& cursor) const;
+		DirectX::XMVECTOR InterpolateQuat(float t, uint32_t& cursor) const;
+		void Interpolate(float t, BoneAnimationCursor& cursor, DirectX::XMFLOAT4X4& M)const;
+
 		std::vector<TranslationKeyframe> TranslationKeyframes;
 		std::vector<ScaleKeyframe> ScaleKeyframes;
 		std::vector<RotationQuatKeyframe> RotationQuatKeyframes;
@@ -54,6 +74,7 @@ namespace Carol
 		float GetClipEndTime();
 
 		void Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
+		void Interpolate(float t, AnimationCursor& cursor, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)const;
 		std::vector<BoneAnimation> BoneAnimations; 	
 
 	private:
@@ -1,23 +1,63 @@
 #pragma once
+#include <scene/texture_streamer.h>
 #include <utils/d3dx12.h>
 #include <wrl/client.h>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <unordered_map>
 #include <string>
 #include <string_view>
+#include <vector>
+
+namespace DirectX
+{
+	class ScratchImage;
+}
 
 namespace Carol
 {
 	class ColorBuffer;
 	class Heap;
 	class DescriptorManager;
+	class ScenePackage;
+
+	// In the order of the texture indices of a mesh, textures of unknown usage are not cooked
+	enum TextureUsage
+	{
+		TEXTURE_USAGE_DIFFUSE,
+		TEXTURE_USAGE_NORMAL,
+		TEXTURE_USAGE_EMISSIVE,
+		TEXTURE_USAGE_METALLIC_ROUGHNESS,
+		TEXTURE_USAGE_UNKNOWN
+	};
+
+	// Sampled by meshes whose material lacks the texture of a usage
+	std::string_view GetDefaultTexturePath(TextureUsage usage);
 	
+	// Textures are decoded once on whichever thread asks first and keep the decoded image
+	// until they are uploaded on the render thread. Textures of a known usage are decoded from
+	// their cooked copy in the texture cache, which is cooked on the first load.
+	// Those are also streamed, they upload their mip tail first and keep the image to upload finer mips from.
 	class Texture
 	{
 	public:
 		Texture(
 			std::string_view fileName,
-			bool isSrgb);
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN,
+			uint64_t contentHash = 0);
+		~Texture();
+
+		void Decode();
+		uint64_t GetUploadSize()const;
+		bool IsUploaded()const;
+		void Upload();
+
+		// The first mip uploaded with the texture, 0 if the texture is not streamed
+		uint32_t GetTailMip()const;
+		void UploadMips(uint32_t mostDetailedMip);
+		void CommitMips();
 
 		uint32_t GetGpuSrvIdx(uint32_t planeSlice = 0);
 		void ReleaseIntermediateBuffer();
@@ -26,10 +66,38 @@ namespace Carol
 		void AddRef();
 		void DecRef();
 	
+		std::string mFileName;
+		std::once_flag mDecodeFlag;
+		std::unique_ptr<DirectX::ScratchImage> mImage;
 		std::unique_ptr<ColorBuffer> mTexture;
+		std::unique_ptr<ColorBuffer> mPendingTexture;
+		bool mSrgb;
+		TextureUsage mUsage;
+		uint64_t mContentHash;
+		uint32_t mStreamingIdx;
 		uint32_t mNumRef;
+
+	protected:
+		std::unique_ptr<ColorBuffer> CreateColorBuffer(uint32_t mostDetailedMip);
 	};
 
+	class GpuTextureStreamingUploader : public TextureStreamingUploader
+	{
+	public:
+		virtual void Upload(uint32_t idx, uint32_t mostDetailedMip)override;
+		virtual void Commit(uint32_t idx)override;
+	};
+
+	class TexturePath
+	{
+	public:
+		uint64_t Key = 0;
+		uint32_t NumRef = 0;
+	};
+
+	// Textures are keyed by the hash of their source bytes, so copies of a file under other paths share one texture.
+	// Paths remember their key while they are referenced and are hashed only on their first load. A path is loaded
+	// once for every usage and color space it is acquired with, as those pick the cooked format.
 	class TextureManager
 	{
 	public:
@@ -37,12 +105,67 @@ namespace Carol
 
 		uint32_t LoadTexture(
 			std::string_view fileName,
-			bool isSrgb);
-		void UnloadTexture(std::string_view fileName);
-		void ReleaseIntermediateBuffers(std::string_view fileName);
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		// Safe to call from loading threads, the texture still has to be uploaded before it is sampled
+		Texture* DecodeTexture(
+			std::string_view fileName,
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		// Takes a reference without decoding, DecodeTextures then decodes a batch on the thread pool
+		Texture* AcquireTexture(
+			std::string_view fileName,
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		void DecodeTextures(std::span<Texture* const> textures);
+		void UnloadTexture(
+			std::string_view fileName,
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		// The texture a path is loaded as without taking a reference, nullptr if the path is not loaded
+		Texture* FindTexture(
+			std::string_view fileName,
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		void ReleaseIntermediateBuffers(
+			std::string_view fileName,
+			bool isSrgb,
+			TextureUsage usage = TEXTURE_USAGE_UNKNOWN);
+		// Loaded once at startup and held until the manager is destroyed
+		void LoadDefaultTextures();
+		// Source bytes of files found to duplicate a texture already loaded from another path
+		uint64_t GetDuplicateBytes()const;
+		// Paths of the package resolve to its cooked textures without reading their sources, the package is held
+		// as long as the manager
+		void AddScenePackage(std::shared_ptr<const ScenePackage> package);
+		// The cooked DDS of a package texture by texture cache key, empty if no package holds it
+		std::span<const uint8_t> GetPackagedTexture(uint64_t key);
+
+		// Streaming runs on the render thread. Meshes request the mips their textures need to cover screenSize,
+		// a fraction of the screen height as returned by Model::GetScreenSize, and pick up new indices every frame.
+		uint32_t AddStreamedTexture(Texture* texture);
+		Texture* GetStreamedTexture(uint32_t idx)const;
+		void RequestTextureMips(Texture* texture, float screenSize);
+		uint64_t Upload(uint64_t cpuFenceValue);
+		void Update(uint64_t completedFenceValue);
+		const TextureStreamingSettings& GetStreamingSettings()const;
+		void SetStreamingSettings(const TextureStreamingSettings& settings);
+		void SetScreenHeight(uint32_t height);
 
 	protected:
-		std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
+		std::mutex mTextureMutex;
+		std::unordered_map<std::string, TexturePath> mPaths;
+		std::unordered_map<uint64_t, std::unique_ptr<Texture>> mTextures;
+		uint64_t mDuplicateBytes = 0;
+
+		std::vector<std::shared_ptr<const ScenePackage>> mScenePackages;
+		std::unordered_map<std::string, uint64_t> mPackagedContentHashes;
+		std::unordered_map<uint64_t, std::span<const uint8_t>> mPackagedTextures;
+
+		TextureStreamingSettings mStreamingSettings;
+		std::unique_ptr<TextureStreamer> mStreamer;
+		std::vector<Texture*> mStreamedTextures;
+		uint32_t mScreenHeight = 1080;
 	};
 }
 
@@ -0,0 +1,40 @@
+#pragma once
+#include <scene/texture.h>
+#include <utils/mip_chain.h>
+#include <DirectXTex.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Carol
+{
+	// Bump whenever the cooking of any usage changes
+	constexpr uint32_t TEXTURE_CACHE_VERSION = 2;
+
+	// Levels whose top is not a multiple of 4 texels cannot be block compressed and use UncompressedFormat.
+	// Metallic roughness is packed into red and green so that it fits BC5, the shaders read it from there.
+	class TextureCookSettings
+	{
+	public:
+		DXGI_FORMAT Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		DXGI_FORMAT UncompressedFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+		uint32_t CompressFlags = DirectX::TEX_COMPRESS_DEFAULT;
+		uint32_t MipFilterType = MIP_FILTER_BOX;
+		uint32_t MipContentType = MIP_CONTENT_LINEAR;
+		uint32_t KeepCompressedSource = false;
+		uint32_t PackMetallicRoughness = false;
+	};
+
+	TextureCookSettings GetTextureCookSettings(TextureUsage usage);
+	// Hash of the source bytes, 0 if the file cannot be read
+	uint64_t GetTextureContentHash(std::string_view path, uint64_t* byteSize = nullptr);
+	uint64_t GetTextureCacheKey(uint64_t contentHash, TextureUsage usage);
+	std::string GetTextureCachePath(uint64_t key);
+	bool SaveTextureCache(const DirectX::ScratchImage& image, std::string_view path);
+
+	// Generates the mip chain and compresses every level in strips on the thread pool
+	HRESULT CookTexture(
+		const DirectX::ScratchImage& source,
+		TextureUsage usage,
+		DirectX::ScratchImage& cooked);
+}
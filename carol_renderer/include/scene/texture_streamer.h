@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Carol
+{
+	// MemoryBudget bounds the mips of every streamed texture, tails included. UploadBudget bounds the bytes
+	// recorded in one frame. Mips whose larger side is at most TailSize stay resident for the lifetime of a texture.
+	class TextureStreamingSettings
+	{
+	public:
+		uint64_t MemoryBudget = 512 << 20;
+		uint64_t UploadBudget = 16 << 20;
+		uint32_t TailSize = 64;
+	};
+
+	// Where the streamer sends its decisions. Both calls are made on the render thread.
+	class TextureStreamingUploader
+	{
+	public:
+		virtual ~TextureStreamingUploader();
+
+		// Records the upload of the mips from mostDetailedMip down into a new resource, which is not sampled until Commit
+		virtual void Upload(uint32_t idx, uint32_t mostDetailedMip) = 0;
+		// The upload has completed on the GPU, the texture switches to its new mips and releases the old ones
+		virtual void Commit(uint32_t idx) = 0;
+	};
+
+	// Resident and pending ranges run from the mip down to the last one, Sizes[mip] is the size of such a range
+	class StreamedTexture
+	{
+	public:
+		std::vector<uint64_t> Sizes;
+		uint32_t TailMip = 0;
+		uint32_t ResidentMip = 0;
+		uint32_t PendingMip = 0;
+		uint64_t PendingFenceValue = 0;
+		uint32_t RequestedMip = 0;
+		uint64_t LastRequestFrame = 0;
+		bool Active = false;
+	};
+
+	// Residency policy of streamed textures, free of GPU calls so that it runs headless.
+	// Textures are requested every frame at the mip they need. Requests beyond the budget evict the least recently
+	// requested textures down to what they need now, and a texture switches mips only once its upload has completed,
+	// so every frame samples either the old or the new range and never a partial one.
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer(
+			std::unique_ptr<TextureStreamingUploader> uploader,
+			const TextureStreamingSettings& settings = {});
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// mipSizes holds the size of each mip, the texture starts with its tail resident
+		uint32_t AddTexture(std::span<const uint64_t> mipSizes, uint32_t tailMip);
+		void RemoveTexture(uint32_t idx);
+		void RequestMip(uint32_t idx, uint32_t mip);
+
+		// Called while the command list of the frame ending at cpuFenceValue + 1 is recording, returns the uploaded bytes
+		uint64_t Upload(uint64_t cpuFenceValue);
+		// Commits the uploads completed at completedFenceValue and starts a new frame of requests
+		void Update(uint64_t completedFenceValue);
+
+		uint32_t GetResidentMip(uint32_t idx)const;
+		uint64_t GetResidentSize()const;
+		uint32_t GetPendingCount()const;
+		void SetSettings(const TextureStreamingSettings& settings);
+
+	protected:
+		bool IsPending(const StreamedTexture& texture)const;
+		uint32_t GetWantedMip(const StreamedTexture& texture)const;
+		uint64_t GetAccountedSize(const StreamedTexture& texture)const;
+		void Stream(uint32_t idx, uint32_t mip, uint64_t cpuFenceValue);
+
+		std::unique_ptr<TextureStreamingUploader> mUploader;
+		TextureStreamingSettings mSettings;
+
+		std::vector<StreamedTexture> mTextures;
+		std::vector<uint32_t> mFreeIndices;
+		std::vector<uint32_t> mLoads;
+		std::vector<uint32_t> mEvictions;
+
+		// Textures in transition count with the larger of their ranges until the commit
+		uint64_t mResidentSize = 0;
+		uint64_t mFrame = 1;
+	};
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Carol
+{
+	// Arrays are 16-byte aligned relative to the start of the stream, so spans
+	// read back from a mapped file can be handed to the GPU upload directly
+	class BinaryWriter
+	{
+	public:
+		template<class T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+			mData.insert(mData.end(), bytes, bytes + sizeof(T));
+		}
+
+		template<class T>
+		void WriteAt(size_t offset, const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			std::memcpy(mData.data() + offset, &value, sizeof(T));
+		}
+
+		template<class T>
+		void WriteArray(std::span<const T> values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			Write(uint64_t(values.size()));
+			Align(16);
+
+			auto* bytes = reinterpret_cast<const uint8_t*>(values.data());
+			mData.insert(mData.end(), bytes, bytes + values.size_bytes());
+		}
+
+		void WriteString(std::string_view str);
+		void WriteBytes(std::span<const uint8_t> bytes);
+		void Align(size_t alignment);
+
+		size_t GetSize()const;
+		std::span<const uint8_t> GetData()const;
+		bool Save(std::string_view path)const;
+
+	protected:
+		std::vector<uint8_t> mData;
+	};
+
+	class BinaryReader
+	{
+	public:
+		BinaryReader(std::span<const uint8_t> data);
+
+		template<class T>
+		T Read()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value = {};
+
+			if (Check(sizeof(T)))
+			{
+				std::memcpy(&value, mData.data() + mOffset, sizeof(T));
+				mOffset += sizeof(T);
+			}
+
+			return value;
+		}
+
+		template<class T>
+		std::span<const T> ReadArray()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			uint64_t count = Read<uint64_t>();
+			Align(16);
+
+			if (!mValid || count > (mData.size() - mOffset) / sizeof(T))
+			{
+				mValid = false;
+				return {};
+			}
+
+			auto* values = reinterpret_cast<const T*>(mData.data() + mOffset);
+			mOffset += count * sizeof(T);
+
+			return { values, size_t(count) };
+		}
+
+		std::string_view ReadString();
+		void Align(size_t alignment);
+		bool IsValid()const;
+
+	protected:
+		bool Check(size_t byteSize);
+
+		std::span<const uint8_t> mData;
+		size_t mOffset = 0;
+		bool mValid = true;
+	};
+
+	// Files are written under this name and renamed into place, threads saving the same path never share it
+	std::string GetTempFilePath(std::string_view path);
+}
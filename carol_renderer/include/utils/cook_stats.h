@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+namespace Carol
+{
+	// Stages of turning source assets into the runtime formats, counted wherever they run
+	enum CookStage
+	{
+		COOK_STAGE_IMPORT,
+		COOK_STAGE_ANIMATION,
+		COOK_STAGE_MESH,
+		COOK_STAGE_TEXTURE_DECODE,
+		COOK_STAGE_TEXTURE_COOK,
+		COOK_STAGE_CACHE_WRITE,
+		COOK_STAGE_COUNT
+	};
+
+	// Times of stages running on several threads at once add up, so they can exceed the wall time.
+	// Bytes are the source files of imports, the pixels out of texture decodes and cooks and the files of cache writes.
+	class CookStageStats
+	{
+	public:
+		uint64_t Count = 0;
+		uint64_t Nanoseconds = 0;
+		uint64_t Bytes = 0;
+	};
+
+	std::string_view GetCookStageName(CookStage stage);
+	CookStageStats GetCookStageStats(CookStage stage);
+	void ResetCookStageStats();
+
+	// Resident and peak resident bytes of the process, 0 where they cannot be queried
+	uint64_t GetMemoryUsage();
+	uint64_t GetPeakMemoryUsage();
+
+	// Adds its lifetime to the stage when it goes out of scope
+	class CookStageScope
+	{
+	public:
+		CookStageScope(CookStage stage);
+		CookStageScope(const CookStageScope&) = delete;
+		CookStageScope(CookStageScope&&) = delete;
+		CookStageScope& operator=(const CookStageScope&) = delete;
+		~CookStageScope();
+
+		void AddBytes(uint64_t bytes);
+
+	protected:
+		CookStage mStage;
+		uint64_t mBytes = 0;
+		std::chrono::steady_clock::time_point mStart;
+	};
+}
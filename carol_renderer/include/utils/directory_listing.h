@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace Carol
+{
+	// Lists the files of a directory once, lookups then never touch the file system.
+	// Names compare case-insensitively on Windows like the file system there does.
+	class DirectoryListing
+	{
+	public:
+		DirectoryListing(std::string_view directory);
+		DirectoryListing(const DirectoryListing&) = delete;
+		DirectoryListing(DirectoryListing&&) = delete;
+		DirectoryListing& operator=(const DirectoryListing&) = delete;
+
+		bool Contains(std::string_view fileName)const;
+		size_t GetFileCount()const;
+
+	protected:
+		std::unordered_set<std::string> mFileNames;
+	};
+}
@@ -1,7 +1,11 @@
 #pragma once
 #include <string>
 #include <string_view>
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <wsl/winadapter.h>
+#endif
 
 namespace Carol
 {
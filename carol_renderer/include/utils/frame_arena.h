@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Carol
+{
+	// Per thread bump allocator for scratch memory that lives within one job.
+	// Allocations past the capacity fall back to the heap until the arena is rewound to zero,
+	// the buffer then grows to the peak so the following frames allocate nothing.
+	class FrameArena
+	{
+	public:
+		FrameArena() = default;
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		template<class T>
+		std::span<T> Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible_v<T> && alignof(T) <= 16);
+			size_t size = (count * sizeof(T) + 15) & ~size_t(15);
+			std::byte* data = nullptr;
+
+			if (mOffset + size <= mCapacity)
+			{
+				data = mBuffer.get() + mOffset;
+			}
+			else
+			{
+				data = mOverflow.emplace_back(std::make_unique<std::byte[]>(size)).get();
+			}
+
+			mOffset += size;
+			mPeak = mOffset > mPeak ? mOffset : mPeak;
+
+			return { reinterpret_cast<T*>(data), count };
+		}
+
+		size_t GetMarker()const;
+		void Rewind(size_t marker);
+
+		static FrameArena& GetThreadArena();
+
+	protected:
+		std::unique_ptr<std::byte[]> mBuffer;
+		std::vector<std::unique_ptr<std::byte[]>> mOverflow;
+		size_t mCapacity = 0;
+		size_t mOffset = 0;
+		size_t mPeak = 0;
+	};
+}
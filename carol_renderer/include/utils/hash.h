@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace Carol
+{
+	uint64_t Hash64(const void* data, size_t byteSize, uint64_t seed = 0);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <DirectXTex.h>
+#include <string_view>
+
+namespace Carol
+{
+	// Picks the decoder by file suffix. DDS and TGA go through DirectXTex, PNG and JPEG through libpng and
+	// libjpeg-turbo where they were found at build time and through WIC otherwise. Pixels are decoded straight
+	// into the image, which is safe to do on several threads at once.
+	HRESULT DecodeImage(std::string_view fileName, DirectX::ScratchImage& image);
+}
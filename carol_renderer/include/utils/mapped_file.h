@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace Carol
+{
+	class MappedFile
+	{
+	public:
+		MappedFile(std::string_view path);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		bool IsValid()const;
+		std::span<const uint8_t> GetData()const;
+
+	protected:
+#ifdef _WIN32
+		void* mFile = nullptr;
+		void* mMapping = nullptr;
+#else
+		int mFile = -1;
+#endif
+		const uint8_t* mData = nullptr;
+		size_t mSize = 0;
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <DirectXTex.h>
+
+namespace Carol
+{
+	enum MipFilter
+	{
+		MIP_FILTER_BOX,
+		MIP_FILTER_KAISER,
+		MIP_FILTER_COUNT
+	};
+
+	// sRGB colors are filtered in linear space, normals are renormalized on every level
+	enum MipContent
+	{
+		MIP_CONTENT_LINEAR,
+		MIP_CONTENT_SRGB,
+		MIP_CONTENT_NORMAL,
+		MIP_CONTENT_COUNT
+	};
+
+	// Builds the full chain below an R8G8B8A8 image. Each level is filtered in float from the level above it,
+	// rows are split over the thread pool.
+	HRESULT GenerateMipChain(
+		const DirectX::Image& top,
+		MipFilter filter,
+		MipContent content,
+		DirectX::ScratchImage& mipChain);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <utils/mapped_file.h>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Carol
+{
+	constexpr uint32_t SHADER_ARCHIVE_MAGIC = 0x41485343;
+	constexpr uint32_t SHADER_ARCHIVE_VERSION = 1;
+	// Blobs start on cache lines, the DXIL container only asks for 4 bytes
+	constexpr uint32_t SHADER_ARCHIVE_ALIGNMENT = 64;
+
+	class ShaderArchiveHeader
+	{
+	public:
+		uint32_t Magic = SHADER_ARCHIVE_MAGIC;
+		uint32_t Version = SHADER_ARCHIVE_VERSION;
+		uint32_t ShaderCount = 0;
+		uint32_t Reserved = 0;
+	};
+
+	// Offsets are from the start of the file, entries are sorted by NameHash
+	class ShaderArchiveEntry
+	{
+	public:
+		uint64_t NameHash = 0;
+		uint64_t BytecodeHash = 0;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+	};
+
+	// Shaders are named by their path relative to the working directory, e.g. shader/dxil/display_ps.dxil
+	uint64_t GetShaderNameHash(std::string_view path);
+	uint64_t GetShaderBytecodeHash(std::span<const uint8_t> bytecode);
+	// Packs the files under their own paths, fails on unreadable files and name hash collisions
+	bool SaveShaderArchive(std::span<const std::string> paths, std::string_view archivePath);
+
+	// The archive stays mapped for its lifetime and bytecode is handed out as views into the mapping
+	class ShaderArchive
+	{
+	public:
+		ShaderArchive(std::string_view path);
+		ShaderArchive(const ShaderArchive&) = delete;
+		ShaderArchive(ShaderArchive&&) = delete;
+		ShaderArchive& operator=(const ShaderArchive&) = delete;
+
+		bool IsValid()const;
+		const ShaderArchiveEntry* Find(uint64_t nameHash)const;
+		std::span<const uint8_t> GetBytecode(const ShaderArchiveEntry& entry)const;
+		uint32_t GetShaderCount()const;
+
+	protected:
+		MappedFile mFile;
+		std::span<const ShaderArchiveEntry> mEntries;
+		bool mValid = false;
+	};
+}
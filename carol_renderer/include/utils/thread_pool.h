@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Carol
+{
+	class ThreadPool
+	{
+	public:
+		ThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		~ThreadPool();
+
+		std::future<void> Submit(std::function<void()> task);
+
+		// The calling thread takes part in the loop, so nested calls from tasks cannot deadlock.
+		// The first exception thrown by func is rethrown here once every claimed chunk has finished.
+		void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func, uint32_t grainSize = 1);
+
+		uint32_t GetThreadCount()const;
+
+	protected:
+		void WorkerLoop();
+
+		std::vector<std::thread> mThreads;
+		std::queue<std::packaged_task<void()>> mTasks;
+		std::mutex mTaskMutex;
+		std::condition_variable mTaskCondition;
+		bool mStop = false;
+	};
+}
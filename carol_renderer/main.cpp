@@ -7,6 +7,10 @@
 #include <windowsx.h>
 #include <ShlObj.h>
 #include <DirectXMath.h>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <vector>
 
 #define MAX_LOADSTRING 100
 
@@ -18,6 +22,22 @@ CHAR szWindowClass[MAX_LOADSTRING];            // 主窗口类名
 
 std::string loadModelName;
 
+// Loads still in flight, reported from the message loop once they finish
+class PendingLoad
+{
+public:
+    std::string Name;
+    bool Skinned = false;
+    std::future<void> Loaded;
+};
+
+std::vector<PendingLoad> pendingLoads;
+
+namespace Carol
+{
+    std::unique_ptr<Renderer> gRenderer;
+}
+
 // 此代码模块中包含的函数的前向声明:
 ATOM                MyRegisterClass(HINSTANCE hInstance);
 BOOL                InitInstance(HINSTANCE, int);
@@ -27,13 +47,14 @@ LRESULT CALLBACK    LoadWndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK    AnimationWndProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK    DeleteWndProc(HWND, UINT, WPARAM, LPARAM);
 
+void                PollPendingLoads();
+
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_opt_ HINSTANCE hPrevInstance,
                      _In_ LPWSTR    lpCmdLine,
                      _In_ int       nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
 
     // TODO: 在此处放置代码。
 
@@ -60,6 +81,20 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     {
         Carol::gRenderer = std::make_unique<Carol::Renderer>(hWnd,width,height);
 
+        // A scene package cooked by carol-cook can be passed on the command line, it loads while the first frames draw
+        std::wstring scenePath = lpCmdLine;
+        std::erase(scenePath, L'"');
+
+        if (!scenePath.empty())
+        {
+            std::string scenePathStr = std::filesystem::path(scenePath).string();
+
+            for (auto& loaded : Carol::gRenderer->LoadSceneAsync(scenePathStr))
+            {
+                pendingLoads.push_back({ scenePathStr, false, std::move(loaded) });
+            }
+        }
+
 		// 主消息循环:
         while (msg.message != WM_QUIT)
 		{
@@ -82,7 +117,8 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                 {
                     Sleep(100);
                 }
-				
+
+                PollPendingLoads();
 			}
 		}
         
@@ -481,12 +517,8 @@ LRESULT LoadWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             auto translation = DirectX::XMMatrixTranslationFromVector(DirectX::XMLoadFloat3(&transl));
             auto rotation = DirectX::XMMatrixRotationAxis(DirectX::XMLoadFloat3(&rotationAxis), DirectX::XM_PI * angle / 180.f);
             auto world = scaling * rotation * translation;
-            Carol::gRenderer->LoadModel(modelPath, textureDirPath, loadModelName, world, animation);
-
-            if (animation)
-            {
-                DialogBox(hInst, MAKEINTRESOURCE(IDD_ANIMATION), hWnd, AnimationWndProc);
-            }
+            // Imported and uploaded while frames keep drawing, the animation dialog opens once the model is in
+            pendingLoads.push_back({ loadModelName, animation, Carol::gRenderer->LoadModelAsync(modelPath, textureDirPath, loadModelName, world, animation) });
 
             //EnableWindow(GetDlgItem(hWnd, IDC_LOAD_CONFIRM), true);
             EndDialog(hWnd, 0);
@@ -602,3 +634,50 @@ LRESULT DeleteWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
     return 0;
 }
+
+void PollPendingLoads()
+{
+    std::vector<PendingLoad> finished;
+
+    for (size_t i = 0; i < pendingLoads.size();)
+    {
+        if (pendingLoads[i].Loaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++i;
+            continue;
+        }
+
+        finished.push_back(std::move(pendingLoads[i]));
+        pendingLoads.erase(pendingLoads.begin() + i);
+    }
+
+    for (auto& load : finished)
+    {
+        try
+        {
+            load.Loaded.get();
+        }
+        catch (Carol::DxException& e)
+        {
+            MessageBox(hWnd, (load.Name + ": " + e.ToString()).c_str(), "Load Failed", MB_OK);
+            continue;
+        }
+        catch (std::exception& e)
+        {
+            MessageBox(hWnd, (load.Name + ": " + e.what()).c_str(), "Load Failed", MB_OK);
+            continue;
+        }
+
+        if (load.Skinned)
+        {
+            loadModelName = load.Name;
+
+            Carol::gRenderer->SetPaused(true);
+            Carol::gRenderer->Stop();
+            DialogBox(hInst, MAKEINTRESOURCE(IDD_ANIMATION), hWnd, AnimationWndProc);
+
+            Carol::gRenderer->SetPaused(false);
+            Carol::gRenderer->Start();
+        }
+    }
+}
@@ -25,7 +25,8 @@ bool MeshletFrustumCull(uint dtid, CullData cd)
 {
     float4x4 frustumWorldViewProj = mul(gWorld, gCullViewProj);
 
-    if (AabbFrustumTest(cd.Center, cd.Extents, frustumWorldViewProj) == OUTSIDE)
+    if (SphereFrustumTest(cd.BoundingSphere, frustumWorldViewProj) == OUTSIDE
+        || AabbFrustumTest(cd.Center, cd.Extents, frustumWorldViewProj) == OUTSIDE)
     {
         SetMark(dtid, gMeshletFrustumCulledMarkBufferIdx);
         return true;
@@ -68,7 +69,7 @@ void main(uint dtid : SV_DispatchThreadID)
     
     if(dtid < gMeshletCount)
     {
-        bool culled = false;
+        bool culled = !LodTest(dtid, gLodDataBufferIdx, gLodLevelCount, gWorld);
         StructuredBuffer<CullData> cullData = ResourceDescriptorHeap[gCullDataBufferIdx];
         CullData cd = cullData[dtid];
 
@@ -93,7 +94,9 @@ void main(uint dtid : SV_DispatchThreadID)
         visible = !culled;
     }
 #else
-    visible = dtid < gMeshletCount && !GetMark(dtid, gMeshletCulledMarkBufferIdx);
+    visible = dtid < gMeshletCount 
+        && LodTest(dtid, gLodDataBufferIdx, gLodLevelCount, gWorld)
+        && !GetMark(dtid, gMeshletCulledMarkBufferIdx);
 #endif
     
 #if (defined WRITE) && (defined TRANSPARENT)
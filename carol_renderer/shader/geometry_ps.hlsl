@@ -27,22 +27,22 @@ PixelOut main(PixelIn pin)
 
     // Diffuse
     Texture2D diffuseTex = ResourceDescriptorHeap[gDiffuseTextureIdx];
-    float3 diffuse = diffuseTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).rgb;
+    float3 diffuse = diffuseTex.Sample(gsamAnisotropicWrap, pin.TexC).rgb;
     pout.DiffuseRoughness.rgb = diffuse;
 
     // Emissive
     Texture2D emissiveTex = ResourceDescriptorHeap[gEmissiveTextureIdx];
-    float3 emissive = emissiveTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).rgb;
+    float3 emissive = emissiveTex.Sample(gsamAnisotropicWrap, pin.TexC).rgb;
     pout.EmissiveMetallic.rgb = emissive;
 
     // Normal
     Texture2D normalTex = ResourceDescriptorHeap[gNormalTextureIdx];
-    float3 normal = NormalToWorldSpace(normalTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).rgb, normalize(pin.NormalW), normalize(pin.TangentW)).rgb;
+    float3 normal = NormalToWorldSpace(normalTex.Sample(gsamAnisotropicWrap, pin.TexC).rgb, normalize(pin.NormalW), normalize(pin.TangentW)).rgb;
     pout.Normal = float4(normal, 1.f);
     
     // Metallic & Roughness
     Texture2D metallicRoughnessTex = ResourceDescriptorHeap[gMetallicRoughnessTextureIdx];
-    float2 metallicRoughness = metallicRoughnessTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).bg;
+    float2 metallicRoughness = metallicRoughnessTex.Sample(gsamAnisotropicWrap, pin.TexC).rg;
     pout.DiffuseRoughness.a = metallicRoughness.g;
     pout.EmissiveMetallic.a = metallicRoughness.r;
 
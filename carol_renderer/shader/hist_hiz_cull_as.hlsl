@@ -22,6 +22,7 @@ void main(uint dtid : SV_DispatchThreadID)
     bool visible = false;
 
     if (dtid < gMeshletCount 
+        && LodTest(dtid, gLodDataBufferIdx, gLodLevelCount, gWorld)
         && !GetMark(dtid, gMeshletFrustumCulledMarkBufferIdx) 
         && !GetMark(dtid, gMeshletNormalConeCulledMarkBufferIdx) 
         && GetMark(dtid, gMeshletOcclusionCulledMarkBufferIdx))
@@ -8,6 +8,8 @@
 #define OUTSIDE 1
 #define INTERSECTING 2
 
+#define LOD_ERROR_THRESHOLD 1.f
+
 #include "common.hlsli"
 
 cbuffer CullCB : register(b2)
@@ -35,6 +37,16 @@ struct CullData
     float3 Extents;
     uint NormalCone;
     float ApexOffset;
+    float4 BoundingSphere;
+};
+
+struct ClusterLodData
+{
+    float4 LodBounds;
+    float4 ParentLodBounds;
+    float LodError;
+    float ParentLodError;
+    float2 LodPad0;
 };
 
 struct Payload
@@ -73,11 +85,14 @@ struct MeshConstants
     uint MeshNormalMapIdx;
     uint MeshMetallicMapIdx;
     float MeshPad3;
+    
+    uint LodDataBufferIdx;
+    uint LodLevelCount;
+    float2 MeshPad4;
 
     // Padding for 256 byte
     float4 MeshConstantsPad0;
     float4 MeshConstantsPad1;
-    float4 MeshConstantsPad2;
 };
 
 bool GetMark(uint idx, uint markIdx)
@@ -190,6 +205,58 @@ uint AabbFrustumTest(float3 center, float3 extents, float4x4 M)
     }
 }
 
+uint SpherePlaneTest(float4 sphere, float4 plane)
+{
+    plane /= length(plane.xyz);
+    float s = dot(sphere.xyz, plane.xyz) + plane.w;
+    
+    if (s + sphere.w < 0)
+    {
+        return INSIDE;
+    }
+    else if (s - sphere.w > 0)
+    {
+        return OUTSIDE;
+    }
+    else
+    {
+        return INTERSECTING;
+    }
+}
+
+uint SphereFrustumTest(float4 sphere, float4x4 M)
+{
+    // Same planes as AabbFrustumTest, the test is done in object space so non-uniform scale is handled
+    float4 planes[6] =
+    {
+        float4(-(M._11 + M._14), -(M._21 + M._24), -(M._31 + M._34), -(M._41 + M._44)),
+        float4(M._11 - M._14, M._21 - M._24, M._31 - M._34, M._41 - M._44),
+        float4(-(M._12 + M._14), -(M._22 + M._24), -(M._32 + M._34), -(M._42 + M._44)),
+        float4(M._12 - M._14, M._22 - M._24, M._32 - M._34, M._42 - M._44),
+        float4(-M._13, -M._23, -M._33, -M._43),
+        float4(M._13 - M._14, M._23 - M._24, M._33 - M._34, M._43 - M._44)
+    };
+    
+    uint result = INSIDE;
+    
+    [unroll]
+    for (int i = 0; i < 6; ++i)
+    {
+        uint planeResult = SpherePlaneTest(sphere, planes[i]);
+        
+        if (planeResult == OUTSIDE)
+        {
+            return OUTSIDE;
+        }
+        else if (planeResult == INTERSECTING)
+        {
+            result = INTERSECTING;
+        }
+    }
+    
+    return result;
+}
+
 bool IsConeDegenerate(uint packedNormalCone)
 {
     return (packedNormalCone >> 24) == 0xff;
@@ -204,7 +271,7 @@ float4 UnpackCone(uint packedNormalCone)
     normalCone.w = float((packedNormalCone >> 24) & 0xff);
 
     normalCone = normalCone / 255.f;
-    normalCone.xyz = normalCone.xyz * 2.f - 1.f;
+    normalCone.xyz = normalize(normalCone.xyz * 2.f - 1.f);
 
     return normalCone;
 }
@@ -228,6 +295,32 @@ bool NormalConeTest(float3 center, uint packedNormalCone, float apexOffset, floa
     return true;
 }
 
+float ProjectLodError(float4 bounds, float error, float4x4 world)
+{
+    // Project the object space error of a bounding sphere to pixels on the screen,
+    // using the closest point of the sphere keeps the error monotonic along the DAG
+    float3 center = mul(float4(bounds.xyz, 1.f), world).xyz;
+    float scale = max(length(world[0].xyz), max(length(world[1].xyz), length(world[2].xyz)));
+    float dist = max(length(center - gEyePosW) - bounds.w * scale, gNearZ);
+    
+    return error * scale * 0.5f * gRenderTargetSize.y * gProj[1][1] / dist;
+}
+
+bool LodTest(uint idx, uint lodDataIdx, uint lodLevelCount, float4x4 world)
+{
+    // A cluster is in the cut when its own error is acceptable and its parent's is not
+    if (lodLevelCount == 0)
+    {
+        return true;
+    }
+    
+    StructuredBuffer<ClusterLodData> lodData = ResourceDescriptorHeap[lodDataIdx];
+    ClusterLodData ld = lodData[idx];
+    
+    return ProjectLodError(ld.LodBounds, ld.LodError, world) <= LOD_ERROR_THRESHOLD
+        && ProjectLodError(ld.ParentLodBounds, ld.ParentLodError, world) > LOD_ERROR_THRESHOLD;
+}
+
 bool HiZOcclusionTest(float3 center, float3 extents, float4x4 M, uint hiZIdx)
 {
     Texture2D hiZMap = ResourceDescriptorHeap[hiZIdx];
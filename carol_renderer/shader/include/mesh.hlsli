@@ -27,14 +27,24 @@ cbuffer MeshCB : register(b0)
     uint gNormalTextureIdx;
     uint gEmissiveTextureIdx;
     uint gMetallicRoughnessTextureIdx;
+    
+    uint gLodDataBufferIdx;
+    uint gLodLevelCount;
+    float MeshPad2;
+    float MeshPad3;
 };
 
 cbuffer SkinnedCB : register(b1)
 {
-    float4x4 gBoneTransforms[256];
-    float4x4 gHistBoneTransforms[256];
+    uint gBonePaletteBufferIdx;
+    uint gBonePaletteOffset;
+    uint gHistBonePaletteOffset;
+    uint gBonePaletteFormat;
 };
 
+#define BONE_PALETTE_MATRIX 0
+#define BONE_PALETTE_DUAL_QUATERNION 1
+
 struct Meshlet
 {
     uint Vertices[64];
@@ -58,50 +68,100 @@ uint3 UnpackPrim(uint prim)
     return uint3(prim & 0x3FF, (prim >> 10) & 0x3FF, (prim >> 20) & 0x3FF);
 }
 
-MeshIn SkinnedTransform(MeshIn min)
+float4 GetBoneWeights(MeshIn min)
 {
-    float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    weights[0] = min.BoneWeights.x;
-    weights[1] = min.BoneWeights.y;
-    weights[2] = min.BoneWeights.z;
-    weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
-    
-    float3 posL = float3(0.0f, 0.0f, 0.0f);
-    float3 normalL = float3(0.0f, 0.0f, 0.0f);
-    float3 tangentL = float3(0.0f, 0.0f, 0.0f);
+    return float4(min.BoneWeights, 1.0f - min.BoneWeights.x - min.BoneWeights.y - min.BoneWeights.z);
+}
+
+float3x4 BlendBoneMatrices(uint paletteOffset, uint4 boneIndices, float4 weights)
+{
+    StructuredBuffer<float4> bonePalette = ResourceDescriptorHeap[gBonePaletteBufferIdx];
+    float3x4 skin = 0.0f;
 
     [unroll]
-    for(int i = 0; i < 4; ++i)
+    for (int i = 0; i < 4; ++i)
     {
-        posL += weights[i] * mul(float4(min.PosL, 1.0f), gBoneTransforms[min.BoneIndices[i]]).xyz;
-        normalL += weights[i] * mul(float4(min.NormalL, 0.0f), gBoneTransforms[min.BoneIndices[i]]).xyz;
-        tangentL += weights[i] * mul(float4(min.TangentL, 0.0f), gBoneTransforms[min.BoneIndices[i]]).xyz;    
+        uint idx = paletteOffset + boneIndices[i] * 3;
+        skin += weights[i] * float3x4(bonePalette[idx], bonePalette[idx + 1], bonePalette[idx + 2]);
+    }
+
+    return skin;
+}
+
+// Linear blend of the dual quaternions, antipodal ones are flipped towards the first bone
+void BlendBoneDualQuaternions(uint paletteOffset, uint4 boneIndices, float4 weights, out float4 real, out float4 dual)
+{
+    StructuredBuffer<float4> bonePalette = ResourceDescriptorHeap[gBonePaletteBufferIdx];
+    float4 pivot = bonePalette[paletteOffset + boneIndices[0] * 2];
+    real = 0.0f;
+    dual = 0.0f;
+
+    [unroll]
+    for (int i = 0; i < 4; ++i)
+    {
+        uint idx = paletteOffset + boneIndices[i] * 2;
+        float4 boneReal = bonePalette[idx];
+        float weight = dot(boneReal, pivot) < 0.0f ? -weights[i] : weights[i];
+
+        real += weight * boneReal;
+        dual += weight * bonePalette[idx + 1];
+    }
+
+    float invLength = rsqrt(dot(real, real));
+    real *= invLength;
+    dual *= invLength;
+}
+
+float3 QuaternionRotate(float4 q, float3 v)
+{
+    return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+float3 DualQuaternionTranslation(float4 real, float4 dual)
+{
+    return 2.0f * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+}
+
+MeshIn SkinnedTransform(MeshIn min)
+{
+    float4 weights = GetBoneWeights(min);
+
+    if (gBonePaletteFormat == BONE_PALETTE_DUAL_QUATERNION)
+    {
+        float4 real;
+        float4 dual;
+        BlendBoneDualQuaternions(gBonePaletteOffset, min.BoneIndices, weights, real, dual);
+
+        min.PosL = QuaternionRotate(real, min.PosL) + DualQuaternionTranslation(real, dual);
+        min.NormalL = QuaternionRotate(real, min.NormalL);
+        min.TangentL = QuaternionRotate(real, min.TangentL);
+    }
+    else
+    {
+        float3x4 skin = BlendBoneMatrices(gBonePaletteOffset, min.BoneIndices, weights);
+
+        min.PosL = mul(skin, float4(min.PosL, 1.0f));
+        min.NormalL = mul(skin, float4(min.NormalL, 0.0f));
+        min.TangentL = mul(skin, float4(min.TangentL, 0.0f));
     }
-    
-    min.PosL = posL;
-    min.NormalL = normalL;
-    min.TangentL = tangentL;
     
     return min;
 }
 
 float3 HistSkinnedTransformPosL(float3 posL, MeshIn min)
 {    
-    float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    weights[0] = min.BoneWeights.x;
-    weights[1] = min.BoneWeights.y;
-    weights[2] = min.BoneWeights.z;
-    weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
-    
-    float3 histPosL = float3(0.0f, 0.0f, 0.0f);
+    float4 weights = GetBoneWeights(min);
 
-    [unroll]
-    for(int i = 0; i < 4; ++i)
+    if (gBonePaletteFormat == BONE_PALETTE_DUAL_QUATERNION)
     {
-        histPosL += weights[i] * mul(float4(posL, 1.0f), gHistBoneTransforms[min.BoneIndices[i]]).xyz;
+        float4 real;
+        float4 dual;
+        BlendBoneDualQuaternions(gHistBonePaletteOffset, min.BoneIndices, weights, real, dual);
+
+        return QuaternionRotate(real, posL) + DualQuaternionTranslation(real, dual);
     }
-    
-    return histPosL;
+
+    return mul(BlendBoneMatrices(gHistBonePaletteOffset, min.BoneIndices, weights), float4(posL, 1.0f));
 }
 
 #endif
\ No newline at end of file
@@ -18,7 +18,9 @@ bool TextureBorderTest(float2 pos)
 
 float3 NormalToWorldSpace(float3 normal, float3 normalW, float3 tangentW)
 {
-    normal = 2.0f * normal - 1.0f;
+    // Cooked normal maps only keep x and y
+    normal.xy = 2.0f * normal.xy - 1.0f;
+    normal.z = sqrt(saturate(1.0f - dot(normal.xy, normal.xy)));
     
     float3 N = normalW;
     float3 T = normalize(tangentW - dot(normalW, tangentW) * N);
@@ -28,10 +28,10 @@ void main(PixelIn pin)
     
     // Interpolation may unnormalize the normal, so renormalize it
     float2 uv = pin.PosH.xy * gInvRenderTargetSize;
-    float4 diffuse = diffuseTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z));
-    float3 normal = NormalToWorldSpace(normalTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).rgb, normalize(pin.NormalW), pin.TangentW).rgb;
-    float3 emissive = emissiveTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).rgb;
-    float2 metallicRoughness = metallicRoughnessTex.SampleLevel(gsamAnisotropicWrap, pin.TexC, LOD(pin.PosH.z)).bg;
+    float4 diffuse = diffuseTex.Sample(gsamAnisotropicWrap, pin.TexC);
+    float3 normal = NormalToWorldSpace(normalTex.Sample(gsamAnisotropicWrap, pin.TexC).rgb, normalize(pin.NormalW), pin.TangentW).rgb;
+    float3 emissive = emissiveTex.Sample(gsamAnisotropicWrap, pin.TexC).rgb;
+    float2 metallicRoughness = metallicRoughnessTex.Sample(gsamAnisotropicWrap, pin.TexC).rg;
        
     Material lightMat;
     lightMat.SubsurfaceAlbedo = diffuse.rgb;
@@ -1292,7 +1292,7 @@ std::unique_ptr<Carol::StructuredBuffer> Carol::FrameBufferAllocator::RequestBuf
 {
 	std::lock_guard<std::mutex> lock(mAllocatorMutex);
 
-	if (numElements > mNumElements)
+	while (numElements > mNumElements)
 	{
 		mNumElements <<= 1;
 	}
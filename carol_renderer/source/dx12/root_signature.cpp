@@ -5,8 +5,8 @@
 
 Carol::RootSignature::RootSignature()
 {
-    Shader rootSignatureShader("shader/dxil/root_signature.dxil");
-    ThrowIfFailed(gDevice->CreateRootSignature(0, rootSignatureShader.GetBufferPointer(), rootSignatureShader.GetBufferSize(), IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+    Shader* rootSignatureShader = gShaderManager->LoadShader("shader/dxil/root_signature.dxil");
+    ThrowIfFailed(gDevice->CreateRootSignature(0, rootSignatureShader->GetBufferPointer(), rootSignatureShader->GetBufferSize(), IID_PPV_ARGS(mRootSignature.GetAddressOf())));
 }
 
 ID3D12RootSignature* Carol::RootSignature::Get()const
@@ -1,42 +1,68 @@
 #include <dx12/shader.h>
 #include <utils/exception.h>
+#include <utils/shader_archive.h>
 #include <global.h>
 #include <fstream>
 
 Carol::Shader::Shader(std::string_view path)
 {
-    std::ifstream file(path.data(), std::ios::ate | std::ios::binary);
-    size_t size = file.tellg();
+    std::ifstream file(std::string(path), std::ios::ate | std::ios::binary);
+    size_t size = file ? size_t(file.tellg()) : 0;
     mBlob.resize(size);
 
     file.seekg(0);
     file.read((char*)mBlob.data(), size);
     file.close();
+
+    mBytecode = mBlob;
+    mHash = GetShaderBytecodeHash(mBytecode);
+}
+
+Carol::Shader::Shader(std::span<const uint8_t> bytecode, uint64_t hash)
+    :mBytecode(bytecode),
+    mHash(hash)
+{
 }
 
 void* Carol::Shader::GetBufferPointer()const
 {
-    return (void*)mBlob.data();
+    return (void*)mBytecode.data();
 }
 
 size_t Carol::Shader::GetBufferSize()const
 {
-    return mBlob.size();
+    return mBytecode.size();
+}
+
+uint64_t Carol::Shader::GetHash()const
+{
+    return mHash;
 }
 
+Carol::ShaderManager::ShaderManager(std::string_view archivePath)
+    :mArchive(std::make_unique<ShaderArchive>(archivePath))
+{
+}
 
-Carol::ShaderManager::ShaderManager()
+Carol::ShaderManager::~ShaderManager()
 {
-}   
+}
 
 Carol::Shader* Carol::ShaderManager::LoadShader(std::string_view path)
 {
-    std::string pathStr = path.data();
+    uint64_t nameHash = GetShaderNameHash(path);
+    auto& shader = mShaders[nameHash];
 
-    if (mShaders.count(pathStr) == 0)
+    if (!shader)
     {
-        mShaders[pathStr] = std::make_unique<Shader>(path);
+        const ShaderArchiveEntry* entry = mArchive->IsValid() ? mArchive->Find(nameHash) : nullptr;
+        shader = entry ? std::make_unique<Shader>(mArchive->GetBytecode(*entry), entry->BytecodeHash) : std::make_unique<Shader>(path);
     }
 
-    return mShaders[pathStr].get();
-}
\ No newline at end of file
+    return shader.get();
+}
+
+uint32_t Carol::ShaderManager::GetArchiveShaderCount()const
+{
+    return mArchive->GetShaderCount();
+}
@@ -1,9 +1,20 @@
-#include <carol.h>
+#include <global.h>
+#include <dx12/command.h>
+#include <dx12/descriptor.h>
+#include <dx12/heap.h>
+#include <dx12/root_signature.h>
+#include <dx12/shader.h>
+#include <scene/animation_asset.h>
+#include <scene/model.h>
+#include <scene/texture.h>
+#include <utils/thread_pool.h>
 
 namespace Carol
 {
 	Microsoft::WRL::ComPtr<ID3D12Debug> gDebugLayer;
+#ifdef _WIN32
 	Microsoft::WRL::ComPtr<IDXGIFactory> gDxgiFactory;
+#endif
 	Microsoft::WRL::ComPtr<ID3D12Device> gDevice;
 	Microsoft::WRL::ComPtr<ID3D12CommandQueue> gCommandQueue;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> gGraphicsCommandList;
@@ -15,11 +26,11 @@ namespace Carol
 	uint64_t gCpuFenceValue;
 	uint64_t gGpuFenceValue;
 
+	std::unique_ptr<ThreadPool> gThreadPool;
 	std::unique_ptr<DescriptorManager> gDescriptorManager;
 	std::unique_ptr<HeapManager> gHeapManager;
 	std::unique_ptr<ShaderManager> gShaderManager;
 	std::unique_ptr<TextureManager> gTextureManager;
+	std::unique_ptr<AnimationAssetManager> gAnimationAssetManager;
 	std::unique_ptr<ModelManager> gModelManager;
-
-	std::unique_ptr<Renderer> gRenderer;
 }
\ No newline at end of file
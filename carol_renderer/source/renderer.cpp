@@ -20,12 +20,13 @@ Carol::Renderer::Renderer(HWND hWnd, uint32_t width, uint32_t height)
 	InitCommandQueue();
 	InitCommandAllocatorPool();
 	InitGraphicsCommandList();
+	InitShaderManager();
 	InitRootSignature();
 	InitCommandSignature();
 
+	InitThreadPool();
 	InitHeapManager();
 	InitDescriptorManager();
-	InitShaderManager();
 	InitTextureManager();
 	InitModelManager();
 	InitTimer();
@@ -141,6 +142,11 @@ void Carol::Renderer::InitCommandSignature()
 	ThrowIfFailed(gDevice->CreateCommandSignature(&cmdSigDesc, gRootSignature->Get(), IID_PPV_ARGS(gCommandSignature.GetAddressOf())));
 }
 
+void Carol::Renderer::InitThreadPool()
+{
+	gThreadPool = std::make_unique<ThreadPool>();
+}
+
 void Carol::Renderer::InitHeapManager()
 {
 	gHeapManager = std::make_unique<HeapManager>(1 << 29);
@@ -160,6 +166,7 @@ void Carol::Renderer::InitShaderManager()
 void Carol::Renderer::InitTextureManager()
 {
 	gTextureManager = std::make_unique<TextureManager>();
+	gTextureManager->LoadDefaultTextures();
 }
 
 void Carol::Renderer::InitTimer()
@@ -177,7 +184,9 @@ void Carol::Renderer::InitCamera()
 
 void Carol::Renderer::InitModelManager()
 {
+	gAnimationAssetManager = std::make_unique<AnimationAssetManager>();
 	gModelManager = std::make_unique<ModelManager>("Carol");
+	mModelLoader = std::make_unique<ModelLoader>(std::make_unique<GpuModelUploader>());
 }
 
 void Carol::Renderer::InitConstants()
@@ -344,6 +353,8 @@ void Carol::Renderer::Draw()
 
 	ID3D12DescriptorHeap* descriptorHeaps[] = {gDescriptorManager->GetResourceDescriptorHeap()};
 	gGraphicsCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	mModelLoader->Upload(gCpuFenceValue);
+	gTextureManager->Upload(gCpuFenceValue);
 
 	gGraphicsCommandList->SetGraphicsRootSignature(gRootSignature->Get());
 	gGraphicsCommandList->SetComputeRootSignature(gRootSignature->Get());
@@ -536,7 +547,9 @@ void Carol::Renderer::Update()
 	gDescriptorManager->DelayedDelete(gCpuFenceValue, gGpuFenceValue);
 	gHeapManager->DelayedDelete(gCpuFenceValue, gGpuFenceValue);
 
-	gModelManager->Update(mTimer.get(), gCpuFenceValue, gGpuFenceValue);
+	mModelLoader->Update(gGpuFenceValue);
+	gTextureManager->Update(gGpuFenceValue);
+	gModelManager->Update(mTimer.get(), mCamera.get(), gCpuFenceValue, gGpuFenceValue);
 	mCamera->UpdateViewMatrix();
 	mMainLightShadowPass->Update(dynamic_cast<PerspectiveCamera*>(mCamera.get()), .4f);
 
@@ -594,6 +607,7 @@ void Carol::Renderer::OnResize(uint32_t width, uint32_t height, bool init)
 
 	mTimer->Start();
 	dynamic_cast<PerspectiveCamera*>(mCamera.get())->SetLens(0.25f * DirectX::XM_PI, AspectRatio(), 1.0f, 1000.0f);
+	gTextureManager->SetScreenHeight(height);
 
 	mCullPass->OnResize(width, height);
 	mDisplayPass->OnResize(width, height);
@@ -671,6 +685,35 @@ void Carol::Renderer::LoadModel(std::string_view path, std::string_view textureD
 	ThrowIfFailed(gCommandQueue->Signal(gFence.Get(), gCpuFenceValue));
 }
 
+std::future<void> Carol::Renderer::LoadModelAsync(std::string_view path, std::string_view textureDir, std::string_view modelName, DirectX::XMMATRIX world, bool isSkinned)
+{
+	return mModelLoader->LoadModel(
+		modelName,
+		path,
+		textureDir,
+		world,
+		isSkinned);
+}
+
+std::vector<std::future<void>> Carol::Renderer::LoadSceneAsync(std::string_view path)
+{
+	auto package = std::make_shared<ScenePackage>(path);
+
+	// A package that fails validation is reported through its future, like a model that fails to import
+	if (!package->IsValid())
+	{
+		std::promise<void> failed;
+		failed.set_exception(std::make_exception_ptr(DxException(E_INVALIDARG, "ScenePackage::IsValid()", path, __LINE__)));
+
+		std::vector<std::future<void>> loaded;
+		loaded.push_back(failed.get_future());
+
+		return loaded;
+	}
+
+	return mModelLoader->LoadScene(std::move(package));
+}
+
 void Carol::Renderer::UnloadModel(std::string_view modelName)
 {
 	gModelManager->UnloadModel(modelName);
@@ -0,0 +1,109 @@
+#include <scene/animation_asset.h>
+#include <scene/compressed_animation.h>
+#include <utils/hash.h>
+#include <algorithm>
+#include <cstring>
+
+Carol::Skeleton::Skeleton(
+	std::span<const int> hierarchy,
+	std::span<const DirectX::XMFLOAT4X4> offsets,
+	uint64_t hash)
+	:Hierarchy(hierarchy.begin(), hierarchy.end()),
+	Offsets(offsets.begin(), offsets.end()),
+	ContentHash(hash)
+{
+}
+
+uint64_t Carol::Skeleton::Hash(
+	std::span<const int> hierarchy,
+	std::span<const DirectX::XMFLOAT4X4> offsets)
+{
+	uint64_t hash = Hash64(hierarchy.data(), hierarchy.size_bytes());
+	return Hash64(offsets.data(), offsets.size_bytes(), hash);
+}
+
+Carol::AnimationAssetManager::AnimationAssetManager()
+{
+}
+
+std::shared_ptr<const Carol::Skeleton> Carol::AnimationAssetManager::LoadSkeleton(
+	std::span<const int> hierarchy,
+	std::span<const DirectX::XMFLOAT4X4> offsets)
+{
+	uint64_t hash = Skeleton::Hash(hierarchy, offsets);
+	std::lock_guard<std::mutex> lock(mAssetMutex);
+
+	if (auto skeleton = mSkeletons[hash].lock())
+	{
+		// A hash collision keeps its own copy rather than sharing a different rig
+		if (std::ranges::equal(skeleton->Hierarchy, hierarchy)
+			&& skeleton->Offsets.size() == offsets.size()
+			&& std::memcmp(skeleton->Offsets.data(), offsets.data(), offsets.size_bytes()) == 0)
+		{
+			return skeleton;
+		}
+
+		return std::make_shared<const Skeleton>(hierarchy, offsets, hash);
+	}
+
+	ReleaseExpired();
+	auto skeleton = std::make_shared<const Skeleton>(hierarchy, offsets, hash);
+	mSkeletons[hash] = skeleton;
+
+	return skeleton;
+}
+
+std::shared_ptr<const Carol::CompressedAnimationClip> Carol::AnimationAssetManager::FindAnimationClip(uint64_t sourceHash)
+{
+	std::lock_guard<std::mutex> lock(mAssetMutex);
+	auto it = mAnimationClips.find(sourceHash);
+
+	return it == mAnimationClips.end() ? nullptr : it->second.lock();
+}
+
+std::shared_ptr<const Carol::CompressedAnimationClip> Carol::AnimationAssetManager::AddAnimationClip(std::unique_ptr<CompressedAnimationClip> clip)
+{
+	uint64_t hash = clip->GetSourceHash();
+	std::lock_guard<std::mutex> lock(mAssetMutex);
+
+	// Another model may have registered the same clip since the caller last looked
+	if (auto sharedClip = mAnimationClips[hash].lock())
+	{
+		return sharedClip;
+	}
+
+	ReleaseExpired();
+	std::shared_ptr<const CompressedAnimationClip> sharedClip = std::move(clip);
+	mAnimationClips[hash] = sharedClip;
+
+	return sharedClip;
+}
+
+uint32_t Carol::AnimationAssetManager::GetSkeletonsCount()
+{
+	std::lock_guard<std::mutex> lock(mAssetMutex);
+	ReleaseExpired();
+
+	return mSkeletons.size();
+}
+
+uint32_t Carol::AnimationAssetManager::GetAnimationClipsCount()
+{
+	std::lock_guard<std::mutex> lock(mAssetMutex);
+	ReleaseExpired();
+
+	return mAnimationClips.size();
+}
+
+void Carol::AnimationAssetManager::ReleaseExpired()
+{
+	std::erase_if(mSkeletons, [](const auto& entry)
+	{
+		return entry.second.expired();
+	});
+
+	std::erase_if(mAnimationClips, [](const auto& entry)
+	{
+		return entry.second.expired();
+	});
+}
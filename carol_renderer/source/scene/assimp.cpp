@@ -1,15 +1,23 @@
 #include <scene/assimp.h>
 #include <dx12/heap.h>
 #include <dx12/resource.h>
+#include <scene/animation_asset.h>
+#include <scene/compressed_animation.h>
+#include <scene/mesh_cache.h>
 #include <scene/skinned_animation.h>
 #include <scene/texture.h>
+#include <utils/cook_stats.h>
+#include <utils/directory_listing.h>
 #include <utils/exception.h>
+#include <utils/thread_pool.h>
 #include <global.h>
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <algorithm>
-#include <fstream>
+#include <filesystem>
 #include <span>
+#include <unordered_set>
 
 #define aiProcess_Static aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_FixInfacingNormals | aiProcess_PreTransformVertices | aiProcess_ConvertToLeftHanded
 #define aiProcess_Skinned aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_FixInfacingNormals | aiProcess_LimitBoneWeights | aiProcess_ConvertToLeftHanded
@@ -42,34 +50,132 @@ DirectX::XMVECTOR ai2XM(const aiVector3D& aiV)
 	return { aiV.x,aiV.y,aiV.z };
 }
 
+namespace
+{
+	// Records the files an importer opens besides the source, such as glTF buffers and OBJ material libraries
+	class RecordingIOSystem : public Assimp::DefaultIOSystem
+	{
+	public:
+		RecordingIOSystem(std::string_view sourcePath, std::vector<std::string>& openedPaths)
+			:mSourcePath(sourcePath),
+			mOpenedPaths(openedPaths)
+		{
+		}
+
+		Assimp::IOStream* Open(const char* path, const char* mode = "rb")override
+		{
+			Assimp::IOStream* stream = Assimp::DefaultIOSystem::Open(path, mode);
+			std::error_code ec;
+
+			if (stream && !std::filesystem::equivalent(std::filesystem::path(path), mSourcePath, ec))
+			{
+				mOpenedPaths.emplace_back(path);
+			}
+
+			return stream;
+		}
+
+	protected:
+		std::filesystem::path mSourcePath;
+		std::vector<std::string>& mOpenedPaths;
+	};
+}
+
 Carol::AssimpModel::AssimpModel(
 	ModelNode* rootNode,
 	std::string_view path,
 	std::string_view textureDir,
-	bool isSkinned)
-	:Model()
+	bool isSkinned,
+	MeshCacheWriter* cacheWriter)
+	:Model(),
+	mCacheWriter(cacheWriter)
 {
+	std::vector<std::string> dependencies;
 	Assimp::Importer mImporter;
-	const aiScene* scene = mImporter.ReadFile(path.data(), isSkinned ? aiProcess_Skinned : aiProcess_Static);
+	const aiScene* scene = nullptr;
+
+	{
+		CookStageScope stage(COOK_STAGE_IMPORT);
+		// The importer owns the IO system
+		mImporter.SetIOHandler(new RecordingIOSystem(path, dependencies));
+		scene = mImporter.ReadFile(path.data(), isSkinned ? aiProcess_Skinned : aiProcess_Static);
+
+		std::error_code ec;
+		uint64_t size = std::filesystem::file_size(std::filesystem::path(path), ec);
+		stage.AddBytes(ec ? 0 : size);
+	}
+
 	assert(scene);
 
+	std::ranges::sort(dependencies);
+	dependencies.erase(std::ranges::unique(dependencies).begin(), dependencies.end());
+
+	ReadScene(rootNode, scene, textureDir, isSkinned, dependencies);
+}
+
+Carol::AssimpModel::AssimpModel(
+	ModelNode* rootNode,
+	const aiScene* scene,
+	std::string_view textureDir,
+	bool isSkinned,
+	MeshCacheWriter* cacheWriter)
+	:Model(),
+	mCacheWriter(cacheWriter)
+{
+	ReadScene(rootNode, scene, textureDir, isSkinned, {});
+}
+
+void Carol::AssimpModel::ReadScene(
+	ModelNode* rootNode,
+	const aiScene* scene,
+	std::string_view textureDir,
+	bool isSkinned,
+	std::span<const std::string> dependencies)
+{
+	// Texture paths are built with '/', which every platform opens
 	mTexDir = textureDir;
+	std::ranges::replace(mTexDir, '\\', '/');
+	mTexDirListing = std::make_unique<DirectoryListing>(mTexDir);
 	mSkinned = isSkinned;
 
 	if (mSkinned)
 	{
-		ReadBoneHierachy(scene->mRootNode);
+		std::unordered_set<const aiNode*> skeletonNodes;
+		FindSkeletonNodes(scene->mRootNode, scene, skeletonNodes);
+		ReadBoneHierachy(scene->mRootNode, skeletonNodes);
 		ReadBoneOffsets(scene);
+	}
+
+	mSkeleton = gAnimationAssetManager->LoadSkeleton(mBoneHierarchy, mBoneOffsets);
+
+	if (mSkinned)
+	{
+		CookStageScope stage(COOK_STAGE_ANIMATION);
 		ReadAnimations(scene);
 	}
 
+	if (mCacheWriter)
+	{
+		mCacheWriter->WriteDependencies(dependencies);
+		mCacheWriter->WriteSkeleton(mSkeleton->Hierarchy, mSkeleton->Offsets);
+		mCacheWriter->WriteAnimationClips(mAnimationClips);
+	}
+
+	{
+		CookStageScope stage(COOK_STAGE_MESH);
+		ProcessMeshes(scene);
+	}
+
 	ProcessNode(
 		scene->mRootNode,
 		rootNode,
 		scene);
 
 	mFrameTransforms.clear();
+	mBoneHierarchy.clear();
+	mBoneOffsets.clear();
 	mBoneIndices.clear();
+	mTexDirListing.reset();
 }
 
 void Carol::AssimpModel::ProcessNode(
@@ -80,10 +186,12 @@ void Carol::AssimpModel::ProcessNode(
 	for (int i = 0; i < node->mNumMeshes; ++i)
 	{
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		sceneNode->Meshes.push_back(
-			ProcessMesh(
-				mesh,
-				scene));
+		sceneNode->Meshes.push_back(mMeshes.at(mesh->mName.C_Str()).get());
+
+		if (mCacheWriter)
+		{
+			mCacheWriter->WriteNodeMesh(sceneNode->Meshes.back());
+		}
 	}
 	
 	for (int i = 0; i < node->mNumChildren; ++i)
@@ -95,44 +203,114 @@ void Carol::AssimpModel::ProcessNode(
 	}
 }
 
-Carol::Mesh* Carol::AssimpModel::ProcessMesh(
-	aiMesh* mesh,
-	const aiScene* scene)
-{	
-	std::string meshName = mesh->mName.C_Str();
-
-	if (mMeshes.count(meshName) == 0)
+void Carol::AssimpModel::CollectMeshes(
+	aiNode* node,
+	const aiScene* scene,
+	std::vector<aiMesh*>& meshes,
+	std::unordered_set<std::string>& meshNames)
+{
+	// Meshes sharing a name are loaded once, the first one met in scene order wins
+	for (int i = 0; i < node->mNumMeshes; ++i)
 	{
-		ReadMeshVerticesAndIndices(mVertices, mIndices, mesh);
-		ReadMeshBones(mVertices, mesh);
-
-		std::vector<std::pair<std::string, std::vector<std::vector<Vertex>>>> skinnedVertices;
+		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-		for (auto& [name, clip] : mAnimationClips)
+		if (meshNames.insert(mesh->mName.C_Str()).second)
 		{
-			auto skinnedVerticesPair = make_pair(name, std::vector<std::vector<Vertex>>());
-			GetSkinnedVertices(name, mVertices, skinnedVerticesPair.second);
-			skinnedVertices.emplace_back(std::move(skinnedVerticesPair));
+			meshes.push_back(mesh);
 		}
+	}
+
+	for (int i = 0; i < node->mNumChildren; ++i)
+	{
+		CollectMeshes(node->mChildren[i], scene, meshes, meshNames);
+	}
+}
 
-		mMeshes[meshName] = std::make_unique<Mesh>(
-			mVertices,
-			skinnedVertices,
-			mIndices,
-			mSkinned & bool(mesh->mNumBones),
+void Carol::AssimpModel::ProcessMeshes(const aiScene* scene)
+{
+	std::vector<aiMesh*> meshes;
+	std::unordered_set<std::string> meshNames;
+	CollectMeshes(scene->mRootNode, scene, meshes, meshNames);
+
+	std::vector<std::vector<Vertex>> vertices(meshes.size());
+	std::vector<std::vector<uint32_t>> indices(meshes.size());
+	std::vector<std::unique_ptr<Mesh>> cookedMeshes(meshes.size());
+
+	// Every mesh is cooked into its own buffers and only reads the skeleton and the baked poses of the model
+	gThreadPool->ParallelFor(meshes.size(), [&](uint32_t i)
+	{
+		ReadMeshVerticesAndIndices(vertices[i], indices[i], meshes[i]);
+		ReadMeshBones(vertices[i], meshes[i]);
+
+		cookedMeshes[i] = std::make_unique<Mesh>(
+			vertices[i],
+			mFrameTransforms,
+			indices[i],
+			mSkinned && meshes[i]->mNumBones,
 			false);
+	});
 
+	// Textures and the cache are recorded in scene order, so they do not depend on the schedule above
+	for (int i = 0; i < meshes.size(); ++i)
+	{
+		std::string meshName = meshes[i]->mName.C_Str();
+		auto& mesh = mMeshes[meshName];
+		mesh = std::move(cookedMeshes[i]);
+
+		std::string texturePaths[4];
 		ReadMeshMaterialAndTextures(
-			mMeshes[meshName].get(),
-			mesh,
-			scene);
+			meshes[i],
+			scene,
+			texturePaths);
+
+		if (mCacheWriter)
+		{
+			mCacheWriter->WriteMesh(
+				meshName,
+				vertices[i],
+				mesh.get(),
+				texturePaths);
+		}
+
+		// The mesh reads its vertices again when it is uploaded
+		AddMeshUpload(mesh.get(), texturePaths, std::move(vertices[i]));
+		indices[i] = {};
+	}
+}
+
+bool Carol::AssimpModel::FindSkeletonNodes(const aiNode* node, const aiScene* scene, std::unordered_set<const aiNode*>& skeletonNodes)
+{
+	bool isSkeletonNode = false;
+
+	for (int i = 0; i < scene->mNumMeshes && !isSkeletonNode; ++i)
+	{
+		for (int j = 0; j < scene->mMeshes[i]->mNumBones && !isSkeletonNode; ++j)
+		{
+			isSkeletonNode = scene->mMeshes[i]->mBones[j]->mName == node->mName;
+		}
 	}
 
-	return mMeshes[meshName].get();
+	for (int i = 0; i < node->mNumChildren; ++i)
+	{
+		isSkeletonNode |= FindSkeletonNodes(node->mChildren[i], scene, skeletonNodes);
+	}
+
+	if (isSkeletonNode)
+	{
+		skeletonNodes.insert(node);
+	}
+
+	return isSkeletonNode;
 }
 
-void Carol::AssimpModel::ReadBoneHierachy(aiNode* node)
+void Carol::AssimpModel::ReadBoneHierachy(aiNode* node, const std::unordered_set<const aiNode*>& skeletonNodes)
 {
+	// Only bones that skin vertices and their ancestors are kept, mesh nodes and helpers below them are dropped
+	if (skeletonNodes.count(node) == 0)
+	{
+		return;
+	}
+
 	std::string nodeName = node->mName.C_Str();
 	mBoneIndices[nodeName] = mBoneHierarchy.size();
 	mBoneHierarchy.emplace_back(-1);
@@ -145,7 +323,7 @@ void Carol::AssimpModel::ReadBoneHierachy(aiNode* node)
 
 	for (int i = 0; i < node->mNumChildren; ++i)
 	{
-		ReadBoneHierachy(node->mChildren[i]);
+		ReadBoneHierachy(node->mChildren[i], skeletonNodes);
 	}
 }
 
@@ -170,8 +348,8 @@ void Carol::AssimpModel::ReadMeshBones(std::vector<Vertex>& vertices, aiMesh* me
 
 	for (int i = 0; i < mesh->mNumBones; ++i)
 	{
-		std::string boneName = mesh->mBones[i]->mName.C_Str();
-		boneIndex = mBoneIndices[boneName];
+		auto boneIt = mBoneIndices.find(mesh->mBones[i]->mName.C_Str());
+		boneIndex = boneIt != mBoneIndices.end() ? boneIt->second : 0;
 
 		for (int j = 0; j < mesh->mBones[i]->mNumWeights; ++j)
 		{
@@ -224,8 +402,14 @@ void Carol::AssimpModel::ReadAnimations(const aiScene* scene)
 		for (int j = 0; j < animation->mNumChannels; ++j)
 		{
 			auto* nodeAnimation = animation->mChannels[j];
-			std::string boneName = nodeAnimation->mNodeName.C_Str();
-			auto& boneAnimation = boneAnimations[mBoneIndices[boneName]];
+			auto boneIt = mBoneIndices.find(nodeAnimation->mNodeName.C_Str());
+
+			if (boneIt == mBoneIndices.end())
+			{
+				continue;
+			}
+
+			auto& boneAnimation = boneAnimations[boneIt->second];
 
 			auto& transKey = boneAnimation.TranslationKeyframes;
 			auto& scaleKey = boneAnimation.ScaleKeyframes;
@@ -267,22 +451,16 @@ void Carol::AssimpModel::ReadAnimations(const aiScene* scene)
 		animationClip->CalcClipStartTime();
 		animationClip->CalcClipEndTime();
 		std::string clipName = animation->mName.C_Str();
-		mAnimationClips[clipName] = std::move(animationClip);
+
+		// Compression is the slow part of the import, clips already loaded by another model are reused
+		auto clip = gAnimationAssetManager->FindAnimationClip(CompressedAnimationClip::HashSource(*animationClip));
+		mAnimationClips[clipName] = clip ? clip : gAnimationAssetManager->AddAnimationClip(std::make_unique<CompressedAnimationClip>(*animationClip));
 	}
 
 	for (auto& [name, clip] : mAnimationClips)
 	{
 		std::vector<std::vector<DirectX::XMFLOAT4X4>> frameTransforms;
-		float t = clip->GetClipStartTime();
-
-		while (t < clip->GetClipEndTime())
-		{
-			std::vector<DirectX::XMFLOAT4X4> finalTransforms;
-			GetFinalTransforms(name, t, finalTransforms);
-			frameTransforms.emplace_back(std::move(finalTransforms));
-			t += 0.1f;
-		}
-
+		mPoseSamplingStats[name] = SamplePoses(clip.get(), {}, frameTransforms);
 		mFrameTransforms[name] = std::move(frameTransforms);
 	}
 }
@@ -331,9 +509,9 @@ void Carol::AssimpModel::ReadMeshVerticesAndIndices(
 }
 
 void Carol::AssimpModel::ReadMeshMaterialAndTextures(
-	Mesh* mesh,
 	aiMesh* aimesh,
-	const aiScene* scene)
+	const aiScene* scene,
+	std::span<std::string> texturePaths)
 {
 	auto* matData = scene->mMaterials[aimesh->mMaterialIndex];
 
@@ -347,70 +525,24 @@ void Carol::AssimpModel::ReadMeshMaterialAndTextures(
 	matData->GetTexture(aiTextureType_EMISSIVE, 0, &emissivePath);
 	matData->GetTexture(aiTextureType_METALNESS, 0, &metallicRoughnessPath);
 
-	LoadTexture(mesh, diffusePath, aiTextureType_DIFFUSE);
-	LoadTexture(mesh, normalPath, aiTextureType_NORMALS);
-	LoadTexture(mesh, emissivePath, aiTextureType_EMISSIVE);
-	LoadTexture(mesh, metallicRoughnessPath, aiTextureType_METALNESS);
+	texturePaths[0] = ReadTexturePath(diffusePath, TEXTURE_USAGE_DIFFUSE);
+	texturePaths[1] = ReadTexturePath(normalPath, TEXTURE_USAGE_NORMAL);
+	texturePaths[2] = ReadTexturePath(emissivePath, TEXTURE_USAGE_EMISSIVE);
+	texturePaths[3] = ReadTexturePath(metallicRoughnessPath, TEXTURE_USAGE_METALLIC_ROUGHNESS);
 }
 
-void Carol::AssimpModel::LoadTexture(
-	Mesh* mesh,
+std::string Carol::AssimpModel::ReadTexturePath(
 	aiString aiPath,
-	aiTextureType type)
+	TextureUsage usage)
 {
 	std::string path = aiPath.C_Str();
+	size_t lastSeparator = path.find_last_of("\\/");
+	std::string fileName = lastSeparator == std::string::npos ? path : path.substr(lastSeparator + 1);
 
-	bool flag = path.size();
-	if(flag)
+	if (fileName.size() && mTexDirListing->Contains(fileName))
 	{
-		int lastSeparator = path.find_last_of(L'\\');
-
-		if (lastSeparator == -1)
-		{
-			lastSeparator = path.find_last_of(L'/');
-		}
-
-		path = mTexDir + '\\' + path.substr(lastSeparator + 1);
-		
-		std::ifstream fstream(path);
-		flag = fstream.good();
+		return (std::filesystem::path(mTexDir) / fileName).generic_string();
 	}
 
-	if (!flag)
-	{
-		switch (type)
-		{
-		case aiTextureType_DIFFUSE:
-			path = "texture\\default_diffuse_texture.png";
-			break;
-		case aiTextureType_NORMALS:
-			path = "texture\\default_normal_texture.png";
-			break;
-		case aiTextureType_EMISSIVE:
-			path = "texture\\default_emissive_texture.png";
-			break;
-		case aiTextureType_METALNESS:
-			path = "texture\\default_metallic_roughness_texture.png";
-			break;
-		}
-	}
-	
-	switch (type)
-	{
-	case aiTextureType_DIFFUSE:
-		mesh->SetDiffuseTextureIdx(gTextureManager->LoadTexture(path, false));
-		break;
-	case aiTextureType_NORMALS:
-		mesh->SetNormalTextureIdx(gTextureManager->LoadTexture(path, false));
-		break;
-	case aiTextureType_EMISSIVE:
-		mesh->SetEmissiveTextureIdx(gTextureManager->LoadTexture(path, false));
-		break;
-	case aiTextureType_METALNESS:
-		mesh->SetMetallicRoughnessTextureIdx(gTextureManager->LoadTexture(path, false));
-		break;
-	}
-
-	mTexturePath.push_back(path);
+	return std::string(GetDefaultTexturePath(usage));
 }
-
@@ -0,0 +1,93 @@
+#include <scene/bone_palette.h>
+#include <cmath>
+
+namespace
+{
+	// Row vector transforms, so the rotation in column vector form is R[i][j] = M[j][i]
+	DirectX::XMFLOAT4 GetRotationQuaternion(const DirectX::XMFLOAT4X4& M)
+	{
+		float r00 = M.m[0][0], r01 = M.m[1][0], r02 = M.m[2][0];
+		float r10 = M.m[0][1], r11 = M.m[1][1], r12 = M.m[2][1];
+		float r20 = M.m[0][2], r21 = M.m[1][2], r22 = M.m[2][2];
+		float trace = r00 + r11 + r22;
+		DirectX::XMFLOAT4 q;
+
+		if (trace > 0.f)
+		{
+			float s = std::sqrt(trace + 1.f) * 2.f;
+			q = { (r21 - r12) / s, (r02 - r20) / s, (r10 - r01) / s, 0.25f * s };
+		}
+		else if (r00 > r11 && r00 > r22)
+		{
+			float s = std::sqrt(1.f + r00 - r11 - r22) * 2.f;
+			q = { 0.25f * s, (r01 + r10) / s, (r02 + r20) / s, (r21 - r12) / s };
+		}
+		else if (r11 > r22)
+		{
+			float s = std::sqrt(1.f + r11 - r00 - r22) * 2.f;
+			q = { (r01 + r10) / s, 0.25f * s, (r12 + r21) / s, (r02 - r20) / s };
+		}
+		else
+		{
+			float s = std::sqrt(1.f + r22 - r00 - r11) * 2.f;
+			q = { (r02 + r20) / s, (r12 + r21) / s, 0.25f * s, (r10 - r01) / s };
+		}
+
+		DirectX::XMStoreFloat4(&q, DirectX::XMVector4Normalize(DirectX::XMLoadFloat4(&q)));
+		return q;
+	}
+}
+
+uint32_t Carol::GetBonePaletteStride(BonePaletteFormat format)
+{
+	return format == BONE_PALETTE_DUAL_QUATERNION ? 2 : 3;
+}
+
+bool Carol::IsRigidBonePalette(std::span<const DirectX::XMFLOAT4X4> transforms, float tolerance)
+{
+	for (auto& transform : transforms)
+	{
+		DirectX::XMMATRIX M = DirectX::XMLoadFloat4x4(&transform);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (std::abs(DirectX::XMVectorGetX(DirectX::XMVector3Length(M.r[i])) - 1.f) > tolerance)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void Carol::PackBonePalette(std::span<const DirectX::XMFLOAT4X4> transforms, BonePaletteFormat format, std::span<DirectX::XMFLOAT4> palette)
+{
+	for (int i = 0; i < transforms.size(); ++i)
+	{
+		auto& M = transforms[i];
+
+		if (format == BONE_PALETTE_DUAL_QUATERNION)
+		{
+			// dual = 0.5 * t * real
+			DirectX::XMFLOAT4 real = GetRotationQuaternion(M);
+			float tx = 0.5f * M.m[3][0], ty = 0.5f * M.m[3][1], tz = 0.5f * M.m[3][2];
+
+			palette[i * 2] = real;
+			palette[i * 2 + 1] =
+			{
+				real.w * tx + ty * real.z - tz * real.y,
+				real.w * ty + tz * real.x - tx * real.z,
+				real.w * tz + tx * real.y - ty * real.x,
+				-(tx * real.x + ty * real.y + tz * real.z)
+			};
+		}
+		else
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				palette[i * 3 + j] = { M.m[0][j], M.m[1][j], M.m[2][j], M.m[3][j] };
+			}
+		}
+	}
+}
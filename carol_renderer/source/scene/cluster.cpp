@@ -0,0 +1,634 @@
+#include <scene/cluster.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <tuple>
+
+namespace
+{
+	class Quadric
+	{
+	public:
+		void AddPlane(double a, double b, double c, double d)
+		{
+			A00 += a * a; A01 += a * b; A02 += a * c;
+			A11 += b * b; A12 += b * c; A22 += c * c;
+			B0 += a * d; B1 += b * d; B2 += c * d;
+			C += d * d;
+		}
+
+		double Evaluate(const DirectX::XMFLOAT3& p)const
+		{
+			double x = p.x;
+			double y = p.y;
+			double z = p.z;
+
+			return A00 * x * x + 2. * A01 * x * y + 2. * A02 * x * z
+				+ A11 * y * y + 2. * A12 * y * z + A22 * z * z
+				+ 2. * (B0 * x + B1 * y + B2 * z) + C;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			A00 += q.A00; A01 += q.A01; A02 += q.A02;
+			A11 += q.A11; A12 += q.A12; A22 += q.A22;
+			B0 += q.B0; B1 += q.B1; B2 += q.B2;
+			C += q.C;
+			return *this;
+		}
+
+		double A00 = 0., A01 = 0., A02 = 0., A11 = 0., A12 = 0., A22 = 0.;
+		double B0 = 0., B1 = 0., B2 = 0.;
+		double C = 0.;
+	};
+
+	class Collapse
+	{
+	public:
+		double Cost;
+		uint32_t From;
+		uint32_t To;
+	};
+
+	DirectX::XMVECTOR TriangleNormal(const DirectX::XMFLOAT3& p0, const DirectX::XMFLOAT3& p1, const DirectX::XMFLOAT3& p2)
+	{
+		DirectX::XMVECTOR v0 = DirectX::XMLoadFloat3(&p0);
+		DirectX::XMVECTOR e0 = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&p1), v0);
+		DirectX::XMVECTOR e1 = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&p2), v0);
+		return DirectX::XMVector3Cross(e0, e1);
+	}
+}
+
+Carol::ClusterDag::ClusterDag(
+	std::span<const DirectX::XMFLOAT3> positions,
+	std::span<const uint32_t> indices,
+	uint32_t maxVertices,
+	uint32_t maxPrims,
+	uint32_t groupSize,
+	uint32_t maxLevels)
+	:mPositions(positions),
+	mLocked(positions.size(), 0),
+	mMaxVertices(maxVertices),
+	mMaxPrims(maxPrims),
+	mGroupSize(groupSize)
+{
+	std::vector<uint32_t> activeIds;
+	std::vector<uint32_t> rootIds;
+
+	SplitClusters(indices, 0, activeIds);
+	mLevelCount = 1;
+
+	while (activeIds.size() > 1 && mLevelCount < maxLevels)
+	{
+		auto groups = GroupClusters(activeIds);
+		LockVertices(groups, rootIds);
+
+		std::vector<uint32_t> nextIds;
+
+		for (auto& group : groups)
+		{
+			std::vector<uint32_t> simplifiedIndices;
+			float error = 0.f;
+
+			if (!SimplifyGroup(group, simplifiedIndices, error))
+			{
+				rootIds.insert(rootIds.end(), group.begin(), group.end());
+				continue;
+			}
+
+			// The group bounds enclose every child bound and the group error
+			// dominates every child error, which keeps the DAG monotonic
+			DirectX::BoundingSphere bounds = mClusters[group.front()].LodBounds;
+
+			for (auto id : group)
+			{
+				DirectX::BoundingSphere::CreateMerged(bounds, bounds, mClusters[id].LodBounds);
+				error = std::fmax(error, mClusters[id].LodError);
+			}
+
+			for (auto id : group)
+			{
+				mClusters[id].ParentLodBounds = bounds;
+				mClusters[id].ParentLodError = error;
+			}
+
+			std::vector<uint32_t> parentIds;
+			SplitClusters(simplifiedIndices, mLevelCount, parentIds);
+
+			for (auto id : parentIds)
+			{
+				mClusters[id].LodBounds = bounds;
+				mClusters[id].LodError = error;
+			}
+
+			nextIds.insert(nextIds.end(), parentIds.begin(), parentIds.end());
+		}
+
+		if (nextIds.empty())
+		{
+			break;
+		}
+
+		activeIds = std::move(nextIds);
+		++mLevelCount;
+	}
+}
+
+const std::vector<Carol::Cluster>& Carol::ClusterDag::GetClusters()const
+{
+	return mClusters;
+}
+
+uint32_t Carol::ClusterDag::GetLevelCount()const
+{
+	return mLevelCount;
+}
+
+void Carol::ClusterDag::SplitClusters(
+	std::span<const uint32_t> indices,
+	uint32_t level,
+	std::vector<uint32_t>& clusterIds)
+{
+	std::vector<uint32_t> globalIds;
+	std::unordered_map<uint32_t, uint32_t> localIds;
+	std::vector<uint32_t> tris(indices.size());
+
+	for (int i = 0; i < indices.size(); ++i)
+	{
+		auto [itr, inserted] = localIds.try_emplace(indices[i], uint32_t(globalIds.size()));
+
+		if (inserted)
+		{
+			globalIds.push_back(indices[i]);
+		}
+
+		tris[i] = itr->second;
+	}
+
+	uint32_t triCount = tris.size() / 3;
+	std::vector<uint32_t> vertexTriOffsets(globalIds.size() + 1, 0);
+	std::vector<uint32_t> vertexTris(tris.size());
+
+	for (auto v : tris)
+	{
+		++vertexTriOffsets[v + 1];
+	}
+
+	for (int i = 0; i < globalIds.size(); ++i)
+	{
+		vertexTriOffsets[i + 1] += vertexTriOffsets[i];
+	}
+
+	std::vector<uint32_t> fill(vertexTriOffsets.begin(), vertexTriOffsets.end() - 1);
+
+	for (int i = 0; i < tris.size(); ++i)
+	{
+		vertexTris[fill[tris[i]]++] = i / 3;
+	}
+
+	// Grow each cluster over triangle adjacency, always taking the candidate
+	// adding the fewest new vertices so that clusters stay compact and full
+	std::vector<uint8_t> emitted(triCount, 0);
+	std::vector<uint32_t> vertexStamp(globalIds.size(), UINT32_MAX);
+	uint32_t seed = 0;
+
+	while (true)
+	{
+		while (seed < triCount && emitted[seed])
+		{
+			++seed;
+		}
+
+		if (seed == triCount)
+		{
+			break;
+		}
+
+		uint32_t stamp = clusterIds.size();
+		uint32_t vertexCount = 0;
+		std::vector<uint32_t> candidates = { seed };
+		std::vector<DirectX::XMFLOAT3> points;
+		Cluster cluster;
+
+		while (cluster.Indices.size() / 3 < mMaxPrims)
+		{
+			uint32_t best = UINT32_MAX;
+			uint32_t bestNewCount = 4;
+
+			for (auto tri : candidates)
+			{
+				if (emitted[tri])
+				{
+					continue;
+				}
+
+				uint32_t newCount = 0;
+
+				for (int j = 0; j < 3; ++j)
+				{
+					uint32_t v = tris[tri * 3 + j];
+					newCount += vertexStamp[v] != stamp && (j == 0 || v != tris[tri * 3]) && (j < 2 || v != tris[tri * 3 + 1]);
+				}
+
+				if (newCount < bestNewCount || (newCount == bestNewCount && tri < best))
+				{
+					best = tri;
+					bestNewCount = newCount;
+				}
+			}
+
+			if (best == UINT32_MAX || vertexCount + bestNewCount > mMaxVertices)
+			{
+				break;
+			}
+
+			emitted[best] = 1;
+
+			for (int j = 0; j < 3; ++j)
+			{
+				uint32_t v = tris[best * 3 + j];
+				cluster.Indices.push_back(globalIds[v]);
+
+				if (vertexStamp[v] != stamp)
+				{
+					vertexStamp[v] = stamp;
+					points.push_back(mPositions[globalIds[v]]);
+					++vertexCount;
+
+					for (int k = vertexTriOffsets[v]; k < vertexTriOffsets[v + 1]; ++k)
+					{
+						if (!emitted[vertexTris[k]])
+						{
+							candidates.push_back(vertexTris[k]);
+						}
+					}
+				}
+			}
+
+			std::erase_if(candidates, [&](uint32_t tri) { return emitted[tri]; });
+		}
+
+		DirectX::BoundingSphere::CreateFromPoints(cluster.LodBounds, points.size(), points.data(), sizeof(DirectX::XMFLOAT3));
+		cluster.ParentLodBounds = cluster.LodBounds;
+		cluster.Level = level;
+
+		clusterIds.push_back(mClusters.size());
+		mClusters.push_back(std::move(cluster));
+	}
+}
+
+std::vector<std::vector<uint32_t>> Carol::ClusterDag::GroupClusters(std::span<const uint32_t> clusterIds)const
+{
+	// Clusters sharing more vertices are more likely to share long borders,
+	// grouping them unlocks the most edges for the following simplification
+	std::vector<std::pair<uint32_t, uint32_t>> vertexClusters;
+
+	for (int i = 0; i < clusterIds.size(); ++i)
+	{
+		for (auto idx : mClusters[clusterIds[i]].Indices)
+		{
+			vertexClusters.emplace_back(idx, i);
+		}
+	}
+
+	std::sort(vertexClusters.begin(), vertexClusters.end());
+	vertexClusters.erase(std::unique(vertexClusters.begin(), vertexClusters.end()), vertexClusters.end());
+
+	std::vector<std::map<uint32_t, uint32_t>> adjacency(clusterIds.size());
+
+	for (int begin = 0, end = 0; begin < vertexClusters.size(); begin = end)
+	{
+		while (end < vertexClusters.size() && vertexClusters[end].first == vertexClusters[begin].first)
+		{
+			++end;
+		}
+
+		for (int i = begin; i < end; ++i)
+		{
+			for (int j = i + 1; j < end; ++j)
+			{
+				++adjacency[vertexClusters[i].second][vertexClusters[j].second];
+				++adjacency[vertexClusters[j].second][vertexClusters[i].second];
+			}
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> groups;
+	std::vector<uint8_t> grouped(clusterIds.size(), 0);
+
+	for (int seed = 0; seed < clusterIds.size(); ++seed)
+	{
+		if (grouped[seed])
+		{
+			continue;
+		}
+
+		std::vector<uint32_t> group = { uint32_t(seed) };
+		grouped[seed] = 1;
+
+		while (group.size() < mGroupSize)
+		{
+			uint32_t best = UINT32_MAX;
+			uint32_t bestWeight = 0;
+
+			for (auto member : group)
+			{
+				for (auto& [neighbor, weight] : adjacency[member])
+				{
+					if (!grouped[neighbor] && (weight > bestWeight || (weight == bestWeight && neighbor < best)))
+					{
+						best = neighbor;
+						bestWeight = weight;
+					}
+				}
+			}
+
+			if (best == UINT32_MAX)
+			{
+				break;
+			}
+
+			group.push_back(best);
+			grouped[best] = 1;
+		}
+
+		for (auto& member : group)
+		{
+			member = clusterIds[member];
+		}
+
+		groups.push_back(std::move(group));
+	}
+
+	return groups;
+}
+
+void Carol::ClusterDag::LockVertices(
+	std::span<const std::vector<uint32_t>> groups,
+	std::span<const uint32_t> rootIds)
+{
+	// Vertices shared between groups must survive simplification untouched,
+	// otherwise neighboring groups selected at different levels would crack
+	std::vector<uint32_t> owner(mPositions.size(), UINT32_MAX);
+	std::fill(mLocked.begin(), mLocked.end(), 0);
+
+	auto mark = [&](const Cluster& cluster, uint32_t ownerId)
+	{
+		for (auto idx : cluster.Indices)
+		{
+			if (owner[idx] == UINT32_MAX)
+			{
+				owner[idx] = ownerId;
+			}
+			else if (owner[idx] != ownerId)
+			{
+				mLocked[idx] = 1;
+			}
+		}
+	};
+
+	for (int i = 0; i < groups.size(); ++i)
+	{
+		for (auto id : groups[i])
+		{
+			mark(mClusters[id], i);
+		}
+	}
+
+	for (int i = 0; i < rootIds.size(); ++i)
+	{
+		mark(mClusters[rootIds[i]], groups.size() + i);
+	}
+}
+
+bool Carol::ClusterDag::SimplifyGroup(
+	std::span<const uint32_t> group,
+	std::vector<uint32_t>& indices,
+	float& error)const
+{
+	std::vector<uint32_t> globalIds;
+	std::unordered_map<uint32_t, uint32_t> localIds;
+	std::vector<uint32_t> tris;
+
+	for (auto id : group)
+	{
+		for (auto idx : mClusters[id].Indices)
+		{
+			auto [itr, inserted] = localIds.try_emplace(idx, uint32_t(globalIds.size()));
+
+			if (inserted)
+			{
+				globalIds.push_back(idx);
+			}
+
+			tris.push_back(itr->second);
+		}
+	}
+
+	uint32_t vertexCount = globalIds.size();
+	uint32_t triCount = tris.size() / 3;
+	uint32_t originTriCount = triCount;
+	uint32_t targetTriCount = triCount / 2;
+
+	std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+	std::vector<uint8_t> alive(triCount, 1);
+	std::vector<Quadric> quadrics(vertexCount);
+
+	for (int i = 0; i < vertexCount; ++i)
+	{
+		positions[i] = mPositions[globalIds[i]];
+		locked[i] = mLocked[globalIds[i]];
+	}
+
+	// Open edges of the group are either mesh borders or borders to other groups
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> edgeCount;
+
+	for (int i = 0; i < triCount; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			uint32_t v0 = tris[i * 3 + j];
+			uint32_t v1 = tris[i * 3 + (j + 1) % 3];
+			++edgeCount[std::minmax(v0, v1)];
+		}
+
+		DirectX::XMVECTOR normal = DirectX::XMVector3Normalize(TriangleNormal(positions[tris[i * 3]], positions[tris[i * 3 + 1]], positions[tris[i * 3 + 2]]));
+		DirectX::XMFLOAT3 n;
+		DirectX::XMStoreFloat3(&n, normal);
+
+		auto& p = positions[tris[i * 3]];
+		double d = -(double(n.x) * p.x + double(n.y) * p.y + double(n.z) * p.z);
+
+		Quadric q;
+		q.AddPlane(n.x, n.y, n.z, d);
+
+		for (int j = 0; j < 3; ++j)
+		{
+			quadrics[tris[i * 3 + j]] += q;
+		}
+	}
+
+	for (auto& [edge, count] : edgeCount)
+	{
+		if (count == 1)
+		{
+			locked[edge.first] = 1;
+			locked[edge.second] = 1;
+		}
+	}
+
+	double maxCost = 0.;
+
+	while (triCount > targetTriCount)
+	{
+		std::vector<std::vector<uint32_t>> vertexTris(vertexCount);
+		std::vector<Collapse> collapses;
+
+		for (int i = 0; i < alive.size(); ++i)
+		{
+			if (!alive[i])
+			{
+				continue;
+			}
+
+			for (int j = 0; j < 3; ++j)
+			{
+				uint32_t v0 = tris[i * 3 + j];
+				uint32_t v1 = tris[i * 3 + (j + 1) % 3];
+				vertexTris[v0].push_back(i);
+
+				if (!locked[v0])
+				{
+					collapses.push_back({ 0., v0, v1 });
+				}
+
+				if (!locked[v1])
+				{
+					collapses.push_back({ 0., v1, v0 });
+				}
+			}
+		}
+
+		for (auto& collapse : collapses)
+		{
+			Quadric q = quadrics[collapse.From];
+			q += quadrics[collapse.To];
+			collapse.Cost = std::fmax(q.Evaluate(positions[collapse.To]), 0.);
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& c0, const Collapse& c1)
+		{
+			return std::tie(c0.Cost, c0.From, c0.To) < std::tie(c1.Cost, c1.From, c1.To);
+		});
+
+		std::vector<uint8_t> touched(vertexCount, 0);
+		uint32_t collapsedCount = 0;
+
+		for (auto& collapse : collapses)
+		{
+			if (triCount <= targetTriCount)
+			{
+				break;
+			}
+
+			if (touched[collapse.From] || touched[collapse.To])
+			{
+				continue;
+			}
+
+			// Reject collapses flipping or degenerating any remaining triangle
+			bool valid = true;
+
+			for (auto tri : vertexTris[collapse.From])
+			{
+				uint32_t* v = &tris[tri * 3];
+
+				if (v[0] == collapse.To || v[1] == collapse.To || v[2] == collapse.To)
+				{
+					continue;
+				}
+
+				DirectX::XMFLOAT3 p[3] = { positions[v[0]],positions[v[1]],positions[v[2]] };
+				DirectX::XMVECTOR before = TriangleNormal(p[0], p[1], p[2]);
+
+				for (int j = 0; j < 3; ++j)
+				{
+					if (v[j] == collapse.From)
+					{
+						p[j] = positions[collapse.To];
+					}
+				}
+
+				DirectX::XMVECTOR after = TriangleNormal(p[0], p[1], p[2]);
+
+				if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(before, after)) <= 0.f)
+				{
+					valid = false;
+					break;
+				}
+			}
+
+			if (!valid)
+			{
+				continue;
+			}
+
+			for (auto tri : vertexTris[collapse.From])
+			{
+				uint32_t* v = &tris[tri * 3];
+
+				if (v[0] == collapse.To || v[1] == collapse.To || v[2] == collapse.To)
+				{
+					alive[tri] = 0;
+					--triCount;
+				}
+				else
+				{
+					for (int j = 0; j < 3; ++j)
+					{
+						v[j] = v[j] == collapse.From ? collapse.To : v[j];
+					}
+				}
+
+				touched[v[0]] = 1;
+				touched[v[1]] = 1;
+				touched[v[2]] = 1;
+			}
+
+			quadrics[collapse.To] += quadrics[collapse.From];
+			maxCost = std::fmax(maxCost, collapse.Cost);
+			touched[collapse.From] = 1;
+			touched[collapse.To] = 1;
+			++collapsedCount;
+		}
+
+		if (collapsedCount == 0)
+		{
+			break;
+		}
+	}
+
+	// Groups that barely simplify would only duplicate triangles up the DAG
+	if (triCount == 0 || triCount > originTriCount * 0.85f)
+	{
+		return false;
+	}
+
+	indices.clear();
+
+	for (int i = 0; i < alive.size(); ++i)
+	{
+		if (alive[i])
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				indices.push_back(globalIds[tris[i * 3 + j]]);
+			}
+		}
+	}
+
+	error = std::sqrt(maxCost);
+	return true;
+}
@@ -0,0 +1,666 @@
+#include <scene/compressed_animation.h>
+#include <scene/pose.h>
+#include <scene/skinned_animation.h>
+#include <utils/binary.h>
+#include <utils/frame_arena.h>
+#include <utils/hash.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+	using DirectX::operator+;
+	using DirectX::operator-;
+	using DirectX::operator*;
+
+	enum TrackType
+	{
+		TRANSLATION_TRACK, ROTATION_TRACK, SCALE_TRACK, TRACK_TYPE_COUNT
+	};
+
+	// Reduction never spans more keys than this, it bounds the quadratic error check
+	constexpr uint32_t MAX_REDUCED_SPAN = 128;
+	constexpr float SQRT2 = 1.41421356f;
+
+	class RawTrack
+	{
+	public:
+		std::vector<float> Times;
+		std::vector<DirectX::XMFLOAT4> Values;
+	};
+
+	class QuantizedTrack
+	{
+	public:
+		std::vector<DirectX::XMFLOAT4> Decoded;
+		std::vector<std::array<uint16_t, 3>> Values;
+		std::vector<uint32_t> Kept;
+	};
+
+	uint16_t Quantize(float x, float min, float scale, uint32_t maxValue)
+	{
+		return scale == 0.f ? 0 : std::clamp<float>(std::round((x - min) / scale), 0.f, maxValue);
+	}
+
+	std::array<uint16_t, 3> EncodeQuat(const DirectX::XMFLOAT4& quat)
+	{
+		float c[4] = { quat.x,quat.y,quat.z,quat.w };
+		uint32_t maxIdx = 0;
+
+		for (int i = 1; i < 4; ++i)
+		{
+			maxIdx = std::abs(c[i]) > std::abs(c[maxIdx]) ? i : maxIdx;
+		}
+
+		float sign = c[maxIdx] < 0.f ? -1.f : 1.f;
+		uint16_t q[3];
+
+		for (int i = 0, j = 0; i < 4; ++i)
+		{
+			if (i != maxIdx)
+			{
+				q[j++] = Quantize(c[i] * sign * SQRT2, -1.f, 2.f / 32767.f, 32767);
+			}
+		}
+
+		return { uint16_t(q[0] | (maxIdx >> 1) << 15), uint16_t(q[1] | (maxIdx & 1) << 15), q[2] };
+	}
+
+	DirectX::XMFLOAT4 DecodeQuat(uint16_t w0, uint16_t w1, uint16_t w2)
+	{
+		uint32_t maxIdx = (w0 >> 15) << 1 | (w1 >> 15);
+		float q[3] =
+		{
+			((w0 & 0x7fff) / 32767.f * 2.f - 1.f) / SQRT2,
+			((w1 & 0x7fff) / 32767.f * 2.f - 1.f) / SQRT2,
+			((w2 & 0x7fff) / 32767.f * 2.f - 1.f) / SQRT2
+		};
+
+		float c[4];
+		c[maxIdx] = std::sqrt(std::fmax(1.f - q[0] * q[0] - q[1] * q[1] - q[2] * q[2], 0.f));
+
+		for (int i = 0, j = 0; i < 4; ++i)
+		{
+			if (i != maxIdx)
+			{
+				c[i] = q[j++];
+			}
+		}
+
+		return { c[0],c[1],c[2],c[3] };
+	}
+
+	std::array<uint16_t, 3> EncodeValue(const DirectX::XMFLOAT4& value, TrackType type, const Carol::CompressedTrackRange& range)
+	{
+		if (type == ROTATION_TRACK)
+		{
+			return EncodeQuat(value);
+		}
+
+		auto& min = type == TRANSLATION_TRACK ? range.TranslationMin : range.ScaleMin;
+		auto& scale = type == TRANSLATION_TRACK ? range.TranslationScale : range.ScaleScale;
+
+		return { Quantize(value.x, min.x, scale.x, 65535), Quantize(value.y, min.y, scale.y, 65535), Quantize(value.z, min.z, scale.z, 65535) };
+	}
+
+	DirectX::XMFLOAT4 DecodeValue(const std::array<uint16_t, 3>& words, TrackType type, const Carol::CompressedTrackRange& range)
+	{
+		if (type == ROTATION_TRACK)
+		{
+			return DecodeQuat(words[0], words[1], words[2]);
+		}
+
+		auto& min = type == TRANSLATION_TRACK ? range.TranslationMin : range.ScaleMin;
+		auto& scale = type == TRANSLATION_TRACK ? range.TranslationScale : range.ScaleScale;
+
+		return { min.x + words[0] * scale.x, min.y + words[1] * scale.y, min.z + words[2] * scale.z, 0.f };
+	}
+
+	DirectX::XMVECTOR InterpolateKeys(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, float alpha, bool isQuat)
+	{
+		DirectX::XMVECTOR va = DirectX::XMLoadFloat4(&a);
+		DirectX::XMVECTOR vb = DirectX::XMLoadFloat4(&b);
+
+		if (!isQuat)
+		{
+			return DirectX::XMVectorLerp(va, vb, alpha);
+		}
+
+		// Same normalized lerp as the decoder
+		if (DirectX::XMVectorGetX(DirectX::XMVector4Dot(va, vb)) < 0.f)
+		{
+			vb = DirectX::XMVectorNegate(vb);
+		}
+
+		return DirectX::XMVector4Normalize(DirectX::XMVectorLerp(va, vb, alpha));
+	}
+
+	float KeyError(DirectX::FXMVECTOR v, const DirectX::XMFLOAT4& original, bool isQuat)
+	{
+		DirectX::XMVECTOR o = DirectX::XMLoadFloat4(&original);
+
+		if (isQuat)
+		{
+			float dot = std::abs(DirectX::XMVectorGetX(DirectX::XMVector4Dot(v, o)));
+			return 2.f * std::acos(std::fmin(dot, 1.f));
+		}
+
+		return DirectX::XMVectorGetX(DirectX::XMVector3Length(v - o));
+	}
+
+	void ReduceKeys(const RawTrack& raw, QuantizedTrack& track, std::span<const float> times, bool isQuat, float tolerance)
+	{
+		uint32_t count = times.size();
+		track.Kept = { 0 };
+
+		auto isValid = [&](uint32_t prev, uint32_t next)
+		{
+			float dt = times[next] - times[prev];
+
+			for (uint32_t k = prev + 1; k < next; ++k)
+			{
+				float alpha = dt > 0.f ? (times[k] - times[prev]) / dt : 0.f;
+
+				if (KeyError(InterpolateKeys(track.Decoded[prev], track.Decoded[next], alpha, isQuat), raw.Values[k], isQuat) > tolerance)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		};
+
+		// Constant and linear tracks collapse to their end points without the quadratic search
+		if (count > 1 && isValid(0, count - 1))
+		{
+			track.Kept.push_back(count - 1);
+			return;
+		}
+
+		for (uint32_t prev = 0, next = 2; next < count; ++next)
+		{
+			if (next - prev > MAX_REDUCED_SPAN || !isValid(prev, next))
+			{
+				prev = next - 1;
+				track.Kept.push_back(prev);
+			}
+		}
+
+		if (count > 1)
+		{
+			track.Kept.push_back(count - 1);
+		}
+	}
+
+	RawTrack GetRawTrack(const Carol::BoneAnimation& boneAnimation, TrackType type)
+	{
+		RawTrack track;
+
+		if (type == TRANSLATION_TRACK)
+		{
+			for (auto& key : boneAnimation.TranslationKeyframes)
+			{
+				track.Times.push_back(key.TimePos);
+				track.Values.push_back({ key.Translation.x,key.Translation.y,key.Translation.z,0.f });
+			}
+
+			if (track.Values.empty())
+			{
+				track.Times.push_back(0.f);
+				track.Values.push_back({ 0.f,0.f,0.f,0.f });
+			}
+		}
+		else if (type == ROTATION_TRACK)
+		{
+			for (auto& key : boneAnimation.RotationQuatKeyframes)
+			{
+				track.Times.push_back(key.TimePos);
+				DirectX::XMStoreFloat4(&track.Values.emplace_back(), DirectX::XMQuaternionNormalize(DirectX::XMLoadFloat4(&key.RotationQuat)));
+			}
+
+			if (track.Values.empty())
+			{
+				track.Times.push_back(0.f);
+				track.Values.push_back({ 0.f,0.f,0.f,1.f });
+			}
+		}
+		else
+		{
+			for (auto& key : boneAnimation.ScaleKeyframes)
+			{
+				track.Times.push_back(key.TimePos);
+				track.Values.push_back({ key.Scale.x,key.Scale.y,key.Scale.z,0.f });
+			}
+
+			if (track.Values.empty())
+			{
+				track.Times.push_back(0.f);
+				track.Values.push_back({ 1.f,1.f,1.f,0.f });
+			}
+		}
+
+		return track;
+	}
+
+	void GetTrackRange(const RawTrack& track, DirectX::XMFLOAT3& min, DirectX::XMFLOAT3& scale)
+	{
+		DirectX::XMVECTOR boxMin = DirectX::XMLoadFloat4(&track.Values[0]);
+		DirectX::XMVECTOR boxMax = boxMin;
+
+		for (auto& value : track.Values)
+		{
+			boxMin = DirectX::XMVectorMin(boxMin, DirectX::XMLoadFloat4(&value));
+			boxMax = DirectX::XMVectorMax(boxMax, DirectX::XMLoadFloat4(&value));
+		}
+
+		DirectX::XMStoreFloat3(&min, boxMin);
+		DirectX::XMStoreFloat3(&scale, (boxMax - boxMin) * (1.f / 65535.f));
+	}
+
+	// Per bone sampling state gathered from a block before the vectorized part of the decode:
+	// translation a/b xyz, rotation a/b xyzw, scale a/b xyz, then one lerp factor per track
+	enum SampleComponent
+	{
+		TA = 0, TB = 3, QA = 6, QB = 10, SA = 14, SB = 17, T_ALPHA = 20, Q_ALPHA = 21, S_ALPHA = 22, SAMPLE_COMPONENT_COUNT = 23
+	};
+}
+
+Carol::CompressedAnimationClip::CompressedAnimationClip(const AnimationClip& clip, const AnimationCompressionSettings& settings)
+{
+	uint32_t boneCount = clip.BoneAnimations.size();
+	float startTime = D3D12_FLOAT32_MAX;
+	float endTime = 0.f;
+
+	std::vector<RawTrack> rawTracks;
+	std::vector<CompressedTrackRange> trackRanges(boneCount);
+
+	for (int i = 0; i < boneCount; ++i)
+	{
+		for (int type = 0; type < TRACK_TYPE_COUNT; ++type)
+		{
+			rawTracks.push_back(GetRawTrack(clip.BoneAnimations[i], TrackType(type)));
+		}
+
+		startTime = std::fmin(startTime, clip.BoneAnimations[i].GetStartTime());
+		endTime = std::fmax(endTime, clip.BoneAnimations[i].GetEndTime());
+
+		GetTrackRange(rawTracks[i * TRACK_TYPE_COUNT + TRANSLATION_TRACK], trackRanges[i].TranslationMin, trackRanges[i].TranslationScale);
+		GetTrackRange(rawTracks[i * TRACK_TYPE_COUNT + SCALE_TRACK], trackRanges[i].ScaleMin, trackRanges[i].ScaleScale);
+	}
+
+	startTime = std::fmin(startTime, endTime);
+	mHeader.SourceHash = HashSource(clip, settings);
+	mHeader.BoneCount = boneCount;
+	mHeader.StartTime = startTime;
+	mHeader.EndTime = endTime;
+	mHeader.BlockDuration = settings.BlockDuration;
+	mHeader.BlockCount = std::max<uint32_t>(std::ceil((endTime - startTime) / settings.BlockDuration), 1);
+
+	// Quantize first so that key reduction measures the error the decoder will actually produce
+	std::vector<QuantizedTrack> tracks(rawTracks.size());
+
+	for (int i = 0; i < rawTracks.size(); ++i)
+	{
+		auto& raw = rawTracks[i];
+		auto& track = tracks[i];
+		auto& range = trackRanges[i / TRACK_TYPE_COUNT];
+		TrackType type = TrackType(i % TRACK_TYPE_COUNT);
+
+		for (auto& value : raw.Values)
+		{
+			auto& words = track.Values.emplace_back(EncodeValue(value, type, range));
+			track.Decoded.push_back(DecodeValue(words, type, range));
+		}
+
+		float tolerance = type == TRANSLATION_TRACK ? settings.TranslationError : (type == ROTATION_TRACK ? settings.RotationError : settings.ScaleError);
+		ReduceKeys(raw, track, raw.Times, type == ROTATION_TRACK, tolerance);
+	}
+
+	BinaryWriter writer;
+	writer.Write(mHeader);
+	writer.WriteArray(std::span<const CompressedTrackRange>(trackRanges));
+
+	std::vector<uint32_t> keyOffsets;
+	std::vector<uint16_t> times;
+	std::vector<uint16_t> values[3];
+
+	for (int b = 0; b < mHeader.BlockCount; ++b)
+	{
+		float blockStart = startTime + b * settings.BlockDuration;
+		float blockEnd = std::fmin(blockStart + settings.BlockDuration, endTime);
+		float timeScale = blockEnd > blockStart ? 65535.f / (blockEnd - blockStart) : 0.f;
+
+		keyOffsets.clear();
+		times.clear();
+		std::ranges::for_each(values, [](std::vector<uint16_t>& v) { v.clear(); });
+
+		auto pushKey = [&](float time, const std::array<uint16_t, 3>& words)
+		{
+			times.push_back(std::clamp<float>(std::round((time - blockStart) * timeScale), 0.f, 65535.f));
+
+			for (int c = 0; c < 3; ++c)
+			{
+				values[c].push_back(words[c]);
+			}
+		};
+
+		for (int i = 0; i < tracks.size(); ++i)
+		{
+			auto& raw = rawTracks[i];
+			auto& track = tracks[i];
+			auto& range = trackRanges[i / TRACK_TYPE_COUNT];
+			TrackType type = TrackType(i % TRACK_TYPE_COUNT);
+			keyOffsets.push_back(times.size());
+
+			if (track.Kept.size() == 1)
+			{
+				pushKey(blockStart, track.Values[0]);
+				continue;
+			}
+
+			// Blocks are closed by keys resampled at their bounds, so times stay block relative
+			auto sample = [&](float time)
+			{
+				auto it = std::upper_bound(track.Kept.begin(), track.Kept.end(), time, [&](float time, uint32_t idx)
+				{
+					return time < raw.Times[idx];
+				});
+
+				uint32_t next = std::min<uint32_t>(std::max<uint32_t>(it - track.Kept.begin(), 1), track.Kept.size() - 1);
+				uint32_t prev = track.Kept[next - 1];
+				next = track.Kept[next];
+
+				float dt = raw.Times[next] - raw.Times[prev];
+				float alpha = dt > 0.f ? std::clamp((time - raw.Times[prev]) / dt, 0.f, 1.f) : 0.f;
+				DirectX::XMFLOAT4 value;
+				DirectX::XMStoreFloat4(&value, InterpolateKeys(track.Decoded[prev], track.Decoded[next], alpha, type == ROTATION_TRACK));
+
+				return EncodeValue(value, type, range);
+			};
+
+			pushKey(blockStart, sample(blockStart));
+
+			for (auto idx : track.Kept)
+			{
+				if (raw.Times[idx] > blockStart && raw.Times[idx] < blockEnd)
+				{
+					pushKey(raw.Times[idx], track.Values[idx]);
+				}
+			}
+
+			if (blockEnd > blockStart)
+			{
+				pushKey(blockEnd, sample(blockEnd));
+			}
+		}
+
+		keyOffsets.push_back(times.size());
+
+		writer.WriteArray(std::span<const uint32_t>(keyOffsets));
+		writer.WriteArray(std::span<const uint16_t>(times));
+
+		for (auto& v : values)
+		{
+			writer.WriteArray(std::span<const uint16_t>(v));
+		}
+	}
+
+	auto data = writer.GetData();
+	mData.assign(data.begin(), data.end());
+	LoadBlocks();
+}
+
+Carol::CompressedAnimationClip::CompressedAnimationClip(std::span<const uint8_t> data)
+	:mData(data.begin(), data.end())
+{
+	LoadBlocks();
+}
+
+float Carol::CompressedAnimationClip::GetClipStartTime()const
+{
+	return mHeader.StartTime;
+}
+
+float Carol::CompressedAnimationClip::GetClipEndTime()const
+{
+	return mHeader.EndTime;
+}
+
+uint32_t Carol::CompressedAnimationClip::GetBoneCount()const
+{
+	return mHeader.BoneCount;
+}
+
+std::span<const uint8_t> Carol::CompressedAnimationClip::GetData()const
+{
+	return mData;
+}
+
+uint64_t Carol::CompressedAnimationClip::GetSourceHash()const
+{
+	return mHeader.SourceHash;
+}
+
+uint64_t Carol::CompressedAnimationClip::HashSource(const AnimationClip& clip, const AnimationCompressionSettings& settings)
+{
+	uint64_t hash = Hash64(&settings, sizeof(settings));
+
+	// Key counts go in with the keys, so keys cannot move between tracks without changing the hash
+	auto hashKeys = [&](const auto& keys)
+	{
+		uint32_t keyCount = keys.size();
+		hash = Hash64(&keyCount, sizeof(keyCount), hash);
+		hash = Hash64(keys.data(), keys.size() * sizeof(keys[0]), hash);
+	};
+
+	for (auto& boneAnimation : clip.BoneAnimations)
+	{
+		hashKeys(boneAnimation.TranslationKeyframes);
+		hashKeys(boneAnimation.RotationQuatKeyframes);
+		hashKeys(boneAnimation.ScaleKeyframes);
+	}
+
+	return hash;
+}
+
+uint64_t Carol::CompressedAnimationClip::ReadSourceHash(std::span<const uint8_t> data)
+{
+	BinaryReader reader(data);
+	return reader.Read<CompressedClipHeader>().SourceHash;
+}
+
+void Carol::CompressedAnimationClip::Interpolate(float t, std::span<DirectX::XMFLOAT4X4> boneTransforms)const
+{
+	AnimationCursor cursor;
+	Interpolate(t, cursor, boneTransforms);
+}
+
+void Carol::CompressedAnimationClip::Interpolate(float t, AnimationCursor& cursor, std::span<DirectX::XMFLOAT4X4> boneTransforms)const
+{
+	auto& arena = FrameArena::GetThreadArena();
+	size_t marker = arena.GetMarker();
+
+	LocalPose pose(arena, std::min<uint32_t>(boneTransforms.size(), mHeader.BoneCount));
+	Sample(t, cursor, pose);
+	BuildLocalTransforms(pose, boneTransforms);
+
+	arena.Rewind(marker);
+}
+
+void Carol::CompressedAnimationClip::Sample(float t, AnimationCursor& cursor, LocalPose& pose)const
+{
+	auto& arena = FrameArena::GetThreadArena();
+	size_t marker = arena.GetMarker();
+
+	uint32_t boneCount = std::min(pose.BoneCount, mHeader.BoneCount);
+	cursor.BoneCursors.resize(boneCount);
+
+	uint32_t paddedCount = (boneCount + 3) / 4 * 4;
+	auto components = arena.Allocate<float>(SAMPLE_COMPONENT_COUNT * paddedCount);
+	std::ranges::fill(components, 0.f);
+
+	t = std::clamp(t, mHeader.StartTime, mHeader.EndTime);
+	uint32_t blockIdx = std::min<uint32_t>((t - mHeader.StartTime) / mHeader.BlockDuration, mHeader.BlockCount - 1);
+	auto& block = mBlocks[blockIdx];
+
+	// Key times are stored relative to the block, bring t into the same [0, 65535] range
+	float blockStart = mHeader.StartTime + blockIdx * mHeader.BlockDuration;
+	float blockEnd = std::fmin(blockStart + mHeader.BlockDuration, mHeader.EndTime);
+	float localT = blockEnd > blockStart ? (t - blockStart) * (65535.f / (blockEnd - blockStart)) : 0.f;
+
+	// Scalar part: find the key pair of every track, the cursor holds the last pair inside the block
+	auto findKeys = [&](uint32_t track, uint32_t& keyIdx, float& alpha)
+	{
+		uint32_t begin = block.KeyOffsets[track];
+		uint32_t end = block.KeyOffsets[track + 1];
+
+		if (end - begin == 1 || localT <= block.Times[begin])
+		{
+			keyIdx = begin;
+			alpha = 0.f;
+			return;
+		}
+
+		if (localT >= block.Times[end - 1])
+		{
+			keyIdx = end - 2;
+			alpha = 1.f;
+			return;
+		}
+
+		auto contains = [&](uint32_t i)
+		{
+			return i >= begin && i + 1 < end && block.Times[i] <= localT && block.Times[i + 1] > localT;
+		};
+
+		if (!contains(keyIdx) && !contains(++keyIdx))
+		{
+			auto it = std::upper_bound(block.Times.begin() + begin, block.Times.begin() + end, localT);
+
+			keyIdx = it - block.Times.begin() - 1;
+		}
+
+		float t0 = block.Times[keyIdx];
+		float t1 = block.Times[keyIdx + 1];
+		alpha = (localT - t0) / (t1 - t0);
+	};
+
+	float* c[SAMPLE_COMPONENT_COUNT];
+
+	for (int i = 0; i < SAMPLE_COMPONENT_COUNT; ++i)
+	{
+		c[i] = components.data() + i * paddedCount;
+	}
+
+	for (uint32_t i = 0; i < boneCount; ++i)
+	{
+		auto& boneCursor = cursor.BoneCursors[i];
+		auto& range = mTrackRanges[i];
+		uint32_t track = i * TRACK_TYPE_COUNT;
+
+		float min[2][3] = { { range.TranslationMin.x, range.TranslationMin.y, range.TranslationMin.z }, { range.ScaleMin.x, range.ScaleMin.y, range.ScaleMin.z } };
+		float scale[2][3] = { { range.TranslationScale.x, range.TranslationScale.y, range.TranslationScale.z }, { range.ScaleScale.x, range.ScaleScale.y, range.ScaleScale.z } };
+
+		findKeys(track + TRANSLATION_TRACK, boneCursor.TranslationIdx, c[T_ALPHA][i]);
+		findKeys(track + SCALE_TRACK, boneCursor.ScaleIdx, c[S_ALPHA][i]);
+		findKeys(track + ROTATION_TRACK, boneCursor.RotationQuatIdx, c[Q_ALPHA][i]);
+
+		// Single key tracks read their only key twice
+		uint32_t tLast = block.KeyOffsets[track + TRANSLATION_TRACK + 1] - 1;
+		uint32_t qLast = block.KeyOffsets[track + ROTATION_TRACK + 1] - 1;
+		uint32_t sLast = block.KeyOffsets[track + SCALE_TRACK + 1] - 1;
+
+		for (int k = 0; k < 2; ++k)
+		{
+			uint32_t tIdx = std::min(boneCursor.TranslationIdx + k, tLast);
+			uint32_t sIdx = std::min(boneCursor.ScaleIdx + k, sLast);
+
+			for (int j = 0; j < 3; ++j)
+			{
+				c[TA + k * 3 + j][i] = min[0][j] + block.Values[j][tIdx] * scale[0][j];
+				c[SA + k * 3 + j][i] = min[1][j] + block.Values[j][sIdx] * scale[1][j];
+			}
+
+			uint32_t qIdx = std::min(boneCursor.RotationQuatIdx + k, qLast);
+			DirectX::XMFLOAT4 quat = DecodeQuat(block.Values[0][qIdx], block.Values[1][qIdx], block.Values[2][qIdx]);
+			c[QA + k * 4 + 0][i] = quat.x;
+			c[QA + k * 4 + 1][i] = quat.y;
+			c[QA + k * 4 + 2][i] = quat.z;
+			c[QA + k * 4 + 3][i] = quat.w;
+		}
+	}
+
+	// Vector part: interpolate 4 bones at once
+	auto load = [&](int component, uint32_t i)
+	{
+		return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&c[component][i]));
+	};
+
+	auto lerp = [&](int a, int b, int alpha, uint32_t i)
+	{
+		DirectX::XMVECTOR va = load(a, i);
+		return va + (load(b, i) - va) * load(alpha, i);
+	};
+
+	for (uint32_t i = 0; i < boneCount; i += 4)
+	{
+		DirectX::XMVECTOR tx = lerp(TA + 0, TB + 0, T_ALPHA, i);
+		DirectX::XMVECTOR ty = lerp(TA + 1, TB + 1, T_ALPHA, i);
+		DirectX::XMVECTOR tz = lerp(TA + 2, TB + 2, T_ALPHA, i);
+		DirectX::XMVECTOR sx = lerp(SA + 0, SB + 0, S_ALPHA, i);
+		DirectX::XMVECTOR sy = lerp(SA + 1, SB + 1, S_ALPHA, i);
+		DirectX::XMVECTOR sz = lerp(SA + 2, SB + 2, S_ALPHA, i);
+
+		DirectX::XMVECTOR ax = load(QA + 0, i);
+		DirectX::XMVECTOR ay = load(QA + 1, i);
+		DirectX::XMVECTOR az = load(QA + 2, i);
+		DirectX::XMVECTOR aw = load(QA + 3, i);
+		DirectX::XMVECTOR bx = load(QB + 0, i);
+		DirectX::XMVECTOR by = load(QB + 1, i);
+		DirectX::XMVECTOR bz = load(QB + 2, i);
+		DirectX::XMVECTOR bw = load(QB + 3, i);
+		DirectX::XMVECTOR alpha = load(Q_ALPHA, i);
+
+		// Normalized lerp along the shorter arc
+		DirectX::XMVECTOR dot = ax * bx + ay * by + az * bz + aw * bw;
+		DirectX::XMVECTOR sign = DirectX::XMVectorSelect(DirectX::XMVectorSplatOne(), DirectX::XMVectorReplicate(-1.f), DirectX::XMVectorLess(dot, DirectX::XMVectorZero()));
+		DirectX::XMVECTOR qx = ax + (bx * sign - ax) * alpha;
+		DirectX::XMVECTOR qy = ay + (by * sign - ay) * alpha;
+		DirectX::XMVECTOR qz = az + (bz * sign - az) * alpha;
+		DirectX::XMVECTOR qw = aw + (bw * sign - aw) * alpha;
+		DirectX::XMVECTOR invLength = DirectX::XMVectorReciprocalSqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+		qx = qx * invLength;
+		qy = qy * invLength;
+		qz = qz * invLength;
+		qw = qw * invLength;
+
+		DirectX::XMVECTOR channels[POSE_CHANNEL_COUNT] = { tx, ty, tz, qx, qy, qz, qw, sx, sy, sz };
+
+		for (int j = 0; j < POSE_CHANNEL_COUNT; ++j)
+		{
+			DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(pose.Channels[j] + i), channels[j]);
+		}
+	}
+
+	arena.Rewind(marker);
+}
+
+void Carol::CompressedAnimationClip::LoadBlocks()
+{
+	BinaryReader reader(mData);
+	mHeader = reader.Read<CompressedClipHeader>();
+	mTrackRanges = reader.ReadArray<CompressedTrackRange>();
+	mBlocks.resize(mHeader.BlockCount);
+
+	for (auto& block : mBlocks)
+	{
+		block.KeyOffsets = reader.ReadArray<uint32_t>();
+		block.Times = reader.ReadArray<uint16_t>();
+
+		for (auto& values : block.Values)
+		{
+			values = reader.ReadArray<uint16_t>();
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#include <scene/cull_simulator.h>
+#include <scene/camera.h>
+#include <scene/mesh.h>
+#include <cmath>
+
+namespace
+{
+	using DirectX::operator+;
+	using DirectX::operator-;
+	using DirectX::operator*;
+
+	// Same plane order and sign convention as AabbFrustumTest in cull.hlsli, normals point outwards
+	void GetFrustumPlanes(DirectX::FXMMATRIX M, DirectX::XMVECTOR* planes)
+	{
+		DirectX::XMMATRIX T = DirectX::XMMatrixTranspose(M);
+
+		planes[0] = DirectX::XMVectorNegate(T.r[0] + T.r[3]);
+		planes[1] = T.r[0] - T.r[3];
+		planes[2] = DirectX::XMVectorNegate(T.r[1] + T.r[3]);
+		planes[3] = T.r[1] - T.r[3];
+		planes[4] = DirectX::XMVectorNegate(T.r[2]);
+		planes[5] = T.r[2] - T.r[3];
+
+		for (int i = 0; i < 6; ++i)
+		{
+			planes[i] = planes[i] / DirectX::XMVector3Length(planes[i]);
+		}
+	}
+}
+
+Carol::CullSimulator::CullSimulator(const Camera* camera)
+	:CullSimulator(DirectX::XMMatrixMultiply(camera->GetView(), camera->GetProj()), camera->GetPosition3f())
+{
+}
+
+Carol::CullSimulator::CullSimulator(DirectX::FXMMATRIX viewProj, const DirectX::XMFLOAT3& eyePos)
+	:mEyePos(eyePos)
+{
+	DirectX::XMStoreFloat4x4(&mViewProj, viewProj);
+}
+
+void Carol::CullSimulator::Cull(const Mesh* mesh, std::string_view clipName, DirectX::FXMMATRIX world)
+{
+	for (auto& clipCullData : mesh->GetCullData())
+	{
+		if (clipCullData.ClipName == clipName)
+		{
+			Cull(clipCullData.MeshletCullData, world);
+		}
+	}
+}
+
+void Carol::CullSimulator::Cull(std::span<const CullData> cullData, DirectX::FXMMATRIX world)
+{
+	DirectX::XMMATRIX worldViewProj = DirectX::XMMatrixMultiply(world, DirectX::XMLoadFloat4x4(&mViewProj));
+
+	for (auto& cd : cullData)
+	{
+		++mStats.MeshletCount;
+
+		if (FrustumCull(cd, worldViewProj))
+		{
+			++mStats.FrustumCulledCount;
+		}
+		else if (NormalConeCull(cd, world))
+		{
+			++mStats.NormalConeCulledCount;
+		}
+	}
+}
+
+void Carol::CullSimulator::Reset()
+{
+	mStats = {};
+}
+
+const Carol::CullStats& Carol::CullSimulator::GetStats()const
+{
+	return mStats;
+}
+
+float Carol::CullSimulator::GetCulledRatio()const
+{
+	if (mStats.MeshletCount == 0)
+	{
+		return 0.f;
+	}
+
+	return float(mStats.FrustumCulledCount + mStats.NormalConeCulledCount) / mStats.MeshletCount;
+}
+
+bool Carol::CullSimulator::FrustumCull(const CullData& cullData, DirectX::FXMMATRIX worldViewProj)const
+{
+	DirectX::XMVECTOR planes[6];
+	GetFrustumPlanes(worldViewProj, planes);
+
+	DirectX::XMVECTOR sphereCenter = DirectX::XMVectorSet(cullData.BoundingSphere.x, cullData.BoundingSphere.y, cullData.BoundingSphere.z, 1.f);
+	DirectX::XMVECTOR center = DirectX::XMVectorSetW(DirectX::XMLoadFloat3(&cullData.Center), 1.f);
+	DirectX::XMVECTOR extents = DirectX::XMLoadFloat3(&cullData.Extent);
+
+	for (auto& plane : planes)
+	{
+		float sphereDist = DirectX::XMVectorGetX(DirectX::XMVector4Dot(sphereCenter, plane));
+		float boxDist = DirectX::XMVectorGetX(DirectX::XMVector4Dot(center, plane));
+		float boxRadius = DirectX::XMVectorGetX(DirectX::XMVector3Dot(extents, DirectX::XMVectorAbs(plane)));
+
+		if (sphereDist - cullData.BoundingSphere.w > 0.f || boxDist - boxRadius > 0.f)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Carol::CullSimulator::NormalConeCull(const CullData& cullData, DirectX::FXMMATRIX world)const
+{
+	uint32_t packedCone = cullData.NormalCone.c;
+
+	if ((packedCone >> 24) == 0xff)
+	{
+		return false;
+	}
+
+	DirectX::XMVECTOR normalCone = DirectX::XMVector3Normalize(DirectX::XMVectorSet(
+		((packedCone >> 0) & 0xff) / 255.f * 2.f - 1.f,
+		((packedCone >> 8) & 0xff) / 255.f * 2.f - 1.f,
+		((packedCone >> 16) & 0xff) / 255.f * 2.f - 1.f,
+		0.f));
+	float sinConeSpread = ((packedCone >> 24) & 0xff) / 255.f;
+
+	DirectX::XMVECTOR axis = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(normalCone, world));
+	DirectX::XMVECTOR apex = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&cullData.Center) - normalCone * cullData.ApexOffset, world);
+	DirectX::XMVECTOR view = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&mEyePos) - apex);
+
+	return DirectX::XMVectorGetX(DirectX::XMVector3Dot(view, DirectX::XMVectorNegate(axis))) > sinConeSpread;
+}
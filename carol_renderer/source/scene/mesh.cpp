@@ -1,12 +1,350 @@
 #include <scene/mesh.h>
+#include <scene/cluster.h>
 #include <dx12/heap.h>
 #include <dx12/resource.h>
+#include <utils/thread_pool.h>
 #include <global.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string_view>
 
 namespace
 {
+	using DirectX::operator+;
 	using DirectX::operator-;
 	using DirectX::operator*;
+
+	// Static meshes keep their cull data under a single pseudo clip
+	constexpr std::string_view STATIC_CLIP_NAME = "mesh";
+
+	// Meshlet points in SoA layout, padded to a multiple of 4 with copies of the first point
+	// so that every sweep runs on full vectors without changing min/max results
+	class PointStream
+	{
+	public:
+		void Clear()
+		{
+			X.clear();
+			Y.clear();
+			Z.clear();
+		}
+
+		void Push(const DirectX::XMFLOAT3& point)
+		{
+			X.push_back(point.x);
+			Y.push_back(point.y);
+			Z.push_back(point.z);
+		}
+
+		void Pad()
+		{
+			while (X.size() % 4)
+			{
+				Push({ X[0], Y[0], Z[0] });
+			}
+		}
+
+		std::vector<float> X;
+		std::vector<float> Y;
+		std::vector<float> Z;
+	};
+
+	class Ball
+	{
+	public:
+		double Center[3] = {};
+		double Radius = -1.0;
+	};
+
+	double Dot(const double* a, const double* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Cross(const double* a, const double* b, double* c)
+	{
+		c[0] = a[1] * b[2] - a[2] * b[1];
+		c[1] = a[2] * b[0] - a[0] * b[2];
+		c[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	bool BallContains(const Ball& ball, const double* p)
+	{
+		double d[3] = { p[0] - ball.Center[0], p[1] - ball.Center[1], p[2] - ball.Center[2] };
+		return std::sqrt(Dot(d, d)) <= ball.Radius * (1.0 + 1e-9) + 1e-9;
+	}
+
+	Ball BallFromSupport(const double (*support)[3], uint32_t count)
+	{
+		Ball ball;
+
+		if (count == 0)
+		{
+			return ball;
+		}
+
+		const double* p = support[0];
+		double a[3] = {};
+		double b[3] = {};
+		double c[3] = {};
+		double offset[3] = {};
+
+		if (count >= 2)
+		{
+			a[0] = support[1][0] - p[0]; a[1] = support[1][1] - p[1]; a[2] = support[1][2] - p[2];
+		}
+
+		if (count >= 3)
+		{
+			b[0] = support[2][0] - p[0]; b[1] = support[2][1] - p[1]; b[2] = support[2][2] - p[2];
+		}
+
+		if (count == 4)
+		{
+			c[0] = support[3][0] - p[0]; c[1] = support[3][1] - p[1]; c[2] = support[3][2] - p[2];
+		}
+
+		if (count == 2)
+		{
+			offset[0] = a[0] * 0.5; offset[1] = a[1] * 0.5; offset[2] = a[2] * 0.5;
+		}
+		else if (count == 3)
+		{
+			// Circumcircle of the triangle
+			double axb[3], t0[3], t1[3];
+			Cross(a, b, axb);
+			double denom = 2.0 * Dot(axb, axb);
+
+			if (denom < 1e-24)
+			{
+				return BallFromSupport(support, 2);
+			}
+
+			Cross(b, axb, t0);
+			Cross(axb, a, t1);
+
+			for (int i = 0; i < 3; ++i)
+			{
+				offset[i] = (Dot(a, a) * t0[i] + Dot(b, b) * t1[i]) / denom;
+			}
+		}
+		else if (count == 4)
+		{
+			// Circumsphere of the tetrahedron
+			double bxc[3], cxa[3], axb[3];
+			Cross(b, c, bxc);
+			Cross(c, a, cxa);
+			Cross(a, b, axb);
+			double denom = 2.0 * Dot(a, bxc);
+
+			if (std::abs(denom) < 1e-24)
+			{
+				return BallFromSupport(support, 3);
+			}
+
+			for (int i = 0; i < 3; ++i)
+			{
+				offset[i] = (Dot(a, a) * bxc[i] + Dot(b, b) * cxa[i] + Dot(c, c) * axb[i]) / denom;
+			}
+		}
+
+		ball.Center[0] = p[0] + offset[0];
+		ball.Center[1] = p[1] + offset[1];
+		ball.Center[2] = p[2] + offset[2];
+		ball.Radius = std::sqrt(Dot(offset, offset));
+
+		return ball;
+	}
+
+	Ball Welzl(std::span<const DirectX::XMFLOAT3> points, uint32_t count, double (*support)[3], uint32_t supportCount)
+	{
+		Ball ball = BallFromSupport(support, supportCount);
+
+		if (supportCount == 4)
+		{
+			return ball;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			double p[3] = { points[i].x, points[i].y, points[i].z };
+
+			if (!BallContains(ball, p))
+			{
+				support[supportCount][0] = p[0];
+				support[supportCount][1] = p[1];
+				support[supportCount][2] = p[2];
+				ball = Welzl(points, i, support, supportCount + 1);
+			}
+		}
+
+		return ball;
+	}
+
+	// Exact minimal enclosing sphere, expected linear time since the points are shuffled first.
+	// The radius is widened to the farthest point in float precision to stay conservative.
+	DirectX::XMFLOAT4 LoadMinimalBoundingSphere(std::vector<DirectX::XMFLOAT3>& points)
+	{
+		if (points.empty())
+		{
+			return { 0.f,0.f,0.f,0.f };
+		}
+
+		std::minstd_rand rand(points.size());
+		std::shuffle(points.begin(), points.end(), rand);
+
+		double support[4][3];
+		Ball ball = Welzl(points, points.size(), support, 0);
+
+		DirectX::XMVECTOR center = DirectX::XMVectorSet(ball.Center[0], ball.Center[1], ball.Center[2], 0.f);
+		float radius = 0.f;
+
+		for (auto& p : points)
+		{
+			radius = std::fmax(radius, DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&p) - center)));
+		}
+
+		DirectX::XMFLOAT4 sphere;
+		DirectX::XMStoreFloat4(&sphere, DirectX::XMVectorSetW(center, radius));
+		return sphere;
+	}
+
+	// The cone axis is stored in 8 bits per channel, the spread has to be measured against the axis the shader sees.
+	// The result is left unnormalized so that packing it again yields the same bytes.
+	DirectX::XMVECTOR QuantizeConeAxis(DirectX::FXMVECTOR axis)
+	{
+		DirectX::XMFLOAT3 a;
+		DirectX::XMStoreFloat3(&a, axis);
+
+		auto quantize = [](float x)
+		{
+			return std::round((x + 1.f) * 0.5f * 255.f) / 255.f * 2.f - 1.f;
+		};
+
+		return DirectX::XMVectorSet(quantize(a.x), quantize(a.y), quantize(a.z), 0.f);
+	}
+
+	float ReduceMin(DirectX::FXMVECTOR v)
+	{
+		DirectX::XMFLOAT4 f;
+		DirectX::XMStoreFloat4(&f, v);
+		return std::fmin(std::fmin(f.x, f.y), std::fmin(f.z, f.w));
+	}
+
+	float ReduceMax(DirectX::FXMVECTOR v)
+	{
+		DirectX::XMFLOAT4 f;
+		DirectX::XMStoreFloat4(&f, v);
+		return std::fmax(std::fmax(f.x, f.y), std::fmax(f.z, f.w));
+	}
+
+	// Box, cone apex and bottom radius in three sweeps over the same cache resident meshlet,
+	// each sweep handles 4 points per iteration
+	void LoadMeshletCullData(Carol::CullData& cullData, const PointStream& points, DirectX::FXMVECTOR quantizedCone, float cosConeSpread)
+	{
+		thread_local std::vector<DirectX::XMFLOAT3> spherePoints;
+		spherePoints.clear();
+
+		for (int i = 0; i < points.X.size(); ++i)
+		{
+			spherePoints.push_back({ points.X[i], points.Y[i], points.Z[i] });
+		}
+
+		cullData.BoundingSphere = LoadMinimalBoundingSphere(spherePoints);
+
+		DirectX::XMVECTOR minX = DirectX::XMVectorReplicate(D3D12_FLOAT32_MAX);
+		DirectX::XMVECTOR minY = minX;
+		DirectX::XMVECTOR minZ = minX;
+		DirectX::XMVECTOR maxX = DirectX::XMVectorReplicate(-D3D12_FLOAT32_MAX);
+		DirectX::XMVECTOR maxY = maxX;
+		DirectX::XMVECTOR maxZ = maxX;
+
+		for (int i = 0; i < points.X.size(); i += 4)
+		{
+			DirectX::XMVECTOR x = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.X[i]));
+			DirectX::XMVECTOR y = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Y[i]));
+			DirectX::XMVECTOR z = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Z[i]));
+
+			minX = DirectX::XMVectorMin(minX, x);
+			minY = DirectX::XMVectorMin(minY, y);
+			minZ = DirectX::XMVectorMin(minZ, z);
+			maxX = DirectX::XMVectorMax(maxX, x);
+			maxY = DirectX::XMVectorMax(maxY, y);
+			maxZ = DirectX::XMVectorMax(maxZ, z);
+		}
+
+		DirectX::BoundingBox box;
+		DirectX::BoundingBox::CreateFromPoints(
+			box,
+			DirectX::XMVectorSet(ReduceMin(minX), ReduceMin(minY), ReduceMin(minZ), 0.f),
+			DirectX::XMVectorSet(ReduceMax(maxX), ReduceMax(maxY), ReduceMax(maxZ), 0.f));
+
+		cullData.Center = box.Center;
+		cullData.Extent = box.Extents;
+
+		// Round the sine up to the stored precision so that quantization never tightens the cone
+		float sinConeSpread = std::fmax(std::ceil(std::sqrt(std::fmax(1.f - cosConeSpread * cosConeSpread, 0.f)) * 255.f), 1.f) / 255.f;
+
+		if (cosConeSpread <= 0.f || sinConeSpread >= 1.f)
+		{
+			cullData.NormalCone = { 0.f,0.f,0.f,1.f };
+			return;
+		}
+
+		float tanConeSpread = sinConeSpread / std::sqrt(1.f - sinConeSpread * sinConeSpread);
+
+		cullData.NormalCone = {
+			(DirectX::XMVectorGetZ(quantizedCone) + 1.f) * 0.5f,
+			(DirectX::XMVectorGetY(quantizedCone) + 1.f) * 0.5f,
+			(DirectX::XMVectorGetX(quantizedCone) + 1.f) * 0.5f,
+			sinConeSpread
+		};
+
+		DirectX::XMVECTOR normalCone = DirectX::XMVector3Normalize(quantizedCone);
+
+		DirectX::XMVECTOR coneX = DirectX::XMVectorSplatX(normalCone);
+		DirectX::XMVECTOR coneY = DirectX::XMVectorSplatY(normalCone);
+		DirectX::XMVECTOR coneZ = DirectX::XMVectorSplatZ(normalCone);
+		DirectX::XMVECTOR minDot = DirectX::XMVectorReplicate(D3D12_FLOAT32_MAX);
+
+		for (int i = 0; i < points.X.size(); i += 4)
+		{
+			DirectX::XMVECTOR x = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.X[i]));
+			DirectX::XMVECTOR y = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Y[i]));
+			DirectX::XMVECTOR z = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Z[i]));
+
+			minDot = DirectX::XMVectorMin(minDot, x * coneX + y * coneY + z * coneZ);
+		}
+
+		float bottomDist = ReduceMin(minDot);
+		DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&cullData.Center);
+		float centerToBottomDist = DirectX::XMVectorGetX(DirectX::XMVector3Dot(center, normalCone)) - bottomDist;
+		DirectX::XMVECTOR bottomCenter = center - centerToBottomDist * normalCone;
+
+		DirectX::XMVECTOR centerX = DirectX::XMVectorSplatX(bottomCenter);
+		DirectX::XMVECTOR centerY = DirectX::XMVectorSplatY(bottomCenter);
+		DirectX::XMVECTOR centerZ = DirectX::XMVectorSplatZ(bottomCenter);
+		DirectX::XMVECTOR tan = DirectX::XMVectorReplicate(tanConeSpread);
+		DirectX::XMVECTOR maxRadius = DirectX::XMVectorZero();
+
+		for (int i = 0; i < points.X.size(); i += 4)
+		{
+			DirectX::XMVECTOR x = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.X[i])) - centerX;
+			DirectX::XMVECTOR y = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Y[i])) - centerY;
+			DirectX::XMVECTOR z = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&points.Z[i])) - centerZ;
+
+			DirectX::XMVECTOR height = x * coneX + y * coneY + z * coneZ;
+			x = x - coneX * height;
+			y = y - coneY * height;
+			z = z - coneZ * height;
+
+			DirectX::XMVECTOR radius = DirectX::XMVectorSqrt(x * x + y * y + z * z) - height * tan;
+			maxRadius = DirectX::XMVectorMax(maxRadius, radius);
+		}
+
+		cullData.ApexOffset = centerToBottomDist + ReduceMax(maxRadius) / tanConeSpread;
+	}
 }
 
 void BoundingBoxCompare(const DirectX::XMFLOAT3& pos, DirectX::XMFLOAT3& boxMin, DirectX::XMFLOAT3& boxMax)
@@ -20,35 +358,84 @@ void BoundingBoxCompare(const DirectX::XMFLOAT3& pos, DirectX::XMFLOAT3& boxMin,
 	boxMax.z = std::fmax(boxMax.z, pos.z);
 }
 
-void RadiusCompare(const DirectX::XMVECTOR& pos, const DirectX::XMVECTOR& center, const DirectX::XMVECTOR& normalCone, float tanConeSpread, float& radius)
-{
-	float height = DirectX::XMVector3Dot(pos - center, normalCone).m128_f32[0];
-	float posRadius = DirectX::XMVector3Length(pos - center - normalCone * height).m128_f32[0] - height * tanConeSpread;
-	
-	if (posRadius > radius)
-	{
-		radius = posRadius;
-	}
-}
-
 Carol::Mesh::Mesh(
 	std::span<Vertex> vertices,
-	std::span<std::pair<std::string, std::vector<std::vector<Vertex>>>> skinnedVertices,
+	const std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>>& frameTransforms,
 	std::span<uint32_t> indices,
 	bool isSkinned,
 	bool isTransparent)
 	:mVertices(vertices),
-	mSkinnedVertices(skinnedVertices),
 	mIndices(indices),
 	mMeshConstants(std::make_unique<MeshConstants>()),
 	mSkinned(isSkinned),
 	mTransparent(isTransparent)
 {
-	LoadVertices();
 	LoadMeshlets();
-	LoadCullData();
+	LoadCullData(frameTransforms);
+}
+
+Carol::Mesh::Mesh(
+	std::span<const Vertex> vertices,
+	std::span<const Meshlet> meshlets,
+	std::span<const ClusterLodData> lodData,
+	uint32_t lodLevelCount,
+	std::span<const ClipCullData> cullData,
+	bool isSkinned,
+	bool isTransparent)
+	:mVertices(vertices),
+	mMeshlets(meshlets.begin(), meshlets.end()),
+	mLodData(lodData.begin(), lodData.end()),
+	mMeshConstants(std::make_unique<MeshConstants>()),
+	mSkinned(isSkinned),
+	mTransparent(isTransparent)
+{
+	mMeshConstants->LodLevelCount = lodLevelCount;
+
+	for (auto& clip : cullData)
+	{
+		std::string name(clip.ClipName);
+		mCullData[name].assign(clip.MeshletCullData.begin(), clip.MeshletCullData.end());
+		mBoundingBoxes[name] = clip.BoundingBox;
+	}
+}
+
+void Carol::Mesh::Upload()
+{
+	LoadVertices(mVertices);
+	UploadMeshlets(mMeshlets);
+
+	if (mLodData.size())
+	{
+		UploadLodData(mLodData, mMeshConstants->LodLevelCount);
+	}
+
+	for (auto& [name, cullData] : mCullData)
+	{
+		UploadCullData(name, cullData, mBoundingBoxes[name]);
+	}
+
+	if (!mSkinned)
+	{
+		SetAnimationClip(STATIC_CLIP_NAME);
+	}
+
 	InitCullMark();
 	ReleaseIntermediateBuffer();
+
+	mVertices = {};
+	mIndices = {};
+}
+
+uint64_t Carol::Mesh::GetUploadSize()const
+{
+	uint64_t size = mVertices.size_bytes() + mMeshlets.size() * sizeof(Meshlet) + mLodData.size() * sizeof(ClusterLodData);
+
+	for (auto& [name, cullData] : mCullData)
+	{
+		size += cullData.size() * sizeof(CullData);
+	}
+
+	return size;
 }
 
 void Carol::Mesh::ReleaseIntermediateBuffer()
@@ -56,6 +443,11 @@ void Carol::Mesh::ReleaseIntermediateBuffer()
 	mVertexBuffer->ReleaseIntermediateBuffer();
 	mMeshletBuffer->ReleaseIntermediateBuffer();
 
+	if (mLodDataBuffer)
+	{
+		mLodDataBuffer->ReleaseIntermediateBuffer();
+	}
+
 	for (auto& [name, buffer] : mCullDataBuffer)
 	{
 		buffer->ReleaseIntermediateBuffer();
@@ -136,29 +528,90 @@ bool Carol::Mesh::IsTransparent()const
 	return mTransparent;
 }
 
-void Carol::Mesh::LoadVertices()
+std::span<const Carol::Meshlet> Carol::Mesh::GetMeshlets()const
+{
+	return mMeshlets;
+}
+
+std::span<const Carol::ClusterLodData> Carol::Mesh::GetLodData()const
+{
+	return mLodData;
+}
+
+std::vector<Carol::ClipCullData> Carol::Mesh::GetCullData()const
+{
+	std::vector<ClipCullData> cullData;
+
+	for (auto& [name, data] : mCullData)
+	{
+		cullData.push_back({ name, data, mBoundingBoxes.at(name) });
+	}
+
+	return cullData;
+}
+
+void Carol::Mesh::LoadVertices(std::span<const Vertex> vertices)
 {
 	mVertexBuffer = std::make_unique<StructuredBuffer>(
-		mVertices.size(),
+		vertices.size(),
 		sizeof(Vertex),
 		gHeapManager->GetDefaultBuffersHeap(),
 		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-	mVertexBuffer->CopySubresources(gHeapManager->GetUploadBuffersHeap(), mVertices.data(), mVertices.size() * sizeof(Vertex));
+	mVertexBuffer->CopySubresources(gHeapManager->GetUploadBuffersHeap(), vertices.data(), vertices.size() * sizeof(Vertex));
 	mMeshConstants->VertexBufferIdx = mVertexBuffer->GetGpuSrvIdx();
 }
 
 void Carol::Mesh::LoadMeshlets()
+{
+	// Skinned meshes deform away from the bind pose the DAG errors are measured in
+	if (mSkinned)
+	{
+		LoadMeshlets(mIndices);
+	}
+	else
+	{
+		LoadClusterLod();
+	}
+}
+
+void Carol::Mesh::UploadMeshlets(std::span<const Meshlet> meshlets)
+{
+	mMeshletBuffer = std::make_unique<StructuredBuffer>(
+		meshlets.size(),
+		sizeof(Meshlet),
+		gHeapManager->GetDefaultBuffersHeap(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	mMeshletBuffer->CopySubresources(gHeapManager->GetUploadBuffersHeap(), meshlets.data(), meshlets.size() * sizeof(Meshlet));
+	mMeshConstants->MeshletBufferIdx = mMeshletBuffer->GetGpuSrvIdx();
+	mMeshConstants->MeshletCount = meshlets.size();
+}
+
+void Carol::Mesh::LoadMeshlets(std::span<const uint32_t> indices)
 {
 	Meshlet meshlet = {};
-	std::vector<uint8_t> vertices(mVertices.size(), 0xff);
 
-	for (int i = 0; i < mIndices.size(); i += 3)
+	for (int i = 0; i < indices.size(); i += 3)
 	{
-		uint32_t index[3] = { mIndices[i],mIndices[i + 1],mIndices[i + 2] };
-		uint32_t meshletIndex[3] = { vertices[index[0]],vertices[index[1]],vertices[index[2]] };
+		uint32_t index[3] = { indices[i],indices[i + 1],indices[i + 2] };
+		uint32_t meshletIndex[3] = { 0xff,0xff,0xff };
+
+		// A meshlet holds at most 64 vertices, a linear search beats clearing a per-vertex table
+		for (int j = 0; j < meshlet.VertexCount; ++j)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				if (meshlet.Vertices[j] == index[k])
+				{
+					meshletIndex[k] = j;
+				}
+			}
+		}
+
+		uint32_t newCount = (meshletIndex[0] == 0xff) + (meshletIndex[1] == 0xff && index[1] != index[0]) + (meshletIndex[2] == 0xff && index[2] != index[0] && index[2] != index[1]);
 
-		if (meshlet.VertexCount + (meshletIndex[0] == 0xff) + (meshletIndex[1] == 0xff) + (meshletIndex[2] == 0xff) > 64 || meshlet.PrimCount + 1 > 126)
+		if (meshlet.VertexCount + newCount > 64 || meshlet.PrimCount + 1 > 126)
 		{
 			mMeshlets.push_back(meshlet);
 
@@ -168,11 +621,6 @@ void Carol::Mesh::LoadMeshlets()
 			{
 				index = 0xff;
 			}
-
-			for (auto& vertex : vertices)
-			{
-				vertex = 0xff;
-			}
 		}
 
 		for (int j = 0; j < 3; ++j)
@@ -180,8 +628,15 @@ void Carol::Mesh::LoadMeshlets()
 			if (meshletIndex[j] == 0xff)
 			{
 				meshletIndex[j] = meshlet.VertexCount;
-				meshlet.Vertices[meshlet.VertexCount] = index[j];
-				vertices[index[j]] = meshlet.VertexCount++;
+				meshlet.Vertices[meshlet.VertexCount++] = index[j];
+
+				for (int k = j + 1; k < 3; ++k)
+				{
+					if (index[k] == index[j])
+					{
+						meshletIndex[k] = meshletIndex[j];
+					}
+				}
 			}
 		}	
 
@@ -196,57 +651,257 @@ void Carol::Mesh::LoadMeshlets()
 	{
 		mMeshlets.push_back(meshlet);
 	}
+}
 
-	mMeshletBuffer = std::make_unique<StructuredBuffer>(
-		mMeshlets.size(),
-		sizeof(Meshlet),
+void Carol::Mesh::LoadClusterLod()
+{
+	std::vector<DirectX::XMFLOAT3> positions(mVertices.size());
+
+	for (int i = 0; i < mVertices.size(); ++i)
+	{
+		positions[i] = mVertices[i].Pos;
+	}
+
+	ClusterDag dag(positions, mIndices);
+
+	for (auto& cluster : dag.GetClusters())
+	{
+		uint32_t meshletStart = mMeshlets.size();
+		LoadMeshlets(cluster.Indices);
+
+		// Clusters are built within the meshlet limits, so this normally adds a single entry
+		for (int i = meshletStart; i < mMeshlets.size(); ++i)
+		{
+			auto& ld = mLodData.emplace_back();
+			ld.LodBounds = { cluster.LodBounds.Center.x, cluster.LodBounds.Center.y, cluster.LodBounds.Center.z, cluster.LodBounds.Radius };
+			ld.ParentLodBounds = { cluster.ParentLodBounds.Center.x, cluster.ParentLodBounds.Center.y, cluster.ParentLodBounds.Center.z, cluster.ParentLodBounds.Radius };
+			ld.LodError = cluster.LodError;
+			ld.ParentLodError = cluster.ParentLodError;
+		}
+	}
+
+	mMeshConstants->LodLevelCount = dag.GetLevelCount();
+}
+
+void Carol::Mesh::UploadLodData(std::span<const ClusterLodData> lodData, uint32_t lodLevelCount)
+{
+	mLodDataBuffer = std::make_unique<StructuredBuffer>(
+		lodData.size(),
+		sizeof(ClusterLodData),
 		gHeapManager->GetDefaultBuffersHeap(),
 		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
-	mMeshletBuffer->CopySubresources(gHeapManager->GetUploadBuffersHeap(), mMeshlets.data(), mMeshlets.size() * sizeof(Meshlet));
-	mMeshConstants->MeshletBufferIdx = mMeshletBuffer->GetGpuSrvIdx();
-	mMeshConstants->MeshletCount = mMeshlets.size();
+	mLodDataBuffer->CopySubresources(gHeapManager->GetUploadBuffersHeap(), lodData.data(), lodData.size() * sizeof(ClusterLodData));
+	mMeshConstants->LodDataBufferIdx = mLodDataBuffer->GetGpuSrvIdx();
+	mMeshConstants->LodLevelCount = lodLevelCount;
 }
 
-void Carol::Mesh::LoadCullData()
+void Carol::Mesh::LoadCullData(const std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>>& frameTransforms)
 {
-	static std::string staticName = "mesh";
-	std::vector<std::vector<Vertex>> vertices;
-	std::pair<std::string, std::vector<std::vector<Vertex>>> staticpair;
-
 	if (!mSkinned)
 	{
-		vertices.emplace_back(mVertices.begin(), mVertices.end());
-		staticpair = std::make_pair(staticName, std::move(vertices));
-		mSkinnedVertices = std::span(&staticpair, 1);
+		LoadStaticCullData(STATIC_CLIP_NAME);
+	}
+	else
+	{
+		for (auto& [name, frames] : frameTransforms)
+		{
+			LoadSkinnedCullData(name, frames);
+		}
 	}
+}
+
+void Carol::Mesh::LoadStaticCullData(std::string_view clipName)
+{
+	std::string name(clipName);
+	auto& cullData = mCullData[name];
+	cullData.resize(mMeshlets.size());
+
+	gThreadPool->ParallelFor(mMeshlets.size(), [&](uint32_t i)
+	{
+		thread_local PointStream points;
+		thread_local std::vector<DirectX::XMFLOAT3> normals;
+
+		auto& meshlet = mMeshlets[i];
+		points.Clear();
+		normals.clear();
+
+		for (int j = 0; j < meshlet.VertexCount; ++j)
+		{
+			points.Push(mVertices[meshlet.Vertices[j]].Pos);
+			normals.push_back(mVertices[meshlet.Vertices[j]].Normal);
+		}
+
+		points.Pad();
+
+		DirectX::XMVECTOR quantizedCone = QuantizeConeAxis(LoadConeAxis(normals));
+		LoadMeshletCullData(cullData[i], points, quantizedCone, LoadConeSpread(DirectX::XMVector3Normalize(quantizedCone), normals));
+	}, 16);
+
+	mBoundingBoxes[name] = LoadMeshBoundingBox(cullData);
+}
+
+void Carol::Mesh::LoadSkinnedCullData(std::string_view clipName, std::span<const std::vector<DirectX::XMFLOAT4X4>> frameTransforms)
+{
+	// A skinned position is a convex combination of its bone-transformed bind positions,
+	// so the transformed bind-space boxes of every influencing bone bound it in every pose.
+	// The same holds for normals with the per-bone cones, as long as each cone stays under 90 degrees.
+	std::string name(clipName);
+	auto& cullData = mCullData[name];
+	cullData.resize(mMeshlets.size());
+
+	gThreadPool->ParallelFor(mMeshlets.size(), [&](uint32_t i)
+	{
+		thread_local std::vector<BoneBounds> boneBounds;
+		thread_local PointStream points;
+		thread_local std::vector<DirectX::XMFLOAT3> axes;
+		thread_local std::vector<float> spreads;
+
+		LoadMeshletBoneBounds(mMeshlets[i], boneBounds);
+		points.Clear();
+		axes.clear();
+		spreads.clear();
+
+		for (auto& finalTransforms : frameTransforms)
+		{
+			for (auto& bounds : boneBounds)
+			{
+				DirectX::XMMATRIX transform = bounds.BoneIdx == UINT32_MAX ? DirectX::XMMatrixIdentity() : DirectX::XMLoadFloat4x4(&finalTransforms[bounds.BoneIdx]);
+				DirectX::BoundingBox box;
+				DirectX::XMFLOAT3 corners[DirectX::BoundingBox::CORNER_COUNT];
+
+				DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&bounds.BoxMin), DirectX::XMLoadFloat3(&bounds.BoxMax));
+				box.GetCorners(corners);
+				DirectX::XMVector3TransformCoordStream(corners, sizeof(DirectX::XMFLOAT3), corners, sizeof(DirectX::XMFLOAT3), DirectX::BoundingBox::CORNER_COUNT, transform);
+
+				for (auto& corner : corners)
+				{
+					points.Push(corner);
+				}
+
+				DirectX::XMVECTOR axis = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&bounds.NormalCone), transform));
+				axes.emplace_back();
+				DirectX::XMStoreFloat3(&axes.back(), axis);
+				spreads.push_back(bounds.ConeSpread);
+			}
+		}
+
+		points.Pad();
+
+		DirectX::XMVECTOR quantizedCone = QuantizeConeAxis(LoadConeAxis(axes));
+		DirectX::XMVECTOR normalCone = DirectX::XMVector3Normalize(quantizedCone);
+		float coneSpread = 0.f;
+
+		for (int j = 0; j < axes.size(); ++j)
+		{
+			float cosAngle = DirectX::XMVectorGetX(DirectX::XMVector3Dot(normalCone, DirectX::XMLoadFloat3(&axes[j])));
+			coneSpread = std::fmax(coneSpread, std::acos(std::clamp(cosAngle, -1.f, 1.f)) + spreads[j]);
+		}
+
+		LoadMeshletCullData(cullData[i], points, quantizedCone, coneSpread < DirectX::XM_PIDIV2 ? std::cos(coneSpread) : 0.f);
+	});
+
+	mBoundingBoxes[name] = LoadMeshBoundingBox(cullData);
+}
+
+void Carol::Mesh::LoadMeshletBoneBounds(const Meshlet& meshlet, std::vector<BoneBounds>& boneBounds)
+{
+	boneBounds.clear();
 
-	for (auto& [name, vertices] : mSkinnedVertices)
+	auto getBounds = [&](uint32_t boneIdx)->BoneBounds&
 	{
-		mCullData[name].resize(mMeshlets.size());
-		LoadMeshletBoundingBox(name, vertices);
-		LoadMeshletNormalCone(name, vertices);
+		for (auto& bounds : boneBounds)
+		{
+			if (bounds.BoneIdx == boneIdx)
+			{
+				return bounds;
+			}
+		}
+
+		auto& bounds = boneBounds.emplace_back();
+		bounds.BoneIdx = boneIdx;
+		bounds.BoxMin = { D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX };
+		bounds.BoxMax = { -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX };
+		bounds.NormalBoxMin = bounds.BoxMin;
+		bounds.NormalBoxMax = bounds.BoxMax;
+		bounds.ConeSpread = 0.f;
+
+		return bounds;
+	};
 
-		mCullDataBuffer[name] = std::make_unique<StructuredBuffer>(
-			mCullData[name].size(),
-			sizeof(CullData),
-			gHeapManager->GetDefaultBuffersHeap(),
-			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	// Follow the weight rules of the skinning shader, unweighted vertices stay in bind pose
+	auto forEachBone = [&](const Vertex& vertex, auto&& func)
+	{
+		if (vertex.Weights.x == 0.f)
+		{
+			func(getBounds(UINT32_MAX));
+			return;
+		}
 
-		mCullDataBuffer[name]->CopySubresources(gHeapManager->GetUploadBuffersHeap(), mCullData[name].data(), mCullData[name].size() * sizeof(CullData));
+		float weights[] =
+		{
+			vertex.Weights.x,
+			vertex.Weights.y,
+			vertex.Weights.z,
+			1.f - vertex.Weights.x - vertex.Weights.y - vertex.Weights.z
+		};
+
+		uint32_t boneIndices[] = { vertex.BoneIndices.x,vertex.BoneIndices.y,vertex.BoneIndices.z,vertex.BoneIndices.w };
+
+		for (int k = 0; k < 4 && weights[k] != 0.f; ++k)
+		{
+			func(getBounds(boneIndices[k]));
+		}
+	};
+
+	for (int i = 0; i < meshlet.VertexCount; ++i)
+	{
+		auto& vertex = mVertices[meshlet.Vertices[i]];
+
+		forEachBone(vertex, [&](BoneBounds& bounds)
+		{
+			BoundingBoxCompare(vertex.Pos, bounds.BoxMin, bounds.BoxMax);
+			BoundingBoxCompare(vertex.Normal, bounds.NormalBoxMin, bounds.NormalBoxMax);
+		});
 	}
 
-	if (!mSkinned)
+	for (auto& bounds : boneBounds)
+	{
+		DirectX::BoundingBox box;
+		DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&bounds.NormalBoxMin), DirectX::XMLoadFloat3(&bounds.NormalBoxMax));
+		DirectX::XMStoreFloat3(&bounds.NormalCone, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&box.Center)));
+	}
+
+	for (int i = 0; i < meshlet.VertexCount; ++i)
 	{
-		mMeshConstants->CullDataBufferIdx = mCullDataBuffer[staticName]->GetGpuSrvIdx();
-		mMeshConstants->Center = mBoundingBoxes[staticName].Center;
-		mMeshConstants->Extents = mBoundingBoxes[staticName].Extents;
+		auto& vertex = mVertices[meshlet.Vertices[i]];
+
+		forEachBone(vertex, [&](BoneBounds& bounds)
+		{
+			DirectX::XMVECTOR normal = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&vertex.Normal));
+			float cosAngle = DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMLoadFloat3(&bounds.NormalCone), normal));
+			bounds.ConeSpread = std::fmax(bounds.ConeSpread, std::acos(std::clamp(cosAngle, -1.f, 1.f)));
+		});
 	}
 }
 
+void Carol::Mesh::UploadCullData(std::string_view clipName, std::span<const CullData> cullData, const DirectX::BoundingBox& boundingBox)
+{
+	std::string name(clipName);
+
+	mCullDataBuffer[name] = std::make_unique<StructuredBuffer>(
+		cullData.size(),
+		sizeof(CullData),
+		gHeapManager->GetDefaultBuffersHeap(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	mCullDataBuffer[name]->CopySubresources(gHeapManager->GetUploadBuffersHeap(), cullData.data(), cullData.size() * sizeof(CullData));
+	mBoundingBoxes[name] = boundingBox;
+}
+
 void Carol::Mesh::InitCullMark()
 {
-	uint32_t byteSize = ceilf(mMeshlets.size() / 8.f);
+	uint32_t byteSize = ceilf(mMeshConstants->MeshletCount / 8.f);
 
 	mMeshletFrustumCulledMarkBuffer = std::make_unique<RawBuffer>(
 		byteSize,
@@ -281,147 +936,56 @@ void Carol::Mesh::InitCullMark()
 	mMeshConstants->MeshletCulledMarkBufferIdx = mMeshletCulledMarkBuffer->GetGpuUavIdx();
 }
 
-void Carol::Mesh::LoadMeshletBoundingBox(std::string_view clipName, std::span<std::vector<Vertex>> vertices)
+DirectX::BoundingBox Carol::Mesh::LoadMeshBoundingBox(std::span<const CullData> cullData)
 {
-	std::string name(clipName);
-	DirectX::XMFLOAT3 meshBoxMin = { D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX };
-	DirectX::XMFLOAT3 meshBoxMax = { -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX };
+	DirectX::XMFLOAT3 boxMin = { D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX };
+	DirectX::XMFLOAT3 boxMax = { -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX };
 
-	for (int i = 0; i < mMeshlets.size(); ++i)
+	for (auto& cd : cullData)
 	{
-		auto& meshlet = mMeshlets[i];
-		DirectX::XMFLOAT3 meshletBoxMin = { D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX };
-		DirectX::XMFLOAT3 meshletBoxMax = { -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX };
-		
-		for (auto& criticalFrameVertices : vertices)
-		{
-			for (int j = 0; j < meshlet.VertexCount; ++j)
-			{
-				auto& pos = criticalFrameVertices[meshlet.Vertices[j]].Pos;
-				BoundingBoxCompare(pos, meshBoxMin, meshBoxMax);
-				BoundingBoxCompare(pos, meshletBoxMin, meshletBoxMax);
-			}
-		}
-
-		DirectX::BoundingBox box;
-		DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&meshletBoxMin), DirectX::XMLoadFloat3(&meshletBoxMax));
-
-		mCullData[name][i].Center = box.Center;
-		mCullData[name][i].Extent = box.Extents;
+		BoundingBoxCompare({ cd.Center.x - cd.Extent.x, cd.Center.y - cd.Extent.y, cd.Center.z - cd.Extent.z }, boxMin, boxMax);
+		BoundingBoxCompare({ cd.Center.x + cd.Extent.x, cd.Center.y + cd.Extent.y, cd.Center.z + cd.Extent.z }, boxMin, boxMax);
 	}
-	
-	DirectX::BoundingBox::CreateFromPoints(mBoundingBoxes[name], DirectX::XMLoadFloat3(&meshBoxMin), DirectX::XMLoadFloat3(&meshBoxMax));
-}
-
-void Carol::Mesh::LoadMeshletNormalCone(std::string_view clipName, std::span<std::vector<Vertex>> vertices)
-{
-	std::string name(clipName);
-
-	for (int i = 0; i < mMeshlets.size(); ++i)
-	{
-		auto& meshlet = mMeshlets[i];
-		DirectX::XMVECTOR normalCone = LoadConeCenter(meshlet, vertices);
-		float cosConeSpread = LoadConeSpread(meshlet, normalCone, vertices);
-
-		if (cosConeSpread <= 0.f)
-		{
-			mCullData[name][i].NormalCone = { 0.f,0.f,0.f,1.f };
-		}
-		else
-		{
-			float sinConeSpread = std::sqrt(1.f - cosConeSpread * cosConeSpread);
-			float tanConeSpread = sinConeSpread / cosConeSpread;
 
-			mCullData[name][i].NormalCone = {
-				(normalCone.m128_f32[2] + 1.f) * 0.5f,
-				(normalCone.m128_f32[1] + 1.f) * 0.5f,
-				(normalCone.m128_f32[0] + 1.f) * 0.5f,
-				sinConeSpread
-			};
-			
-			float bottomDist = LoadConeBottomDist(meshlet, normalCone, vertices);
-			DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&mCullData[name][i].Center);
-
-			float centerToBottomDist = DirectX::XMVector3Dot(center, normalCone).m128_f32[0] - bottomDist;
-			DirectX::XMVECTOR bottomCenter = center - centerToBottomDist * normalCone;
-			float radius = LoadBottomRadius(meshlet, bottomCenter, normalCone, tanConeSpread, vertices);
-			
-			mCullData[name][i].ApexOffset = centerToBottomDist + radius / tanConeSpread;
-		}
-	}
-}
-
-DirectX::XMVECTOR Carol::Mesh::LoadConeCenter(const Meshlet& meshlet, std::span<std::vector<Vertex>> vertices)
-{
-	DirectX::XMFLOAT3 normalBoxMin = { D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX, D3D12_FLOAT32_MAX };
-	DirectX::XMFLOAT3 normalBoxMax = { -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX, -D3D12_FLOAT32_MAX };
-
-	if (mSkinned)
-	{
-		for (auto& criticalFrameVertices : vertices)
-		{
-			for (int i = 0; i < meshlet.VertexCount; ++i)
-			{
-				auto& normal = criticalFrameVertices[meshlet.Vertices[i]].Normal;
-				BoundingBoxCompare(normal, normalBoxMin, normalBoxMax);
-			}
-		}
-	}
-	
 	DirectX::BoundingBox box;
-	DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&normalBoxMin), DirectX::XMLoadFloat3(&normalBoxMax));
-	return DirectX::XMLoadFloat3(&box.Center);
+	DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&boxMin), DirectX::XMLoadFloat3(&boxMax));
+
+	return box;
 }
 
-float Carol::Mesh::LoadConeSpread(const Meshlet& meshlet, const DirectX::XMVECTOR& normalCone, std::span<std::vector<Vertex>> vertices)
+DirectX::XMVECTOR Carol::Mesh::LoadConeAxis(std::span<const DirectX::XMFLOAT3> normals)
 {
-	float cosConeSpread = 1.f;
+	// For normals within a hemisphere the minimal enclosing sphere of their end points
+	// touches the unit sphere along the rim of the minimal cone, so its centre gives the axis
+	thread_local std::vector<DirectX::XMFLOAT3> endPoints;
+	endPoints.clear();
 
-	for (auto& criticalFrameVertices : vertices)
+	for (auto& n : normals)
 	{
-		for (int i = 0; i < meshlet.VertexCount; ++i)
-		{
-			auto normal = DirectX::XMLoadFloat3(&criticalFrameVertices[meshlet.Vertices[i]].Normal);
-			cosConeSpread = std::fmin(cosConeSpread, DirectX::XMVector3Dot(normalCone, DirectX::XMVector3Normalize(normal)).m128_f32[0]);
-		}
+		endPoints.emplace_back();
+		DirectX::XMStoreFloat3(&endPoints.back(), DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&n)));
 	}
 
-	return cosConeSpread;
-}
-
-float Carol::Mesh::LoadConeBottomDist(const Meshlet& meshlet, const DirectX::XMVECTOR& normalCone, std::span<std::vector<Vertex>> vertices)
-{
-	float bd = D3D12_FLOAT32_MAX;
+	DirectX::XMFLOAT4 sphere = LoadMinimalBoundingSphere(endPoints);
+	DirectX::XMVECTOR center = DirectX::XMVectorSet(sphere.x, sphere.y, sphere.z, 0.f);
 
-	for (auto& criticalFrameVertices : vertices)
+	if (endPoints.empty() || DirectX::XMVectorGetX(DirectX::XMVector3Length(center)) < 1e-3f)
 	{
-		for (int i = 0; i < meshlet.VertexCount; ++i)
-		{
-			auto pos = DirectX::XMLoadFloat3(&criticalFrameVertices[meshlet.Vertices[i]].Pos);
-			float dot = DirectX::XMVector3Dot(normalCone, pos).m128_f32[0];
-
-			if (dot < bd)
-			{
-				bd = dot;
-			}
-		}
+		return DirectX::XMVectorSet(0.f, 0.f, 1.f, 0.f);
 	}
 
-	return bd;
+	return DirectX::XMVector3Normalize(center);
 }
 
-float Carol::Mesh::LoadBottomRadius(const Meshlet& meshlet, const DirectX::XMVECTOR& center, const DirectX::XMVECTOR& normalCone, float tanConeSpread, std::span<std::vector<Vertex>> vertices)
+float Carol::Mesh::LoadConeSpread(const DirectX::XMVECTOR& normalCone, std::span<const DirectX::XMFLOAT3> normals)
 {
-	float radius = 0.f;
+	float cosConeSpread = 1.f;
 
-	for (auto& criticalFrameVertices : vertices)
+	for (auto& n : normals)
 	{
-		for (int i = 0; i < meshlet.VertexCount; ++i)
-		{
-			auto pos = DirectX::XMLoadFloat3(&criticalFrameVertices[meshlet.Vertices[i]].Pos);
-			RadiusCompare(pos, center, normalCone, tanConeSpread, radius);
-		}
+		auto normal = DirectX::XMLoadFloat3(&n);
+		cosConeSpread = std::fmin(cosConeSpread, DirectX::XMVectorGetX(DirectX::XMVector3Dot(normalCone, DirectX::XMVector3Normalize(normal))));
 	}
 
-	return radius;
+	return cosConeSpread;
 }
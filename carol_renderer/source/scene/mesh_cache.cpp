@@ -0,0 +1,329 @@
+#include <scene/mesh_cache.h>
+#include <dx12/resource.h>
+#include <scene/animation_asset.h>
+#include <scene/compressed_animation.h>
+#include <scene/mesh.h>
+#include <utils/cook_stats.h>
+#include <utils/hash.h>
+#include <utils/mapped_file.h>
+#include <global.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+namespace
+{
+	// A missing file hashes to 0, which no longer matches the hash stored for it
+	uint64_t HashFile(std::string_view path)
+	{
+		Carol::MappedFile file(path);
+		return file.IsValid() ? Carol::Hash64(file.GetData().data(), file.GetData().size(), Carol::MESH_CACHE_VERSION) : 0;
+	}
+
+	// Indices past the vertices of the meshlet or of the mesh would read out of bounds in the mesh shader
+	bool IsMeshletValid(const Carol::Meshlet& meshlet, size_t vertexCount)
+	{
+		if (meshlet.VertexCount > std::size(meshlet.Vertices) || meshlet.PrimCount > std::size(meshlet.Prims))
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			if (meshlet.Vertices[i] >= vertexCount)
+			{
+				return false;
+			}
+		}
+
+		for (uint32_t i = 0; i < meshlet.PrimCount; ++i)
+		{
+			uint32_t prim = meshlet.Prims[i];
+
+			if ((prim & 0x3ff) >= meshlet.VertexCount || ((prim >> 10) & 0x3ff) >= meshlet.VertexCount || ((prim >> 20) & 0x3ff) >= meshlet.VertexCount)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Cluster LOD data is per meshlet or absent, cull data per meshlet for every clip. Skinned meshes without clips have none.
+	bool IsMeshValid(
+		std::span<const Carol::Vertex> vertices,
+		std::span<const Carol::Meshlet> meshlets,
+		std::span<const Carol::ClusterLodData> lodData,
+		std::span<const Carol::ClipCullData> cullData)
+	{
+		return (lodData.empty() || lodData.size() == meshlets.size())
+			&& std::ranges::all_of(cullData, [&](const Carol::ClipCullData& clip) { return clip.MeshletCullData.size() == meshlets.size(); })
+			&& std::ranges::all_of(meshlets, [&](const Carol::Meshlet& meshlet) { return IsMeshletValid(meshlet, vertices.size()); });
+	}
+
+	// Reads past the dependency section, the hashes are only compared by IsMeshCacheCurrent
+	void SkipDependencies(Carol::BinaryReader& reader)
+	{
+		uint32_t dependencyCount = reader.Read<uint32_t>();
+
+		for (uint32_t i = 0; i < dependencyCount && reader.IsValid(); ++i)
+		{
+			reader.ReadString();
+			reader.Read<uint64_t>();
+		}
+	}
+}
+
+uint64_t Carol::GetMeshCacheKey(
+	std::string_view path,
+	std::string_view textureDir,
+	bool isSkinned)
+{
+	MappedFile file(path);
+
+	if (!file.IsValid())
+	{
+		return 0;
+	}
+
+	// The texture directory and the import flags change the cooked result as much as the source does
+	uint64_t seed = Hash64(textureDir.data(), textureDir.size(), MESH_CACHE_VERSION);
+	seed = Hash64(&isSkinned, sizeof(isSkinned), seed);
+
+	return Hash64(file.GetData().data(), file.GetData().size(), seed);
+}
+
+std::string Carol::GetMeshCachePath(uint64_t key)
+{
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+
+	return std::string("cache/") + name + ".mesh";
+}
+
+bool Carol::IsMeshCacheValid(std::span<const uint8_t> data, uint64_t key)
+{
+	if (data.empty() || key == 0)
+	{
+		return false;
+	}
+
+	BinaryReader reader(data);
+	auto header = reader.Read<MeshCacheHeader>();
+
+	return reader.IsValid()
+		&& header.Magic == MESH_CACHE_MAGIC
+		&& header.Version == MESH_CACHE_VERSION
+		&& header.SourceHash == key;
+}
+
+bool Carol::IsMeshCacheCurrent(std::span<const uint8_t> data)
+{
+	BinaryReader reader(data);
+	reader.Read<MeshCacheHeader>();
+	uint32_t dependencyCount = reader.Read<uint32_t>();
+
+	for (uint32_t i = 0; i < dependencyCount && reader.IsValid(); ++i)
+	{
+		auto path = reader.ReadString();
+		uint64_t hash = reader.Read<uint64_t>();
+
+		if (reader.IsValid() && HashFile(path) != hash)
+		{
+			return false;
+		}
+	}
+
+	return reader.IsValid();
+}
+
+Carol::MeshCacheWriter::MeshCacheWriter(uint64_t key, bool isSkinned)
+{
+	MeshCacheHeader header;
+	header.SourceHash = key;
+	header.Skinned = isSkinned;
+
+	mWriter.Write(header);
+}
+
+void Carol::MeshCacheWriter::WriteDependencies(std::span<const std::string> paths)
+{
+	mWriter.Write(uint32_t(paths.size()));
+
+	for (auto& path : paths)
+	{
+		mWriter.WriteString(path);
+		mWriter.Write(HashFile(path));
+	}
+}
+
+void Carol::MeshCacheWriter::WriteSkeleton(
+	std::span<const int> boneHierarchy,
+	std::span<const DirectX::XMFLOAT4X4> boneOffsets)
+{
+	mWriter.WriteArray(boneHierarchy);
+	mWriter.WriteArray(boneOffsets);
+}
+
+void Carol::MeshCacheWriter::WriteAnimationClips(const std::unordered_map<std::string, std::shared_ptr<const CompressedAnimationClip>>& animationClips)
+{
+	mWriter.Write(uint32_t(animationClips.size()));
+
+	for (auto& [name, clip] : animationClips)
+	{
+		mWriter.WriteString(name);
+		mWriter.WriteArray(clip->GetData());
+	}
+}
+
+void Carol::MeshCacheWriter::WriteMesh(
+	std::string_view name,
+	std::span<const Vertex> vertices,
+	const Mesh* mesh,
+	std::span<const std::string> texturePaths)
+{
+	mMeshIndices[mesh] = mMeshIndices.size();
+
+	mWriter.WriteString(name);
+	mWriter.Write(uint32_t(mesh->IsSkinned()));
+	mWriter.Write(uint32_t(mesh->IsTransparent()));
+	mWriter.Write(mesh->GetMeshConstants()->LodLevelCount);
+
+	mWriter.WriteArray(vertices);
+	mWriter.WriteArray(mesh->GetMeshlets());
+	mWriter.WriteArray(mesh->GetLodData());
+
+	auto cullData = mesh->GetCullData();
+	mWriter.Write(uint32_t(cullData.size()));
+
+	for (auto& clip : cullData)
+	{
+		mWriter.WriteString(clip.ClipName);
+		mWriter.Write(clip.BoundingBox);
+		mWriter.WriteArray(clip.MeshletCullData);
+	}
+
+	mWriter.Write(uint32_t(texturePaths.size()));
+
+	for (auto& path : texturePaths)
+	{
+		mWriter.WriteString(path);
+	}
+}
+
+void Carol::MeshCacheWriter::WriteNodeMesh(const Mesh* mesh)
+{
+	mNodeMeshes.push_back(mMeshIndices.at(mesh));
+}
+
+bool Carol::MeshCacheWriter::Save(std::string_view path)
+{
+	mWriter.WriteArray(std::span<const uint32_t>(mNodeMeshes));
+	mWriter.WriteAt(offsetof(MeshCacheHeader, MeshCount), uint32_t(mMeshIndices.size()));
+
+	CookStageScope stage(COOK_STAGE_CACHE_WRITE);
+	stage.AddBytes(mWriter.GetSize());
+
+	return mWriter.Save(path);
+}
+
+Carol::CachedModel::CachedModel(
+	ModelNode* rootNode,
+	std::span<const uint8_t> data)
+	:Model()
+{
+	BinaryReader reader(data);
+	auto header = reader.Read<MeshCacheHeader>();
+	mSkinned = header.Skinned;
+	SkipDependencies(reader);
+
+	auto boneHierarchy = reader.ReadArray<int>();
+	auto boneOffsets = reader.ReadArray<DirectX::XMFLOAT4X4>();
+	mSkeleton = gAnimationAssetManager->LoadSkeleton(boneHierarchy, boneOffsets);
+
+	uint32_t clipCount = reader.Read<uint32_t>();
+
+	for (uint32_t i = 0; i < clipCount; ++i)
+	{
+		std::string clipName(reader.ReadString());
+		auto data = reader.ReadArray<uint8_t>();
+
+		if (!reader.IsValid())
+		{
+			return;
+		}
+
+		auto clip = gAnimationAssetManager->FindAnimationClip(CompressedAnimationClip::ReadSourceHash(data));
+		mAnimationClips[clipName] = clip ? clip : gAnimationAssetManager->AddAnimationClip(std::make_unique<CompressedAnimationClip>(data));
+	}
+
+	std::vector<Mesh*> meshes;
+
+	for (int i = 0; i < header.MeshCount && reader.IsValid(); ++i)
+	{
+		std::string meshName(reader.ReadString());
+		bool isSkinned = reader.Read<uint32_t>();
+		bool isTransparent = reader.Read<uint32_t>();
+		uint32_t lodLevelCount = reader.Read<uint32_t>();
+
+		// The vertices stay in the mapped file or package and are uploaded from it without any copy on the CPU side
+		auto vertices = reader.ReadArray<Vertex>();
+		auto meshlets = reader.ReadArray<Meshlet>();
+		auto lodData = reader.ReadArray<ClusterLodData>();
+
+		// Every clip takes more than a byte, so a corrupt count cannot allocate more than the file holds
+		std::vector<ClipCullData> cullData(std::min<size_t>(reader.Read<uint32_t>(), data.size()));
+
+		for (auto& clip : cullData)
+		{
+			clip.ClipName = reader.ReadString();
+			clip.BoundingBox = reader.Read<DirectX::BoundingBox>();
+			clip.MeshletCullData = reader.ReadArray<CullData>();
+		}
+
+		// Meshes sample one texture of every usage
+		std::vector<std::string> texturePaths(reader.Read<uint32_t>() == 4 ? 4 : 0);
+
+		for (auto& path : texturePaths)
+		{
+			path = reader.ReadString();
+		}
+
+		if (!reader.IsValid() || texturePaths.empty() || !IsMeshValid(vertices, meshlets, lodData, cullData))
+		{
+			return;
+		}
+
+		auto& mesh = mMeshes[meshName];
+		mesh = std::make_unique<Mesh>(
+			vertices,
+			meshlets,
+			lodData,
+			lodLevelCount,
+			cullData,
+			isSkinned,
+			isTransparent);
+
+		AddMeshUpload(mesh.get(), texturePaths);
+		meshes.push_back(mesh.get());
+	}
+
+	auto nodeMeshes = reader.ReadArray<uint32_t>();
+
+	if (!reader.IsValid() || meshes.size() != header.MeshCount || std::ranges::any_of(nodeMeshes, [&](uint32_t idx) { return idx >= meshes.size(); }))
+	{
+		return;
+	}
+
+	for (auto idx : nodeMeshes)
+	{
+		rootNode->Meshes.push_back(meshes[idx]);
+	}
+
+	mValid = true;
+}
+
+bool Carol::CachedModel::IsValid()const
+{
+	return mValid;
+}
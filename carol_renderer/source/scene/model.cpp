@@ -2,20 +2,99 @@
 #include <dx12/resource.h>
 #include <dx12/heap.h>
 #include <dx12/indirect_command.h>
+#include <scene/animation_asset.h>
 #include <scene/mesh.h>
 #include <scene/assimp.h>
+#include <scene/camera.h>
+#include <scene/compressed_animation.h>
+#include <scene/mesh_cache.h>
+#include <scene/pose.h>
 #include <scene/texture.h>
 #include <scene/skinned_animation.h>
 #include <scene/timer.h>
+#include <utils/frame_arena.h>
+#include <utils/mapped_file.h>
+#include <utils/thread_pool.h>
 #include <global.h>
 #include <cmath>
 #include <algorithm>
+#include <functional>
 #include <ranges>
 
 namespace
 {
 	using DirectX::operator*;
 	using DirectX::operator+=;
+
+	// Times before the start wrap too, negative lookaheads sample the end of the previous loop
+	float WrapClipTime(const Carol::CompressedAnimationClip* clip, float t)
+	{
+		float duration = clip->GetClipEndTime() - clip->GetClipStartTime();
+
+		if (duration <= 0.f)
+		{
+			return t;
+		}
+
+		float offset = std::fmod(t - clip->GetClipStartTime(), duration);
+
+		return clip->GetClipStartTime() + (offset < 0.f ? offset + duration : offset);
+	}
+
+	// Scale, rotation and translation are interpolated apart, lerping the matrices would shear between differing rotations
+	DirectX::XMMATRIX InterpolateTransform(DirectX::FXMMATRIX M0, DirectX::CXMMATRIX M1, float alpha)
+	{
+		DirectX::XMVECTOR scale[2];
+		DirectX::XMVECTOR rotation[2];
+		DirectX::XMVECTOR translation[2];
+
+		if (!DirectX::XMMatrixDecompose(&scale[0], &rotation[0], &translation[0], M0)
+			|| !DirectX::XMMatrixDecompose(&scale[1], &rotation[1], &translation[1], M1))
+		{
+			return alpha < 0.5f ? M0 : M1;
+		}
+
+		return DirectX::XMMatrixAffineTransformation(
+			DirectX::XMVectorLerp(scale[0], scale[1], alpha),
+			DirectX::XMVectorZero(),
+			DirectX::XMQuaternionSlerp(rotation[0], rotation[1], alpha),
+			DirectX::XMVectorLerp(translation[0], translation[1], alpha));
+	}
+
+	float MoveTowards(float value, float target, float delta)
+	{
+		return value < target ? std::fmin(value + delta, target) : std::fmax(value - delta, target);
+	}
+
+	float GetMeshScreenSize(const Carol::Mesh* mesh, const Carol::Camera* camera)
+	{
+		auto* meshConstants = mesh->GetMeshConstants();
+		DirectX::XMMATRIX world = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&meshConstants->World));
+		DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&meshConstants->Center), world);
+
+		float scale = std::max({
+			DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[0])),
+			DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[1])),
+			DirectX::XMVectorGetX(DirectX::XMVector3Length(world.r[2])) });
+		float radius = scale * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&meshConstants->Extents)));
+		float dist = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, camera->GetPosition())));
+
+		// Fraction of the screen height covered by the bounding sphere
+		return dist > radius ? radius * camera->GetProj4x4f()._22 / dist : 1.f;
+	}
+
+	void SetTextureIdx(const Carol::ModelUpload& upload)
+	{
+		auto textureIdx = [](Carol::Texture* texture) -> uint32_t
+		{
+			return texture ? texture->GetGpuSrvIdx() : -1;
+		};
+
+		upload.Target->SetDiffuseTextureIdx(textureIdx(upload.Textures[0]));
+		upload.Target->SetNormalTextureIdx(textureIdx(upload.Textures[1]));
+		upload.Target->SetEmissiveTextureIdx(textureIdx(upload.Textures[2]));
+		upload.Target->SetMetallicRoughnessTextureIdx(textureIdx(upload.Textures[3]));
+	}
 }
 
 Carol::ModelNode::ModelNode()
@@ -25,16 +104,15 @@ Carol::ModelNode::ModelNode()
 
 
 Carol::Model::Model()
-	:mSkinnedConstants(std::make_unique<SkinnedConstants>())
 {
 	
 }
 
 Carol::Model::~Model()
 {
-	for (auto& path : mTexturePath)
+	for (auto& texture : mTextures)
 	{
-		gTextureManager->UnloadTexture(path);
+		gTextureManager->UnloadTexture(texture.Path, false, texture.Usage);
 	}
 }
 
@@ -48,6 +126,104 @@ const std::unordered_map<std::string, std::unique_ptr<Carol::Mesh>>& Carol::Mode
 	return mMeshes;
 }
 
+uint32_t Carol::Model::GetUploadCount()const
+{
+	return mUploads.size();
+}
+
+uint64_t Carol::Model::GetUploadSize(uint32_t idx)const
+{
+	auto& upload = mUploads[idx];
+	uint64_t size = upload.Target ? upload.Target->GetUploadSize() : 0;
+
+	// Textures uploaded before, by this model or another one, are not counted again
+	for (auto* texture : upload.Textures)
+	{
+		if (texture && !texture->IsUploaded())
+		{
+			size += texture->GetUploadSize();
+		}
+	}
+
+	return size;
+}
+
+void Carol::Model::Upload(uint32_t idx)
+{
+	auto& upload = mUploads[idx];
+
+	for (auto* texture : upload.Textures)
+	{
+		if (texture && !texture->IsUploaded())
+		{
+			texture->Upload();
+		}
+	}
+
+	if (!upload.Target)
+	{
+		return;
+	}
+
+	upload.Target->Upload();
+	SetTextureIdx(upload);
+	upload.Vertices = {};
+}
+
+std::span<const Carol::ModelTexture> Carol::Model::GetTextures()const
+{
+	return mTextures;
+}
+
+void Carol::Model::AddMeshUpload(Mesh* mesh, std::span<const std::string> texturePaths, std::vector<Vertex> vertices)
+{
+	ModelUpload meshUpload;
+	meshUpload.Target = mesh;
+	meshUpload.Vertices = std::move(vertices);
+
+	for (int i = 0; i < texturePaths.size(); ++i)
+	{
+		auto* texture = gTextureManager->AcquireTexture(texturePaths[i], false, TextureUsage(i));
+		meshUpload.Textures[i] = texture;
+
+		if (!texture)
+		{
+			continue;
+		}
+
+		// Only textures actually referenced are released with the model
+		mTextures.push_back({ texturePaths[i], TextureUsage(i) });
+
+		// Textures get uploads of their own ahead of the first mesh sampling them, which keeps uploads small
+		bool queued = std::ranges::any_of(mUploads, [texture](const ModelUpload& upload)
+		{
+			return std::ranges::find(upload.Textures, texture) != std::end(upload.Textures);
+		});
+
+		if (!queued)
+		{
+			mUploads.emplace_back().Textures[0] = texture;
+		}
+	}
+
+	mUploads.push_back(std::move(meshUpload));
+}
+
+void Carol::Model::DecodeTextures()
+{
+	std::vector<Texture*> textures;
+
+	for (auto& upload : mUploads)
+	{
+		if (!upload.Target)
+		{
+			textures.push_back(upload.Textures[0]);
+		}
+	}
+
+	gTextureManager->DecodeTextures(textures);
+}
+
 std::vector<std::string_view> Carol::Model::GetAnimationClips()const
 {
 	std::vector<std::string_view> animations;
@@ -60,141 +236,405 @@ std::vector<std::string_view> Carol::Model::GetAnimationClips()const
 	return animations;
 }
 
-void Carol::Model::SetAnimationClip(std::string_view clipName)
+void Carol::Model::SetAnimationClip(std::string_view clipName, float fadeDuration)
 {
 	if (!mSkinned || mAnimationClips.count(clipName.data()) == 0)
 	{
 		return;
 	}
 
-	mClipName = clipName;
-	mTimePos = 0.0f;
+	auto additiveIt = std::ranges::find(mAnimationLayers, ANIMATION_LAYER_ADDITIVE, &AnimationLayer::Mode);
+	bool fade = fadeDuration > 0.f && additiveIt != mAnimationLayers.begin();
+
+	AnimationLayer layer;
+	layer.ClipName = clipName;
+	layer.Clip = mAnimationClips[layer.ClipName].get();
+	layer.TimePos = layer.Clip->GetClipStartTime();
+	layer.Weight = fade ? 0.f : 1.f;
+	layer.FadeSpeed = fade ? 1.f / fadeDuration : 0.f;
+	layer.Cursor = std::make_unique<AnimationCursor>();
+	mAnimationLayers.insert(additiveIt, std::move(layer));
+	mKeyPoses[1].clear();
 
 	for (auto& [name, mesh] : mMeshes)
 	{
 		if (mesh->IsSkinned())
 		{
-			mesh->SetAnimationClip(mClipName);
+			mesh->SetAnimationClip(clipName);
 		}
 	}
 }
 
+void Carol::Model::SetAdditiveClip(std::string_view clipName, float weight, float fadeDuration)
+{
+	if (!mSkinned || mAnimationClips.count(clipName.data()) == 0)
+	{
+		return;
+	}
+
+	auto it = std::ranges::find_if(mAnimationLayers, [&](const AnimationLayer& layer)
+	{
+		return layer.Mode == ANIMATION_LAYER_ADDITIVE && layer.ClipName == clipName;
+	});
+
+	if (it == mAnimationLayers.end())
+	{
+		uint32_t boneCount = mSkeleton->Hierarchy.size();
+		auto& layer = mAnimationLayers.emplace_back();
+		layer.ClipName = clipName;
+		layer.Clip = mAnimationClips[layer.ClipName].get();
+		layer.Mode = ANIMATION_LAYER_ADDITIVE;
+		layer.TimePos = layer.Clip->GetClipStartTime();
+		layer.Weight = 0.f;
+		layer.Cursor = std::make_unique<AnimationCursor>();
+		layer.ReferencePose.resize(LocalPose::GetSize(boneCount));
+
+		LocalPose reference(layer.ReferencePose, boneCount);
+		layer.Clip->Sample(layer.TimePos, *layer.Cursor, reference);
+		it = mAnimationLayers.end() - 1;
+	}
+
+	it->TargetWeight = weight;
+	it->FadeSpeed = fadeDuration > 0.f ? std::fabs(weight - it->Weight) / fadeDuration : 0.f;
+	it->Weight = fadeDuration > 0.f ? it->Weight : weight;
+	mKeyPoses[1].clear();
+}
+
 void Carol::Model::Update(Timer* timer)
 {
-	if (mSkinned)
+	if (mSkinned && !mAnimationLayers.empty())
 	{
-		mTimePos += timer->DeltaTime();
+		AdvanceAnimationLayers(timer->DeltaTime());
+
+		uint32_t boneCount = mSkeleton->Hierarchy.size();
+		uint32_t period = std::max(mAnimationUpdatePeriod, 1u);
+		mHistFinalTransforms.swap(mFinalTransforms);
+		mFinalTransforms.resize(boneCount);
 
-		if (mTimePos > mAnimationClips[mClipName]->GetClipEndTime())
+		// A model without key poses is evaluated even when deferred
+		if (mKeyPoses[1].size() != boneCount || (IsPoseDue() && !mPoseEvaluationDeferred))
 		{
-			mTimePos = mAnimationClips[mClipName]->GetClipStartTime();
-		};
+			// The pose shown period - 1 frames later is sampled now
+			float lookahead = (period - 1) * timer->DeltaTime();
+			mKeyPoses[1].resize(boneCount);
+			EvaluatePose(lookahead, mKeyPoses[1]);
+			if (mHistFinalTransforms.size() == boneCount)
+			{
+				mKeyPoses[0] = mHistFinalTransforms;
+			}
+			else
+			{
+				mKeyPoses[0].resize(boneCount);
+				EvaluatePose(-timer->DeltaTime(), mKeyPoses[0]);
+			}
+
+			mFramesSinceEvaluation = 0;
+		}
 
-		std::vector<DirectX::XMFLOAT4X4> finalTransforms;
-		GetFinalTransforms(mClipName, mTimePos, finalTransforms);
+		// Once the key pose has been shown for two frames, both halves of the palette already hold it
+		bool settled = mFramesSinceEvaluation > period && !mBonePalette.empty();
+		float alpha = std::min(float(mFramesSinceEvaluation + 1) / period, 1.f);
+		++mFramesSinceEvaluation;
+		mPoseEvaluationDeferred = false;
 
-		for (int i = 0; i < mBoneHierarchy.size(); ++i)
+		if (settled)
 		{
-			DirectX::XMStoreFloat4x4(&finalTransforms[i], DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&finalTransforms[i])));
+			return;
 		}
 
-		std::copy(std::begin(mSkinnedConstants->FinalTransforms), std::end(mSkinnedConstants->FinalTransforms), mSkinnedConstants->HistFinalTransforms);
-		std::copy(std::begin(finalTransforms), std::end(finalTransforms), mSkinnedConstants->FinalTransforms);
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			DirectX::XMMATRIX M0 = DirectX::XMLoadFloat4x4(&mKeyPoses[0][i]);
+			DirectX::XMMATRIX M1 = DirectX::XMLoadFloat4x4(&mKeyPoses[1][i]);
+			DirectX::XMStoreFloat4x4(&mFinalTransforms[i], InterpolateTransform(M0, M1, alpha));
+		}
+
+		if (mHistFinalTransforms.size() != boneCount)
+		{
+			mHistFinalTransforms = mFinalTransforms;
+		}
+
+		// Dual quaternions cannot hold scale, such poses fall back to matrices
+		mPackedBonePaletteFormat = mBonePaletteFormat == BONE_PALETTE_DUAL_QUATERNION && IsRigidBonePalette(mFinalTransforms) && IsRigidBonePalette(mHistFinalTransforms)
+			? BONE_PALETTE_DUAL_QUATERNION : BONE_PALETTE_MATRIX;
+
+		uint32_t paletteSize = boneCount * GetBonePaletteStride(mPackedBonePaletteFormat);
+		mBonePalette.resize(2 * paletteSize);
+		PackBonePalette(mFinalTransforms, mPackedBonePaletteFormat, std::span(mBonePalette).first(paletteSize));
+		PackBonePalette(mHistFinalTransforms, mPackedBonePaletteFormat, std::span(mBonePalette).last(paletteSize));
 	}
 }
 
-void Carol::Model::GetFinalTransforms(std::string_view clipName, float t, std::vector<DirectX::XMFLOAT4X4>& finalTransforms)
+float Carol::Model::GetScreenSize(const Camera* camera)const
 {
-	auto& clip = mAnimationClips[std::string(clipName)];
-	uint32_t boneCount = mBoneHierarchy.size();
+	float screenSize = 0.f;
+
+	for (auto& [name, mesh] : mMeshes)
+	{
+		screenSize = std::max(screenSize, GetMeshScreenSize(mesh.get(), camera));
+	}
 
-	std::vector<DirectX::XMFLOAT4X4> toParentTransforms(boneCount);
-	std::vector<DirectX::XMFLOAT4X4> toRootTransforms(boneCount);
-	finalTransforms.resize(boneCount);
-	clip->Interpolate(t, toParentTransforms);
+	return screenSize;
+}
 
-	for (int i = 0; i < boneCount; ++i)
+void Carol::Model::UpdateTextures(const Camera* camera)
+{
+	for (auto& upload : mUploads)
 	{
-		DirectX::XMMATRIX toParent = DirectX::XMLoadFloat4x4(&toParentTransforms[i]);
-		DirectX::XMMATRIX parentToRoot = mBoneHierarchy[i] != -1 ? DirectX::XMLoadFloat4x4(&toRootTransforms[mBoneHierarchy[i]]) : DirectX::XMMatrixIdentity();
+		if (!upload.Target)
+		{
+			continue;
+		}
 
-		DirectX::XMMATRIX toRoot = toParent * parentToRoot;
-		DirectX::XMStoreFloat4x4(&toRootTransforms[i], toRoot);
+		float screenSize = camera ? GetMeshScreenSize(upload.Target, camera) : 1.f;
+
+		for (auto* texture : upload.Textures)
+		{
+			gTextureManager->RequestTextureMips(texture, screenSize);
+		}
+
+		// Streamed textures move to a new index whenever their mips change
+		SetTextureIdx(upload);
 	}
+}
+
+uint32_t Carol::Model::GetBoneCount()const
+{
+	return mSkeleton ? mSkeleton->Hierarchy.size() : 0;
+}
+
+const Carol::Skeleton* Carol::Model::GetSkeleton()const
+{
+	return mSkeleton.get();
+}
+
+uint32_t Carol::Model::GetFramesSinceEvaluation()const
+{
+	return mFramesSinceEvaluation;
+}
+
+bool Carol::Model::IsPoseDue()const
+{
+	return mKeyPoses[1].size() != GetBoneCount() || (mAnimationUpdatePeriod != 0 && mFramesSinceEvaluation >= mAnimationUpdatePeriod);
+}
+
+void Carol::Model::SetAnimationUpdatePeriod(uint32_t period)
+{
+	mAnimationUpdatePeriod = period;
+}
+
+void Carol::Model::DeferPoseEvaluation()
+{
+	mPoseEvaluationDeferred = true;
+}
+
+void Carol::Model::GetFinalTransforms(const CompressedAnimationClip* clip, float t, AnimationCursor& cursor, std::span<DirectX::XMFLOAT4X4> finalTransforms)const
+{
+	auto& arena = FrameArena::GetThreadArena();
+	size_t marker = arena.GetMarker();
+
+	auto toParentTransforms = arena.Allocate<DirectX::XMFLOAT4X4>(finalTransforms.size());
+	clip->Interpolate(t, cursor, toParentTransforms);
+	ResolveBoneHierarchy(toParentTransforms, finalTransforms);
 
-	for (int i = 0; i < mBoneHierarchy.size(); ++i)
+	arena.Rewind(marker);
+}
+
+void Carol::Model::AdvanceAnimationLayers(float deltaTime)
+{
+	for (auto& layer : mAnimationLayers)
 	{
-		DirectX::XMMATRIX offset = DirectX::XMLoadFloat4x4(&mBoneOffsets[i]);
-		DirectX::XMMATRIX toRoot = DirectX::XMLoadFloat4x4(&toRootTransforms[i]);
+		layer.TimePos = WrapClipTime(layer.Clip, layer.TimePos + deltaTime);
+		layer.Weight = MoveTowards(layer.Weight, layer.TargetWeight, layer.FadeSpeed * deltaTime);
+	}
 
-		DirectX::XMStoreFloat4x4(&finalTransforms[i], DirectX::XMMatrixMultiply(offset, toRoot));
+	// A fully faded in override layer hides every layer below it
+	for (int i = mAnimationLayers.size() - 1; i > 0; --i)
+	{
+		if (mAnimationLayers[i].Mode == ANIMATION_LAYER_OVERRIDE && mAnimationLayers[i].Weight >= 1.f)
+		{
+			mAnimationLayers.erase(mAnimationLayers.begin(), mAnimationLayers.begin() + i);
+			break;
+		}
 	}
+
+	std::erase_if(mAnimationLayers, [](const AnimationLayer& layer)
+	{
+		return layer.Mode == ANIMATION_LAYER_ADDITIVE && layer.Weight == 0.f && layer.TargetWeight == 0.f;
+	});
 }
 
-void Carol::Model::GetSkinnedVertices(std::string_view clipName, std::span<Vertex> vertices, std::vector<std::vector<Vertex>>& skinnedVertices)const
+void Carol::Model::EvaluatePose(float lookahead, std::span<DirectX::XMFLOAT4X4> finalTransforms)
 {
-	auto& frameTransforms = mFrameTransforms.at(clipName.data());
-	skinnedVertices.resize(frameTransforms.size());
-	std::ranges::for_each(skinnedVertices, [&](std::vector<Vertex>& v) {v.resize(vertices.size()); });
+	auto& arena = FrameArena::GetThreadArena();
+	size_t marker = arena.GetMarker();
 
-	for (int i = 0; i < frameTransforms.size(); ++i)
+	uint32_t boneCount = finalTransforms.size();
+	LocalPose pose(arena, boneCount);
+	LocalPose layerPose(arena, boneCount);
+
+	for (int i = 0; i < mAnimationLayers.size(); ++i)
 	{
-		auto& finalTransforms = frameTransforms[i];
+		auto& layer = mAnimationLayers[i];
+		float t = WrapClipTime(layer.Clip, layer.TimePos + lookahead);
+		float weight = MoveTowards(layer.Weight, layer.TargetWeight, layer.FadeSpeed * lookahead);
 
-		for (int j = 0; j < vertices.size(); ++j)
+		// The bottom layer has nothing to blend with
+		if (i == 0)
+		{
+			layer.Clip->Sample(t, *layer.Cursor, pose);
+		}
+		else if (weight > 0.f)
 		{
-			auto& vertex = vertices[j];
-			auto& skinnedVertex = skinnedVertices[i][j];
+			layer.Clip->Sample(t, *layer.Cursor, layerPose);
 
-			if (vertex.Weights.x == 0.f)
+			if (layer.Mode == ANIMATION_LAYER_OVERRIDE)
 			{
-				skinnedVertices[i][j] = vertex;
+				BlendPoses(pose, layerPose, weight, pose);
 			}
 			else
 			{
-				float weights[] =
-				{
-					vertex.Weights.x,
-					vertex.Weights.y,
-					vertex.Weights.z,
-					1 - vertex.Weights.x - vertex.Weights.y - vertex.Weights.z
-				};
-
-				DirectX::XMMATRIX transform[] =
-				{
-					DirectX::XMLoadFloat4x4(&finalTransforms[vertex.BoneIndices.x]),
-					DirectX::XMLoadFloat4x4(&finalTransforms[vertex.BoneIndices.y]),
-					DirectX::XMLoadFloat4x4(&finalTransforms[vertex.BoneIndices.z]),
-					DirectX::XMLoadFloat4x4(&finalTransforms[vertex.BoneIndices.w])
-
-				};
-
-				DirectX::XMVECTOR pos = { vertex.Pos.x,vertex.Pos.y,vertex.Pos.z,1.f };
-				DirectX::XMVECTOR normal = { vertex.Normal.x,vertex.Normal.y,vertex.Normal.z,0.f };
-				DirectX::XMVECTOR skinnedPos = { 0.f,0.f,0.f,0.f };
-				DirectX::XMVECTOR skinnedNormal = { 0.f,0.f,0.f,0.f };
-
-				for (int k = 0; k < 4; ++k)
-				{
-					if (weights[k] == 0.f)
-					{
-						break;
-					}
-
-					skinnedPos += weights[k] * DirectX::XMVector4Transform(pos, transform[k]);
-					skinnedNormal += weights[k] * DirectX::XMVector4Transform(normal, transform[k]);
-				}
-
-				DirectX::XMStoreFloat3(&skinnedVertex.Pos, skinnedPos);
-				DirectX::XMStoreFloat3(&skinnedVertex.Normal, skinnedNormal);
+				AddPose(pose, layerPose, LocalPose(layer.ReferencePose, boneCount), weight, pose);
 			}
 		}
 	}
+
+	auto toParentTransforms = arena.Allocate<DirectX::XMFLOAT4X4>(boneCount);
+	BuildLocalTransforms(pose, toParentTransforms);
+	ResolveBoneHierarchy(toParentTransforms, finalTransforms);
+
+	arena.Rewind(marker);
+}
+
+void Carol::Model::ResolveBoneHierarchy(std::span<const DirectX::XMFLOAT4X4> toParentTransforms, std::span<DirectX::XMFLOAT4X4> finalTransforms)const
+{
+	auto& arena = FrameArena::GetThreadArena();
+	size_t marker = arena.GetMarker();
+
+	uint32_t boneCount = finalTransforms.size();
+	auto& hierarchy = mSkeleton->Hierarchy;
+	auto& offsets = mSkeleton->Offsets;
+	auto toRootTransforms = arena.Allocate<DirectX::XMFLOAT4X4>(boneCount);
+
+	// Parents precede their children, so one pass resolves the hierarchy
+	for (int i = 0; i < boneCount; ++i)
+	{
+		DirectX::XMMATRIX toParent = DirectX::XMLoadFloat4x4(&toParentTransforms[i]);
+		DirectX::XMMATRIX parentToRoot = hierarchy[i] != -1 ? DirectX::XMLoadFloat4x4(&toRootTransforms[hierarchy[i]]) : DirectX::XMMatrixIdentity();
+
+		DirectX::XMMATRIX toRoot = toParent * parentToRoot;
+		DirectX::XMStoreFloat4x4(&toRootTransforms[i], toRoot);
+		DirectX::XMStoreFloat4x4(&finalTransforms[i], DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&offsets[i]), toRoot));
+	}
+
+	arena.Rewind(marker);
+}
+
+Carol::PoseSamplingStats Carol::Model::SamplePoses(
+	const CompressedAnimationClip* clip,
+	const PoseSamplingSettings& settings,
+	std::vector<std::vector<DirectX::XMFLOAT4X4>>& frameTransforms)const
+{
+	uint32_t boneCount = mSkeleton->Hierarchy.size();
+	std::vector<DirectX::XMFLOAT3> bindJoints(boneCount);
+	DirectX::XMVECTOR jointMin = DirectX::XMVectorReplicate(D3D12_FLOAT32_MAX);
+	DirectX::XMVECTOR jointMax = DirectX::XMVectorReplicate(-D3D12_FLOAT32_MAX);
+
+	// A joint sits at the origin of its bone, the offset matrix maps it from bind space
+	for (int i = 0; i < boneCount; ++i)
+	{
+		DirectX::XMMATRIX offset = DirectX::XMLoadFloat4x4(&mSkeleton->Offsets[i]);
+		DirectX::XMVECTOR joint = DirectX::XMMatrixInverse(nullptr, offset).r[3];
+		DirectX::XMStoreFloat3(&bindJoints[i], joint);
+		jointMin = DirectX::XMVectorMin(jointMin, joint);
+		jointMax = DirectX::XMVectorMax(jointMax, joint);
+	}
+
+	float radius = boneCount ? 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(jointMax, jointMin))) : 0.f;
+	float tolerance = settings.Tolerance * std::max(radius, 1e-3f);
+
+	AnimationCursor cursor;
+	PoseSamplingStats stats;
+	frameTransforms.clear();
+
+	auto samplePose = [&](float t)
+	{
+		std::vector<DirectX::XMFLOAT4X4> pose(boneCount);
+		GetFinalTransforms(clip, t, cursor, pose);
+		return pose;
+	};
+
+	auto getDeviation = [&](std::span<const DirectX::XMFLOAT4X4> pose0, std::span<const DirectX::XMFLOAT4X4> pose1, std::span<const DirectX::XMFLOAT4X4> poseMid)
+	{
+		float deviation = 0.f;
+
+		for (int i = 0; i < boneCount; ++i)
+		{
+			DirectX::XMVECTOR joint = DirectX::XMLoadFloat3(&bindJoints[i]);
+			DirectX::XMVECTOR joint0 = DirectX::XMVector3TransformCoord(joint, DirectX::XMLoadFloat4x4(&pose0[i]));
+			DirectX::XMVECTOR joint1 = DirectX::XMVector3TransformCoord(joint, DirectX::XMLoadFloat4x4(&pose1[i]));
+			DirectX::XMVECTOR jointMid = DirectX::XMVector3TransformCoord(joint, DirectX::XMLoadFloat4x4(&poseMid[i]));
+			DirectX::XMVECTOR error = DirectX::XMVectorSubtract(DirectX::XMVectorLerp(joint0, joint1, 0.5f), jointMid);
+			deviation = std::max(deviation, DirectX::XMVectorGetX(DirectX::XMVector3Length(error)));
+		}
+
+		return deviation;
+	};
+
+	// Appends the samples inside (t0, t1] in time order. Poses are moved into frameTransforms,
+	// so spans of earlier samples stay valid when it reallocates.
+	auto subdivide = [&](auto& self, float t0, std::span<const DirectX::XMFLOAT4X4> pose0, float t1, std::vector<DirectX::XMFLOAT4X4>&& pose1)->void
+	{
+		float tMid = 0.5f * (t0 + t1);
+		auto poseMid = samplePose(tMid);
+		float deviation = getDeviation(pose0, pose1, poseMid);
+
+		if (t1 - t0 > settings.MaxInterval || (deviation > tolerance && t1 - t0 > 2.f * settings.MinInterval))
+		{
+			self(self, t0, pose0, tMid, std::move(poseMid));
+			self(self, tMid, frameTransforms.back(), t1, std::move(pose1));
+		}
+		else
+		{
+			stats.MaxDeviation = std::max(stats.MaxDeviation, deviation);
+			frameTransforms.emplace_back(std::move(pose1));
+		}
+	};
+
+	float startTime = clip->GetClipStartTime();
+	float endTime = clip->GetClipEndTime();
+	frameTransforms.emplace_back(samplePose(startTime));
+
+	if (endTime > startTime)
+	{
+		subdivide(subdivide, startTime, frameTransforms.front(), endTime, samplePose(endTime));
+	}
+
+	stats.SampleCount = frameTransforms.size();
+
+	return stats;
+}
+
+const Carol::PoseSamplingStats* Carol::Model::GetPoseSamplingStats(std::string_view clipName)const
+{
+	auto it = mPoseSamplingStats.find(std::string(clipName));
+	return it == mPoseSamplingStats.end() ? nullptr : &it->second;
+}
+
+std::span<const DirectX::XMFLOAT4> Carol::Model::GetBonePalette()const
+{
+	return mBonePalette;
+}
+
+Carol::BonePaletteFormat Carol::Model::GetBonePaletteFormat()const
+{
+	return mPackedBonePaletteFormat;
 }
 
-const Carol::SkinnedConstants* Carol::Model::GetSkinnedConstants()const
+void Carol::Model::SetBonePaletteFormat(BonePaletteFormat format)
 {
-	return mSkinnedConstants.get();
+	mBonePaletteFormat = format;
+	mBonePalette.clear();
 }
 
 void Carol::Model::SetMeshCBAddress(std::string_view meshName, D3D12_GPU_VIRTUAL_ADDRESS addr)
@@ -275,6 +715,14 @@ void Carol::ModelManager::InitBuffers()
 		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
 		D3D12_RESOURCE_FLAG_NONE,
 		true);
+
+	mBonePaletteBufferAllocator = std::make_unique<FrameBufferAllocator>(
+		16384,
+		sizeof(DirectX::XMFLOAT4),
+		gHeapManager->GetUploadBuffersHeap(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_FLAG_NONE,
+		false);
 }
 
 std::vector<std::string_view> Carol::ModelManager::GetAnimationClips(std::string_view modelName)const
@@ -309,23 +757,90 @@ void Carol::ModelManager::LoadModel(
 	std::string_view textureDir,
 	bool isSkinned)
 {
-	mRootNode->Children.push_back(std::make_unique<ModelNode>());
-	auto& node = mRootNode->Children.back();
+	auto node = std::make_unique<ModelNode>();
 	node->Children.push_back(std::make_unique<ModelNode>());
-
 	node->Name = name;
-	mModels[node->Name] = std::make_unique<AssimpModel>(
-		node.get(),
-		path,
-		textureDir,
-		isSkinned);
 
-	for (auto& [name, mesh] : mModels[node->Name]->GetMeshes())
+	std::unique_ptr<MappedFile> cacheFile;
+	auto model = ImportModel(node.get(), path, textureDir, isSkinned, cacheFile);
+
+	for (int i = 0; i < model->GetUploadCount(); ++i)
+	{
+		model->Upload(i);
+	}
+
+	AddModel(std::move(node), std::move(model));
+}
+
+void Carol::ModelManager::AddModel(std::unique_ptr<ModelNode> node, std::unique_ptr<Model> model)
+{
+	auto& addedModel = mModels[node->Name];
+	addedModel = std::move(model);
+	addedModel->SetBonePaletteFormat(mBonePaletteFormat);
+
+	// Skinned meshes take their cull data, bounds and palette from a clip, so they start on the first one by name
+	auto clips = addedModel->GetAnimationClips();
+
+	if (addedModel->IsSkinned() && !clips.empty())
+	{
+		addedModel->SetAnimationClip(*std::ranges::min_element(clips));
+	}
+
+	for (auto& [name, mesh] : addedModel->GetMeshes())
 	{
 		std::string meshName = node->Name + '_' + name;
 		uint32_t type = uint32_t(mesh->IsSkinned()) | (uint32_t(mesh->IsTransparent()) << 1);
 		mMeshes[type][meshName] = mesh.get();
 	}
+
+	mRootNode->Children.push_back(std::move(node));
+}
+
+std::unique_ptr<Carol::Model> Carol::ImportModel(
+	ModelNode* rootNode,
+	std::string_view path,
+	std::string_view textureDir,
+	bool isSkinned,
+	std::unique_ptr<MappedFile>& cacheFile)
+{
+	// Reuse the cooked meshlets, cull data and animations when the source and the files it references are unchanged
+	uint64_t cacheKey = GetMeshCacheKey(path, textureDir, isSkinned);
+	std::string cachePath = GetMeshCachePath(cacheKey);
+	cacheFile = std::make_unique<MappedFile>(cachePath);
+
+	if (IsMeshCacheValid(cacheFile->GetData(), cacheKey) && IsMeshCacheCurrent(cacheFile->GetData()))
+	{
+		auto model = std::make_unique<CachedModel>(
+			rootNode,
+			cacheFile->GetData());
+
+		// A truncated or corrupt cache is imported again and rewritten
+		if (model->IsValid())
+		{
+			model->DecodeTextures();
+
+			return model;
+		}
+	}
+
+	cacheFile.reset();
+	std::unique_ptr<MeshCacheWriter> cacheWriter = cacheKey ? std::make_unique<MeshCacheWriter>(cacheKey, isSkinned) : nullptr;
+
+	auto model = std::make_unique<AssimpModel>(
+		rootNode,
+		path,
+		textureDir,
+		isSkinned,
+		cacheWriter.get());
+
+	if (cacheWriter)
+	{
+		cacheWriter->Save(cachePath);
+	}
+
+	model->DecodeTextures();
+
+	return model;
 }
 
 void Carol::ModelManager::UnloadModel(std::string_view modelName)
@@ -372,9 +887,29 @@ void Carol::ModelManager::SetWorld(std::string_view modelName, DirectX::XMMATRIX
 	}
 }
 
-void Carol::ModelManager::SetAnimationClip(std::string_view modelName, std::string_view clipName)
+void Carol::ModelManager::SetAnimationClip(std::string_view modelName, std::string_view clipName, float fadeDuration)
+{
+	mModels[modelName.data()]->SetAnimationClip(clipName, fadeDuration);
+}
+
+void Carol::ModelManager::SetAdditiveClip(std::string_view modelName, std::string_view clipName, float weight, float fadeDuration)
+{
+	mModels[modelName.data()]->SetAdditiveClip(clipName, weight, fadeDuration);
+}
+
+void Carol::ModelManager::SetAnimationLodSettings(const AnimationLodSettings& settings)
 {
-	mModels[modelName.data()]->SetAnimationClip(clipName);
+	mAnimationLodSettings = settings;
+}
+
+void Carol::ModelManager::SetBonePaletteFormat(BonePaletteFormat format)
+{
+	mBonePaletteFormat = format;
+
+	for (auto& [name, model] : mModels)
+	{
+		model->SetBonePaletteFormat(format);
+	}
 }
 
 uint32_t Carol::ModelManager::GetMeshBufferIdx(MeshType type)const
@@ -402,14 +937,26 @@ uint32_t Carol::ModelManager::GetInstanceCulledMarkBufferIdx(MeshType type) cons
 	return mInstanceCulledMarkBuffer[uint32_t(type)]->GetGpuUavIdx();
 }
 
-void Carol::ModelManager::Update(Timer* timer, uint64_t cpuFenceValue, uint64_t completedFenceValue)
+void Carol::ModelManager::Update(Timer* timer, const Camera* camera, uint64_t cpuFenceValue, uint64_t completedFenceValue)
 {
+	ProcessNode(mRootNode.get(), DirectX::XMMatrixIdentity());
+	ScheduleAnimations(camera);
+
+	mUpdateModels.clear();
+
 	for (auto& [name, model] : mModels)
 	{
-		model->Update(timer);
+		mUpdateModels.push_back(model.get());
 	}
 
-	ProcessNode(mRootNode.get(), DirectX::XMMatrixIdentity());
+	// Instances of a skeleton are evaluated back to back, so the shared hierarchy and clip blocks stay in cache
+	std::ranges::stable_sort(mUpdateModels, std::less<>(), &Model::GetSkeleton);
+
+	// Models only touch their own pose, scratch memory comes from the arena of the evaluating thread
+	gThreadPool->ParallelFor(mUpdateModels.size(), [&](uint32_t i)
+	{
+		mUpdateModels[i]->Update(timer);
+	});
 
 	for (int i = 0; i < MESH_TYPE_COUNT; ++i)
 	{
@@ -423,17 +970,46 @@ void Carol::ModelManager::Update(Timer* timer, uint64_t cpuFenceValue, uint64_t
 	mSkinnedBufferAllocator->DiscardBuffer(mSkinnedBuffer.release(), cpuFenceValue);
 	mSkinnedBuffer = mSkinnedBufferAllocator->RequestBuffer(completedFenceValue, GetModelsCount());
 
+	uint32_t paletteSize = 0;
+	for (auto& [name, model] : mModels)
+	{
+		if (model->IsSkinned())
+		{
+			paletteSize += model->GetBonePalette().size();
+		}
+	}
+
+	mBonePaletteBufferAllocator->DiscardBuffer(mBonePaletteBuffer.release(), cpuFenceValue);
+	mBonePaletteBuffer = mBonePaletteBufferAllocator->RequestBuffer(completedFenceValue, std::max(paletteSize, 1u));
+
 	int modelIdx = 0;
+	uint32_t paletteOffset = 0;
 	for (auto& [name, model] : mModels)
 	{
 		if (model->IsSkinned())
 		{
-			mSkinnedBuffer->CopyElements(model->GetSkinnedConstants(), modelIdx);
+			// Current and previous poses are packed back to back
+			auto palette = model->GetBonePalette();
+
+			SkinnedConstants skinnedConstants;
+			skinnedConstants.BonePaletteBufferIdx = mBonePaletteBuffer->GetGpuSrvIdx();
+			skinnedConstants.BonePaletteOffset = paletteOffset;
+			skinnedConstants.HistBonePaletteOffset = paletteOffset + palette.size() / 2;
+			skinnedConstants.BonePaletteFormat = model->GetBonePaletteFormat();
+
+			mBonePaletteBuffer->CopyElements(palette.data(), paletteOffset, palette.size());
+			paletteOffset += palette.size();
+			mSkinnedBuffer->CopyElements(&skinnedConstants, modelIdx);
 			model->SetSkinnedCBAddress(mSkinnedBuffer->GetElementAddress(modelIdx));
 			++modelIdx;
 		}
 	}
 
+	for (auto& [name, model] : mModels)
+	{
+		model->UpdateTextures(camera);
+	}
+
 	for (int i = 0; i < MESH_TYPE_COUNT; ++i)
 	{
 		int meshIdx = 0;
@@ -459,6 +1035,21 @@ void Carol::ModelManager::Update(Timer* timer, uint64_t cpuFenceValue, uint64_t
 	}
 }
 
+void Carol::ModelManager::ScheduleAnimations(const Camera* camera)
+{
+	mAnimatedModels.clear();
+
+	for (auto& [name, model] : mModels)
+	{
+		if (model->IsSkinned())
+		{
+			mAnimatedModels.emplace_back(camera ? model->GetScreenSize(camera) : 1.f, model.get());
+		}
+	}
+
+	Carol::ScheduleAnimations(mAnimatedModels, mAnimationLodSettings, mPoseRequests);
+}
+
 void Carol::ModelManager::ProcessNode(ModelNode* node, DirectX::XMMATRIX parentToRoot)
 {
 	DirectX::XMMATRIX toParent = DirectX::XMLoadFloat4x4(&node->Transformation);
@@ -473,4 +1064,55 @@ void Carol::ModelManager::ProcessNode(ModelNode* node, DirectX::XMMATRIX parentT
 	{
 		ProcessNode(child.get(), world);
 	}
-}
\ No newline at end of file
+}
+
+void Carol::ScheduleAnimations(
+	std::span<const std::pair<float, Model*>> models,
+	const AnimationLodSettings& settings,
+	std::vector<std::pair<float, Model*>>& requests)
+{
+	requests.clear();
+
+	for (auto [screenSize, model] : models)
+	{
+		uint32_t period = 1;
+
+		if (screenSize < settings.FrozenScreenSize)
+		{
+			period = 0;
+		}
+		else if (screenSize < settings.QuarterRateScreenSize)
+		{
+			period = 4;
+		}
+		else if (screenSize < settings.HalfRateScreenSize)
+		{
+			period = 2;
+		}
+
+		model->SetAnimationUpdatePeriod(period);
+
+		if (model->IsPoseDue())
+		{
+			requests.emplace_back(screenSize * (model->GetFramesSinceEvaluation() + 1), model);
+		}
+	}
+
+	// Larger and staler models go first, the rest keep holding their key pose until the budget allows
+	std::sort(requests.begin(), requests.end(), [](auto& a, auto& b) { return a.first > b.first; });
+	uint32_t boneBudget = settings.BoneBudget;
+
+	for (int i = 0; i < requests.size(); ++i)
+	{
+		auto* model = requests[i].second;
+
+		if (i > 0 && model->GetBoneCount() > boneBudget)
+		{
+			model->DeferPoseEvaluation();
+		}
+		else
+		{
+			boneBudget -= std::min(model->GetBoneCount(), boneBudget);
+		}
+	}
+}
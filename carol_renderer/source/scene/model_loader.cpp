@@ -0,0 +1,194 @@
+#include <scene/model_loader.h>
+#include <scene/mesh_cache.h>
+#include <scene/model.h>
+#include <scene/scene_package.h>
+#include <scene/texture.h>
+#include <utils/exception.h>
+#include <utils/mapped_file.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <chrono>
+
+Carol::ModelUploader::~ModelUploader()
+{
+}
+
+void Carol::GpuModelUploader::Upload(Model* model, uint32_t idx)
+{
+	model->Upload(idx);
+}
+
+void Carol::GpuModelUploader::AddModel(std::unique_ptr<ModelNode> node, std::unique_ptr<Model> model)
+{
+	gModelManager->AddModel(std::move(node), std::move(model));
+}
+
+Carol::ModelLoader::ModelLoader(
+	std::unique_ptr<ModelUploader> uploader,
+	uint64_t uploadBudget)
+	:mUploader(std::move(uploader)),
+	mUploadBudget(uploadBudget)
+{
+}
+
+Carol::ModelLoader::~ModelLoader()
+{
+	// Imports still running write into their jobs
+	for (auto& job : mJobs)
+	{
+		if (job->Import.valid())
+		{
+			job->Import.wait();
+		}
+	}
+}
+
+std::future<void> Carol::ModelLoader::LoadModel(
+	std::string_view name,
+	std::string_view path,
+	std::string_view textureDir,
+	DirectX::XMMATRIX world,
+	bool isSkinned)
+{
+	auto& job = mJobs.emplace_back(std::make_unique<ModelLoadJob>());
+	job->Path = path;
+	job->TextureDir = textureDir;
+	job->Skinned = isSkinned;
+
+	job->Node = std::make_unique<ModelNode>();
+	job->Node->Children.push_back(std::make_unique<ModelNode>());
+	job->Node->Name = name;
+	DirectX::XMStoreFloat4x4(&job->Node->Transformation, world);
+
+	job->Import = gThreadPool->Submit([job = job.get()]()
+	{
+		job->ImportedModel = ImportModel(job->Node.get(), job->Path, job->TextureDir, job->Skinned, job->CacheFile);
+	});
+
+	return job->Loaded.get_future();
+}
+
+std::vector<std::future<void>> Carol::ModelLoader::LoadScene(std::shared_ptr<const ScenePackage> package)
+{
+	std::vector<std::future<void>> loaded;
+
+	// Registered before any import runs, so the models find their textures in the package
+	gTextureManager->AddScenePackage(package);
+
+	for (auto& model : package->GetModels())
+	{
+		auto& job = mJobs.emplace_back(std::make_unique<ModelLoadJob>());
+		job->Package = package;
+
+		job->Node = std::make_unique<ModelNode>();
+		job->Node->Children.push_back(std::make_unique<ModelNode>());
+		job->Node->Name = model.Name;
+		job->Node->Transformation = model.World;
+
+		job->Import = gThreadPool->Submit([job = job.get(), data = model.Data]()
+		{
+			auto model = std::make_unique<CachedModel>(job->Node.get(), data);
+			ThrowIfFailed(model->IsValid() ? S_OK : E_FAIL);
+
+			job->ImportedModel = std::move(model);
+			job->ImportedModel->DecodeTextures();
+		});
+
+		loaded.push_back(job->Loaded.get_future());
+	}
+
+	return loaded;
+}
+
+uint64_t Carol::ModelLoader::Upload(uint64_t cpuFenceValue)
+{
+	uint64_t uploadSize = 0;
+
+	// Jobs are served in request order, one whose import is still running does not hold back the others
+	for (auto& job : mJobs)
+	{
+		if (job->Failed || job->UploadFenceValue)
+		{
+			continue;
+		}
+
+		if (!job->ImportDone)
+		{
+			if (job->Import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				continue;
+			}
+
+			job->ImportDone = true;
+
+			try
+			{
+				job->Import.get();
+			}
+			catch (...)
+			{
+				job->Failed = true;
+				job->Loaded.set_exception(std::current_exception());
+				continue;
+			}
+		}
+
+		while (job->NextUpload < job->ImportedModel->GetUploadCount())
+		{
+			uint64_t size = job->ImportedModel->GetUploadSize(job->NextUpload);
+
+			// An upload larger than the budget still goes through, alone in its frame
+			if (uploadSize && uploadSize + size > mUploadBudget)
+			{
+				return uploadSize;
+			}
+
+			try
+			{
+				mUploader->Upload(job->ImportedModel.get(), job->NextUpload++);
+			}
+			catch (...)
+			{
+				job->Failed = true;
+				job->Loaded.set_exception(std::current_exception());
+				break;
+			}
+
+			uploadSize += size;
+		}
+
+		job->UploadFenceValue = cpuFenceValue + 1;
+	}
+
+	return uploadSize;
+}
+
+void Carol::ModelLoader::Update(uint64_t completedFenceValue)
+{
+	std::erase_if(mJobs, [&](auto& job)
+	{
+		// A job failing in its uploads keeps the model until the GPU is done with the uploads recorded before
+		if (job->UploadFenceValue > completedFenceValue || (!job->UploadFenceValue && !job->Failed))
+		{
+			return false;
+		}
+
+		if (!job->Failed)
+		{
+			mUploader->AddModel(std::move(job->Node), std::move(job->ImportedModel));
+			job->Loaded.set_value();
+		}
+
+		return true;
+	});
+}
+
+uint32_t Carol::ModelLoader::GetPendingCount()const
+{
+	return mJobs.size();
+}
+
+void Carol::ModelLoader::SetUploadBudget(uint64_t uploadBudget)
+{
+	mUploadBudget = uploadBudget;
+}
@@ -0,0 +1,191 @@
+#include <scene/pose.h>
+#include <utils/frame_arena.h>
+
+namespace
+{
+	using DirectX::operator+;
+	using DirectX::operator-;
+	using DirectX::operator*;
+
+	DirectX::XMVECTOR LoadChannel(const Carol::LocalPose& pose, int channel, uint32_t i)
+	{
+		return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(pose.Channels[channel] + i));
+	}
+
+	void StoreChannel(Carol::LocalPose& pose, int channel, uint32_t i, DirectX::FXMVECTOR v)
+	{
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(pose.Channels[channel] + i), v);
+	}
+
+	// Normalized lerp of 4 quaternions at once along the shorter arc
+	void NlerpQuaternions(const DirectX::XMVECTOR (&a)[4], const DirectX::XMVECTOR (&b)[4], DirectX::FXMVECTOR weight, DirectX::XMVECTOR (&result)[4])
+	{
+		DirectX::XMVECTOR dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+		DirectX::XMVECTOR sign = DirectX::XMVectorSelect(DirectX::XMVectorSplatOne(), DirectX::XMVectorReplicate(-1.f), DirectX::XMVectorLess(dot, DirectX::XMVectorZero()));
+
+		for (int j = 0; j < 4; ++j)
+		{
+			result[j] = a[j] + (b[j] * sign - a[j]) * weight;
+		}
+
+		DirectX::XMVECTOR invLength = DirectX::XMVectorReciprocalSqrt(result[0] * result[0] + result[1] * result[1] + result[2] * result[2] + result[3] * result[3]);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			result[j] = result[j] * invLength;
+		}
+	}
+
+	// Hamilton product p * q of 4 quaternions at once, the same as XMQuaternionMultiply(q, p)
+	void MultiplyQuaternions(const DirectX::XMVECTOR (&p)[4], const DirectX::XMVECTOR (&q)[4], DirectX::XMVECTOR (&result)[4])
+	{
+		result[0] = p[3] * q[0] + p[0] * q[3] + p[1] * q[2] - p[2] * q[1];
+		result[1] = p[3] * q[1] - p[0] * q[2] + p[1] * q[3] + p[2] * q[0];
+		result[2] = p[3] * q[2] + p[0] * q[1] - p[1] * q[0] + p[2] * q[3];
+		result[3] = p[3] * q[3] - p[0] * q[0] - p[1] * q[1] - p[2] * q[2];
+	}
+}
+
+Carol::LocalPose::LocalPose(std::span<float> data, uint32_t boneCount)
+	:BoneCount(boneCount),
+	PaddedCount((boneCount + 3) / 4 * 4)
+{
+	for (int i = 0; i < POSE_CHANNEL_COUNT; ++i)
+	{
+		Channels[i] = data.data() + i * PaddedCount;
+	}
+}
+
+Carol::LocalPose::LocalPose(FrameArena& arena, uint32_t boneCount)
+	:LocalPose(arena.Allocate<float>(GetSize(boneCount)), boneCount)
+{
+}
+
+uint32_t Carol::LocalPose::GetSize(uint32_t boneCount)
+{
+	return (boneCount + 3) / 4 * 4 * POSE_CHANNEL_COUNT;
+}
+
+void Carol::BlendPoses(const LocalPose& pose0, const LocalPose& pose1, float weight, LocalPose& result)
+{
+	DirectX::XMVECTOR w = DirectX::XMVectorReplicate(weight);
+
+	for (uint32_t i = 0; i < result.BoneCount; i += 4)
+	{
+		for (int c : { POSE_TRANSLATION_X, POSE_TRANSLATION_Y, POSE_TRANSLATION_Z, POSE_SCALE_X, POSE_SCALE_Y, POSE_SCALE_Z })
+		{
+			StoreChannel(result, c, i, DirectX::XMVectorLerpV(LoadChannel(pose0, c, i), LoadChannel(pose1, c, i), w));
+		}
+
+		DirectX::XMVECTOR q0[4];
+		DirectX::XMVECTOR q1[4];
+		DirectX::XMVECTOR q[4];
+
+		for (int j = 0; j < 4; ++j)
+		{
+			q0[j] = LoadChannel(pose0, POSE_ROTATION_X + j, i);
+			q1[j] = LoadChannel(pose1, POSE_ROTATION_X + j, i);
+		}
+
+		NlerpQuaternions(q0, q1, w, q);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			StoreChannel(result, POSE_ROTATION_X + j, i, q[j]);
+		}
+	}
+}
+
+void Carol::AddPose(const LocalPose& base, const LocalPose& additive, const LocalPose& reference, float weight, LocalPose& result)
+{
+	DirectX::XMVECTOR w = DirectX::XMVectorReplicate(weight);
+	DirectX::XMVECTOR one = DirectX::XMVectorSplatOne();
+	DirectX::XMVECTOR identity[4] = { DirectX::XMVectorZero(), DirectX::XMVectorZero(), DirectX::XMVectorZero(), one };
+
+	for (uint32_t i = 0; i < result.BoneCount; i += 4)
+	{
+		for (int c : { POSE_TRANSLATION_X, POSE_TRANSLATION_Y, POSE_TRANSLATION_Z })
+		{
+			DirectX::XMVECTOR delta = LoadChannel(additive, c, i) - LoadChannel(reference, c, i);
+			StoreChannel(result, c, i, LoadChannel(base, c, i) + delta * w);
+		}
+
+		for (int c : { POSE_SCALE_X, POSE_SCALE_Y, POSE_SCALE_Z })
+		{
+			DirectX::XMVECTOR ratio = DirectX::XMVectorDivide(LoadChannel(additive, c, i), LoadChannel(reference, c, i));
+			StoreChannel(result, c, i, LoadChannel(base, c, i) * DirectX::XMVectorLerpV(one, ratio, w));
+		}
+
+		// The delta rotates from the reference to the additive pose in the local space of the bone,
+		// so it is applied before the base rotation
+		DirectX::XMVECTOR q[4];
+		DirectX::XMVECTOR inverseReference[4];
+		DirectX::XMVECTOR delta[4];
+		DirectX::XMVECTOR weightedDelta[4];
+
+		for (int j = 0; j < 4; ++j)
+		{
+			q[j] = LoadChannel(additive, POSE_ROTATION_X + j, i);
+			inverseReference[j] = LoadChannel(reference, POSE_ROTATION_X + j, i);
+			inverseReference[j] = j < 3 ? DirectX::XMVectorNegate(inverseReference[j]) : inverseReference[j];
+		}
+
+		MultiplyQuaternions(inverseReference, q, delta);
+		NlerpQuaternions(identity, delta, w, weightedDelta);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			q[j] = LoadChannel(base, POSE_ROTATION_X + j, i);
+		}
+
+		MultiplyQuaternions(q, weightedDelta, delta);
+
+		for (int j = 0; j < 4; ++j)
+		{
+			StoreChannel(result, POSE_ROTATION_X + j, i, delta[j]);
+		}
+	}
+}
+
+void Carol::BuildLocalTransforms(const LocalPose& pose, std::span<DirectX::XMFLOAT4X4> transforms)
+{
+	DirectX::XMVECTOR one = DirectX::XMVectorSplatOne();
+	DirectX::XMVECTOR two = DirectX::XMVectorReplicate(2.f);
+
+	for (uint32_t i = 0; i < pose.BoneCount; i += 4)
+	{
+		DirectX::XMVECTOR tx = LoadChannel(pose, POSE_TRANSLATION_X, i);
+		DirectX::XMVECTOR ty = LoadChannel(pose, POSE_TRANSLATION_Y, i);
+		DirectX::XMVECTOR tz = LoadChannel(pose, POSE_TRANSLATION_Z, i);
+		DirectX::XMVECTOR qx = LoadChannel(pose, POSE_ROTATION_X, i);
+		DirectX::XMVECTOR qy = LoadChannel(pose, POSE_ROTATION_Y, i);
+		DirectX::XMVECTOR qz = LoadChannel(pose, POSE_ROTATION_Z, i);
+		DirectX::XMVECTOR qw = LoadChannel(pose, POSE_ROTATION_W, i);
+		DirectX::XMVECTOR sx = LoadChannel(pose, POSE_SCALE_X, i);
+		DirectX::XMVECTOR sy = LoadChannel(pose, POSE_SCALE_Y, i);
+		DirectX::XMVECTOR sz = LoadChannel(pose, POSE_SCALE_Z, i);
+
+		// Scale * RotationQuaternion * Translation, as XMMatrixAffineTransformation with a zero origin
+		DirectX::XMVECTOR xx = qx * qx * two, yy = qy * qy * two, zz = qz * qz * two;
+		DirectX::XMVECTOR xy = qx * qy * two, xz = qx * qz * two, yz = qy * qz * two;
+		DirectX::XMVECTOR wx = qw * qx * two, wy = qw * qy * two, wz = qw * qz * two;
+
+		DirectX::XMMATRIX rows[4] =
+		{
+			DirectX::XMMATRIX((one - yy - zz) * sx, (xy + wz) * sx, (xz - wy) * sx, DirectX::XMVectorZero()),
+			DirectX::XMMATRIX((xy - wz) * sy, (one - xx - zz) * sy, (yz + wx) * sy, DirectX::XMVectorZero()),
+			DirectX::XMMATRIX((xz + wy) * sz, (yz - wx) * sz, (one - xx - yy) * sz, DirectX::XMVectorZero()),
+			DirectX::XMMATRIX(tx, ty, tz, one)
+		};
+
+		for (auto& row : rows)
+		{
+			row = DirectX::XMMatrixTranspose(row);
+		}
+
+		for (uint32_t j = 0; j < 4 && i + j < pose.BoneCount; ++j)
+		{
+			DirectX::XMStoreFloat4x4(&transforms[i + j], DirectX::XMMATRIX(rows[0].r[j], rows[1].r[j], rows[2].r[j], rows[3].r[j]));
+		}
+	}
+}
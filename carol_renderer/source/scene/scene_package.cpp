@@ -0,0 +1,273 @@
+#include <scene/scene_package.h>
+#include <scene/mesh_cache.h>
+#include <scene/texture_cache.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	uint64_t AlignBlobOffset(uint64_t offset)
+	{
+		return (offset + Carol::SCENE_PACKAGE_ALIGNMENT - 1) / Carol::SCENE_PACKAGE_ALIGNMENT * Carol::SCENE_PACKAGE_ALIGNMENT;
+	}
+}
+
+Carol::ScenePackageWriter::ScenePackageWriter()
+{
+	// The index is built in memory and written at Save, it always comes first
+	AddBlob(SCENE_BLOB_INDEX, 0, {});
+}
+
+void Carol::ScenePackageWriter::AddModel(
+	std::string_view name,
+	const DirectX::XMFLOAT4X4& world,
+	uint64_t meshCacheKey,
+	std::string_view meshCachePath)
+{
+	auto it = mModelBlobs.find(meshCacheKey);
+
+	if (it == mModelBlobs.end())
+	{
+		it = mModelBlobs.emplace(meshCacheKey, AddBlob(SCENE_BLOB_MODEL, meshCacheKey, meshCachePath)).first;
+	}
+
+	mModels.WriteString(name);
+	mModels.Write(world);
+	mModels.Write(it->second);
+	++mModelCount;
+}
+
+void Carol::ScenePackageWriter::AddTexture(
+	std::string_view path,
+	uint64_t contentHash,
+	TextureUsage usage,
+	std::string_view textureCachePath)
+{
+	uint64_t key = GetTextureCacheKey(contentHash, usage);
+	auto it = mTextureBlobs.find(key);
+
+	if (it == mTextureBlobs.end())
+	{
+		it = mTextureBlobs.emplace(key, AddBlob(SCENE_BLOB_TEXTURE, key, textureCachePath)).first;
+	}
+
+	mTextures.WriteString(path);
+	mTextures.Write(contentHash);
+	mTextures.Write(uint32_t(usage));
+	mTextures.Write(it->second);
+	++mTextureCount;
+}
+
+uint32_t Carol::ScenePackageWriter::GetModelCount()const
+{
+	return mModelCount;
+}
+
+uint32_t Carol::ScenePackageWriter::GetTextureCount()const
+{
+	return mTextureCount;
+}
+
+bool Carol::ScenePackageWriter::Save(std::string_view path)
+{
+	BinaryWriter index;
+	index.Write(mModelCount);
+	index.WriteBytes(mModels.GetData());
+	index.Write(mTextureCount);
+	index.WriteBytes(mTextures.GetData());
+	mBlobs[0].Size = index.GetSize();
+
+	ScenePackageHeader header;
+	header.BlobCount = mBlobs.size();
+	uint64_t offset = sizeof(ScenePackageHeader) + mBlobs.size() * sizeof(ScenePackageBlob);
+
+	for (auto& blob : mBlobs)
+	{
+		offset = AlignBlobOffset(offset);
+		blob.Offset = offset;
+		offset += blob.Size;
+	}
+
+	BinaryWriter toc;
+	toc.Write(header);
+
+	for (auto& blob : mBlobs)
+	{
+		toc.Write(blob);
+	}
+
+	// Written under a temporary name like the caches, so a failed cook never leaves a truncated package behind
+	std::filesystem::path filePath(path);
+	std::filesystem::path tempPath(GetTempFilePath(path));
+	std::error_code ec;
+
+	if (filePath.has_parent_path())
+	{
+		std::filesystem::create_directories(filePath.parent_path(), ec);
+	}
+
+	bool written = false;
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		std::vector<char> padding(SCENE_PACKAGE_ALIGNMENT);
+		uint64_t end = toc.GetSize();
+		file.write(reinterpret_cast<const char*>(toc.GetData().data()), toc.GetSize());
+
+		for (uint32_t i = 0; i < mBlobs.size() && file.good(); ++i)
+		{
+			// Sources are mapped one at a time, each has to still have the size its entry was given
+			std::unique_ptr<MappedFile> source = i ? std::make_unique<MappedFile>(mSourcePaths[i]) : nullptr;
+			std::span<const uint8_t> data = source ? source->GetData() : index.GetData();
+
+			if (data.size() != mBlobs[i].Size)
+			{
+				break;
+			}
+
+			file.write(padding.data(), mBlobs[i].Offset - end);
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+			end = mBlobs[i].Offset + mBlobs[i].Size;
+			written = i + 1 == mBlobs.size();
+		}
+
+		written = written && file.good();
+	}
+
+	if (!written)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
+
+uint32_t Carol::ScenePackageWriter::AddBlob(ScenePackageBlobType type, uint64_t key, std::string_view sourcePath)
+{
+	std::error_code ec;
+	auto& blob = mBlobs.emplace_back();
+	blob.Type = type;
+	blob.Key = key;
+
+	// A missing source keeps a size of 0, which no mapped file matches, so Save fails on it
+	if (!sourcePath.empty())
+	{
+		uint64_t size = std::filesystem::file_size(std::filesystem::path(sourcePath), ec);
+		blob.Size = ec ? 0 : size;
+	}
+
+	mSourcePaths.emplace_back(sourcePath);
+
+	return mBlobs.size() - 1;
+}
+
+Carol::ScenePackage::ScenePackage(std::string_view path)
+	:mFile(path)
+{
+	if (!mFile.IsValid())
+	{
+		return;
+	}
+
+	auto data = mFile.GetData();
+	BinaryReader reader(data);
+	auto header = reader.Read<ScenePackageHeader>();
+
+	if (!reader.IsValid()
+		|| header.Magic != SCENE_PACKAGE_MAGIC
+		|| header.Version != SCENE_PACKAGE_VERSION
+		|| header.BlobCount == 0
+		|| header.BlobCount > (data.size() - sizeof(ScenePackageHeader)) / sizeof(ScenePackageBlob))
+	{
+		return;
+	}
+
+	// The mapping is page aligned and the table follows the 16-byte header, so entries are read in place
+	std::span<const ScenePackageBlob> blobs(reinterpret_cast<const ScenePackageBlob*>(data.data() + sizeof(ScenePackageHeader)), header.BlobCount);
+
+	for (auto& blob : blobs)
+	{
+		if (blob.Type >= SCENE_BLOB_TYPE_COUNT
+			|| blob.Offset % SCENE_PACKAGE_ALIGNMENT
+			|| blob.Offset > data.size()
+			|| blob.Size > data.size() - blob.Offset)
+		{
+			return;
+		}
+	}
+
+	mValid = blobs[0].Type == SCENE_BLOB_INDEX && ReadIndex(blobs);
+
+	if (!mValid)
+	{
+		mModels.clear();
+		mTextures.clear();
+	}
+}
+
+bool Carol::ScenePackage::IsValid()const
+{
+	return mValid;
+}
+
+std::span<const Carol::ScenePackageModel> Carol::ScenePackage::GetModels()const
+{
+	return mModels;
+}
+
+std::span<const Carol::ScenePackageTexture> Carol::ScenePackage::GetTextures()const
+{
+	return mTextures;
+}
+
+bool Carol::ScenePackage::ReadIndex(std::span<const ScenePackageBlob> blobs)
+{
+	auto data = mFile.GetData();
+	BinaryReader reader(data.subspan(blobs[0].Offset, blobs[0].Size));
+
+	auto blobData = [&](uint32_t idx, ScenePackageBlobType type) -> std::span<const uint8_t>
+	{
+		if (idx >= blobs.size() || blobs[idx].Type != type)
+		{
+			return {};
+		}
+
+		return data.subspan(blobs[idx].Offset, blobs[idx].Size);
+	};
+
+	// Instances share model blobs and paths share texture blobs, so only the index size bounds the counts
+	mModels.resize(std::min<size_t>(reader.Read<uint32_t>(), blobs[0].Size));
+
+	for (auto& model : mModels)
+	{
+		model.Name = reader.ReadString();
+		model.World = reader.Read<DirectX::XMFLOAT4X4>();
+		uint32_t idx = reader.Read<uint32_t>();
+		model.Data = blobData(idx, SCENE_BLOB_MODEL);
+
+		if (!reader.IsValid() || model.Data.empty() || !IsMeshCacheValid(model.Data, blobs[idx].Key))
+		{
+			return false;
+		}
+	}
+
+	mTextures.resize(std::min<size_t>(reader.Read<uint32_t>(), blobs[0].Size));
+
+	for (auto& texture : mTextures)
+	{
+		texture.Path = reader.ReadString();
+		texture.ContentHash = reader.Read<uint64_t>();
+		texture.Usage = TextureUsage(std::min<uint32_t>(reader.Read<uint32_t>(), TEXTURE_USAGE_UNKNOWN));
+		texture.Data = blobData(reader.Read<uint32_t>(), SCENE_BLOB_TEXTURE);
+
+		if (!reader.IsValid() || texture.Data.empty())
+		{
+			return false;
+		}
+	}
+
+	return reader.IsValid();
+}
@@ -1,6 +1,35 @@
 #include <scene/skinned_animation.h>
+#include <algorithm>
 #include <cmath>
 
+namespace
+{
+	// Returns i with keyframes[i].TimePos <= t < keyframes[i + 1].TimePos, t has to lie inside the track.
+	// Forward playback stays in the cached segment or moves to the next one, seeks fall back to a binary search.
+	template<typename Keyframe>
+	uint32_t FindKeyframe(const std::vector<Keyframe>& keyframes, float t, uint32_t& cursor)
+	{
+		uint32_t lastSegment = keyframes.size() - 2;
+
+		for (uint32_t i = cursor; i <= std::min(cursor + 1, lastSegment); ++i)
+		{
+			if (keyframes[i].TimePos <= t && keyframes[i + 1].TimePos > t)
+			{
+				cursor = i;
+				return i;
+			}
+		}
+
+		auto it = std::upper_bound(keyframes.begin(), keyframes.end(), t, [](float t, const Keyframe& keyframe)
+		{
+			return t < keyframe.TimePos;
+		});
+
+		cursor = std::min<uint32_t>(std::max<ptrdiff_t>(it - keyframes.begin() - 1, 0), lastSegment);
+		return cursor;
+	}
+}
+
 float Carol::BoneAnimation::GetStartTime() const
 {
 	float tTrans = D3D12_FLOAT32_MAX;
@@ -26,44 +55,63 @@ float Carol::BoneAnimation::GetEndTime() const
 }
 
 DirectX::XMVECTOR Carol::BoneAnimation::InterpolateTranslation(float t) const
+{
+	uint32_t cursor = 0;
+	return InterpolateTranslation(t, cursor);
+}
+
+DirectX::XMVECTOR Carol::BoneAnimation::InterpolateScale(float t) const
+{
+	uint32_t cursor = 0;
+	return InterpolateScale(t, cursor);
+}
+
+DirectX::XMVECTOR Carol::BoneAnimation::InterpolateQuat(float t) const
+{
+	uint32_t cursor = 0;
+	return InterpolateQuat(t, cursor);
+}
+
+void Carol::BoneAnimation::Interpolate(float t, DirectX::XMFLOAT4X4& M) const
+{
+	BoneAnimationCursor cursor;
+	Interpolate(t, cursor, M);
+}
+
+DirectX::XMVECTOR Carol::BoneAnimation::InterpolateTranslation(float t, uint32_t& cursor) const
 {
 	if (TranslationKeyframes.size() == 0)
 	{
 		return { 0.0f,0.0f,0.0f };
 	}
 
-	if (t < TranslationKeyframes.front().TimePos)
+	if (t <= TranslationKeyframes.front().TimePos)
 	{
 		return DirectX::XMLoadFloat3(&TranslationKeyframes.front().Translation);
 	}
-	else if (t > TranslationKeyframes.back().TimePos)
+	else if (t >= TranslationKeyframes.back().TimePos)
 	{
 		return DirectX::XMLoadFloat3(&TranslationKeyframes.back().Translation);
 	}
 	else
 	{
-		for (int i = 0; i < TranslationKeyframes.size() - 1; ++i)
-		{
-			if (TranslationKeyframes[i].TimePos <= t && TranslationKeyframes[i + 1].TimePos > t)
-			{
-				float lerpFactor = (t - TranslationKeyframes[i].TimePos) / (TranslationKeyframes[i + 1].TimePos - TranslationKeyframes[i].TimePos);
+		uint32_t i = FindKeyframe(TranslationKeyframes, t, cursor);
+		float lerpFactor = (t - TranslationKeyframes[i].TimePos) / (TranslationKeyframes[i + 1].TimePos - TranslationKeyframes[i].TimePos);
 
-				DirectX::XMVECTOR preT = DirectX::XMLoadFloat3(&TranslationKeyframes[i].Translation);
-				DirectX::XMVECTOR sucT = DirectX::XMLoadFloat3(&TranslationKeyframes[i + 1].Translation);
-				return DirectX::XMVectorLerp(preT, sucT, lerpFactor);
-			}
-		}
+		DirectX::XMVECTOR preT = DirectX::XMLoadFloat3(&TranslationKeyframes[i].Translation);
+		DirectX::XMVECTOR sucT = DirectX::XMLoadFloat3(&TranslationKeyframes[i + 1].Translation);
+		return DirectX::XMVectorLerp(preT, sucT, lerpFactor);
 	}
 }
 
-DirectX::XMVECTOR Carol::BoneAnimation::InterpolateScale(float t) const
+DirectX::XMVECTOR Carol::BoneAnimation::InterpolateScale(float t, uint32_t& cursor) const
 {
 	if (ScaleKeyframes.size() == 0)
 	{
 		return { 1.0f,1.0f,1.0f };
 	}
 
-	if (t < ScaleKeyframes.front().TimePos)
+	if (t <= ScaleKeyframes.front().TimePos)
 	{
 		return DirectX::XMLoadFloat3(&ScaleKeyframes.front().Scale);
 	}
@@ -73,57 +121,46 @@ DirectX::XMVECTOR Carol::BoneAnimation::InterpolateScale(float t) const
 	}
 	else
 	{
-		for (int i = 0; i < ScaleKeyframes.size() - 1; ++i)
-		{
-			if (ScaleKeyframes[i].TimePos <= t && ScaleKeyframes[i + 1].TimePos > t)
-			{
-				float lerpFactor = (t - ScaleKeyframes[i].TimePos) / (ScaleKeyframes[i + 1].TimePos - ScaleKeyframes[i].TimePos);
+		uint32_t i = FindKeyframe(ScaleKeyframes, t, cursor);
+		float lerpFactor = (t - ScaleKeyframes[i].TimePos) / (ScaleKeyframes[i + 1].TimePos - ScaleKeyframes[i].TimePos);
 
-				DirectX::XMVECTOR preS = DirectX::XMLoadFloat3(&ScaleKeyframes[i].Scale);
-				DirectX::XMVECTOR sucS = DirectX::XMLoadFloat3(&ScaleKeyframes[i + 1].Scale);
-				return DirectX::XMVectorLerp(preS, sucS, lerpFactor);
-			}
-		}
+		DirectX::XMVECTOR preS = DirectX::XMLoadFloat3(&ScaleKeyframes[i].Scale);
+		DirectX::XMVECTOR sucS = DirectX::XMLoadFloat3(&ScaleKeyframes[i + 1].Scale);
+		return DirectX::XMVectorLerp(preS, sucS, lerpFactor);
 	}
 }
 
-DirectX::XMVECTOR Carol::BoneAnimation::InterpolateQuat(float t) const
+DirectX::XMVECTOR Carol::BoneAnimation::InterpolateQuat(float t, uint32_t& cursor) const
 {
 	if (RotationQuatKeyframes.size() == 0)
 	{
 		return { 0.0f,0.0f,0.0f,1.0f };
 	}
 
-	if (t < RotationQuatKeyframes.front().TimePos)
+	if (t <= RotationQuatKeyframes.front().TimePos)
 	{
 		return DirectX::XMLoadFloat4(&RotationQuatKeyframes.front().RotationQuat);
 	}
-	else if (t > RotationQuatKeyframes.back().TimePos)
+	else if (t >= RotationQuatKeyframes.back().TimePos)
 	{
 		return DirectX::XMLoadFloat4(&RotationQuatKeyframes.back().RotationQuat);
 	}
 	else
 	{
-		for (int i = 0; i < RotationQuatKeyframes.size() - 1; ++i)
-		{
-			if (RotationQuatKeyframes[i].TimePos <= t && RotationQuatKeyframes[i + 1].TimePos > t)
-			{
-				float lerpFactor = (t - RotationQuatKeyframes[i].TimePos) / (RotationQuatKeyframes[i + 1].TimePos - RotationQuatKeyframes[i].TimePos);
+		uint32_t i = FindKeyframe(RotationQuatKeyframes, t, cursor);
+		float lerpFactor = (t - RotationQuatKeyframes[i].TimePos) / (RotationQuatKeyframes[i + 1].TimePos - RotationQuatKeyframes[i].TimePos);
 
-				DirectX::XMVECTOR preQ = DirectX::XMLoadFloat4(&RotationQuatKeyframes[i].RotationQuat);
-				DirectX::XMVECTOR sucQ = DirectX::XMLoadFloat4(&RotationQuatKeyframes[i + 1].RotationQuat);
-				return DirectX::XMQuaternionSlerp(preQ, sucQ, lerpFactor);
-			}
-		}
+		DirectX::XMVECTOR preQ = DirectX::XMLoadFloat4(&RotationQuatKeyframes[i].RotationQuat);
+		DirectX::XMVECTOR sucQ = DirectX::XMLoadFloat4(&RotationQuatKeyframes[i + 1].RotationQuat);
+		return DirectX::XMQuaternionSlerp(preQ, sucQ, lerpFactor);
 	}
-
 }
 
-void Carol::BoneAnimation::Interpolate(float t, DirectX::XMFLOAT4X4& M) const
+void Carol::BoneAnimation::Interpolate(float t, BoneAnimationCursor& cursor, DirectX::XMFLOAT4X4& M) const
 {
-	DirectX::XMVECTOR S = InterpolateScale(t);
-	DirectX::XMVECTOR Q = InterpolateQuat(t);
-	DirectX::XMVECTOR T = InterpolateTranslation(t);
+	DirectX::XMVECTOR S = InterpolateScale(t, cursor.ScaleIdx);
+	DirectX::XMVECTOR Q = InterpolateQuat(t, cursor.RotationQuatIdx);
+	DirectX::XMVECTOR T = InterpolateTranslation(t, cursor.TranslationIdx);
 	DirectX::XMVECTOR origin = { 0.0f,0.0f,0.0f,1.0f };
 	DirectX::XMStoreFloat4x4(&M, DirectX::XMMatrixAffineTransformation(S, origin, Q, T));
 }
@@ -161,8 +198,16 @@ float Carol::AnimationClip::GetClipEndTime()
 
 void Carol::AnimationClip::Interpolate(float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms) const
 {
+	AnimationCursor cursor;
+	Interpolate(t, cursor, boneTransforms);
+}
+
+void Carol::AnimationClip::Interpolate(float t, AnimationCursor& cursor, std::vector<DirectX::XMFLOAT4X4>& boneTransforms) const
+{
+	cursor.BoneCursors.resize(boneTransforms.size());
+
 	for (int i = 0; i < boneTransforms.size(); ++i)
 	{	
-		BoneAnimations[i].Interpolate(t, boneTransforms[i]);
+		BoneAnimations[i].Interpolate(t, cursor.BoneCursors[i], boneTransforms[i]);
 	}
 }
@@ -1,43 +1,196 @@
 #include <scene/texture.h>
+#include <scene/scene_package.h>
+#include <scene/texture_cache.h>
 #include <dx12/heap.h>
 #include <dx12/resource.h>
+#include <utils/cook_stats.h>
 #include <utils/exception.h>
+#include <utils/hash.h>
+#include <utils/image_decoder.h>
+#include <utils/thread_pool.h>
 #include <global.h>
 #include <DirectXTex.h>
-#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+#include <exception>
 #include <memory>
 #include <vector>
 
-std::wstring StringToWString(std::string_view str)
+namespace
 {
-    WCHAR buffer[512];
-	MultiByteToWideChar(CP_ACP, 0, str.data(), -1, buffer, 512);
-	return std::wstring(buffer);
+	// Paths are only separated from the usage and color space by a character no path contains
+	std::string GetPathKey(std::string_view fileName, bool isSrgb, Carol::TextureUsage usage)
+	{
+		std::string key(fileName);
+		key += '\0';
+		key += char('0' + usage * 2 + isSrgb);
+
+		return key;
+	}
+}
+
+std::string_view Carol::GetDefaultTexturePath(TextureUsage usage)
+{
+	static constexpr std::string_view paths[] =
+	{
+		"texture/default_diffuse_texture.png",
+		"texture/default_normal_texture.png",
+		"texture/default_emissive_texture.png",
+		"texture/default_metallic_roughness_texture.png"
+	};
+
+	return usage < TEXTURE_USAGE_UNKNOWN ? paths[usage] : std::string_view();
 }
 
 Carol::Texture::Texture(
 	std::string_view fileName,
-	bool isSrgb)
-	:mNumRef(1)
+	bool isSrgb,
+	TextureUsage usage,
+	uint64_t contentHash)
+	:mFileName(fileName),
+	mSrgb(isSrgb),
+	mUsage(usage),
+	mContentHash(contentHash),
+	mStreamingIdx(-1),
+	mNumRef(1)
 {
-	std::string_view suffix = fileName.substr(fileName.find_last_of(L'.') + 1, 3);
-	DirectX::TexMetadata metaData;
-	DirectX::ScratchImage scratchImage;
+}
 
-	if (suffix == "dds")
+void Carol::Texture::Decode()
+{
+	// A failed decode leaves the flag unset, so the next caller tries again
+	std::call_once(mDecodeFlag, [this]()
 	{
-		ThrowIfFailed(LoadFromDDSFile(StringToWString(fileName).data(), DirectX::DDS_FLAGS_NONE, &metaData, scratchImage));
+		auto image = std::make_unique<DirectX::ScratchImage>();
+
+		if (mUsage == TEXTURE_USAGE_UNKNOWN)
+		{
+			ThrowIfFailed(DecodeImage(mFileName, *image));
+			mImage = std::move(image);
+
+			return;
+		}
+
+		// The key covers the source content and the cook settings, so edited sources are cooked again
+		uint64_t key = mContentHash ? GetTextureCacheKey(mContentHash, mUsage) : 0;
+		std::string cachePath = GetTextureCachePath(key);
+		auto packaged = key ? gTextureManager->GetPackagedTexture(key) : std::span<const uint8_t>();
+
+		if (!packaged.empty())
+		{
+			// Cooked offline, the DDS is only copied out of the package
+			ThrowIfFailed(DirectX::LoadFromDDSMemory(packaged.data(), packaged.size(), DirectX::DDS_FLAGS_NONE, nullptr, *image));
+		}
+		else if (key == 0 || FAILED(DecodeImage(cachePath, *image)))
+		{
+			DirectX::ScratchImage source;
+
+			{
+				CookStageScope stage(COOK_STAGE_TEXTURE_DECODE);
+				ThrowIfFailed(DecodeImage(mFileName, source));
+				stage.AddBytes(source.GetPixelsSize());
+			}
+
+			{
+				CookStageScope stage(COOK_STAGE_TEXTURE_COOK);
+				ThrowIfFailed(CookTexture(source, mUsage, *image));
+				stage.AddBytes(image->GetPixelsSize());
+			}
+
+			// A cache that cannot be written only costs another cook on the next load
+			SaveTextureCache(*image, cachePath);
+		}
+
+		mImage = std::move(image);
+	});
+}
+
+Carol::Texture::~Texture()
+{
+}
+
+uint64_t Carol::Texture::GetUploadSize()const
+{
+	if (!mImage)
+	{
+		return 0;
 	}
-	else if (suffix == "tga")
+
+	uint64_t size = 0;
+	const DirectX::Image* images = mImage->GetImages();
+
+	for (uint32_t i = GetTailMip(); i < mImage->GetImageCount(); ++i)
 	{
-		ThrowIfFailed(LoadFromTGAFile(StringToWString(fileName).data(), DirectX::TGA_FLAGS_NONE, &metaData, scratchImage));
+		size += images[i].slicePitch;
+	}
+
+	return size;
+}
+
+bool Carol::Texture::IsUploaded()const
+{
+	return mTexture != nullptr;
+}
+
+void Carol::Texture::Upload()
+{
+	uint32_t tailMip = GetTailMip();
+	mTexture = CreateColorBuffer(tailMip);
+
+	if (tailMip)
+	{
+		mStreamingIdx = gTextureManager->AddStreamedTexture(this);
 	}
 	else
 	{
-		ThrowIfFailed(LoadFromWICFile(StringToWString(fileName).data(), DirectX::WIC_FLAGS_NONE, &metaData, scratchImage));
+		mImage.reset();
+	}
+}
+
+uint32_t Carol::Texture::GetTailMip()const
+{
+	const DirectX::TexMetadata& metaData = mImage->GetMetadata();
+
+	// Skyboxes and other textures loaded by name are sampled whole
+	if (mUsage == TEXTURE_USAGE_UNKNOWN || metaData.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metaData.arraySize > 1)
+	{
+		return 0;
+	}
+
+	uint32_t tailSize = gTextureManager->GetStreamingSettings().TailSize;
+	uint32_t mip = 0;
+
+	while (mip + 1 < metaData.mipLevels && std::max(metaData.width, metaData.height) >> mip > tailSize)
+	{
+		// Block compressed resources must start at a size in whole blocks
+		if (DirectX::IsCompressed(metaData.format) && ((metaData.width >> (mip + 1)) % 4 || (metaData.height >> (mip + 1)) % 4))
+		{
+			break;
+		}
+
+		++mip;
 	}
 
-	if (isSrgb)
+	return mip;
+}
+
+void Carol::Texture::UploadMips(uint32_t mostDetailedMip)
+{
+	mPendingTexture = CreateColorBuffer(mostDetailedMip);
+}
+
+void Carol::Texture::CommitMips()
+{
+	// Frames recorded before still sample the old mips, their memory and descriptors are freed once those complete
+	mTexture = std::move(mPendingTexture);
+	mTexture->ReleaseIntermediateBuffer();
+}
+
+std::unique_ptr<Carol::ColorBuffer> Carol::Texture::CreateColorBuffer(uint32_t mostDetailedMip)
+{
+	DirectX::TexMetadata metaData = mImage->GetMetadata();
+
+	if (mSrgb)
 	{
 		metaData.format = DirectX::MakeSRGB(metaData.format);
 	}
@@ -94,9 +247,9 @@ Carol::Texture::Texture(
 		break;
 	}
 
-	mTexture = std::make_unique<ColorBuffer>(
-		metaData.width,
-		metaData.height,
+	auto texture = std::make_unique<ColorBuffer>(
+		std::max<uint32_t>(metaData.width >> mostDetailedMip, 1),
+		std::max<uint32_t>(metaData.height >> mostDetailedMip, 1),
 		depthOrArraySize,
 		viewDimension,
 		metaData.format,
@@ -104,10 +257,11 @@ Carol::Texture::Texture(
 		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 		D3D12_RESOURCE_FLAG_NONE,
 		nullptr,
-		metaData.mipLevels);
+		metaData.mipLevels - mostDetailedMip);
 
-	std::vector<D3D12_SUBRESOURCE_DATA> subresources(scratchImage.GetImageCount());
-	const DirectX::Image* images = scratchImage.GetImages();
+	// Streamed textures are single 2D images, so their mips are the trailing images
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(mImage->GetImageCount() - mostDetailedMip);
+	const DirectX::Image* images = mImage->GetImages() + mostDetailedMip;
 
 	for (int i = 0; i < subresources.size(); ++i)
 	{
@@ -116,7 +270,9 @@ Carol::Texture::Texture(
 		subresources[i].pData = images[i].pixels;
 	}
 
-	mTexture->CopySubresources(gHeapManager->GetUploadBuffersHeap(), subresources.data(), 0, subresources.size());
+	texture->CopySubresources(gHeapManager->GetUploadBuffersHeap(), subresources.data(), 0, subresources.size());
+
+	return texture;
 }
 
 uint32_t Carol::Texture::GetGpuSrvIdx(uint32_t planeSlice)
@@ -144,54 +300,315 @@ void Carol::Texture::DecRef()
 	--mNumRef;
 }
 
+void Carol::GpuTextureStreamingUploader::Upload(uint32_t idx, uint32_t mostDetailedMip)
+{
+	gTextureManager->GetStreamedTexture(idx)->UploadMips(mostDetailedMip);
+}
+
+void Carol::GpuTextureStreamingUploader::Commit(uint32_t idx)
+{
+	gTextureManager->GetStreamedTexture(idx)->CommitMips();
+}
+
 Carol::TextureManager::TextureManager()
+	:mStreamer(std::make_unique<TextureStreamer>(std::make_unique<GpuTextureStreamingUploader>(), mStreamingSettings))
 {
 }
 
 uint32_t Carol::TextureManager::LoadTexture(
 	std::string_view fileName,
-	bool isSrgb)
+	bool isSrgb,
+	TextureUsage usage)
 {
-	if (fileName.size() == 0)
+	Texture* texture = DecodeTexture(fileName, isSrgb, usage);
+
+	if (!texture)
 	{
 		return -1;
 	}
 
+	if (!texture->IsUploaded())
+	{
+		texture->Upload();
+	}
+
+	return texture->GetGpuSrvIdx();
+}
+
+Carol::Texture* Carol::TextureManager::DecodeTexture(
+	std::string_view fileName,
+	bool isSrgb,
+	TextureUsage usage)
+{
+	Texture* texture = AcquireTexture(fileName, isSrgb, usage);
+
+	try
+	{
+		if (texture)
+		{
+			texture->Decode();
+		}
+	}
+	catch (...)
+	{
+		UnloadTexture(fileName, isSrgb, usage);
+		throw;
+	}
+
+	return texture;
+}
+
+Carol::Texture* Carol::TextureManager::AcquireTexture(
+	std::string_view fileName,
+	bool isSrgb,
+	TextureUsage usage)
+{
+	if (fileName.size() == 0)
+	{
+		return nullptr;
+	}
+
 	std::string name(fileName);
+	std::string pathKey = GetPathKey(fileName, isSrgb, usage);
+	uint64_t contentHash = 0;
 
-	if (mTextures.count(name) == 0)
 	{
-		mTextures[name] = make_unique<Texture>(
-			name,
-			isSrgb);
+		std::lock_guard<std::mutex> lock(mTextureMutex);
+		auto it = mPaths.find(pathKey);
+
+		if (it != mPaths.end())
+		{
+			++it->second.NumRef;
+			auto& texture = mTextures[it->second.Key];
+			texture->AddRef();
+
+			return texture.get();
+		}
+
+		auto packagedIt = mPackagedContentHashes.find(name);
+
+		if (packagedIt != mPackagedContentHashes.end())
+		{
+			contentHash = packagedIt->second;
+		}
+	}
+
+	// Hashing reads the whole file, so loading threads do it outside the lock.
+	// Unreadable files are keyed by path and fail when they are decoded.
+	uint64_t byteSize = 0;
+
+	if (contentHash == 0)
+	{
+		contentHash = GetTextureContentHash(fileName, &byteSize);
+	}
+
+	uint64_t key = contentHash
+		? Hash64(&contentHash, sizeof(contentHash), usage * 2 + isSrgb)
+		: Hash64(name.data(), name.size(), usage * 2 + isSrgb);
+
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+	auto& path = mPaths[pathKey];
+
+	// Another thread may have hashed the same path in the meantime
+	if (path.NumRef++ == 0)
+	{
+		path.Key = key;
+	}
+
+	auto& texture = mTextures[path.Key];
+
+	if (texture)
+	{
+		texture->AddRef();
+
+		if (path.NumRef == 1)
+		{
+			mDuplicateBytes += byteSize;
+		}
 	}
 	else
 	{
-		mTextures[name]->AddRef();
+		texture = std::make_unique<Texture>(fileName, isSrgb, usage, contentHash);
 	}
 
-	return mTextures[name]->GetGpuSrvIdx();
+	return texture.get();
 }
 
-void Carol::TextureManager::UnloadTexture(std::string_view fileName)
+void Carol::TextureManager::DecodeTextures(std::span<Texture* const> textures)
 {
-	std::string name(fileName);
-	mTextures[name]->DecRef();
+	// One task per texture, outside the lock. Loads racing for the same texture wait for a single decode.
+	std::vector<std::exception_ptr> errors(textures.size());
 
-	if (mTextures[name]->GetRef() == 0)
+	gThreadPool->ParallelFor(textures.size(), [&](uint32_t i)
 	{
-		mTextures.erase(name);
+		try
+		{
+			textures[i]->Decode();
+		}
+		catch (...)
+		{
+			errors[i] = std::current_exception();
+		}
+	});
+
+	for (auto& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
 	}
 }
 
-void Carol::TextureManager::ReleaseIntermediateBuffers(std::string_view fileName)
+void Carol::TextureManager::UnloadTexture(
+	std::string_view fileName,
+	bool isSrgb,
+	TextureUsage usage)
 {
-	std::string name(fileName);
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+	auto pathIt = mPaths.find(GetPathKey(fileName, isSrgb, usage));
+	auto textureIt = mTextures.find(pathIt->second.Key);
+	auto& texture = textureIt->second;
 
-	if (mTextures.count(name) == 0)
+	if (--pathIt->second.NumRef == 0)
 	{
-		mTextures[name]->ReleaseIntermediateBuffer();
+		mPaths.erase(pathIt);
+	}
+
+	texture->DecRef();
+
+	if (texture->GetRef() == 0)
+	{
+		// Only textures uploaded on the render thread are streamed, so this never races the streamer
+		if (texture->mStreamingIdx != -1)
+		{
+			mStreamer->RemoveTexture(texture->mStreamingIdx);
+			mStreamedTextures[texture->mStreamingIdx] = nullptr;
+		}
+
+		mTextures.erase(textureIt);
 	}
 }
 
+Carol::Texture* Carol::TextureManager::FindTexture(
+	std::string_view fileName,
+	bool isSrgb,
+	TextureUsage usage)
+{
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+	auto it = mPaths.find(GetPathKey(fileName, isSrgb, usage));
+
+	return it != mPaths.end() ? mTextures[it->second.Key].get() : nullptr;
+}
+
+void Carol::TextureManager::ReleaseIntermediateBuffers(
+	std::string_view fileName,
+	bool isSrgb,
+	TextureUsage usage)
+{
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+	auto it = mPaths.find(GetPathKey(fileName, isSrgb, usage));
+
+	if (it != mPaths.end())
+	{
+		mTextures[it->second.Key]->ReleaseIntermediateBuffer();
+	}
+}
 
+void Carol::TextureManager::LoadDefaultTextures()
+{
+	// Taken with the usage and color space meshes acquire them with, so they resolve to the same textures
+	for (int i = 0; i < TEXTURE_USAGE_UNKNOWN; ++i)
+	{
+		LoadTexture(GetDefaultTexturePath(TextureUsage(i)), false, TextureUsage(i));
+	}
+}
+
+uint64_t Carol::TextureManager::GetDuplicateBytes()const
+{
+	return mDuplicateBytes;
+}
+
+void Carol::TextureManager::AddScenePackage(std::shared_ptr<const ScenePackage> package)
+{
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+
+	for (auto& texture : package->GetTextures())
+	{
+		mPackagedContentHashes[std::string(texture.Path)] = texture.ContentHash;
+		mPackagedTextures[GetTextureCacheKey(texture.ContentHash, texture.Usage)] = texture.Data;
+	}
+
+	mScenePackages.push_back(std::move(package));
+}
+
+std::span<const uint8_t> Carol::TextureManager::GetPackagedTexture(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(mTextureMutex);
+	auto it = mPackagedTextures.find(key);
+
+	return it != mPackagedTextures.end() ? it->second : std::span<const uint8_t>();
+}
+
+uint32_t Carol::TextureManager::AddStreamedTexture(Texture* texture)
+{
+	std::vector<uint64_t> mipSizes;
+	const DirectX::Image* images = texture->mImage->GetImages();
+
+	for (uint32_t i = 0; i < texture->mImage->GetImageCount(); ++i)
+	{
+		mipSizes.push_back(images[i].slicePitch);
+	}
+
+	uint32_t idx = mStreamer->AddTexture(mipSizes, texture->GetTailMip());
+	mStreamedTextures.resize(std::max<size_t>(mStreamedTextures.size(), idx + 1));
+	mStreamedTextures[idx] = texture;
+
+	return idx;
+}
+
+Carol::Texture* Carol::TextureManager::GetStreamedTexture(uint32_t idx)const
+{
+	return mStreamedTextures[idx];
+}
+
+void Carol::TextureManager::RequestTextureMips(Texture* texture, float screenSize)
+{
+	if (!texture || texture->mStreamingIdx == -1)
+	{
+		return;
+	}
+
+	// Meshes are taken to map their textures once across their bounds
+	const DirectX::TexMetadata& metaData = texture->mImage->GetMetadata();
+	float texels = std::max(metaData.width, metaData.height);
+	float pixels = std::max(screenSize * mScreenHeight, 1.f);
+
+	mStreamer->RequestMip(texture->mStreamingIdx, uint32_t(std::max(std::log2(texels / pixels), 0.f)));
+}
+
+uint64_t Carol::TextureManager::Upload(uint64_t cpuFenceValue)
+{
+	return mStreamer->Upload(cpuFenceValue);
+}
+
+void Carol::TextureManager::Update(uint64_t completedFenceValue)
+{
+	mStreamer->Update(completedFenceValue);
+}
+
+const Carol::TextureStreamingSettings& Carol::TextureManager::GetStreamingSettings()const
+{
+	return mStreamingSettings;
+}
+
+void Carol::TextureManager::SetStreamingSettings(const TextureStreamingSettings& settings)
+{
+	mStreamingSettings = settings;
+	mStreamer->SetSettings(settings);
+}
+
+void Carol::TextureManager::SetScreenHeight(uint32_t height)
+{
+	mScreenHeight = height;
+}
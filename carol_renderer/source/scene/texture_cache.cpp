@@ -0,0 +1,281 @@
+#include <scene/texture_cache.h>
+#include <utils/binary.h>
+#include <utils/cook_stats.h>
+#include <utils/hash.h>
+#include <utils/mapped_file.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Rows of blocks compressed by one task, a multiple of the 4 texel block height
+	constexpr uint32_t COMPRESS_STRIP_HEIGHT = 64;
+
+	std::string NormalizePath(std::string_view path)
+	{
+		std::string pathStr(path);
+		std::ranges::replace(pathStr, '\\', '/');
+
+		return pathStr;
+	}
+
+	// glTF keeps roughness in green and metallic in blue
+	void PackMetallicRoughness(const DirectX::Image& image)
+	{
+		for (size_t y = 0; y < image.height; ++y)
+		{
+			uint8_t* row = image.pixels + y * image.rowPitch;
+
+			for (size_t x = 0; x < image.width; ++x)
+			{
+				row[x * 4] = row[x * 4 + 2];
+				row[x * 4 + 2] = 0;
+			}
+		}
+	}
+
+	HRESULT CompressLevels(
+		const DirectX::ScratchImage& mipChain,
+		DXGI_FORMAT format,
+		DirectX::TEX_COMPRESS_FLAGS flags,
+		DirectX::ScratchImage& cooked)
+	{
+		DirectX::TexMetadata metadata = mipChain.GetMetadata();
+		metadata.format = format;
+		HRESULT hr = cooked.Initialize(metadata);
+
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+
+		// Blocks are independent of each other, so strips of a level compress separately
+		std::vector<std::pair<uint32_t, uint32_t>> strips;
+
+		for (uint32_t level = 0; level < metadata.mipLevels; ++level)
+		{
+			for (uint32_t row = 0; row < mipChain.GetImage(level, 0, 0)->height; row += COMPRESS_STRIP_HEIGHT)
+			{
+				strips.emplace_back(level, row);
+			}
+		}
+
+		std::vector<HRESULT> results(strips.size(), S_OK);
+
+		Carol::gThreadPool->ParallelFor(strips.size(), [&](uint32_t i)
+		{
+			auto [level, row] = strips[i];
+			DirectX::Image strip = *mipChain.GetImage(level, 0, 0);
+			strip.height = std::min<size_t>(COMPRESS_STRIP_HEIGHT, strip.height - row);
+			strip.slicePitch = strip.rowPitch * strip.height;
+			strip.pixels += row * strip.rowPitch;
+
+			DirectX::ScratchImage compressed;
+			results[i] = DirectX::Compress(strip, format, flags, DirectX::TEX_THRESHOLD_DEFAULT, compressed);
+
+			if (SUCCEEDED(results[i]))
+			{
+				const DirectX::Image* dst = cooked.GetImage(level, 0, 0);
+				std::memcpy(dst->pixels + row / 4 * dst->rowPitch, compressed.GetPixels(), compressed.GetPixelsSize());
+			}
+		});
+
+		for (HRESULT result : results)
+		{
+			if (FAILED(result))
+			{
+				return result;
+			}
+		}
+
+		return S_OK;
+	}
+}
+
+Carol::TextureCookSettings Carol::GetTextureCookSettings(TextureUsage usage)
+{
+	TextureCookSettings settings;
+
+	switch (usage)
+	{
+	case TEXTURE_USAGE_DIFFUSE:
+	case TEXTURE_USAGE_EMISSIVE:
+		// Mode 6 only, full BC7 takes minutes per texture on the CPU
+		settings.Format = DXGI_FORMAT_BC7_UNORM;
+		settings.CompressFlags = DirectX::TEX_COMPRESS_BC7_QUICK;
+		settings.MipFilterType = MIP_FILTER_KAISER;
+		settings.MipContentType = MIP_CONTENT_SRGB;
+		settings.KeepCompressedSource = true;
+		break;
+
+	case TEXTURE_USAGE_NORMAL:
+		settings.Format = DXGI_FORMAT_BC5_UNORM;
+		settings.UncompressedFormat = DXGI_FORMAT_R8G8_UNORM;
+		settings.MipContentType = MIP_CONTENT_NORMAL;
+		break;
+
+	case TEXTURE_USAGE_METALLIC_ROUGHNESS:
+		settings.Format = DXGI_FORMAT_BC5_UNORM;
+		settings.UncompressedFormat = DXGI_FORMAT_R8G8_UNORM;
+		settings.PackMetallicRoughness = true;
+		break;
+
+	default:
+		break;
+	}
+
+	return settings;
+}
+
+uint64_t Carol::GetTextureContentHash(std::string_view path, uint64_t* byteSize)
+{
+	MappedFile file(NormalizePath(path));
+
+	if (!file.IsValid())
+	{
+		return 0;
+	}
+
+	if (byteSize)
+	{
+		*byteSize = file.GetData().size();
+	}
+
+	return Hash64(file.GetData().data(), file.GetData().size());
+}
+
+uint64_t Carol::GetTextureCacheKey(uint64_t contentHash, TextureUsage usage)
+{
+	TextureCookSettings settings = GetTextureCookSettings(usage);
+	uint64_t seed = Hash64(&contentHash, sizeof(contentHash), TEXTURE_CACHE_VERSION);
+
+	return Hash64(&settings, sizeof(settings), seed);
+}
+
+std::string Carol::GetTextureCachePath(uint64_t key)
+{
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+
+	return std::string("cache/") + name + ".dds";
+}
+
+bool Carol::SaveTextureCache(const DirectX::ScratchImage& image, std::string_view path)
+{
+	// Written under a temporary name like the mesh cache, so a crash never leaves a truncated texture behind
+	std::string pathStr = NormalizePath(path);
+	std::filesystem::path filePath(pathStr);
+	std::filesystem::path tempPath(GetTempFilePath(pathStr));
+	std::error_code ec;
+
+	if (filePath.has_parent_path())
+	{
+		std::filesystem::create_directories(filePath.parent_path(), ec);
+	}
+
+	CookStageScope stage(COOK_STAGE_CACHE_WRITE);
+	stage.AddBytes(image.GetPixelsSize());
+
+	HRESULT hr = DirectX::SaveToDDSFile(
+		image.GetImages(),
+		image.GetImageCount(),
+		image.GetMetadata(),
+		DirectX::DDS_FLAGS_NONE,
+		tempPath.wstring().c_str());
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
+
+HRESULT Carol::CookTexture(
+	const DirectX::ScratchImage& source,
+	TextureUsage usage,
+	DirectX::ScratchImage& cooked)
+{
+	TextureCookSettings settings = GetTextureCookSettings(usage);
+	const DirectX::TexMetadata& metadata = source.GetMetadata();
+
+	// Only plain 2D textures are cooked, block compressed sources are taken as authored where the usage allows
+	bool keepSource = usage == TEXTURE_USAGE_UNKNOWN
+		|| metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D
+		|| metadata.arraySize > 1
+		|| (DirectX::IsCompressed(metadata.format) && (settings.KeepCompressedSource || metadata.format == settings.Format));
+
+	if (keepSource)
+	{
+		HRESULT hr = cooked.Initialize(metadata);
+
+		if (SUCCEEDED(hr))
+		{
+			std::memcpy(cooked.GetPixels(), source.GetPixels(), source.GetPixelsSize());
+		}
+
+		return hr;
+	}
+
+	const DirectX::Image& top = *source.GetImage(0, 0, 0);
+	DirectX::ScratchImage rgba;
+	HRESULT hr;
+
+	if (DirectX::IsCompressed(top.format))
+	{
+		hr = DirectX::Decompress(top, DXGI_FORMAT_R8G8B8A8_UNORM, rgba);
+	}
+	else if (top.format != DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		hr = DirectX::Convert(top, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, rgba);
+	}
+	else
+	{
+		hr = rgba.InitializeFromImage(top);
+	}
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	if (settings.PackMetallicRoughness)
+	{
+		PackMetallicRoughness(*rgba.GetImage(0, 0, 0));
+	}
+
+	DirectX::ScratchImage mipChain;
+	hr = GenerateMipChain(*rgba.GetImage(0, 0, 0), MipFilter(settings.MipFilterType), MipContent(settings.MipContentType), mipChain);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	if (top.width % 4 == 0 && top.height % 4 == 0)
+	{
+		return CompressLevels(mipChain, settings.Format, DirectX::TEX_COMPRESS_FLAGS(settings.CompressFlags), cooked);
+	}
+
+	if (settings.UncompressedFormat == DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		cooked = std::move(mipChain);
+		return S_OK;
+	}
+
+	return DirectX::Convert(
+		mipChain.GetImages(),
+		mipChain.GetImageCount(),
+		mipChain.GetMetadata(),
+		settings.UncompressedFormat,
+		DirectX::TEX_FILTER_DEFAULT,
+		DirectX::TEX_THRESHOLD_DEFAULT,
+		cooked);
+}
@@ -0,0 +1,260 @@
+#include <scene/texture_streamer.h>
+#include <algorithm>
+
+Carol::TextureStreamingUploader::~TextureStreamingUploader()
+{
+}
+
+Carol::TextureStreamer::TextureStreamer(
+	std::unique_ptr<TextureStreamingUploader> uploader,
+	const TextureStreamingSettings& settings)
+	:mUploader(std::move(uploader)),
+	mSettings(settings)
+{
+}
+
+uint32_t Carol::TextureStreamer::AddTexture(std::span<const uint64_t> mipSizes, uint32_t tailMip)
+{
+	uint32_t idx;
+
+	if (mFreeIndices.empty())
+	{
+		idx = mTextures.size();
+		mTextures.emplace_back();
+	}
+	else
+	{
+		idx = mFreeIndices.back();
+		mFreeIndices.pop_back();
+	}
+
+	auto& texture = mTextures[idx];
+	texture.Sizes.assign(mipSizes.size() + 1, 0);
+
+	for (int mip = int(mipSizes.size()) - 1; mip >= 0; --mip)
+	{
+		texture.Sizes[mip] = texture.Sizes[mip + 1] + mipSizes[mip];
+	}
+
+	texture.TailMip = std::min<uint32_t>(tailMip, mipSizes.size() - 1);
+	texture.ResidentMip = texture.TailMip;
+	texture.PendingMip = texture.TailMip;
+	texture.PendingFenceValue = 0;
+	texture.RequestedMip = texture.TailMip;
+	texture.LastRequestFrame = 0;
+	texture.Active = true;
+	mResidentSize += texture.Sizes[texture.ResidentMip];
+
+	return idx;
+}
+
+void Carol::TextureStreamer::RemoveTexture(uint32_t idx)
+{
+	// An upload still in flight is dropped with the texture, it is never committed
+	mResidentSize -= GetAccountedSize(mTextures[idx]);
+	mTextures[idx] = {};
+	mFreeIndices.push_back(idx);
+}
+
+void Carol::TextureStreamer::RequestMip(uint32_t idx, uint32_t mip)
+{
+	auto& texture = mTextures[idx];
+	mip = std::min(mip, texture.TailMip);
+
+	// Several meshes may sample a texture, the finest request of the frame wins
+	if (texture.LastRequestFrame != mFrame)
+	{
+		texture.RequestedMip = mip;
+		texture.LastRequestFrame = mFrame;
+	}
+	else
+	{
+		texture.RequestedMip = std::min(texture.RequestedMip, mip);
+	}
+}
+
+uint64_t Carol::TextureStreamer::Upload(uint64_t cpuFenceValue)
+{
+	mLoads.clear();
+	mEvictions.clear();
+
+	// Evictions already in flight free their memory once they commit
+	uint64_t freeing = 0;
+
+	for (uint32_t idx = 0; idx < mTextures.size(); ++idx)
+	{
+		auto& texture = mTextures[idx];
+
+		if (!texture.Active)
+		{
+			continue;
+		}
+
+		if (IsPending(texture))
+		{
+			if (texture.PendingMip > texture.ResidentMip)
+			{
+				freeing += texture.Sizes[texture.ResidentMip] - texture.Sizes[texture.PendingMip];
+			}
+
+			continue;
+		}
+
+		uint32_t wantedMip = GetWantedMip(texture);
+
+		if (wantedMip < texture.ResidentMip)
+		{
+			mLoads.push_back(idx);
+		}
+		else if (wantedMip > texture.ResidentMip)
+		{
+			mEvictions.push_back(idx);
+		}
+	}
+
+	// The blurriest textures first, eviction in the order of the last request
+	std::ranges::sort(mLoads, [&](uint32_t i, uint32_t j)
+	{
+		uint32_t gapI = mTextures[i].ResidentMip - mTextures[i].RequestedMip;
+		uint32_t gapJ = mTextures[j].ResidentMip - mTextures[j].RequestedMip;
+		return gapI != gapJ ? gapI > gapJ : i < j;
+	});
+
+	std::ranges::sort(mEvictions, [&](uint32_t i, uint32_t j)
+	{
+		return mTextures[i].LastRequestFrame != mTextures[j].LastRequestFrame ? mTextures[i].LastRequestFrame < mTextures[j].LastRequestFrame : i < j;
+	});
+
+	uint64_t uploadSize = 0;
+	uint32_t nextEviction = 0;
+
+	auto withinUploadBudget = [&](uint64_t size)
+	{
+		// An upload larger than the budget still goes through, alone in its frame
+		return uploadSize == 0 || uploadSize + size <= mSettings.UploadBudget;
+	};
+
+	for (uint32_t idx : mLoads)
+	{
+		auto& texture = mTextures[idx];
+		uint32_t targetMip = texture.RequestedMip;
+
+		auto growth = [&](uint32_t mip)
+		{
+			return texture.Sizes[mip] - texture.Sizes[texture.ResidentMip];
+		};
+
+		while (mResidentSize - freeing + growth(targetMip) > mSettings.MemoryBudget && nextEviction < mEvictions.size())
+		{
+			auto& victim = mTextures[mEvictions[nextEviction]];
+			uint32_t victimMip = GetWantedMip(victim);
+
+			if (!withinUploadBudget(victim.Sizes[victimMip]))
+			{
+				return uploadSize;
+			}
+
+			freeing += victim.Sizes[victim.ResidentMip] - victim.Sizes[victimMip];
+			uploadSize += victim.Sizes[victimMip];
+			Stream(mEvictions[nextEviction++], victimMip, cpuFenceValue);
+		}
+
+		// What does not fit even with every eviction is streamed as far as it does
+		while (targetMip < texture.ResidentMip && mResidentSize - freeing + growth(targetMip) > mSettings.MemoryBudget)
+		{
+			++targetMip;
+		}
+
+		// Waits for the evictions to commit rather than streaming a coarser range twice
+		if (targetMip == texture.ResidentMip || mResidentSize + growth(targetMip) > mSettings.MemoryBudget)
+		{
+			continue;
+		}
+
+		if (!withinUploadBudget(texture.Sizes[targetMip]))
+		{
+			break;
+		}
+
+		uploadSize += texture.Sizes[targetMip];
+		Stream(idx, targetMip, cpuFenceValue);
+	}
+
+	return uploadSize;
+}
+
+void Carol::TextureStreamer::Update(uint64_t completedFenceValue)
+{
+	for (uint32_t idx = 0; idx < mTextures.size(); ++idx)
+	{
+		auto& texture = mTextures[idx];
+
+		if (!texture.Active || !IsPending(texture) || texture.PendingFenceValue > completedFenceValue)
+		{
+			continue;
+		}
+
+		uint64_t accountedSize = GetAccountedSize(texture);
+		texture.ResidentMip = texture.PendingMip;
+		texture.PendingFenceValue = 0;
+		mResidentSize = mResidentSize - accountedSize + GetAccountedSize(texture);
+		mUploader->Commit(idx);
+	}
+
+	++mFrame;
+}
+
+uint32_t Carol::TextureStreamer::GetResidentMip(uint32_t idx)const
+{
+	return mTextures[idx].ResidentMip;
+}
+
+uint64_t Carol::TextureStreamer::GetResidentSize()const
+{
+	return mResidentSize;
+}
+
+uint32_t Carol::TextureStreamer::GetPendingCount()const
+{
+	return std::ranges::count_if(mTextures, [this](const StreamedTexture& texture)
+	{
+		return texture.Active && IsPending(texture);
+	});
+}
+
+void Carol::TextureStreamer::SetSettings(const TextureStreamingSettings& settings)
+{
+	mSettings = settings;
+}
+
+bool Carol::TextureStreamer::IsPending(const StreamedTexture& texture)const
+{
+	return texture.PendingFenceValue != 0;
+}
+
+uint32_t Carol::TextureStreamer::GetWantedMip(const StreamedTexture& texture)const
+{
+	// Textures nobody asked for this frame only need their tail
+	return texture.LastRequestFrame == mFrame ? texture.RequestedMip : texture.TailMip;
+}
+
+uint64_t Carol::TextureStreamer::GetAccountedSize(const StreamedTexture& texture)const
+{
+	if (!texture.Active)
+	{
+		return 0;
+	}
+
+	uint32_t mip = IsPending(texture) ? std::min(texture.ResidentMip, texture.PendingMip) : texture.ResidentMip;
+	return texture.Sizes[mip];
+}
+
+void Carol::TextureStreamer::Stream(uint32_t idx, uint32_t mip, uint64_t cpuFenceValue)
+{
+	auto& texture = mTextures[idx];
+	uint64_t accountedSize = GetAccountedSize(texture);
+	texture.PendingMip = mip;
+	texture.PendingFenceValue = cpuFenceValue + 1;
+	mResidentSize = mResidentSize - accountedSize + GetAccountedSize(texture);
+	mUploader->Upload(idx, mip);
+}
@@ -1,12 +1,38 @@
 #include <scene/timer.h>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <chrono>
+#endif
 
-Carol::Timer::Timer()
+namespace
 {
-    uint64_t countsPerSec;
-    QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+    uint64_t QueryCounter()
+    {
+#ifdef _WIN32
+        uint64_t count;
+        QueryPerformanceCounter((LARGE_INTEGER*)&count);
+        return count;
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
 
-    mSecondsPerCount = 1.0 / countsPerSec;
+    uint64_t QueryCountsPerSecond()
+    {
+#ifdef _WIN32
+        uint64_t countsPerSec;
+        QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+        return countsPerSec;
+#else
+        return std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+    }
+}
+
+Carol::Timer::Timer()
+{
+    mSecondsPerCount = 1.0 / QueryCountsPerSecond();
 }
 
 float Carol::Timer::TotalTime() const
@@ -28,8 +54,7 @@ float Carol::Timer::DeltaTime() const
 
 void Carol::Timer::Reset()
 {
-    uint64_t currTime;
-    QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+    uint64_t currTime = QueryCounter();
 
     mBaseTime = currTime;
     mPrevTime = currTime;
@@ -41,8 +66,7 @@ void Carol::Timer::Start()
 {
     if (mStopped)
     {
-        uint64_t startTime;
-        QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+        uint64_t startTime = QueryCounter();
         mStopped = false;
 
         mPausedTime += startTime - mStopTime;
@@ -55,8 +79,7 @@ void Carol::Timer::Stop()
 {
     if (!mStopped)
     {   
-        uint64_t stopTime;
-        QueryPerformanceCounter((LARGE_INTEGER*)&stopTime);
+        uint64_t stopTime = QueryCounter();
         mStopped = true;
 
         mStopTime = stopTime;
@@ -71,8 +94,7 @@ void Carol::Timer::Tick()
         return;
     }
 
-    uint64_t currTime;
-    QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+    uint64_t currTime = QueryCounter();
     
     mCurrTime = currTime;
     mDeltaTime = (mCurrTime - mPrevTime) * mSecondsPerCount;
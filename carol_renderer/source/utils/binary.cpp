@@ -0,0 +1,104 @@
+#include <utils/binary.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+void Carol::BinaryWriter::WriteString(std::string_view str)
+{
+	Write(uint32_t(str.size()));
+	mData.insert(mData.end(), str.begin(), str.end());
+}
+
+void Carol::BinaryWriter::WriteBytes(std::span<const uint8_t> bytes)
+{
+	mData.insert(mData.end(), bytes.begin(), bytes.end());
+}
+
+void Carol::BinaryWriter::Align(size_t alignment)
+{
+	mData.resize((mData.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+size_t Carol::BinaryWriter::GetSize()const
+{
+	return mData.size();
+}
+
+std::span<const uint8_t> Carol::BinaryWriter::GetData()const
+{
+	return mData;
+}
+
+bool Carol::BinaryWriter::Save(std::string_view path)const
+{
+	// Write to a temporary file first so that a crash never leaves a truncated file behind
+	std::filesystem::path filePath(path);
+	std::filesystem::path tempPath(GetTempFilePath(path));
+	std::error_code ec;
+
+	if (filePath.has_parent_path())
+	{
+		std::filesystem::create_directories(filePath.parent_path(), ec);
+	}
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(mData.data()), mData.size());
+
+		if (!file.good())
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
+
+Carol::BinaryReader::BinaryReader(std::span<const uint8_t> data)
+	:mData(data)
+{
+}
+
+std::string_view Carol::BinaryReader::ReadString()
+{
+	uint32_t size = Read<uint32_t>();
+
+	if (!Check(size))
+	{
+		return {};
+	}
+
+	std::string_view str(reinterpret_cast<const char*>(mData.data() + mOffset), size);
+	mOffset += size;
+
+	return str;
+}
+
+void Carol::BinaryReader::Align(size_t alignment)
+{
+	size_t offset = (mOffset + alignment - 1) / alignment * alignment;
+	mValid = mValid && offset <= mData.size();
+	mOffset = mValid ? offset : mData.size();
+}
+
+bool Carol::BinaryReader::IsValid()const
+{
+	return mValid;
+}
+
+bool Carol::BinaryReader::Check(size_t byteSize)
+{
+	mValid = mValid && byteSize <= mData.size() - mOffset;
+	return mValid;
+}
+
+std::string Carol::GetTempFilePath(std::string_view path)
+{
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), ".%zx.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	return std::string(path) + suffix;
+}
@@ -0,0 +1,125 @@
+#include <utils/cook_stats.h>
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	class CookStageCounters
+	{
+	public:
+		std::atomic<uint64_t> Count = 0;
+		std::atomic<uint64_t> Nanoseconds = 0;
+		std::atomic<uint64_t> Bytes = 0;
+	};
+
+	CookStageCounters gCookStageCounters[Carol::COOK_STAGE_COUNT];
+}
+
+std::string_view Carol::GetCookStageName(CookStage stage)
+{
+	constexpr std::string_view names[COOK_STAGE_COUNT] =
+	{
+		"import",
+		"animation",
+		"mesh",
+		"texture decode",
+		"texture cook",
+		"cache write"
+	};
+
+	return names[stage];
+}
+
+Carol::CookStageStats Carol::GetCookStageStats(CookStage stage)
+{
+	auto& counters = gCookStageCounters[stage];
+	CookStageStats stats;
+	stats.Count = counters.Count.load();
+	stats.Nanoseconds = counters.Nanoseconds.load();
+	stats.Bytes = counters.Bytes.load();
+
+	return stats;
+}
+
+void Carol::ResetCookStageStats()
+{
+	for (auto& counters : gCookStageCounters)
+	{
+		counters.Count = 0;
+		counters.Nanoseconds = 0;
+		counters.Bytes = 0;
+	}
+}
+
+uint64_t Carol::GetMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#else
+	// Only Linux has statm, elsewhere the file is missing and 0 is returned
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	FILE* file = std::fopen("/proc/self/statm", "r");
+
+	if (file)
+	{
+		if (std::fscanf(file, "%llu %llu", &size, &resident) != 2)
+		{
+			resident = 0;
+		}
+
+		std::fclose(file);
+	}
+
+	return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+uint64_t Carol::GetPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+	rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage))
+	{
+		return 0;
+	}
+
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return uint64_t(usage.ru_maxrss) << 10;
+#endif
+#endif
+}
+
+Carol::CookStageScope::CookStageScope(CookStage stage)
+	:mStage(stage),
+	mStart(std::chrono::steady_clock::now())
+{
+}
+
+Carol::CookStageScope::~CookStageScope()
+{
+	auto& counters = gCookStageCounters[mStage];
+	++counters.Count;
+	counters.Nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - mStart).count();
+	counters.Bytes += mBytes;
+}
+
+void Carol::CookStageScope::AddBytes(uint64_t bytes)
+{
+	mBytes += bytes;
+}
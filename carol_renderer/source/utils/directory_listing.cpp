@@ -0,0 +1,44 @@
+#include <utils/directory_listing.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace
+{
+	std::string GetKey(std::string_view fileName)
+	{
+		std::string key(fileName);
+
+#ifdef _WIN32
+		std::ranges::transform(key, key.begin(), [](unsigned char c) { return std::tolower(c); });
+#endif
+
+		return key;
+	}
+}
+
+Carol::DirectoryListing::DirectoryListing(std::string_view directory)
+{
+	std::string directoryStr(directory);
+	std::ranges::replace(directoryStr, '\\', '/');
+	std::error_code ec;
+
+	// A missing directory lists as empty
+	for (auto it = std::filesystem::directory_iterator(directoryStr, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+	{
+		if (it->is_regular_file(ec))
+		{
+			mFileNames.insert(GetKey(it->path().filename().string()));
+		}
+	}
+}
+
+bool Carol::DirectoryListing::Contains(std::string_view fileName)const
+{
+	return mFileNames.contains(GetKey(fileName));
+}
+
+size_t Carol::DirectoryListing::GetFileCount()const
+{
+	return mFileNames.size();
+}
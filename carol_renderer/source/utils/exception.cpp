@@ -1,7 +1,11 @@
 #include <utils/exception.h>
-#include <comdef.h>
+#include <cstdio>
 #include <system_error>
 
+#ifdef _WIN32
+#include <comdef.h>
+#endif
+
 Carol::DxException::DxException(HRESULT hr, std::string_view functionName, std::string_view filename, int lineNumber)
 	:ErrorCode(hr),
 	FunctionName(functionName),
@@ -11,7 +15,13 @@ Carol::DxException::DxException(HRESULT hr, std::string_view functionName, std::
 
 std::string Carol::DxException::ToString()const
 {
+#ifdef _WIN32
 	_com_error err(ErrorCode);
-	return FunctionName + " failed in " + Filename + "; line " + std::to_string(LineNumber) + "; error: " + err.ErrorMessage();
+	std::string message = err.ErrorMessage();
+#else
+	char message[16];
+	std::snprintf(message, sizeof(message), "0x%08x", uint32_t(ErrorCode));
+#endif
+	return FunctionName + " failed in " + Filename + "; line " + std::to_string(LineNumber) + "; error: " + message;
 }
 
@@ -0,0 +1,24 @@
+#include <utils/frame_arena.h>
+
+size_t Carol::FrameArena::GetMarker()const
+{
+	return mOffset;
+}
+
+void Carol::FrameArena::Rewind(size_t marker)
+{
+	mOffset = marker;
+
+	if (mOffset == 0 && !mOverflow.empty())
+	{
+		mOverflow.clear();
+		mBuffer = std::make_unique<std::byte[]>(mPeak);
+		mCapacity = mPeak;
+	}
+}
+
+Carol::FrameArena& Carol::FrameArena::GetThreadArena()
+{
+	thread_local FrameArena arena;
+	return arena;
+}
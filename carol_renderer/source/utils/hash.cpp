@@ -0,0 +1,104 @@
+#include <utils/hash.h>
+#include <cstring>
+
+namespace
+{
+	// Constants and round structure follow xxHash64, input is consumed 32 bytes per round
+	constexpr uint64_t Prime0 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t Prime1 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t Prime2 = 0x165667B19E3779F9ull;
+	constexpr uint64_t Prime3 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t Prime4 = 0x27D4EB2F165667C5ull;
+
+	uint64_t Rotl(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	uint64_t Load64(const uint8_t* p)
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint32_t Load32(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	uint64_t Round(uint64_t acc, uint64_t input)
+	{
+		acc += input * Prime1;
+		acc = Rotl(acc, 31);
+		return acc * Prime0;
+	}
+
+	uint64_t MergeRound(uint64_t acc, uint64_t val)
+	{
+		acc ^= Round(0, val);
+		return acc * Prime0 + Prime3;
+	}
+}
+
+uint64_t Carol::Hash64(const void* data, size_t byteSize, uint64_t seed)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* end = p + byteSize;
+	uint64_t h;
+
+	if (byteSize >= 32)
+	{
+		uint64_t v[4] = { seed + Prime0 + Prime1, seed + Prime1, seed, seed - Prime0 };
+
+		for (; p + 32 <= end; p += 32)
+		{
+			v[0] = Round(v[0], Load64(p));
+			v[1] = Round(v[1], Load64(p + 8));
+			v[2] = Round(v[2], Load64(p + 16));
+			v[3] = Round(v[3], Load64(p + 24));
+		}
+
+		h = Rotl(v[0], 1) + Rotl(v[1], 7) + Rotl(v[2], 12) + Rotl(v[3], 18);
+
+		for (auto lane : v)
+		{
+			h = MergeRound(h, lane);
+		}
+	}
+	else
+	{
+		h = seed + Prime4;
+	}
+
+	h += byteSize;
+
+	for (; p + 8 <= end; p += 8)
+	{
+		h ^= Round(0, Load64(p));
+		h = Rotl(h, 27) * Prime0 + Prime3;
+	}
+
+	if (p + 4 <= end)
+	{
+		h ^= uint64_t(Load32(p)) * Prime0;
+		h = Rotl(h, 23) * Prime1 + Prime2;
+		p += 4;
+	}
+
+	for (; p < end; ++p)
+	{
+		h ^= (*p) * Prime4;
+		h = Rotl(h, 11) * Prime0;
+	}
+
+	h ^= h >> 33;
+	h *= Prime1;
+	h ^= h >> 29;
+	h *= Prime2;
+	h ^= h >> 32;
+
+	return h;
+}
\ No newline at end of file
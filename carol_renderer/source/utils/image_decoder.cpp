@@ -0,0 +1,188 @@
+#include <utils/image_decoder.h>
+#include <utils/mapped_file.h>
+#include <algorithm>
+#include <cctype>
+#include <csetjmp>
+#include <filesystem>
+#include <span>
+#include <string>
+
+#ifdef CAROL_USE_LIBPNG
+#include <png.h>
+#endif
+
+#ifdef CAROL_USE_LIBJPEG
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace
+{
+#ifdef CAROL_USE_LIBPNG
+	HRESULT DecodePng(std::span<const uint8_t> data, DirectX::ScratchImage& image)
+	{
+		png_image png = {};
+		png.version = PNG_IMAGE_VERSION;
+
+		if (!png_image_begin_read_from_memory(&png, data.data(), data.size()))
+		{
+			return E_FAIL;
+		}
+
+		png.format = PNG_FORMAT_RGBA;
+
+		if (FAILED(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, png.width, png.height, 1, 1)))
+		{
+			png_image_free(&png);
+			return E_OUTOFMEMORY;
+		}
+
+		const DirectX::Image* dst = image.GetImage(0, 0, 0);
+
+		return png_image_finish_read(&png, nullptr, dst->pixels, dst->rowPitch, nullptr) ? S_OK : E_FAIL;
+	}
+#endif
+
+#ifdef CAROL_USE_LIBJPEG
+	class JpegErrorManager
+	{
+	public:
+		jpeg_error_mgr Manager;
+		std::jmp_buf Jump;
+	};
+
+	void JpegErrorExit(j_common_ptr info)
+	{
+		std::longjmp(reinterpret_cast<JpegErrorManager*>(info->err)->Jump, 1);
+	}
+
+	// Nothing with a destructor may live in this frame, errors longjmp back to the setjmp below
+	HRESULT DecodeJpeg(std::span<const uint8_t> data, DirectX::ScratchImage& image)
+	{
+		jpeg_decompress_struct info;
+		JpegErrorManager error;
+		info.err = jpeg_std_error(&error.Manager);
+		error.Manager.error_exit = JpegErrorExit;
+
+		if (setjmp(error.Jump))
+		{
+			jpeg_destroy_decompress(&info);
+			return E_FAIL;
+		}
+
+		jpeg_create_decompress(&info);
+		jpeg_mem_src(&info, data.data(), data.size());
+		jpeg_read_header(&info, TRUE);
+
+#ifdef JCS_EXTENSIONS
+		info.out_color_space = JCS_EXT_RGBA;
+#else
+		info.out_color_space = JCS_RGB;
+#endif
+
+		jpeg_start_decompress(&info);
+
+		if (FAILED(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, info.output_width, info.output_height, 1, 1)))
+		{
+			jpeg_destroy_decompress(&info);
+			return E_OUTOFMEMORY;
+		}
+
+		const DirectX::Image* dst = image.GetImage(0, 0, 0);
+
+		while (info.output_scanline < info.output_height)
+		{
+			JSAMPROW row = dst->pixels + info.output_scanline * dst->rowPitch;
+			jpeg_read_scanlines(&info, &row, 1);
+
+#ifndef JCS_EXTENSIONS
+			// Widen RGB to RGBA in place from the back of the row
+			for (int i = info.output_width - 1; i >= 0; --i)
+			{
+				row[i * 4 + 3] = 0xff;
+				row[i * 4 + 2] = row[i * 3 + 2];
+				row[i * 4 + 1] = row[i * 3 + 1];
+				row[i * 4 + 0] = row[i * 3 + 0];
+			}
+#endif
+		}
+
+		jpeg_finish_decompress(&info);
+		jpeg_destroy_decompress(&info);
+
+		return S_OK;
+	}
+#endif
+
+#ifdef _WIN32
+	HRESULT DecodeWic(const std::filesystem::path& path, DirectX::ScratchImage& image)
+	{
+		// WIC needs COM on every thread that decodes, loading threads never leave it
+		thread_local HRESULT comInitialized = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+		return LoadFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
+	}
+#endif
+}
+
+HRESULT Carol::DecodeImage(std::string_view fileName, DirectX::ScratchImage& image)
+{
+	// Asset paths are written with either separator, both work everywhere once they are forward slashes
+	std::string pathStr(fileName);
+	std::ranges::replace(pathStr, '\\', '/');
+
+	std::filesystem::path path(pathStr);
+	std::string suffix = path.extension().string();
+	std::ranges::transform(suffix, suffix.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	if (suffix == ".dds")
+	{
+		return LoadFromDDSFile(path.wstring().c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image);
+	}
+
+	if (suffix == ".tga")
+	{
+		return LoadFromTGAFile(path.wstring().c_str(), DirectX::TGA_FLAGS_NONE, nullptr, image);
+	}
+
+	// Files whose content does not match their suffix fall through to WIC
+#ifdef CAROL_USE_LIBPNG
+	if (suffix == ".png")
+	{
+		MappedFile file(pathStr);
+
+		if (!file.IsValid())
+		{
+			return E_FAIL;
+		}
+
+		if (file.GetData().size() >= 8 && png_sig_cmp(file.GetData().data(), 0, 8) == 0)
+		{
+			return DecodePng(file.GetData(), image);
+		}
+	}
+#endif
+
+#ifdef CAROL_USE_LIBJPEG
+	if (suffix == ".jpg" || suffix == ".jpeg")
+	{
+		MappedFile file(pathStr);
+
+		if (!file.IsValid())
+		{
+			return E_FAIL;
+		}
+
+		if (file.GetData().size() >= 2 && file.GetData()[0] == 0xFF && file.GetData()[1] == 0xD8)
+		{
+			return DecodeJpeg(file.GetData(), image);
+		}
+	}
+#endif
+
+#ifdef _WIN32
+	return DecodeWic(path, image);
+#else
+	return E_FAIL;
+#endif
+}
@@ -0,0 +1,99 @@
+#include <utils/mapped_file.h>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Carol::MappedFile::MappedFile(std::string_view path)
+{
+	std::string pathStr(path);
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(pathStr.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	LARGE_INTEGER size;
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	mFile = file;
+
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		return;
+	}
+
+	mMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mMapping)
+	{
+		return;
+	}
+
+	mData = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	mSize = mData ? size.QuadPart : 0;
+#else
+	struct stat st;
+	mFile = open(pathStr.c_str(), O_RDONLY);
+
+	if (mFile == -1 || fstat(mFile, &st) != 0 || st.st_size == 0)
+	{
+		return;
+	}
+
+	void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+
+	if (data != MAP_FAILED)
+	{
+		mData = static_cast<const uint8_t*>(data);
+		mSize = st.st_size;
+	}
+#endif
+}
+
+Carol::MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+	}
+
+	if (mFile)
+	{
+		CloseHandle(mFile);
+	}
+#else
+	if (mData)
+	{
+		munmap(const_cast<uint8_t*>(mData), mSize);
+	}
+
+	if (mFile != -1)
+	{
+		close(mFile);
+	}
+#endif
+}
+
+bool Carol::MappedFile::IsValid()const
+{
+	return mData != nullptr;
+}
+
+std::span<const uint8_t> Carol::MappedFile::GetData()const
+{
+	return { mData, mSize };
+}
@@ -0,0 +1,300 @@
+#include <utils/mip_chain.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// In texels of the smaller level, with the usual alpha of 4
+	constexpr float KAISER_RADIUS = 2.f;
+	constexpr float KAISER_ALPHA = 4.f;
+	constexpr uint32_t SRGB_ENCODE_TABLE_SIZE = 16384;
+	constexpr uint32_t ROW_GRAIN_SIZE = 8;
+
+	// Every destination texel reads TapCount source texels, shorter filters are padded with zero weights
+	class FilterTaps
+	{
+	public:
+		uint32_t TapCount = 0;
+		std::vector<uint32_t> Indices;
+		std::vector<float> Weights;
+	};
+
+	float Sinc(float x)
+	{
+		return x == 0.f ? 1.f : std::sin(DirectX::XM_PI * x) / (DirectX::XM_PI * x);
+	}
+
+	float BesselI0(float x)
+	{
+		float sum = 1.f;
+		float term = 1.f;
+
+		for (int k = 1; term > 1e-7f * sum; ++k)
+		{
+			term *= (x / (2.f * k)) * (x / (2.f * k));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	float Kaiser(float x)
+	{
+		return BesselI0(KAISER_ALPHA * std::sqrt(std::max(0.f, 1.f - x * x))) / BesselI0(KAISER_ALPHA);
+	}
+
+	FilterTaps BuildFilterTaps(uint32_t srcSize, uint32_t dstSize, Carol::MipFilter filter)
+	{
+		float scale = float(srcSize) / dstSize;
+		float radius = filter == Carol::MIP_FILTER_KAISER ? KAISER_RADIUS * scale : 0.5f * scale;
+		std::vector<std::vector<std::pair<uint32_t, float>>> taps(dstSize);
+		FilterTaps filterTaps;
+
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			float center = (i + 0.5f) * scale;
+			float sum = 0.f;
+
+			for (int j = int(std::floor(center - radius)); j < int(std::ceil(center + radius)); ++j)
+			{
+				float weight;
+
+				if (filter == Carol::MIP_FILTER_KAISER)
+				{
+					float x = (j + 0.5f - center) / scale;
+					weight = std::abs(x) < KAISER_RADIUS ? Sinc(x) * Kaiser(x / KAISER_RADIUS) : 0.f;
+				}
+				else
+				{
+					weight = std::max(0.f, std::min(j + 1.f, center + radius) - std::max(float(j), center - radius));
+				}
+
+				if (weight != 0.f)
+				{
+					// Texels past the border repeat the edge
+					taps[i].emplace_back(std::clamp(j, 0, int(srcSize) - 1), weight);
+					sum += weight;
+				}
+			}
+
+			for (auto& tap : taps[i])
+			{
+				tap.second /= sum;
+			}
+
+			filterTaps.TapCount = std::max<uint32_t>(filterTaps.TapCount, taps[i].size());
+		}
+
+		filterTaps.Indices.resize(dstSize * filterTaps.TapCount);
+		filterTaps.Weights.resize(dstSize * filterTaps.TapCount);
+
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			for (uint32_t t = 0; t < filterTaps.TapCount; ++t)
+			{
+				auto tap = t < taps[i].size() ? taps[i][t] : std::make_pair(taps[i][0].first, 0.f);
+				filterTaps.Indices[i * filterTaps.TapCount + t] = tap.first;
+				filterTaps.Weights[i * filterTaps.TapCount + t] = tap.second;
+			}
+		}
+
+		return filterTaps;
+	}
+
+	const float* GetSrgbDecodeTable()
+	{
+		static const std::vector<float> table = []()
+		{
+			std::vector<float> table(256);
+
+			for (int i = 0; i < 256; ++i)
+			{
+				float c = i / 255.f;
+				table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			return table;
+		}();
+
+		return table.data();
+	}
+
+	const uint8_t* GetSrgbEncodeTable()
+	{
+		static const std::vector<uint8_t> table = []()
+		{
+			std::vector<uint8_t> table(SRGB_ENCODE_TABLE_SIZE);
+
+			for (uint32_t i = 0; i < SRGB_ENCODE_TABLE_SIZE; ++i)
+			{
+				float c = float(i) / (SRGB_ENCODE_TABLE_SIZE - 1);
+				c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+				table[i] = uint8_t(c * 255.f + 0.5f);
+			}
+
+			return table;
+		}();
+
+		return table.data();
+	}
+
+	DirectX::XMVECTOR DecodeTexel(const uint8_t* texel, Carol::MipContent content)
+	{
+		if (content == Carol::MIP_CONTENT_SRGB)
+		{
+			const float* table = GetSrgbDecodeTable();
+			return DirectX::XMVectorSet(table[texel[0]], table[texel[1]], table[texel[2]], texel[3] / 255.f);
+		}
+
+		DirectX::XMVECTOR v = DirectX::XMVectorScale(DirectX::XMVectorSet(texel[0], texel[1], texel[2], texel[3]), 1.f / 255.f);
+
+		if (content == Carol::MIP_CONTENT_NORMAL)
+		{
+			v = DirectX::XMVectorSelect(v, DirectX::XMVectorMultiplyAdd(v, DirectX::XMVectorReplicate(2.f), DirectX::XMVectorReplicate(-1.f)), DirectX::g_XMSelect1110);
+		}
+
+		return v;
+	}
+
+	void EncodeTexel(DirectX::FXMVECTOR v, Carol::MipContent content, uint8_t* texel)
+	{
+		DirectX::XMFLOAT4 f;
+
+		if (content == Carol::MIP_CONTENT_NORMAL)
+		{
+			DirectX::XMVECTOR n = DirectX::XMVectorMultiplyAdd(v, DirectX::XMVectorReplicate(0.5f), DirectX::XMVectorReplicate(0.5f));
+			DirectX::XMStoreFloat4(&f, DirectX::XMVectorSaturate(DirectX::XMVectorSelect(v, n, DirectX::g_XMSelect1110)));
+		}
+		else
+		{
+			// Kaiser lobes may overshoot
+			DirectX::XMStoreFloat4(&f, DirectX::XMVectorSaturate(v));
+		}
+
+		if (content == Carol::MIP_CONTENT_SRGB)
+		{
+			const uint8_t* table = GetSrgbEncodeTable();
+			texel[0] = table[uint32_t(f.x * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+			texel[1] = table[uint32_t(f.y * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+			texel[2] = table[uint32_t(f.z * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+		}
+		else
+		{
+			texel[0] = uint8_t(f.x * 255.f + 0.5f);
+			texel[1] = uint8_t(f.y * 255.f + 0.5f);
+			texel[2] = uint8_t(f.z * 255.f + 0.5f);
+		}
+
+		texel[3] = uint8_t(f.w * 255.f + 0.5f);
+	}
+}
+
+HRESULT Carol::GenerateMipChain(
+	const DirectX::Image& top,
+	MipFilter filter,
+	MipContent content,
+	DirectX::ScratchImage& mipChain)
+{
+	if (top.format != DXGI_FORMAT_R8G8B8A8_UNORM)
+	{
+		return E_INVALIDARG;
+	}
+
+	uint32_t levelCount = 1;
+
+	for (size_t size = std::max(top.width, top.height); size > 1; size /= 2)
+	{
+		++levelCount;
+	}
+
+	HRESULT hr = mipChain.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, top.width, top.height, 1, levelCount);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	const DirectX::Image* levels = mipChain.GetImages();
+	uint32_t srcWidth = top.width;
+	uint32_t srcHeight = top.height;
+	std::vector<DirectX::XMFLOAT4A> src(srcWidth * srcHeight);
+	std::vector<DirectX::XMFLOAT4A> rows;
+	std::vector<DirectX::XMFLOAT4A> dst;
+
+	gThreadPool->ParallelFor(srcHeight, [&](uint32_t y)
+	{
+		const uint8_t* row = top.pixels + y * top.rowPitch;
+		std::memcpy(levels[0].pixels + y * levels[0].rowPitch, row, srcWidth * 4);
+
+		for (uint32_t x = 0; x < srcWidth; ++x)
+		{
+			DirectX::XMStoreFloat4A(&src[y * srcWidth + x], DecodeTexel(row + x * 4, content));
+		}
+	}, ROW_GRAIN_SIZE);
+
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+		uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+		FilterTaps columnTaps = BuildFilterTaps(srcWidth, dstWidth, filter);
+		FilterTaps rowTaps = BuildFilterTaps(srcHeight, dstHeight, filter);
+		rows.resize(srcHeight * dstWidth);
+		dst.resize(dstHeight * dstWidth);
+
+		// The filter is separable, every source row is filtered horizontally before the columns are
+		gThreadPool->ParallelFor(srcHeight, [&](uint32_t y)
+		{
+			const DirectX::XMFLOAT4A* srcRow = src.data() + y * srcWidth;
+
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				DirectX::XMVECTOR sum = DirectX::XMVectorZero();
+
+				for (uint32_t t = 0; t < columnTaps.TapCount; ++t)
+				{
+					uint32_t tap = x * columnTaps.TapCount + t;
+					sum = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat4A(&srcRow[columnTaps.Indices[tap]]), DirectX::XMVectorReplicate(columnTaps.Weights[tap]), sum);
+				}
+
+				DirectX::XMStoreFloat4A(&rows[y * dstWidth + x], sum);
+			}
+		}, ROW_GRAIN_SIZE);
+
+		gThreadPool->ParallelFor(dstHeight, [&](uint32_t y)
+		{
+			DirectX::XMFLOAT4A* dstRow = dst.data() + y * dstWidth;
+			uint8_t* texels = levels[level].pixels + y * levels[level].rowPitch;
+
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				DirectX::XMVECTOR sum = DirectX::XMVectorZero();
+
+				for (uint32_t t = 0; t < rowTaps.TapCount; ++t)
+				{
+					uint32_t tap = y * rowTaps.TapCount + t;
+					sum = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat4A(&rows[rowTaps.Indices[tap] * dstWidth + x]), DirectX::XMVectorReplicate(rowTaps.Weights[tap]), sum);
+				}
+
+				// Normals are renormalized before the next level filters them again
+				if (content == MIP_CONTENT_NORMAL)
+				{
+					sum = DirectX::XMVectorSelect(sum, DirectX::XMVector3Normalize(sum), DirectX::g_XMSelect1110);
+				}
+
+				DirectX::XMStoreFloat4A(&dstRow[x], sum);
+				EncodeTexel(sum, content, texels + x * 4);
+			}
+		}, ROW_GRAIN_SIZE);
+
+		std::swap(src, dst);
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+
+	return S_OK;
+}
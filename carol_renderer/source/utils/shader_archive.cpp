@@ -0,0 +1,140 @@
+#include <utils/shader_archive.h>
+#include <utils/binary.h>
+#include <utils/hash.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t SHADER_BYTECODE_SEED = 0x445849;
+}
+
+uint64_t Carol::GetShaderNameHash(std::string_view path)
+{
+	std::string pathStr(path);
+	std::ranges::replace(pathStr, '\\', '/');
+
+	return Hash64(pathStr.data(), pathStr.size());
+}
+
+uint64_t Carol::GetShaderBytecodeHash(std::span<const uint8_t> bytecode)
+{
+	return Hash64(bytecode.data(), bytecode.size(), SHADER_BYTECODE_SEED);
+}
+
+bool Carol::SaveShaderArchive(std::span<const std::string> paths, std::string_view archivePath)
+{
+	std::vector<std::unique_ptr<MappedFile>> files(paths.size());
+	std::vector<ShaderArchiveEntry> entries(paths.size());
+	std::vector<uint32_t> order(paths.size());
+	uint64_t offset = sizeof(ShaderArchiveHeader) + paths.size() * sizeof(ShaderArchiveEntry);
+
+	for (uint32_t i = 0; i < paths.size(); ++i)
+	{
+		files[i] = std::make_unique<MappedFile>(paths[i]);
+
+		if (!files[i]->IsValid())
+		{
+			return false;
+		}
+
+		offset = (offset + SHADER_ARCHIVE_ALIGNMENT - 1) / SHADER_ARCHIVE_ALIGNMENT * SHADER_ARCHIVE_ALIGNMENT;
+		entries[i].NameHash = GetShaderNameHash(paths[i]);
+		entries[i].BytecodeHash = GetShaderBytecodeHash(files[i]->GetData());
+		entries[i].Offset = offset;
+		entries[i].Size = files[i]->GetData().size();
+		offset += entries[i].Size;
+		order[i] = i;
+	}
+
+	// Blobs keep the order of the paths, only the table is sorted for the lookup
+	std::ranges::sort(order, {}, [&](uint32_t i) { return entries[i].NameHash; });
+
+	for (uint32_t i = 1; i < order.size(); ++i)
+	{
+		if (entries[order[i]].NameHash == entries[order[i - 1]].NameHash)
+		{
+			return false;
+		}
+	}
+
+	BinaryWriter writer;
+	ShaderArchiveHeader header;
+	header.ShaderCount = paths.size();
+	writer.Write(header);
+
+	for (uint32_t i : order)
+	{
+		writer.Write(entries[i]);
+	}
+
+	for (const auto& file : files)
+	{
+		writer.Align(SHADER_ARCHIVE_ALIGNMENT);
+		writer.WriteBytes(file->GetData());
+	}
+
+	return writer.Save(archivePath);
+}
+
+Carol::ShaderArchive::ShaderArchive(std::string_view path)
+	:mFile(path)
+{
+	if (!mFile.IsValid())
+	{
+		return;
+	}
+
+	auto data = mFile.GetData();
+	BinaryReader reader(data);
+	auto header = reader.Read<ShaderArchiveHeader>();
+
+	if (!reader.IsValid()
+		|| header.Magic != SHADER_ARCHIVE_MAGIC
+		|| header.Version != SHADER_ARCHIVE_VERSION
+		|| header.ShaderCount > (data.size() - sizeof(ShaderArchiveHeader)) / sizeof(ShaderArchiveEntry))
+	{
+		return;
+	}
+
+	// The mapping is page aligned and the table follows the 16-byte header, so entries are read in place
+	mEntries = { reinterpret_cast<const ShaderArchiveEntry*>(data.data() + sizeof(ShaderArchiveHeader)), header.ShaderCount };
+
+	for (uint32_t i = 0; i < mEntries.size(); ++i)
+	{
+		const auto& entry = mEntries[i];
+
+		if (entry.Offset > data.size()
+			|| entry.Size > data.size() - entry.Offset
+			|| (i > 0 && entry.NameHash <= mEntries[i - 1].NameHash))
+		{
+			mEntries = {};
+			return;
+		}
+	}
+
+	mValid = true;
+}
+
+bool Carol::ShaderArchive::IsValid()const
+{
+	return mValid;
+}
+
+const Carol::ShaderArchiveEntry* Carol::ShaderArchive::Find(uint64_t nameHash)const
+{
+	auto it = std::ranges::lower_bound(mEntries, nameHash, {}, &ShaderArchiveEntry::NameHash);
+
+	return it != mEntries.end() && it->NameHash == nameHash ? &*it : nullptr;
+}
+
+std::span<const uint8_t> Carol::ShaderArchive::GetBytecode(const ShaderArchiveEntry& entry)const
+{
+	return mFile.GetData().subspan(entry.Offset, entry.Size);
+}
+
+uint32_t Carol::ShaderArchive::GetShaderCount()const
+{
+	return mEntries.size();
+}
@@ -0,0 +1,157 @@
+#include <utils/thread_pool.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace
+{
+	class ParallelForState
+	{
+	public:
+		std::atomic<uint32_t> NextIdx = 0;
+		std::atomic<uint32_t> DoneCount = 0;
+		std::mutex DoneMutex;
+		std::condition_variable DoneCondition;
+		// The first exception thrown by any chunk, guarded by DoneMutex
+		std::exception_ptr Error;
+		std::atomic<bool> Failed = false;
+	};
+}
+
+Carol::ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		mThreads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+Carol::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mTaskMutex);
+		mStop = true;
+	}
+
+	mTaskCondition.notify_all();
+
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+std::future<void> Carol::ThreadPool::Submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packagedTask(std::move(task));
+	std::future<void> future = packagedTask.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(mTaskMutex);
+		mTasks.push(std::move(packagedTask));
+	}
+
+	mTaskCondition.notify_one();
+	return future;
+}
+
+void Carol::ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func, uint32_t grainSize)
+{
+	grainSize = std::max(grainSize, 1u);
+	uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	if (chunkCount <= 1)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			func(i);
+		}
+
+		return;
+	}
+
+	// Helpers may start after the loop has finished, so the state outlives this call
+	auto state = std::make_shared<ParallelForState>();
+
+	auto runChunks = [state, &func, count, grainSize, chunkCount]()
+	{
+		for (uint32_t chunk = state->NextIdx.fetch_add(1); chunk < chunkCount; chunk = state->NextIdx.fetch_add(1))
+		{
+			uint32_t end = std::min(count, (chunk + 1) * grainSize);
+
+			// Every claimed chunk counts as done, so the caller never waits on a chunk that threw
+			try
+			{
+				for (uint32_t i = chunk * grainSize; i < end && !state->Failed.load(); ++i)
+				{
+					func(i);
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(state->DoneMutex);
+
+				if (!state->Error)
+				{
+					state->Error = std::current_exception();
+				}
+
+				state->Failed = true;
+			}
+
+			if (state->DoneCount.fetch_add(1) + 1 == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(state->DoneMutex);
+				state->DoneCondition.notify_all();
+			}
+		}
+	};
+
+	uint32_t helperCount = std::min<uint32_t>(mThreads.size(), chunkCount - 1);
+
+	for (uint32_t i = 0; i < helperCount; ++i)
+	{
+		Submit(runChunks);
+	}
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state->DoneMutex);
+	state->DoneCondition.wait(lock, [&]() { return state->DoneCount.load() == chunkCount; });
+
+	if (state->Error)
+	{
+		std::rethrow_exception(state->Error);
+	}
+}
+
+uint32_t Carol::ThreadPool::GetThreadCount()const
+{
+	return mThreads.size();
+}
+
+void Carol::ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::packaged_task<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(mTaskMutex);
+			mTaskCondition.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+
+			if (mStop && mTasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(mTasks.front());
+			mTasks.pop();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions to count heap allocations, include it from one source of the executable only
+
+inline std::atomic<uint64_t> gAllocationCount = 0;
+
+void* operator new(size_t size)
+{
+	++gAllocationCount;
+
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p)noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t)noexcept
+{
+	std::free(p);
+}
@@ -0,0 +1,142 @@
+#include "animation_fixture.h"
+#include "test.h"
+#include <scene/animation_asset.h>
+#include <scene/compressed_animation.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 30;
+	constexpr uint32_t VARIANT_COUNT = 50;
+
+	// Rig as a model import would read it, every variant gets its own copy of the arrays
+	void BuildRig(uint32_t boneCount, float height, std::vector<int>& hierarchy, std::vector<DirectX::XMFLOAT4X4>& offsets)
+	{
+		hierarchy.resize(boneCount);
+		offsets.resize(boneCount);
+
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			hierarchy[i] = int(i) - 1;
+			DirectX::XMStoreFloat4x4(&offsets[i], DirectX::XMMatrixTranslation(0.f, -height * i, 0.f));
+		}
+	}
+}
+
+int main()
+{
+	Carol::AnimationAssetManager manager;
+
+	// Variants of one rig share a skeleton, a different rig gets its own
+	{
+		std::vector<std::shared_ptr<const Carol::Skeleton>> skeletons;
+
+		for (uint32_t i = 0; i < VARIANT_COUNT; ++i)
+		{
+			std::vector<int> hierarchy;
+			std::vector<DirectX::XMFLOAT4X4> offsets;
+			BuildRig(BONE_COUNT, 1.f, hierarchy, offsets);
+			skeletons.push_back(manager.LoadSkeleton(hierarchy, offsets));
+		}
+
+		for (auto& skeleton : skeletons)
+		{
+			CAROL_CHECK(skeleton == skeletons[0]);
+		}
+
+		CAROL_CHECK(manager.GetSkeletonsCount() == 1);
+		CAROL_CHECK(skeletons[0]->Hierarchy.size() == BONE_COUNT);
+
+		std::vector<int> hierarchy;
+		std::vector<DirectX::XMFLOAT4X4> offsets;
+		BuildRig(BONE_COUNT, 1.5f, hierarchy, offsets);
+		auto otherSkeleton = manager.LoadSkeleton(hierarchy, offsets);
+
+		CAROL_CHECK(otherSkeleton != skeletons[0]);
+		CAROL_CHECK(otherSkeleton->ContentHash != skeletons[0]->ContentHash);
+		CAROL_CHECK(manager.GetSkeletonsCount() == 2);
+
+		// The manager does not keep assets alive on its own
+		skeletons.pop_back();
+		CAROL_CHECK(manager.GetSkeletonsCount() == 2);
+		otherSkeleton.reset();
+		CAROL_CHECK(manager.GetSkeletonsCount() == 1);
+	}
+
+	CAROL_CHECK(manager.GetSkeletonsCount() == 0);
+
+	// Loading threads racing on one rig still end up with one skeleton
+	{
+		std::vector<std::shared_ptr<const Carol::Skeleton>> skeletons(8);
+		std::vector<std::thread> threads;
+
+		for (auto& skeleton : skeletons)
+		{
+			threads.emplace_back([&]()
+			{
+				std::vector<int> hierarchy;
+				std::vector<DirectX::XMFLOAT4X4> offsets;
+				BuildRig(BONE_COUNT, 1.f, hierarchy, offsets);
+				skeleton = manager.LoadSkeleton(hierarchy, offsets);
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (auto& skeleton : skeletons)
+		{
+			CAROL_CHECK(skeleton == skeletons[0]);
+		}
+
+		CAROL_CHECK(manager.GetSkeletonsCount() == 1);
+	}
+
+	// Clips compressed from the same keys with the same settings are shared, so memory follows the unique clips
+	{
+		auto rawClip = Carol::BuildTestClip(BONE_COUNT, 2.f, 30.f);
+		uint64_t hash = Carol::CompressedAnimationClip::HashSource(rawClip);
+		CAROL_CHECK(manager.FindAnimationClip(hash) == nullptr);
+
+		std::vector<std::shared_ptr<const Carol::CompressedAnimationClip>> clips;
+
+		for (uint32_t i = 0; i < VARIANT_COUNT; ++i)
+		{
+			// Imports look the clip up first and only compress it when it is missing
+			auto clip = manager.FindAnimationClip(hash);
+			clips.push_back(clip ? clip : manager.AddAnimationClip(std::make_unique<Carol::CompressedAnimationClip>(rawClip)));
+		}
+
+		for (auto& clip : clips)
+		{
+			CAROL_CHECK(clip == clips[0]);
+		}
+
+		CAROL_CHECK(manager.GetAnimationClipsCount() == 1);
+
+		// A clip compressed by a racing import is dropped for the registered one
+		auto duplicate = manager.AddAnimationClip(std::make_unique<Carol::CompressedAnimationClip>(rawClip));
+		CAROL_CHECK(duplicate == clips[0]);
+
+		// Other settings are another asset
+		Carol::AnimationCompressionSettings settings;
+		settings.RotationError *= 0.5f;
+		auto finerClip = manager.AddAnimationClip(std::make_unique<Carol::CompressedAnimationClip>(rawClip, settings));
+		CAROL_CHECK(finerClip != clips[0]);
+		CAROL_CHECK(manager.FindAnimationClip(Carol::CompressedAnimationClip::HashSource(rawClip, settings)) == finerClip);
+		CAROL_CHECK(manager.GetAnimationClipsCount() == 2);
+
+		clips.clear();
+		duplicate.reset();
+		CAROL_CHECK(manager.FindAnimationClip(hash) == nullptr);
+		CAROL_CHECK(manager.GetAnimationClipsCount() == 1);
+	}
+
+	CAROL_CHECK(manager.GetAnimationClipsCount() == 0);
+
+	std::printf("animation-asset-test: %u variants, %d failed checks\n", VARIANT_COUNT, gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,114 @@
+#include "allocation_counter.h"
+#include "animation_fixture.h"
+#include "model_fixture.h"
+#include "test.h"
+#include <scene/timer.h>
+#include <utils/thread_pool.h>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+	constexpr uint32_t CHARACTER_COUNT = 500;
+	constexpr uint32_t BONE_COUNT = 100;
+	constexpr uint32_t FRAME_COUNT = 100;
+	constexpr uint32_t MAX_LAYER_COUNT = 4;
+}
+
+// carol-animation-blend-bench [threads]
+// Evaluates 500 characters with 100-bone skeletons and 1 to 4 active layers each: a clip, a cross-fade to a second one
+// and up to two additive clips. Fades are long enough to stay active for the whole run.
+int main(int argc, char** argv)
+{
+	uint32_t threadCount = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+	threadCount = std::max(threadCount, 1u);
+
+	// The calling thread takes part in the loop, so a pool of n - 1 workers runs on n threads
+	auto pool = threadCount > 1 ? std::make_unique<Carol::ThreadPool>(threadCount - 1) : nullptr;
+
+	auto skeleton = Carol::BuildTestSkeleton(BONE_COUNT);
+	const char* clipNames[MAX_LAYER_COUNT] = { "walk", "run", "breathe", "lean" };
+	std::shared_ptr<const Carol::CompressedAnimationClip> clips[MAX_LAYER_COUNT];
+
+	for (uint32_t i = 0; i < MAX_LAYER_COUNT; ++i)
+	{
+		clips[i] = std::make_shared<Carol::CompressedAnimationClip>(Carol::BuildTestClip(BONE_COUNT, 10.f, 30.f, i));
+	}
+
+	Carol::Timer timer;
+	timer.Reset();
+
+	std::printf("%u characters, %u bones, %u threads\n", CHARACTER_COUNT, BONE_COUNT, threadCount);
+	double singleLayerMilliseconds = 0.0;
+
+	for (uint32_t layerCount = 1; layerCount <= MAX_LAYER_COUNT; ++layerCount)
+	{
+		std::vector<std::unique_ptr<Carol::TestModel>> models;
+
+		for (uint32_t i = 0; i < CHARACTER_COUNT; ++i)
+		{
+			auto& model = models.emplace_back(std::make_unique<Carol::TestModel>(skeleton));
+
+			for (uint32_t j = 0; j < MAX_LAYER_COUNT; ++j)
+			{
+				model->AddAnimationClip(clipNames[j], clips[j]);
+			}
+
+			model->SetAnimationClip("walk");
+
+			if (layerCount > 1)
+			{
+				model->SetAnimationClip("run", 1e4f);
+			}
+
+			for (uint32_t j = 2; j < layerCount; ++j)
+			{
+				model->SetAdditiveClip(clipNames[j], 0.5f);
+			}
+		}
+
+		auto update = [&]()
+		{
+			timer.Tick();
+
+			if (pool)
+			{
+				pool->ParallelFor(models.size(), [&](uint32_t i)
+				{
+					models[i]->Update(&timer);
+				});
+			}
+			else
+			{
+				for (auto& model : models)
+				{
+					model->Update(&timer);
+				}
+			}
+		};
+
+		// Arenas and pose buffers grow to their peak in the first frames
+		for (uint32_t frame = 0; frame < 10; ++frame)
+		{
+			update();
+		}
+
+		uint64_t allocationCount = gAllocationCount;
+		Carol::Stopwatch stopwatch;
+
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			update();
+		}
+
+		double milliseconds = stopwatch.Milliseconds() / FRAME_COUNT;
+		double allocations = double(gAllocationCount - allocationCount) / FRAME_COUNT;
+		singleLayerMilliseconds = layerCount == 1 ? milliseconds : singleLayerMilliseconds;
+
+		std::printf("%u layers %8.3f ms/frame %6.2fx single layer cost %6.1f allocations/frame\n",
+			layerCount, milliseconds, milliseconds / singleLayerMilliseconds, allocations);
+	}
+
+	return 0;
+}
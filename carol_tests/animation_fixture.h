@@ -0,0 +1,41 @@
+#pragma once
+#include <scene/skinned_animation.h>
+#include <cmath>
+#include <random>
+
+namespace Carol
+{
+	// Mocap-like clip with a key on every track at keyRate. Every 4th bone holds still, the others sway
+	// with their own phase plus some noise, and scales stay at 1 as they do in most rigs.
+	inline AnimationClip BuildTestClip(uint32_t boneCount, float duration, float keyRate, uint32_t seed = 0)
+	{
+		AnimationClip clip;
+		clip.BoneAnimations.resize(boneCount);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> phase(0.f, 6.28f);
+		std::uniform_real_distribution<float> noise(-1e-3f, 1e-3f);
+
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			auto& bone = clip.BoneAnimations[i];
+			float p = phase(random);
+			float amplitude = i % 4 == 0 ? 0.f : 1.f;
+
+			for (uint32_t k = 0; k <= duration * keyRate; ++k)
+			{
+				float t = k / keyRate;
+				float angle = amplitude * std::sin(t + p);
+				DirectX::XMFLOAT4 q;
+				DirectX::XMStoreFloat4(&q, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f), angle));
+
+				bone.TranslationKeyframes.push_back({ t, { amplitude * (std::sin(t * 2.f + p) + noise(random)), 1.f, 0.f } });
+				bone.ScaleKeyframes.push_back({ t, { 1.f, 1.f, 1.f } });
+				bone.RotationQuatKeyframes.push_back({ t, q });
+			}
+		}
+
+		clip.CalcClipStartTime();
+		clip.CalcClipEndTime();
+		return clip;
+	}
+}
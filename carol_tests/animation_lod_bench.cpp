@@ -0,0 +1,93 @@
+#include "animation_fixture.h"
+#include "model_fixture.h"
+#include "test.h"
+#include <scene/timer.h>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 100;
+	constexpr uint32_t FRAME_COUNT = 200;
+}
+
+// carol-animation-lod-bench [character count]
+// Crowd spread out in depth, screen sizes fall off with distance. Compares updating every character at full rate
+// against the update-rate LOD without and with a bone budget, on one thread.
+int main(int argc, char** argv)
+{
+	uint32_t characterCount = argc > 1 ? std::atoi(argv[1]) : 500;
+
+	auto skeleton = Carol::BuildTestSkeleton(BONE_COUNT);
+	std::shared_ptr<const Carol::CompressedAnimationClip> clip = std::make_shared<Carol::CompressedAnimationClip>(Carol::BuildTestClip(BONE_COUNT, 10.f, 30.f));
+	std::vector<std::unique_ptr<Carol::TestModel>> models;
+	std::vector<std::pair<float, Carol::Model*>> crowd;
+	std::vector<std::pair<float, Carol::Model*>> requests;
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> distance(2.f, 200.f);
+
+	for (uint32_t i = 0; i < characterCount; ++i)
+	{
+		auto& model = models.emplace_back(std::make_unique<Carol::TestModel>(skeleton));
+		model->AddAnimationClip("clip", clip);
+		model->SetAnimationClip("clip");
+		crowd.emplace_back(1.f / distance(random), model.get());
+	}
+
+	Carol::Timer timer;
+	timer.Reset();
+
+	auto run = [&](const char* name, std::span<const std::pair<float, Carol::Model*>> screenSizes, const Carol::AnimationLodSettings& settings)
+	{
+		uint64_t evaluatedBones = 0;
+
+		auto update = [&]()
+		{
+			Carol::ScheduleAnimations(screenSizes, settings, requests);
+			timer.Tick();
+
+			for (auto& model : models)
+			{
+				model->Update(&timer);
+				evaluatedBones += model->GetFramesSinceEvaluation() == 1 ? model->GetBoneCount() : 0;
+			}
+		};
+
+		for (uint32_t frame = 0; frame < 10; ++frame)
+		{
+			update();
+		}
+
+		evaluatedBones = 0;
+		Carol::Stopwatch stopwatch;
+
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			update();
+		}
+
+		double milliseconds = stopwatch.Milliseconds() / FRAME_COUNT;
+		std::printf("%-12s %8.3f ms/frame %10.0f bones evaluated/frame\n", name, milliseconds, double(evaluatedBones) / FRAME_COUNT);
+	};
+
+	std::vector<std::pair<float, Carol::Model*>> nearCrowd(crowd);
+
+	for (auto& [screenSize, model] : nearCrowd)
+	{
+		screenSize = 1.f;
+	}
+
+	Carol::AnimationLodSettings unbudgeted;
+	unbudgeted.BoneBudget = std::numeric_limits<uint32_t>::max();
+	// Below what the LOD alone evaluates for the default crowd, so the budget is what bounds the cost
+	Carol::AnimationLodSettings budgeted;
+	budgeted.BoneBudget = 4096;
+
+	std::printf("%u characters, %u bones, budget %u bones\n", characterCount, BONE_COUNT, budgeted.BoneBudget);
+	run("full rate", nearCrowd, unbudgeted);
+	run("lod", crowd, unbudgeted);
+	run("lod budget", crowd, budgeted);
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include "animation_fixture.h"
+#include "model_fixture.h"
+#include "test.h"
+#include <scene/timer.h>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 20;
+
+	// Lets the clock move so each frame samples a new time
+	void Tick(Carol::Timer& timer)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		timer.Tick();
+	}
+
+	bool IsSamePose(std::span<const DirectX::XMFLOAT4X4> pose0, std::span<const DirectX::XMFLOAT4X4> pose1)
+	{
+		return pose0.size() == pose1.size() && std::memcmp(pose0.data(), pose1.data(), pose0.size_bytes()) == 0;
+	}
+
+	// Evaluated this frame when the counter restarted
+	bool IsEvaluated(const Carol::Model& model)
+	{
+		return model.GetFramesSinceEvaluation() == 1;
+	}
+}
+
+int main()
+{
+	auto skeleton = Carol::BuildTestSkeleton(BONE_COUNT);
+	std::shared_ptr<const Carol::CompressedAnimationClip> clip = std::make_shared<Carol::CompressedAnimationClip>(Carol::BuildTestClip(BONE_COUNT, 10.f, 30.f));
+
+	auto createModel = [&]()
+	{
+		auto model = std::make_unique<Carol::TestModel>(skeleton);
+		model->AddAnimationClip("clip", clip);
+		model->SetAnimationClip("clip");
+		return model;
+	};
+
+	Carol::Timer timer;
+	timer.Reset();
+	Tick(timer);
+
+	// Every 4th frame evaluates a key pose, the frames between are interpolated rather than held
+	{
+		auto model = createModel();
+		model->SetAnimationUpdatePeriod(4);
+		std::vector<DirectX::XMFLOAT4X4> lastPose;
+
+		for (uint32_t frame = 0; frame < 16; ++frame)
+		{
+			bool due = model->IsPoseDue();
+			Tick(timer);
+			model->Update(&timer);
+
+			CAROL_CHECK(due == (frame % 4 == 0));
+			CAROL_CHECK(IsEvaluated(*model) == (frame % 4 == 0));
+			CAROL_CHECK(frame == 0 || !IsSamePose(lastPose, model->GetFinalTransforms()));
+			lastPose.assign(model->GetFinalTransforms().begin(), model->GetFinalTransforms().end());
+		}
+	}
+
+	// Every 2nd frame at half rate
+	{
+		auto model = createModel();
+		model->SetAnimationUpdatePeriod(2);
+
+		for (uint32_t frame = 0; frame < 8; ++frame)
+		{
+			Tick(timer);
+			model->Update(&timer);
+			CAROL_CHECK(IsEvaluated(*model) == (frame % 2 == 0));
+		}
+	}
+
+	// Frozen models keep their first pose however far the clip moves on
+	{
+		auto model = createModel();
+		model->SetAnimationUpdatePeriod(0);
+		Tick(timer);
+		model->Update(&timer);
+		std::vector<DirectX::XMFLOAT4X4> frozenPose(model->GetFinalTransforms().begin(), model->GetFinalTransforms().end());
+
+		for (uint32_t frame = 0; frame < 8; ++frame)
+		{
+			CAROL_CHECK(!model->IsPoseDue());
+			Tick(timer);
+			model->Update(&timer);
+			CAROL_CHECK(IsSamePose(frozenPose, model->GetFinalTransforms()));
+		}
+	}
+
+	// Deferred poses hold the key pose for a frame and are evaluated once the deferral ends
+	{
+		auto model = createModel();
+		model->SetAnimationUpdatePeriod(2);
+
+		for (uint32_t frame = 0; frame < 2; ++frame)
+		{
+			Tick(timer);
+			model->Update(&timer);
+		}
+
+		CAROL_CHECK(model->IsPoseDue());
+		model->DeferPoseEvaluation();
+		Tick(timer);
+		model->Update(&timer);
+		CAROL_CHECK(model->GetFramesSinceEvaluation() == 3);
+
+		CAROL_CHECK(model->IsPoseDue());
+		Tick(timer);
+		model->Update(&timer);
+		CAROL_CHECK(IsEvaluated(*model));
+	}
+
+	Carol::AnimationLodSettings settings;
+	std::vector<std::pair<float, Carol::Model*>> requests;
+
+	// Screen sizes pick the period, one size inside each band
+	{
+		float screenSizes[] = { 0.5f, 0.15f, 0.05f, 0.005f };
+		uint32_t expectedEvaluations[] = { 8, 4, 2, 1 };
+		std::vector<std::unique_ptr<Carol::TestModel>> models;
+		std::vector<std::pair<float, Carol::Model*>> scheduledModels;
+
+		for (float screenSize : screenSizes)
+		{
+			scheduledModels.emplace_back(screenSize, models.emplace_back(createModel()).get());
+		}
+
+		std::vector<uint32_t> evaluations(models.size());
+
+		for (uint32_t frame = 0; frame < 8; ++frame)
+		{
+			Carol::ScheduleAnimations(scheduledModels, settings, requests);
+			Tick(timer);
+
+			for (uint32_t i = 0; i < models.size(); ++i)
+			{
+				models[i]->Update(&timer);
+				evaluations[i] += IsEvaluated(*models[i]);
+			}
+		}
+
+		for (uint32_t i = 0; i < models.size(); ++i)
+		{
+			CAROL_CHECK(evaluations[i] == expectedEvaluations[i]);
+		}
+	}
+
+	// A crowd at full rate evaluates no more bones per frame than the budget, and staleness lets every model in eventually
+	uint32_t maxEvaluatedBones = 0;
+	uint32_t maxFramesSinceEvaluation = 0;
+
+	{
+		constexpr uint32_t CROWD_SIZE = 200;
+		settings.BoneBudget = 50 * BONE_COUNT;
+
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> screenSize(settings.HalfRateScreenSize, 1.f);
+		std::vector<std::unique_ptr<Carol::TestModel>> models;
+		std::vector<std::pair<float, Carol::Model*>> scheduledModels;
+
+		for (uint32_t i = 0; i < CROWD_SIZE; ++i)
+		{
+			scheduledModels.emplace_back(screenSize(random), models.emplace_back(createModel()).get());
+		}
+
+		for (uint32_t frame = 0; frame < 40; ++frame)
+		{
+			Carol::ScheduleAnimations(scheduledModels, settings, requests);
+			Tick(timer);
+			uint32_t evaluatedBones = 0;
+
+			for (auto& model : models)
+			{
+				model->Update(&timer);
+				evaluatedBones += IsEvaluated(*model) ? model->GetBoneCount() : 0;
+				maxFramesSinceEvaluation = std::max(maxFramesSinceEvaluation, model->GetFramesSinceEvaluation());
+			}
+
+			// Models without a key pose yet are evaluated regardless of the budget
+			if (frame > 0)
+			{
+				CAROL_CHECK(evaluatedBones == settings.BoneBudget);
+				maxEvaluatedBones = std::max(maxEvaluatedBones, evaluatedBones);
+			}
+		}
+
+		CAROL_CHECK(maxFramesSinceEvaluation < 40);
+	}
+
+	std::printf("animation-lod-test: %u of %u budgeted bones per frame, %u frames max between evaluations, %d failed checks\n",
+		maxEvaluatedBones, settings.BoneBudget, maxFramesSinceEvaluation, gFailedChecks);
+	return gFailedChecks;
+}
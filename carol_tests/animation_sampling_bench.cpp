@@ -0,0 +1,146 @@
+#include "animation_fixture.h"
+#include "test.h"
+#include <scene/skinned_animation.h>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t CHARACTER_COUNT = 200;
+	constexpr uint32_t BONE_COUNT = 100;
+	constexpr uint32_t FRAME_COUNT = 60;
+	constexpr float KEY_RATE = 30.f;
+	constexpr float CLIP_DURATION = 60.f;
+
+	// Segment lookup as it was before cursors, a scan from the first key on every call
+	template<typename Keyframe>
+	uint32_t ScanKeyframes(const std::vector<Keyframe>& keyframes, float t)
+	{
+		for (uint32_t i = 0; i + 1 < keyframes.size(); ++i)
+		{
+			if (t >= keyframes[i].TimePos && t <= keyframes[i + 1].TimePos)
+			{
+				return i;
+			}
+		}
+
+		return keyframes.size() - 2;
+	}
+
+	template<typename Keyframe>
+	float GetLerpFactor(const std::vector<Keyframe>& keyframes, uint32_t i, float t)
+	{
+		return std::fmin(std::fmax((t - keyframes[i].TimePos) / (keyframes[i + 1].TimePos - keyframes[i].TimePos), 0.f), 1.f);
+	}
+
+	void ScanInterpolate(const Carol::AnimationClip& clip, float t, std::vector<DirectX::XMFLOAT4X4>& boneTransforms)
+	{
+		for (int i = 0; i < boneTransforms.size(); ++i)
+		{
+			auto& bone = clip.BoneAnimations[i];
+			uint32_t ti = ScanKeyframes(bone.TranslationKeyframes, t);
+			uint32_t si = ScanKeyframes(bone.ScaleKeyframes, t);
+			uint32_t ri = ScanKeyframes(bone.RotationQuatKeyframes, t);
+
+			DirectX::XMVECTOR T = DirectX::XMVectorLerp(
+				DirectX::XMLoadFloat3(&bone.TranslationKeyframes[ti].Translation),
+				DirectX::XMLoadFloat3(&bone.TranslationKeyframes[ti + 1].Translation),
+				GetLerpFactor(bone.TranslationKeyframes, ti, t));
+			DirectX::XMVECTOR S = DirectX::XMVectorLerp(
+				DirectX::XMLoadFloat3(&bone.ScaleKeyframes[si].Scale),
+				DirectX::XMLoadFloat3(&bone.ScaleKeyframes[si + 1].Scale),
+				GetLerpFactor(bone.ScaleKeyframes, si, t));
+			DirectX::XMVECTOR Q = DirectX::XMQuaternionSlerp(
+				DirectX::XMLoadFloat4(&bone.RotationQuatKeyframes[ri].RotationQuat),
+				DirectX::XMLoadFloat4(&bone.RotationQuatKeyframes[ri + 1].RotationQuat),
+				GetLerpFactor(bone.RotationQuatKeyframes, ri, t));
+
+			DirectX::XMStoreFloat4x4(&boneTransforms[i], DirectX::XMMatrixAffineTransformation(S, DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), Q, T));
+		}
+	}
+
+	bool IsNear(const DirectX::XMFLOAT4X4& m0, const DirectX::XMFLOAT4X4& m1)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				if (std::fabs(m0.m[i][j] - m1.m[i][j]) > 1e-5f)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+// carol-animation-sampling-bench
+// Samples 200 characters with 100-bone skeletons playing a 60 s clip keyed at 30 Hz, each from its own start time
+int main()
+{
+	auto clip = Carol::BuildTestClip(BONE_COUNT, CLIP_DURATION, KEY_RATE);
+	std::vector<float> startTimes(CHARACTER_COUNT);
+	std::vector<Carol::AnimationCursor> cursors(CHARACTER_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> transforms(BONE_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> seekTransforms(BONE_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> referenceTransforms(BONE_COUNT);
+
+	for (uint32_t i = 0; i < CHARACTER_COUNT; ++i)
+	{
+		startTimes[i] = CLIP_DURATION * i / CHARACTER_COUNT;
+	}
+
+	auto getTime = [&](uint32_t character, uint32_t frame)
+	{
+		return std::fmod(startTimes[character] + frame / 60.f, CLIP_DURATION);
+	};
+
+	// Playback through cursors, a seek with a fresh cursor and the former scan have to agree
+	for (uint32_t frame = 0; frame < FRAME_COUNT; frame += 7)
+	{
+		for (uint32_t i = 0; i < CHARACTER_COUNT; i += 13)
+		{
+			float t = getTime(i, frame);
+			clip.Interpolate(t, cursors[i], transforms);
+			clip.Interpolate(t, seekTransforms);
+			ScanInterpolate(clip, t, referenceTransforms);
+
+			for (uint32_t b = 0; b < BONE_COUNT; ++b)
+			{
+				if (!IsNear(transforms[b], referenceTransforms[b]) || !IsNear(seekTransforms[b], referenceTransforms[b]))
+				{
+					std::fprintf(stderr, "carol-animation-sampling-bench: character %u bone %u differs at %f s\n", i, b, t);
+					return 1;
+				}
+			}
+		}
+	}
+
+	auto run = [&](const char* name, auto&& sample)
+	{
+		Carol::Stopwatch stopwatch;
+
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			for (uint32_t i = 0; i < CHARACTER_COUNT; ++i)
+			{
+				sample(i, getTime(i, frame));
+			}
+		}
+
+		double milliseconds = stopwatch.Milliseconds() / FRAME_COUNT;
+		std::printf("%-8s %8.3f ms/frame %8.1f ns/bone\n", name, milliseconds, milliseconds * 1e6 / (CHARACTER_COUNT * BONE_COUNT));
+		return milliseconds;
+	};
+
+	std::printf("%u characters, %u bones, %u keys per track, %u frames\n", CHARACTER_COUNT, BONE_COUNT, uint32_t(CLIP_DURATION * KEY_RATE) + 1, FRAME_COUNT);
+
+	double scan = run("scan", [&](uint32_t i, float t) { ScanInterpolate(clip, t, transforms); });
+	double seek = run("seek", [&](uint32_t i, float t) { clip.Interpolate(t, transforms); });
+	double cursor = run("cursor", [&](uint32_t i, float t) { clip.Interpolate(t, cursors[i], transforms); });
+
+	std::printf("cursor is %.1fx faster than scan, %.1fx faster than seek\n", scan / cursor, seek / cursor);
+	return 0;
+}
@@ -0,0 +1,272 @@
+#include "test.h"
+#include <scene/bone_palette.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 64;
+	constexpr uint32_t VERTEX_COUNT = 4096;
+
+	class Float3
+	{
+	public:
+		float x = 0.f, y = 0.f, z = 0.f;
+	};
+
+	Float3 operator+(Float3 a, Float3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	Float3 operator-(Float3 a, Float3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Float3 operator*(float s, Float3 a) { return { s * a.x, s * a.y, s * a.z }; }
+	float Dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	float Length(Float3 a) { return std::sqrt(Dot(a, a)); }
+	Float3 Cross(Float3 a, Float3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+	// Bone transforms along with the rotations and translations they were built from
+	class Pose
+	{
+	public:
+		std::vector<DirectX::XMFLOAT4X4> Transforms;
+		std::vector<DirectX::XMFLOAT4> Rotations;
+		std::vector<DirectX::XMFLOAT3> Translations;
+	};
+
+	class Vertex
+	{
+	public:
+		Float3 Position;
+		Float3 Normal;
+		uint32_t BoneIndices[4];
+		float Weights[4];
+	};
+
+	// Reference linear blend skinning with the full row vector matrices
+	Float3 SkinReference(std::span<const DirectX::XMFLOAT4X4> transforms, const Vertex& v, Float3 p, float w)
+	{
+		Float3 result;
+
+		for (int i = 0; i < 4; ++i)
+		{
+			auto& M = transforms[v.BoneIndices[i]];
+			Float3 row = {
+				p.x * M._11 + p.y * M._21 + p.z * M._31 + w * M._41,
+				p.x * M._12 + p.y * M._22 + p.z * M._32 + w * M._42,
+				p.x * M._13 + p.y * M._23 + p.z * M._33 + w * M._43 };
+			result = result + v.Weights[i] * row;
+		}
+
+		return result;
+	}
+
+	// Reference dual quaternion skinning, blending the rotations and translations the bones were built from
+	Float3 SkinDualQuaternionReference(const Pose& pose, const Vertex& v, Float3 p, float w)
+	{
+		DirectX::XMVECTOR real = DirectX::XMVectorZero();
+		DirectX::XMVECTOR dual = DirectX::XMVectorZero();
+		DirectX::XMVECTOR pivot = DirectX::XMVectorZero();
+
+		for (int i = 0; i < 4; ++i)
+		{
+			DirectX::XMVECTOR Q = DirectX::XMLoadFloat4(&pose.Rotations[v.BoneIndices[i]]);
+			DirectX::XMVECTOR T = DirectX::XMLoadFloat3(&pose.Translations[v.BoneIndices[i]]);
+
+			// dual = 0.5 * t * real with t as a pure quaternion
+			DirectX::XMVECTOR D = DirectX::XMVectorScale(DirectX::XMQuaternionMultiply(Q, DirectX::XMVectorSetW(T, 0.f)), 0.5f);
+			pivot = i == 0 ? Q : pivot;
+			float weight = DirectX::XMVectorGetX(DirectX::XMQuaternionDot(Q, pivot)) < 0.f ? -v.Weights[i] : v.Weights[i];
+
+			real = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(weight), Q, real);
+			dual = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorReplicate(weight), D, dual);
+		}
+
+		float length = DirectX::XMVectorGetX(DirectX::XMVector4Length(real));
+		real = DirectX::XMVectorScale(real, 1.f / length);
+		dual = DirectX::XMVectorScale(dual, 1.f / length);
+
+		// t = 2 * dual * conjugate(real)
+		DirectX::XMVECTOR T = DirectX::XMVectorScale(DirectX::XMQuaternionMultiply(DirectX::XMQuaternionConjugate(real), dual), 2.f);
+		DirectX::XMVECTOR P = DirectX::XMVector3Rotate(DirectX::XMVectorSet(p.x, p.y, p.z, 0.f), real);
+		P = w == 0.f ? P : DirectX::XMVectorAdd(P, T);
+
+		return { DirectX::XMVectorGetX(P), DirectX::XMVectorGetY(P), DirectX::XMVectorGetZ(P) };
+	}
+
+	// BlendBoneMatrices and mul(skin, float4(p, w)) of mesh.hlsli
+	Float3 SkinMatrix(std::span<const DirectX::XMFLOAT4> palette, const Vertex& v, Float3 p, float w)
+	{
+		float skin[3][4] = {};
+
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				auto& row = palette[v.BoneIndices[i] * 3 + j];
+				skin[j][0] += v.Weights[i] * row.x;
+				skin[j][1] += v.Weights[i] * row.y;
+				skin[j][2] += v.Weights[i] * row.z;
+				skin[j][3] += v.Weights[i] * row.w;
+			}
+		}
+
+		return {
+			skin[0][0] * p.x + skin[0][1] * p.y + skin[0][2] * p.z + skin[0][3] * w,
+			skin[1][0] * p.x + skin[1][1] * p.y + skin[1][2] * p.z + skin[1][3] * w,
+			skin[2][0] * p.x + skin[2][1] * p.y + skin[2][2] * p.z + skin[2][3] * w };
+	}
+
+	// BlendBoneDualQuaternions, QuaternionRotate and DualQuaternionTranslation of mesh.hlsli
+	Float3 SkinDualQuaternion(std::span<const DirectX::XMFLOAT4> palette, const Vertex& v, Float3 p, float w)
+	{
+		auto& pivot = palette[v.BoneIndices[0] * 2];
+		float real[4] = {};
+		float dual[4] = {};
+
+		for (int i = 0; i < 4; ++i)
+		{
+			auto& boneReal = palette[v.BoneIndices[i] * 2];
+			auto& boneDual = palette[v.BoneIndices[i] * 2 + 1];
+			float dot = boneReal.x * pivot.x + boneReal.y * pivot.y + boneReal.z * pivot.z + boneReal.w * pivot.w;
+			float weight = dot < 0.f ? -v.Weights[i] : v.Weights[i];
+
+			real[0] += weight * boneReal.x; real[1] += weight * boneReal.y; real[2] += weight * boneReal.z; real[3] += weight * boneReal.w;
+			dual[0] += weight * boneDual.x; dual[1] += weight * boneDual.y; dual[2] += weight * boneDual.z; dual[3] += weight * boneDual.w;
+		}
+
+		float invLength = 1.f / std::sqrt(real[0] * real[0] + real[1] * real[1] + real[2] * real[2] + real[3] * real[3]);
+
+		for (int i = 0; i < 4; ++i)
+		{
+			real[i] *= invLength;
+			dual[i] *= invLength;
+		}
+
+		Float3 qv = { real[0], real[1], real[2] };
+		Float3 dv = { dual[0], dual[1], dual[2] };
+		Float3 rotated = p + 2.f * Cross(qv, Cross(qv, p) + real[3] * p);
+		Float3 translation = 2.f * (real[3] * dv - dual[3] * qv + Cross(qv, dv));
+
+		return w == 0.f ? rotated : rotated + translation;
+	}
+
+	// Neighboring bones differ by at most maxAngle from a shared random rotation, any angle up to a half turn,
+	// so packing runs through every branch of the quaternion extraction and gives antipodal neighbors
+	Pose BuildPose(std::mt19937& random, float maxAngle, float scale)
+	{
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+		Pose pose;
+		pose.Transforms.resize(BONE_COUNT);
+		pose.Rotations.resize(BONE_COUNT);
+		pose.Translations.resize(BONE_COUNT);
+
+		auto randomAxis = [&]()
+		{
+			return DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(random), unit(random), unit(random) + 1e-3f, 0.f));
+		};
+
+		DirectX::XMVECTOR base = DirectX::XMQuaternionIdentity();
+
+		for (uint32_t i = 0; i < BONE_COUNT; ++i)
+		{
+			if (i % 8 == 0)
+			{
+				base = DirectX::XMQuaternionRotationAxis(randomAxis(), DirectX::XM_PI * (0.5f + 0.5f * unit(random)));
+			}
+
+			DirectX::XMVECTOR Q = DirectX::XMQuaternionMultiply(base, DirectX::XMQuaternionRotationAxis(randomAxis(), maxAngle * unit(random)));
+			DirectX::XMVECTOR T = DirectX::XMVectorSet(unit(random), unit(random), unit(random), 0.f);
+			DirectX::XMVECTOR S = DirectX::XMVectorReplicate(scale);
+			DirectX::XMStoreFloat4x4(&pose.Transforms[i], DirectX::XMMatrixAffineTransformation(S, DirectX::XMVectorSet(0.f, 0.f, 0.f, 1.f), Q, T));
+			DirectX::XMStoreFloat4(&pose.Rotations[i], Q);
+			DirectX::XMStoreFloat3(&pose.Translations[i], T);
+		}
+
+		return pose;
+	}
+
+	// Influences stay within a group of 8 bones sharing the same base rotation, as they do along a limb
+	std::vector<Vertex> BuildVertices(std::mt19937& random, bool singleBone)
+	{
+		std::uniform_real_distribution<float> unit(-1.f, 1.f);
+		std::uniform_int_distribution<uint32_t> bone(0, 7);
+		std::vector<Vertex> vertices(VERTEX_COUNT);
+
+		for (auto& v : vertices)
+		{
+			v.Position = { unit(random), unit(random), unit(random) };
+			v.Normal = (1.f / Length(v.Position)) * v.Position;
+
+			uint32_t group = bone(random) * 8;
+			float total = 0.f;
+
+			for (int i = 0; i < 4; ++i)
+			{
+				v.BoneIndices[i] = group + bone(random);
+				v.Weights[i] = singleBone ? (i == 0 ? 1.f : 0.f) : unit(random) * 0.5f + 0.5f;
+				total += v.Weights[i];
+			}
+
+			for (auto& weight : v.Weights)
+			{
+				weight /= total;
+			}
+		}
+
+		return vertices;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(35);
+	std::vector<DirectX::XMFLOAT4> matrixPalette(BONE_COUNT * Carol::GetBonePaletteStride(Carol::BONE_PALETTE_MATRIX));
+	std::vector<DirectX::XMFLOAT4> dualQuaternionPalette(BONE_COUNT * Carol::GetBonePaletteStride(Carol::BONE_PALETTE_DUAL_QUATERNION));
+
+	CAROL_CHECK(Carol::GetBonePaletteStride(Carol::BONE_PALETTE_MATRIX) == 3);
+	CAROL_CHECK(Carol::GetBonePaletteStride(Carol::BONE_PALETTE_DUAL_QUATERNION) == 2);
+
+	// Dual quaternions cannot hold scale, models fall back to matrices for such poses
+	CAROL_CHECK(!Carol::IsRigidBonePalette(BuildPose(random, 0.f, 1.1f).Transforms));
+
+	float maxMatrixError = 0.f;
+	float maxRigidError = 0.f;
+	float maxBlendError = 0.f;
+
+	for (int round = 0; round < 16; ++round)
+	{
+		auto pose = BuildPose(random, DirectX::XM_PI / 9.f, 1.f);
+		auto& transforms = pose.Transforms;
+		CAROL_CHECK(Carol::IsRigidBonePalette(transforms));
+
+		Carol::PackBonePalette(transforms, Carol::BONE_PALETTE_MATRIX, matrixPalette);
+		Carol::PackBonePalette(transforms, Carol::BONE_PALETTE_DUAL_QUATERNION, dualQuaternionPalette);
+
+		// 3x4 matrices drop only the constant last column, so they skin exactly like the full matrices
+		for (auto& v : BuildVertices(random, false))
+		{
+			maxMatrixError = std::fmax(maxMatrixError, Length(SkinMatrix(matrixPalette, v, v.Position, 1.f) - SkinReference(transforms, v, v.Position, 1.f)));
+			maxMatrixError = std::fmax(maxMatrixError, Length(SkinMatrix(matrixPalette, v, v.Normal, 0.f) - SkinReference(transforms, v, v.Normal, 0.f)));
+		}
+
+		// A single rigid bone is the same transform in both forms
+		for (auto& v : BuildVertices(random, true))
+		{
+			maxRigidError = std::fmax(maxRigidError, Length(SkinDualQuaternion(dualQuaternionPalette, v, v.Position, 1.f) - SkinReference(transforms, v, v.Position, 1.f)));
+			maxRigidError = std::fmax(maxRigidError, Length(SkinDualQuaternion(dualQuaternionPalette, v, v.Normal, 0.f) - SkinReference(transforms, v, v.Normal, 0.f)));
+		}
+
+		// Blended dual quaternions have to match the reference blend whatever sign packing gave each rotation
+		for (auto& v : BuildVertices(random, false))
+		{
+			maxBlendError = std::fmax(maxBlendError, Length(SkinDualQuaternion(dualQuaternionPalette, v, v.Position, 1.f) - SkinDualQuaternionReference(pose, v, v.Position, 1.f)));
+			maxBlendError = std::fmax(maxBlendError, Length(SkinDualQuaternion(dualQuaternionPalette, v, v.Normal, 0.f) - SkinDualQuaternionReference(pose, v, v.Normal, 0.f)));
+		}
+	}
+
+	CAROL_CHECK(maxMatrixError < 1e-5f);
+	CAROL_CHECK(maxRigidError < 1e-4f);
+	CAROL_CHECK(maxBlendError < 1e-4f);
+
+	std::printf("bone-palette-test: 3x4 error %g, rigid dual quaternion error %g, blended dual quaternion error %g, %d failed checks\n",
+		maxMatrixError, maxRigidError, maxBlendError, gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,288 @@
+#include "test.h"
+#include <scene/cluster.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+#include <span>
+#include <vector>
+
+namespace
+{
+	// Rolling height field over a grid of quads split into two triangles each
+	void BuildGrid(uint32_t size, std::vector<DirectX::XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t y = 0; y <= size; ++y)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+			{
+				float height = 2.f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+				positions.push_back({ float(x), height, float(y) });
+			}
+		}
+
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				uint32_t v = y * (size + 1) + x;
+				indices.insert(indices.end(), { v, v + size + 1, v + 1 });
+				indices.insert(indices.end(), { v + 1, v + size + 1, v + size + 2 });
+			}
+		}
+	}
+
+	bool Contains(const DirectX::BoundingSphere& outer, const DirectX::BoundingSphere& inner)
+	{
+		float dx = inner.Center.x - outer.Center.x;
+		float dy = inner.Center.y - outer.Center.y;
+		float dz = inner.Center.z - outer.Center.z;
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+		return distance + inner.Radius <= outer.Radius * 1.0001f + 1e-4f;
+	}
+
+	bool IsSameSphere(const DirectX::BoundingSphere& s0, const DirectX::BoundingSphere& s1)
+	{
+		return std::memcmp(&s0.Center, &s1.Center, sizeof(s0.Center)) == 0 && s0.Radius == s1.Radius;
+	}
+
+	bool IsSameCluster(const Carol::Cluster& c0, const Carol::Cluster& c1)
+	{
+		return c0.Indices == c1.Indices
+			&& c0.Level == c1.Level
+			&& c0.LodError == c1.LodError
+			&& c0.ParentLodError == c1.ParentLodError
+			&& IsSameSphere(c0.LodBounds, c1.LodBounds)
+			&& IsSameSphere(c0.ParentLodBounds, c1.ParentLodBounds);
+	}
+
+	// Error over the distance to the nearest point of the bounds, an eye inside them sees the error unscaled
+	float GetProjectedError(const DirectX::BoundingSphere& bounds, float error, const DirectX::XMFLOAT3& eyePos)
+	{
+		if (error == FLT_MAX)
+		{
+			return FLT_MAX;
+		}
+
+		float dx = bounds.Center.x - eyePos.x;
+		float dy = bounds.Center.y - eyePos.y;
+		float dz = bounds.Center.z - eyePos.z;
+		float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.Radius;
+
+		return error / std::fmax(distance, 1.f);
+	}
+
+	// The cut the renderer selects per cluster: fine enough itself, while the group simplifying it is not
+	std::vector<uint32_t> SelectCut(std::span<const Carol::Cluster> clusters, const DirectX::XMFLOAT3& eyePos, float threshold)
+	{
+		std::vector<uint32_t> cut;
+
+		for (int i = 0; i < clusters.size(); ++i)
+		{
+			if (GetProjectedError(clusters[i].LodBounds, clusters[i].LodError, eyePos) <= threshold
+				&& GetProjectedError(clusters[i].ParentLodBounds, clusters[i].ParentLodError, eyePos) > threshold)
+			{
+				cut.push_back(i);
+			}
+		}
+
+		return cut;
+	}
+
+	float Cross(float x0, float z0, float x1, float z1)
+	{
+		return x0 * z1 - z0 * x1;
+	}
+
+	// Sum of the orientations of the triangles whose projection onto the grid plane holds (x, z). A cover without
+	// holes or overlaps winds once around every point, folds add as many turns one way as the other.
+	int GetWindingNumber(
+		std::span<const DirectX::XMFLOAT3> positions,
+		std::span<const uint32_t> indices,
+		float x,
+		float z)
+	{
+		int winding = 0;
+
+		for (int i = 0; i < indices.size(); i += 3)
+		{
+			auto& p0 = positions[indices[i]];
+			auto& p1 = positions[indices[i + 1]];
+			auto& p2 = positions[indices[i + 2]];
+			float area = Cross(p1.x - p0.x, p1.z - p0.z, p2.x - p0.x, p2.z - p0.z);
+			float e0 = Cross(p1.x - p0.x, p1.z - p0.z, x - p0.x, z - p0.z);
+			float e1 = Cross(p2.x - p1.x, p2.z - p1.z, x - p1.x, z - p1.z);
+			float e2 = Cross(p0.x - p2.x, p0.z - p2.z, x - p2.x, z - p2.z);
+
+			if (area > 0.f && e0 > 0.f && e1 > 0.f && e2 > 0.f)
+			{
+				++winding;
+			}
+			else if (area < 0.f && e0 < 0.f && e1 < 0.f && e2 < 0.f)
+			{
+				--winding;
+			}
+		}
+
+		return winding;
+	}
+
+	bool IsOnGridBorder(const DirectX::XMFLOAT3& p0, const DirectX::XMFLOAT3& p1, uint32_t size)
+	{
+		return (p0.x == p1.x && (p0.x == 0.f || p0.x == size)) || (p0.z == p1.z && (p0.z == 0.f || p0.z == size));
+	}
+}
+
+int main()
+{
+	constexpr uint32_t gridSize = 48;
+	constexpr uint32_t maxVertices = 64;
+	constexpr uint32_t maxPrims = 126;
+
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	BuildGrid(gridSize, positions, indices);
+
+	Carol::ClusterDag dag(positions, indices, maxVertices, maxPrims);
+	auto& clusters = dag.GetClusters();
+
+	CAROL_CHECK(dag.GetLevelCount() > 2);
+
+	uint32_t leafTriCount = 0;
+
+	for (auto& cluster : clusters)
+	{
+		std::set<uint32_t> vertices(cluster.Indices.begin(), cluster.Indices.end());
+
+		CAROL_CHECK(!cluster.Indices.empty() && cluster.Indices.size() % 3 == 0);
+		CAROL_CHECK(cluster.Indices.size() / 3 <= maxPrims);
+		CAROL_CHECK(vertices.size() <= maxVertices);
+		CAROL_CHECK(cluster.Level < dag.GetLevelCount());
+
+		if (cluster.Level == 0)
+		{
+			leafTriCount += cluster.Indices.size() / 3;
+			CAROL_CHECK(cluster.LodError == 0.f);
+		}
+
+		// Selecting a cluster when its own error is small enough and its parent's is not must stay consistent
+		// between a cluster and its parents, so errors may only grow and bounds only widen towards the roots
+		CAROL_CHECK(cluster.LodError <= cluster.ParentLodError);
+
+		if (cluster.ParentLodError == FLT_MAX)
+		{
+			continue;
+		}
+
+		CAROL_CHECK(Contains(cluster.ParentLodBounds, cluster.LodBounds));
+
+		bool hasParent = false;
+
+		for (auto& parent : clusters)
+		{
+			if (parent.Level == cluster.Level + 1
+				&& parent.LodError == cluster.ParentLodError
+				&& IsSameSphere(parent.LodBounds, cluster.ParentLodBounds))
+			{
+				hasParent = true;
+				CAROL_CHECK(parent.LodError >= cluster.LodError);
+				CAROL_CHECK(Contains(parent.LodBounds, cluster.LodBounds));
+			}
+		}
+
+		CAROL_CHECK(hasParent);
+	}
+
+	CAROL_CHECK(leafTriCount == indices.size() / 3);
+
+	// Two builds of the same mesh must match exactly
+	Carol::ClusterDag rebuiltDag(positions, indices, maxVertices, maxPrims);
+	auto& rebuiltClusters = rebuiltDag.GetClusters();
+
+	CAROL_CHECK(rebuiltDag.GetLevelCount() == dag.GetLevelCount());
+	CAROL_CHECK(rebuiltClusters.size() == clusters.size());
+
+	for (int i = 0; i < clusters.size() && i < rebuiltClusters.size(); ++i)
+	{
+		CAROL_CHECK(IsSameCluster(clusters[i], rebuiltClusters[i]));
+	}
+
+	// Cuts seen from above a corner of the grid, from all leaves to the coarsest levels. Leaf triangles are sampled off
+	// their centroid, which the diagonal edges of simplified triangles can pass through.
+	const float thresholds[] = { 0.f, 3e-3f, 1e-2f, 3e-2f, 1e-1f, 3e-1f, 1.f };
+	DirectX::XMFLOAT3 eyePos = { -8.f, 12.f, -8.f };
+	size_t prevTriCount = SIZE_MAX;
+	uint32_t mixedCutCount = 0;
+
+	for (auto threshold : thresholds)
+	{
+		auto cut = SelectCut(clusters, eyePos, threshold);
+		std::vector<uint32_t> cutIndices;
+		std::set<uint32_t> cutLevels;
+
+		for (auto id : cut)
+		{
+			cutIndices.insert(cutIndices.end(), clusters[id].Indices.begin(), clusters[id].Indices.end());
+			cutLevels.insert(clusters[id].Level);
+		}
+
+		// Every leaf triangle is covered by exactly one triangle of the cut
+		uint32_t miscoveredCount = 0;
+
+		for (int i = 0; i < indices.size(); i += 3)
+		{
+			auto& p0 = positions[indices[i]];
+			auto& p1 = positions[indices[i + 1]];
+			auto& p2 = positions[indices[i + 2]];
+			float x = 0.31f * p0.x + 0.33f * p1.x + 0.36f * p2.x;
+			float z = 0.31f * p0.z + 0.33f * p1.z + 0.36f * p2.z;
+			int orientation = Cross(p1.x - p0.x, p1.z - p0.z, p2.x - p0.x, p2.z - p0.z) > 0.f ? 1 : -1;
+
+			miscoveredCount += GetWindingNumber(positions, cutIndices, x, z) != orientation;
+		}
+
+		// Clusters of the cut meet on the same vertices: every inner edge is walked once each way,
+		// a T-junction or a border vertex moved on one side only would leave an edge without its twin
+		std::map<std::pair<uint32_t, uint32_t>, int> edges;
+
+		for (int i = 0; i < cutIndices.size(); i += 3)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				++edges[{ cutIndices[i + j], cutIndices[i + (j + 1) % 3] }];
+			}
+		}
+
+		uint32_t crackCount = 0;
+
+		for (auto& [edge, count] : edges)
+		{
+			auto itr = edges.find({ edge.second, edge.first });
+			int twinCount = itr == edges.end() ? 0 : itr->second;
+
+			if (count != 1 || (twinCount != 1 && !(twinCount == 0 && IsOnGridBorder(positions[edge.first], positions[edge.second], gridSize))))
+			{
+				++crackCount;
+			}
+		}
+
+		std::printf("cut at %g: %zu clusters, %zu triangles over %zu levels\n", threshold, cut.size(), cutIndices.size() / 3, cutLevels.size());
+
+		CAROL_CHECK(miscoveredCount == 0);
+		CAROL_CHECK(crackCount == 0);
+		CAROL_CHECK(cutIndices.size() / 3 <= prevTriCount);
+
+		prevTriCount = cutIndices.size() / 3;
+		mixedCutCount += cutLevels.size() > 1;
+	}
+
+	CAROL_CHECK(SelectCut(clusters, eyePos, 0.f).size() == std::count_if(clusters.begin(), clusters.end(), [](const Carol::Cluster& cluster) { return cluster.Level == 0; }));
+	CAROL_CHECK(prevTriCount < indices.size() / 3);
+	CAROL_CHECK(mixedCutCount > 0);
+
+	std::printf("cluster-dag-test: %zu clusters over %u levels, %d failed checks\n", clusters.size(), dag.GetLevelCount(), gFailedChecks);
+	return gFailedChecks;
+}
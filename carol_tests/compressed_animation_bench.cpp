@@ -0,0 +1,94 @@
+#include "animation_fixture.h"
+#include "test.h"
+#include <scene/compressed_animation.h>
+#include <scene/pose.h>
+#include <scene/skinned_animation.h>
+#include <utils/frame_arena.h>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t CHARACTER_COUNT = 200;
+	constexpr uint32_t BONE_COUNT = 100;
+	constexpr uint32_t FRAME_COUNT = 120;
+	constexpr float KEY_RATE = 30.f;
+	constexpr float CLIP_DURATION = 60.f;
+
+	uint64_t GetRawSize(const Carol::AnimationClip& clip)
+	{
+		uint64_t size = 0;
+
+		for (auto& bone : clip.BoneAnimations)
+		{
+			size += bone.TranslationKeyframes.size() * sizeof(Carol::TranslationKeyframe);
+			size += bone.RotationQuatKeyframes.size() * sizeof(Carol::RotationQuatKeyframe);
+			size += bone.ScaleKeyframes.size() * sizeof(Carol::ScaleKeyframe);
+		}
+
+		return size;
+	}
+}
+
+// carol-compressed-animation-bench
+// Memory and sampling throughput of compressed clips against the raw keys they are built from,
+// 200 characters with 100-bone skeletons playing a 60 s clip keyed at 30 Hz
+int main()
+{
+	auto clip = Carol::BuildTestClip(BONE_COUNT, CLIP_DURATION, KEY_RATE);
+
+	Carol::Stopwatch compressStopwatch;
+	Carol::CompressedAnimationClip compressed(clip);
+	double compressMilliseconds = compressStopwatch.Milliseconds();
+
+	uint64_t rawSize = GetRawSize(clip);
+	uint64_t compressedSize = compressed.GetData().size();
+
+	std::printf("%u bones, %u keys per track\n", BONE_COUNT, uint32_t(CLIP_DURATION * KEY_RATE) + 1);
+	std::printf("raw        %10.1f KB\n", rawSize / 1024.0);
+	std::printf("compressed %10.1f KB  %.1fx smaller, compressed in %.1f ms\n", compressedSize / 1024.0, double(rawSize) / compressedSize, compressMilliseconds);
+
+	std::vector<Carol::AnimationCursor> rawCursors(CHARACTER_COUNT);
+	std::vector<Carol::AnimationCursor> cursors(CHARACTER_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> transforms(BONE_COUNT);
+	auto& arena = Carol::FrameArena::GetThreadArena();
+
+	auto run = [&](const char* name, auto&& sample)
+	{
+		Carol::Stopwatch stopwatch;
+
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			for (uint32_t i = 0; i < CHARACTER_COUNT; ++i)
+			{
+				sample(i, std::fmod(CLIP_DURATION * i / CHARACTER_COUNT + frame / 60.f, CLIP_DURATION));
+			}
+		}
+
+		double milliseconds = stopwatch.Milliseconds() / FRAME_COUNT;
+		std::printf("%-18s %8.3f ms/frame %8.1f ns/bone\n", name, milliseconds, milliseconds * 1e6 / (CHARACTER_COUNT * BONE_COUNT));
+		return milliseconds;
+	};
+
+	double raw = run("raw", [&](uint32_t i, float t)
+	{
+		clip.Interpolate(t, rawCursors[i], transforms);
+	});
+
+	double matrices = run("compressed", [&](uint32_t i, float t)
+	{
+		compressed.Interpolate(t, cursors[i], transforms);
+	});
+
+	// Blending reads the SoA local pose, so this is what layered playback pays per clip
+	double localPose = run("compressed soa", [&](uint32_t i, float t)
+	{
+		size_t marker = arena.GetMarker();
+		Carol::LocalPose pose(arena, BONE_COUNT);
+		compressed.Sample(t, cursors[i], pose);
+		arena.Rewind(marker);
+	});
+
+	std::printf("compressed sampling runs at %.2fx the raw rate, %.2fx into local poses\n", raw / matrices, raw / localPose);
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include "animation_fixture.h"
+#include "test.h"
+#include <scene/compressed_animation.h>
+#include <scene/skinned_animation.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 37;
+	constexpr float CLIP_DURATION = 5.f;
+	constexpr float KEY_RATE = 30.f;
+
+	uint64_t GetRawSize(const Carol::AnimationClip& clip)
+	{
+		uint64_t size = 0;
+
+		for (auto& bone : clip.BoneAnimations)
+		{
+			size += bone.TranslationKeyframes.size() * sizeof(Carol::TranslationKeyframe);
+			size += bone.RotationQuatKeyframes.size() * sizeof(Carol::RotationQuatKeyframe);
+			size += bone.ScaleKeyframes.size() * sizeof(Carol::ScaleKeyframe);
+		}
+
+		return size;
+	}
+
+	float GetTranslationError(const DirectX::XMFLOAT4X4& m0, const DirectX::XMFLOAT4X4& m1)
+	{
+		float dx = m0._41 - m1._41;
+		float dy = m0._42 - m1._42;
+		float dz = m0._43 - m1._43;
+		return std::sqrt(dx * dx + dy * dy + dz * dz);
+	}
+
+	// Largest difference between the rotated axes, about the rotation angle between the matrices
+	float GetRotationError(const DirectX::XMFLOAT4X4& m0, const DirectX::XMFLOAT4X4& m1)
+	{
+		float error = 0.f;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			float dx = m0.m[i][0] - m1.m[i][0];
+			float dy = m0.m[i][1] - m1.m[i][1];
+			float dz = m0.m[i][2] - m1.m[i][2];
+			error = std::fmax(error, std::sqrt(dx * dx + dy * dy + dz * dz));
+		}
+
+		return error;
+	}
+}
+
+int main()
+{
+	auto clip = Carol::BuildTestClip(BONE_COUNT, CLIP_DURATION, KEY_RATE, 32);
+	Carol::AnimationCompressionSettings settings;
+	settings.BlockDuration = 0.75f;
+	Carol::CompressedAnimationClip compressed(clip, settings);
+
+	CAROL_CHECK(compressed.GetBoneCount() == BONE_COUNT);
+	CAROL_CHECK(compressed.GetClipStartTime() == 0.f);
+	CAROL_CHECK(compressed.GetClipEndTime() == CLIP_DURATION);
+	CAROL_CHECK(compressed.GetData().size() * 4 < GetRawSize(clip));
+
+	// Samples between and on keys, across block bounds, have to stay within the tolerances of the settings.
+	// Quantization and nlerp against slerp between the kept keys add a little on top.
+	std::vector<DirectX::XMFLOAT4X4> rawTransforms(BONE_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> transforms(BONE_COUNT);
+	std::vector<DirectX::XMFLOAT4X4> seekTransforms(BONE_COUNT);
+	Carol::AnimationCursor rawCursor;
+	Carol::AnimationCursor cursor;
+	float maxTranslationError = 0.f;
+	float maxRotationError = 0.f;
+
+	for (float t = 0.f; t <= CLIP_DURATION; t += 1.f / 97.f)
+	{
+		clip.Interpolate(t, rawCursor, rawTransforms);
+		compressed.Interpolate(t, cursor, transforms);
+		compressed.Interpolate(t, seekTransforms);
+
+		for (uint32_t i = 0; i < BONE_COUNT; ++i)
+		{
+			maxTranslationError = std::fmax(maxTranslationError, GetTranslationError(rawTransforms[i], transforms[i]));
+			maxRotationError = std::fmax(maxRotationError, GetRotationError(rawTransforms[i], transforms[i]));
+		}
+
+		// Cursors only skip the search, the keys they find are the same
+		CAROL_CHECK(std::memcmp(transforms.data(), seekTransforms.data(), transforms.size() * sizeof(transforms[0])) == 0);
+	}
+
+	CAROL_CHECK(maxTranslationError <= settings.TranslationError * 2.f);
+	CAROL_CHECK(maxRotationError <= settings.RotationError * 4.f);
+
+	// Times outside the clip hold its first and last poses
+	compressed.Interpolate(-1.f, transforms);
+	compressed.Interpolate(0.f, seekTransforms);
+	CAROL_CHECK(std::memcmp(transforms.data(), seekTransforms.data(), transforms.size() * sizeof(transforms[0])) == 0);
+
+	compressed.Interpolate(CLIP_DURATION + 1.f, transforms);
+	compressed.Interpolate(CLIP_DURATION, seekTransforms);
+	CAROL_CHECK(std::memcmp(transforms.data(), seekTransforms.data(), transforms.size() * sizeof(transforms[0])) == 0);
+
+	// Clips loaded back from their data are the same clip
+	Carol::CompressedAnimationClip loaded(compressed.GetData());
+	CAROL_CHECK(loaded.GetData().size() == compressed.GetData().size());
+	CAROL_CHECK(std::memcmp(loaded.GetData().data(), compressed.GetData().data(), compressed.GetData().size()) == 0);
+	CAROL_CHECK(loaded.GetBoneCount() == compressed.GetBoneCount());
+
+	for (float t = 0.f; t <= CLIP_DURATION; t += 0.1f)
+	{
+		loaded.Interpolate(t, transforms);
+		compressed.Interpolate(t, seekTransforms);
+		CAROL_CHECK(std::memcmp(transforms.data(), seekTransforms.data(), transforms.size() * sizeof(transforms[0])) == 0);
+	}
+
+	// Source hashes follow the keys and the settings
+	uint64_t hash = compressed.GetSourceHash();
+	CAROL_CHECK(hash == Carol::CompressedAnimationClip::HashSource(clip, settings));
+	CAROL_CHECK(hash == Carol::CompressedAnimationClip::ReadSourceHash(compressed.GetData()));
+	CAROL_CHECK(hash != Carol::CompressedAnimationClip::HashSource(clip));
+
+	auto movedClip = clip;
+	movedClip.BoneAnimations[5].TranslationKeyframes[3].Translation.z += 1e-2f;
+	CAROL_CHECK(hash != Carol::CompressedAnimationClip::HashSource(movedClip, settings));
+
+	std::printf("compressed-animation-test: %zu of %llu bytes, translation error %g, rotation error %g, %d failed checks\n",
+		compressed.GetData().size(), (unsigned long long)GetRawSize(clip), maxTranslationError, maxRotationError, gFailedChecks);
+	return gFailedChecks;
+}
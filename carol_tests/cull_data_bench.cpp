@@ -0,0 +1,117 @@
+#include "mesh_fixture.h"
+#include "test.h"
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 16;
+	constexpr uint32_t FRAME_COUNT = 60;
+	constexpr uint32_t REPEAT_COUNT = 3;
+
+	template<class Func>
+	double BestOf(Func&& func)
+	{
+		double milliseconds = 1e30;
+
+		for (uint32_t i = 0; i < REPEAT_COUNT; ++i)
+		{
+			Carol::Stopwatch stopwatch;
+			func();
+			milliseconds = std::min(milliseconds, stopwatch.Milliseconds());
+		}
+
+		return milliseconds;
+	}
+}
+
+// carol-cull-data-bench [grid size] [max threads]
+// Meshlet cull data of a static and a skinned grid, 60 baked frames for the skinned one. The separate scalar passes
+// build the box and apex offset only, serially as before. The fused kernel also builds the minimal cone and bounding
+// sphere, over the thread pool from 1 thread up to the maximum.
+int main(int argc, char** argv)
+{
+	uint32_t gridSize = argc > 1 ? std::atoi(argv[1]) : 128;
+	uint32_t maxThreadCount = argc > 2 ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+	maxThreadCount = std::max(maxThreadCount, 1u);
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(maxThreadCount);
+
+	std::vector<Carol::Vertex> staticVertices;
+	std::vector<uint32_t> staticIndices;
+	Carol::BuildGridMesh(gridSize, 0, staticVertices, staticIndices);
+	Carol::TestMesh staticMesh(staticVertices, {}, staticIndices, false, false);
+
+	std::vector<Carol::Vertex> skinnedVertices;
+	std::vector<uint32_t> skinnedIndices;
+	Carol::BuildGridMesh(gridSize, BONE_COUNT, skinnedVertices, skinnedIndices);
+
+	std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>> frameTransforms;
+	auto& frames = frameTransforms["bend"] = Carol::BuildGridFrames(gridSize, BONE_COUNT, FRAME_COUNT);
+	Carol::TestMesh skinnedMesh(skinnedVertices, frameTransforms, skinnedIndices, true, false);
+
+	auto staticMeshlets = staticMesh.GetMeshlets();
+	auto skinnedMeshlets = skinnedMesh.GetMeshlets();
+	auto staticCullData = staticMesh.GetCullData()[0].MeshletCullData;
+	auto skinnedCullData = skinnedMesh.GetCullData()[0].MeshletCullData;
+
+	std::printf("%u x %u grid, %zu static meshlets, %zu skinned meshlets over %u frames\n",
+		gridSize, gridSize, staticMeshlets.size(), skinnedMeshlets.size(), FRAME_COUNT);
+
+	std::vector<DirectX::XMFLOAT3> points;
+	std::vector<Carol::BoneBounds> boneBounds;
+	Carol::CullData reference;
+
+	double staticPassMilliseconds = BestOf([&]()
+	{
+		for (uint32_t i = 0; i < staticMeshlets.size(); ++i)
+		{
+			points.clear();
+
+			for (uint32_t j = 0; j < staticMeshlets[i].VertexCount; ++j)
+			{
+				points.push_back(staticVertices[staticMeshlets[i].Vertices[j]].Pos);
+			}
+
+			Carol::LoadReferenceCullData(points, staticCullData[i], reference);
+		}
+	});
+
+	double skinnedPassMilliseconds = BestOf([&]()
+	{
+		for (uint32_t i = 0; i < skinnedMeshlets.size(); ++i)
+		{
+			Carol::GetSkinnedMeshletPoints(skinnedMesh, skinnedMeshlets[i], frames, boneBounds, points);
+			Carol::LoadReferenceCullData(points, skinnedCullData[i], reference);
+		}
+	});
+
+	std::printf("%-18s %12s %12s\n", "", "static ms", "skinned ms");
+	std::printf("%-18s %12.2f %12.2f\n", "separate passes", staticPassMilliseconds, skinnedPassMilliseconds);
+
+	std::vector<uint32_t> threadCounts;
+
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(maxThreadCount);
+
+	for (auto threadCount : threadCounts)
+	{
+		Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(threadCount);
+
+		double staticMilliseconds = BestOf([&]() { staticMesh.LoadStaticCullData("mesh"); });
+		double skinnedMilliseconds = BestOf([&]() { skinnedMesh.LoadSkinnedCullData("bend", frames); });
+
+		std::printf("fused, %2u threads %12.2f %12.2f\n", threadCount, staticMilliseconds, skinnedMilliseconds);
+	}
+
+	Carol::gThreadPool.reset();
+	return 0;
+}
@@ -0,0 +1,187 @@
+#include "mesh_fixture.h"
+#include "test.h"
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	using DirectX::operator-;
+
+	constexpr uint32_t GRID_SIZE = 64;
+	constexpr uint32_t BONE_COUNT = 6;
+	constexpr uint32_t FRAME_COUNT = 12;
+
+	float gMaxApexError = 0.f;
+
+	bool IsSameBox(const Carol::CullData& cd0, const Carol::CullData& cd1)
+	{
+		return std::memcmp(&cd0.Center, &cd1.Center, sizeof(cd0.Center)) == 0 && std::memcmp(&cd0.Extent, &cd1.Extent, sizeof(cd0.Extent)) == 0;
+	}
+
+	bool IsSameCullData(std::span<const Carol::CullData> cullData0, std::span<const Carol::CullData> cullData1)
+	{
+		return cullData0.size() == cullData1.size() && std::memcmp(cullData0.data(), cullData1.data(), cullData0.size_bytes()) == 0;
+	}
+
+	bool SphereContains(const DirectX::XMFLOAT4& sphere, const DirectX::XMFLOAT3& p)
+	{
+		float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&p) - DirectX::XMVectorSet(sphere.x, sphere.y, sphere.z, 0.f)));
+		return distance <= sphere.w * 1.0001f + 1e-4f;
+	}
+
+	bool BoxContains(const Carol::CullData& cullData, const DirectX::XMFLOAT3& p)
+	{
+		return std::abs(p.x - cullData.Center.x) <= cullData.Extent.x * 1.0001f + 1e-4f
+			&& std::abs(p.y - cullData.Center.y) <= cullData.Extent.y * 1.0001f + 1e-4f
+			&& std::abs(p.z - cullData.Center.z) <= cullData.Extent.z * 1.0001f + 1e-4f;
+	}
+
+	bool ConeContains(const Carol::CullData& cullData, const DirectX::XMFLOAT3& normal)
+	{
+		DirectX::XMVECTOR axis;
+		float sinConeSpread;
+
+		if (!Carol::UnpackCone(cullData, axis, sinConeSpread))
+		{
+			return true;
+		}
+
+		float cosAngle = DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&normal))));
+		return cosAngle >= std::sqrt(1.f - sinConeSpread * sinConeSpread) - 1e-4f;
+	}
+
+	// Box bit-exact against the separate passes, the apex offset within rounding of the reordered dot products
+	void CheckAgainstReference(std::span<const DirectX::XMFLOAT3> points, const Carol::CullData& cullData)
+	{
+		Carol::CullData reference;
+		Carol::LoadReferenceCullData(points, cullData, reference);
+
+		CAROL_CHECK(IsSameBox(cullData, reference));
+
+		float apexError = std::abs(cullData.ApexOffset - reference.ApexOffset) / (1.f + std::abs(reference.ApexOffset));
+		gMaxApexError = std::fmax(gMaxApexError, apexError);
+		CAROL_CHECK(apexError < 1e-4f);
+
+		for (auto& p : points)
+		{
+			CAROL_CHECK(SphereContains(cullData.BoundingSphere, p));
+		}
+	}
+
+	void SkinVertex(const Carol::Vertex& vertex, std::span<const DirectX::XMFLOAT4X4> finalTransforms, DirectX::XMFLOAT3& pos, DirectX::XMFLOAT3& normal)
+	{
+		float weights[] = { vertex.Weights.x, vertex.Weights.y, vertex.Weights.z, 1.f - vertex.Weights.x - vertex.Weights.y - vertex.Weights.z };
+		uint32_t boneIndices[] = { vertex.BoneIndices.x, vertex.BoneIndices.y, vertex.BoneIndices.z, vertex.BoneIndices.w };
+		DirectX::XMVECTOR skinnedPos = DirectX::XMVectorZero();
+		DirectX::XMVECTOR skinnedNormal = DirectX::XMVectorZero();
+
+		for (int k = 0; k < 4 && weights[k] != 0.f; ++k)
+		{
+			DirectX::XMMATRIX transform = DirectX::XMLoadFloat4x4(&finalTransforms[boneIndices[k]]);
+			skinnedPos = DirectX::XMVectorAdd(skinnedPos, DirectX::XMVectorScale(DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&vertex.Pos), transform), weights[k]));
+			skinnedNormal = DirectX::XMVectorAdd(skinnedNormal, DirectX::XMVectorScale(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&vertex.Normal), transform), weights[k]));
+		}
+
+		DirectX::XMStoreFloat3(&pos, skinnedPos);
+		DirectX::XMStoreFloat3(&normal, skinnedNormal);
+	}
+}
+
+int main()
+{
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(4);
+	std::vector<DirectX::XMFLOAT3> points;
+
+	// Static grid, cluster LOD meshlets of every level under the single pseudo clip
+	std::vector<Carol::Vertex> staticVertices;
+	std::vector<uint32_t> staticIndices;
+	Carol::BuildGridMesh(GRID_SIZE, 0, staticVertices, staticIndices);
+
+	Carol::TestMesh staticMesh(staticVertices, {}, staticIndices, false, false);
+	auto staticMeshlets = staticMesh.GetMeshlets();
+	auto staticCullData = staticMesh.GetCullData();
+
+	CAROL_CHECK(staticCullData.size() == 1);
+	CAROL_CHECK(staticCullData[0].MeshletCullData.size() == staticMeshlets.size());
+	uint32_t staticConeCount = 0;
+
+	for (uint32_t i = 0; i < staticMeshlets.size(); ++i)
+	{
+		auto& meshlet = staticMeshlets[i];
+		auto& cullData = staticCullData[0].MeshletCullData[i];
+		points.clear();
+
+		for (uint32_t j = 0; j < meshlet.VertexCount; ++j)
+		{
+			points.push_back(staticVertices[meshlet.Vertices[j]].Pos);
+			CAROL_CHECK(ConeContains(cullData, staticVertices[meshlet.Vertices[j]].Normal));
+		}
+
+		CheckAgainstReference(points, cullData);
+		staticConeCount += (cullData.NormalCone.c >> 24) != 0xff;
+	}
+
+	// The height field stays well within a hemisphere, every meshlet gets a cone
+	CAROL_CHECK(staticConeCount == staticMeshlets.size());
+
+	// Skinned grid bent by its bones over the frames of one clip
+	std::vector<Carol::Vertex> skinnedVertices;
+	std::vector<uint32_t> skinnedIndices;
+	Carol::BuildGridMesh(GRID_SIZE, BONE_COUNT, skinnedVertices, skinnedIndices);
+
+	std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>> frameTransforms;
+	auto& frames = frameTransforms["bend"] = Carol::BuildGridFrames(GRID_SIZE, BONE_COUNT, FRAME_COUNT);
+
+	Carol::TestMesh skinnedMesh(skinnedVertices, frameTransforms, skinnedIndices, true, false);
+	auto skinnedMeshlets = skinnedMesh.GetMeshlets();
+	auto skinnedCullData = skinnedMesh.GetCullData();
+	std::vector<Carol::BoneBounds> boneBounds;
+
+	CAROL_CHECK(skinnedCullData.size() == 1 && skinnedCullData[0].ClipName == "bend");
+	CAROL_CHECK(skinnedCullData[0].MeshletCullData.size() == skinnedMeshlets.size());
+
+	for (uint32_t i = 0; i < skinnedMeshlets.size(); ++i)
+	{
+		auto& meshlet = skinnedMeshlets[i];
+		auto& cullData = skinnedCullData[0].MeshletCullData[i];
+
+		Carol::GetSkinnedMeshletPoints(skinnedMesh, meshlet, frames, boneBounds, points);
+		CheckAgainstReference(points, cullData);
+
+		// Every pose the clip bakes stays inside the bounds
+		for (auto& finalTransforms : frames)
+		{
+			for (uint32_t j = 0; j < meshlet.VertexCount; ++j)
+			{
+				DirectX::XMFLOAT3 pos;
+				DirectX::XMFLOAT3 normal;
+				SkinVertex(skinnedVertices[meshlet.Vertices[j]], finalTransforms, pos, normal);
+
+				CAROL_CHECK(BoxContains(cullData, pos));
+				CAROL_CHECK(SphereContains(cullData.BoundingSphere, pos));
+				CAROL_CHECK(ConeContains(cullData, normal));
+			}
+		}
+	}
+
+	// Meshlets are spread over the threads in a different order, the result may not change
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(1);
+	Carol::TestMesh rebuiltStaticMesh(staticVertices, {}, staticIndices, false, false);
+	Carol::TestMesh rebuiltSkinnedMesh(skinnedVertices, frameTransforms, skinnedIndices, true, false);
+
+	CAROL_CHECK(IsSameCullData(rebuiltStaticMesh.GetCullData()[0].MeshletCullData, staticCullData[0].MeshletCullData));
+	CAROL_CHECK(IsSameCullData(rebuiltSkinnedMesh.GetCullData()[0].MeshletCullData, skinnedCullData[0].MeshletCullData));
+
+	Carol::gThreadPool.reset();
+
+	std::printf("cull-data-test: %zu static and %zu skinned meshlets, max apex offset error %g, %d failed checks\n",
+		staticMeshlets.size(),
+		skinnedMeshlets.size(),
+		gMaxApexError,
+		gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,206 @@
+#include "mesh_fixture.h"
+#include "test.h"
+#include <scene/cull_simulator.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	using DirectX::operator-;
+
+	constexpr uint32_t VIEW_COUNT = 8;
+	// Lowest culled ratio of any view, a little under what the views measure. The sphere loses most of its back half
+	// to the cones and its sides to the frustum. The inner side of the torus faces the eye across the hole, and the
+	// frustum alone culls none of it.
+	constexpr float MIN_SPHERE_CULLED_RATIO = 0.5f;
+	constexpr float MIN_TORUS_CULLED_RATIO = 0.15f;
+
+	// Cube of size x size quads per face pushed out onto the unit sphere, the faces do not share their edge vertices
+	void BuildSphereMesh(uint32_t size, std::vector<Carol::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		const DirectX::XMFLOAT3 axes[6][3] =
+		{
+			{ { 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f } },
+			{ { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } },
+			{ { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+			{ { 0.f, -1.f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 0.f, 0.f } },
+			{ { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } },
+			{ { 0.f, 0.f, -1.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } }
+		};
+
+		for (auto& [normal, u, v] : axes)
+		{
+			uint32_t base = vertices.size();
+
+			for (uint32_t y = 0; y <= size; ++y)
+			{
+				for (uint32_t x = 0; x <= size; ++x)
+				{
+					float s = 2.f * x / size - 1.f;
+					float t = 2.f * y / size - 1.f;
+					auto& vertex = vertices.emplace_back();
+
+					DirectX::XMStoreFloat3(&vertex.Pos, DirectX::XMVector3Normalize(DirectX::XMVectorSet(
+						normal.x + s * u.x + t * v.x,
+						normal.y + s * u.y + t * v.y,
+						normal.z + s * u.z + t * v.z,
+						0.f)));
+					vertex.Normal = vertex.Pos;
+				}
+			}
+
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					uint32_t i = base + y * (size + 1) + x;
+					indices.insert(indices.end(), { i, i + size + 1, i + 1 });
+					indices.insert(indices.end(), { i + 1, i + size + 1, i + size + 2 });
+				}
+			}
+		}
+	}
+
+	// Torus around y with a tube of radius minorRadius, closed in both directions. The counts are multiples of 8.
+	void BuildTorusMesh(uint32_t ringCount, uint32_t sideCount, float minorRadius, std::vector<Carol::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t i = 0; i < ringCount; ++i)
+		{
+			float ringAngle = DirectX::XM_2PI * i / ringCount;
+
+			for (uint32_t j = 0; j < sideCount; ++j)
+			{
+				float sideAngle = DirectX::XM_2PI * j / sideCount;
+				DirectX::XMFLOAT3 normal = { std::cos(ringAngle) * std::cos(sideAngle), std::sin(sideAngle), std::sin(ringAngle) * std::cos(sideAngle) };
+				auto& vertex = vertices.emplace_back();
+
+				vertex.Pos = { std::cos(ringAngle) + minorRadius * normal.x, minorRadius * normal.y, std::sin(ringAngle) + minorRadius * normal.z };
+				vertex.Normal = normal;
+			}
+		}
+
+		// In tiles of TILE_SIZE x TILE_SIZE quads like a vertex cache optimized asset, ring order would wrap every
+		// meshlet most of the way around the tube
+		constexpr uint32_t TILE_SIZE = 8;
+
+		for (uint32_t tile = 0; tile < ringCount * sideCount / (TILE_SIZE * TILE_SIZE); ++tile)
+		{
+			for (uint32_t k = 0; k < TILE_SIZE * TILE_SIZE; ++k)
+			{
+				uint32_t i = tile / (sideCount / TILE_SIZE) * TILE_SIZE + k / TILE_SIZE;
+				uint32_t j = tile % (sideCount / TILE_SIZE) * TILE_SIZE + k % TILE_SIZE;
+				uint32_t i0 = i * sideCount + j;
+				uint32_t i1 = (i + 1) % ringCount * sideCount + j;
+				uint32_t i2 = i * sideCount + (j + 1) % sideCount;
+				uint32_t i3 = (i + 1) % ringCount * sideCount + (j + 1) % sideCount;
+
+				indices.insert(indices.end(), { i0, i2, i1 });
+				indices.insert(indices.end(), { i1, i2, i3 });
+			}
+		}
+	}
+
+	// A culled meshlet is a false cull when any of its vertices is visible: inside the clip volume and facing the eye
+	bool IsVisible(const Carol::Vertex& vertex, DirectX::FXMMATRIX world, DirectX::CXMMATRIX viewProj, const DirectX::XMFLOAT3& eyePos)
+	{
+		DirectX::XMVECTOR pos = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&vertex.Pos), world);
+		DirectX::XMVECTOR normal = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&vertex.Normal), world));
+		DirectX::XMFLOAT4 clip;
+		DirectX::XMStoreFloat4(&clip, DirectX::XMVector4Transform(DirectX::XMVectorSetW(pos, 1.f), viewProj));
+
+		bool inside = std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && clip.z >= 0.f && clip.z <= clip.w;
+		bool facing = DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, DirectX::XMLoadFloat3(&eyePos) - pos)) > 0.f;
+
+		return inside && facing;
+	}
+
+	// Culls every meshlet of all LOD levels from views orbiting the mesh, tilted up and down in turn. Returns the lowest
+	// culled ratio of the views and checks that no culled meshlet has a visible vertex.
+	float CullFromOrbit(const char* name, const Carol::TestMesh& mesh, DirectX::FXMMATRIX world, float distance, float fovY)
+	{
+		auto meshlets = mesh.GetMeshlets();
+		auto cullData = mesh.GetCullData()[0].MeshletCullData;
+		auto vertices = mesh.GetVertices();
+		DirectX::XMVECTOR target = world.r[3];
+		float minRatio = 1.f;
+
+		for (uint32_t i = 0; i < VIEW_COUNT; ++i)
+		{
+			float angle = DirectX::XM_2PI * i / VIEW_COUNT;
+			float height = i % 2 ? 0.5f : -0.3f;
+			DirectX::XMVECTOR eye = DirectX::XMVectorAdd(target, DirectX::XMVectorScale(DirectX::XMVector3Normalize(DirectX::XMVectorSet(std::cos(angle), height, std::sin(angle), 0.f)), distance));
+			DirectX::XMMATRIX viewProj = DirectX::XMMatrixLookAtLH(eye, target, DirectX::XMVectorSet(0.f, 1.f, 0.f, 0.f)) * DirectX::XMMatrixPerspectiveFovLH(fovY, 16.f / 9.f, 0.1f, 100.f);
+			DirectX::XMFLOAT3 eyePos;
+			DirectX::XMStoreFloat3(&eyePos, eye);
+
+			Carol::CullSimulator simulator(viewProj, eyePos);
+			uint32_t falseCullCount = 0;
+
+			for (uint32_t j = 0; j < meshlets.size(); ++j)
+			{
+				uint32_t culledCount = simulator.GetStats().FrustumCulledCount + simulator.GetStats().NormalConeCulledCount;
+				simulator.Cull(cullData.subspan(j, 1), world);
+
+				if (simulator.GetStats().FrustumCulledCount + simulator.GetStats().NormalConeCulledCount == culledCount)
+				{
+					continue;
+				}
+
+				for (uint32_t k = 0; k < meshlets[j].VertexCount; ++k)
+				{
+					if (IsVisible(vertices[meshlets[j].Vertices[k]], world, viewProj, eyePos))
+					{
+						++falseCullCount;
+						break;
+					}
+				}
+			}
+
+			auto& stats = simulator.GetStats();
+			std::printf("%s view %u: %u meshlets, %u frustum culled, %u cone culled, %.1f%% culled\n",
+				name, i, stats.MeshletCount, stats.FrustumCulledCount, stats.NormalConeCulledCount, simulator.GetCulledRatio() * 100.f);
+
+			CAROL_CHECK(falseCullCount == 0);
+			CAROL_CHECK(stats.MeshletCount == meshlets.size());
+			minRatio = std::fmin(minRatio, simulator.GetCulledRatio());
+		}
+
+		return minRatio;
+	}
+}
+
+int main()
+{
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(4);
+
+	std::vector<Carol::Vertex> sphereVertices;
+	std::vector<uint32_t> sphereIndices;
+	BuildSphereMesh(96, sphereVertices, sphereIndices);
+	Carol::TestMesh sphere(sphereVertices, {}, sphereIndices, false, false);
+
+	std::vector<Carol::Vertex> torusVertices;
+	std::vector<uint32_t> torusIndices;
+	BuildTorusMesh(384, 96, 0.35f, torusVertices, torusIndices);
+	Carol::TestMesh torus(torusVertices, {}, torusIndices, false, false);
+
+	// The sphere fills the view, parts of it leave the frustum. The torus is rotated, scaled and moved off the origin.
+	DirectX::XMMATRIX torusWorld = DirectX::XMMatrixRotationAxis(DirectX::XMVectorSet(1.f, 0.f, 0.f, 0.f), 0.6f)
+		* DirectX::XMMatrixScaling(2.f, 2.f, 2.f)
+		* DirectX::XMMatrixTranslation(5.f, 1.f, -3.f);
+
+	float sphereRatio = CullFromOrbit("sphere", sphere, DirectX::XMMatrixIdentity(), 1.8f, 0.5f * DirectX::XM_PIDIV2);
+	float torusRatio = CullFromOrbit("torus", torus, torusWorld, 8.f, 0.5f * DirectX::XM_PIDIV2);
+
+	CAROL_CHECK(sphereRatio >= MIN_SPHERE_CULLED_RATIO);
+	CAROL_CHECK(torusRatio >= MIN_TORUS_CULLED_RATIO);
+
+	Carol::gThreadPool.reset();
+
+	std::printf("cull-simulator-test: lowest culled ratio %.1f%% sphere, %.1f%% torus, %d failed checks\n",
+		sphereRatio * 100.f,
+		torusRatio * 100.f,
+		gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,97 @@
+#include "test.h"
+#include <scene/animation_asset.h>
+#include <scene/assimp.h>
+#include <scene/mesh_cache.h>
+#include <scene/texture.h>
+#include <utils/mapped_file.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+	constexpr uint32_t REPEAT_COUNT = 3;
+}
+
+// carol-mesh-cache-bench <model> <texture dir> [static|skinned] [threads]
+// Cold import through Assimp writing the mesh cache, against a cache hit mapping the file, checking the header and
+// dependencies and reading the meshes in place. Best of 3 runs each, textures are not decoded by either. The cache
+// is written to the temp directory, so the one the engine loads from is left alone.
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "usage: carol-mesh-cache-bench <model> <texture dir> [static|skinned] [threads]\n");
+		return 1;
+	}
+
+	std::string_view path = argv[1];
+	std::string_view textureDir = argv[2];
+	bool isSkinned = argc > 3 && std::string_view(argv[3]) == "skinned";
+	uint32_t threadCount = argc > 4 ? std::atoi(argv[4]) : std::thread::hardware_concurrency();
+
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(std::max(threadCount, 1u));
+	Carol::gAnimationAssetManager = std::make_unique<Carol::AnimationAssetManager>();
+	Carol::gTextureManager = std::make_unique<Carol::TextureManager>();
+
+	uint64_t key = Carol::GetMeshCacheKey(path, textureDir, isSkinned);
+
+	if (key == 0)
+	{
+		std::fprintf(stderr, "carol-mesh-cache-bench: cannot read %.*s\n", int(path.size()), path.data());
+		return 1;
+	}
+
+	auto tempDir = std::filesystem::temp_directory_path() / "carol-mesh-cache-bench";
+	std::string cachePath = (tempDir / "model.mesh").generic_string();
+	double importMilliseconds = 1e30;
+	double hitMilliseconds = 1e30;
+	size_t importMeshCount = 0;
+	size_t hitMeshCount = 0;
+
+	for (uint32_t i = 0; i < REPEAT_COUNT; ++i)
+	{
+		Carol::Stopwatch stopwatch;
+		Carol::ModelNode node;
+		Carol::MeshCacheWriter writer(key, isSkinned);
+		Carol::AssimpModel model(&node, path, textureDir, isSkinned, &writer);
+		writer.Save(cachePath);
+
+		importMilliseconds = std::min(importMilliseconds, stopwatch.Milliseconds());
+		importMeshCount = model.GetMeshes().size();
+	}
+
+	for (uint32_t i = 0; i < REPEAT_COUNT; ++i)
+	{
+		Carol::Stopwatch stopwatch;
+		Carol::ModelNode node;
+		Carol::MappedFile file(cachePath);
+
+		if (!Carol::IsMeshCacheValid(file.GetData(), key) || !Carol::IsMeshCacheCurrent(file.GetData()))
+		{
+			std::fprintf(stderr, "carol-mesh-cache-bench: the cache written by the import does not load\n");
+			return 1;
+		}
+
+		Carol::CachedModel model(&node, file.GetData());
+		hitMilliseconds = std::min(hitMilliseconds, stopwatch.Milliseconds());
+		hitMeshCount = model.IsValid() ? model.GetMeshes().size() : 0;
+	}
+
+	std::error_code ec;
+	uint64_t cacheSize = std::filesystem::file_size(cachePath, ec);
+
+	std::printf("%zu meshes imported, %zu read from a %.1f KB cache\n", importMeshCount, hitMeshCount, cacheSize / 1024.0);
+	std::printf("%-16s %10.2f ms\n", "assimp import", importMilliseconds);
+	std::printf("%-16s %10.2f ms  %.1fx faster\n", "mapped cache hit", hitMilliseconds, importMilliseconds / hitMilliseconds);
+
+	std::filesystem::remove_all(tempDir, ec);
+	Carol::gThreadPool.reset();
+
+	return hitMeshCount != importMeshCount;
+}
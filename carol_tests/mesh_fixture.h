@@ -0,0 +1,185 @@
+#pragma once
+#include <scene/mesh.h>
+#include <dx12/resource.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace Carol
+{
+	// Mesh with its CPU cook steps opened up, it is never uploaded
+	class TestMesh : public Mesh
+	{
+	public:
+		using Mesh::Mesh;
+		using Mesh::LoadStaticCullData;
+		using Mesh::LoadSkinnedCullData;
+		using Mesh::LoadMeshletBoneBounds;
+
+		std::span<const Vertex> GetVertices()const
+		{
+			return mVertices;
+		}
+	};
+
+	// Rolling height field over a grid of quads split into two triangles each. With bones, every vertex blends
+	// between the two nearest of boneCount bones laid out along x.
+	inline void BuildGridMesh(uint32_t size, uint32_t boneCount, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t y = 0; y <= size; ++y)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+			{
+				auto& vertex = vertices.emplace_back();
+				float height = 2.f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+				float slopeX = 0.6f * std::cos(x * 0.3f) * std::cos(y * 0.2f);
+				float slopeY = -0.4f * std::sin(x * 0.3f) * std::sin(y * 0.2f);
+
+				vertex.Pos = { float(x), height, float(y) };
+				DirectX::XMStoreFloat3(&vertex.Normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(-slopeX, 1.f, -slopeY, 0.f)));
+
+				if (boneCount)
+				{
+					float bone = float(x) / size * (boneCount - 1);
+					uint32_t bone0 = std::min(uint32_t(bone), boneCount - 1);
+					float weight = bone - bone0;
+
+					vertex.Weights = { 1.f - weight, weight, 0.f };
+					vertex.BoneIndices = { bone0, std::min(bone0 + 1, boneCount - 1), 0, 0 };
+				}
+			}
+		}
+
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				uint32_t v = y * (size + 1) + x;
+				indices.insert(indices.end(), { v, v + size + 1, v + 1 });
+				indices.insert(indices.end(), { v + 1, v + size + 1, v + size + 2 });
+			}
+		}
+	}
+
+	// Every bone of a grid bends its stretch around z and lifts it a little, with its own phase per frame
+	inline std::vector<std::vector<DirectX::XMFLOAT4X4>> BuildGridFrames(uint32_t size, uint32_t boneCount, uint32_t frameCount)
+	{
+		std::vector<std::vector<DirectX::XMFLOAT4X4>> frames(frameCount, std::vector<DirectX::XMFLOAT4X4>(boneCount));
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			for (uint32_t i = 0; i < boneCount; ++i)
+			{
+				float pivot = boneCount > 1 ? float(i) / (boneCount - 1) * size : 0.f;
+				float angle = 0.4f * std::sin(frame * 0.7f + i);
+
+				DirectX::XMStoreFloat4x4(&frames[frame][i],
+					DirectX::XMMatrixTranslation(-pivot, 0.f, 0.f) *
+					DirectX::XMMatrixRotationAxis(DirectX::XMVectorSet(0.f, 0.f, 1.f, 0.f), angle) *
+					DirectX::XMMatrixTranslation(pivot, std::cos(frame * 0.5f + i), 0.f));
+			}
+		}
+
+		return frames;
+	}
+
+	// Corners of every bone box of the meshlet in every frame, the points skinned cull data bounds
+	inline void GetSkinnedMeshletPoints(
+		TestMesh& mesh,
+		const Meshlet& meshlet,
+		std::span<const std::vector<DirectX::XMFLOAT4X4>> frames,
+		std::vector<BoneBounds>& boneBounds,
+		std::vector<DirectX::XMFLOAT3>& points)
+	{
+		mesh.LoadMeshletBoneBounds(meshlet, boneBounds);
+		points.clear();
+
+		for (auto& finalTransforms : frames)
+		{
+			for (auto& bounds : boneBounds)
+			{
+				DirectX::XMMATRIX transform = bounds.BoneIdx == UINT32_MAX ? DirectX::XMMatrixIdentity() : DirectX::XMLoadFloat4x4(&finalTransforms[bounds.BoneIdx]);
+				DirectX::BoundingBox box;
+				DirectX::XMFLOAT3 corners[DirectX::BoundingBox::CORNER_COUNT];
+
+				DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&bounds.BoxMin), DirectX::XMLoadFloat3(&bounds.BoxMax));
+				box.GetCorners(corners);
+				DirectX::XMVector3TransformCoordStream(corners, sizeof(DirectX::XMFLOAT3), corners, sizeof(DirectX::XMFLOAT3), DirectX::BoundingBox::CORNER_COUNT, transform);
+				points.insert(points.end(), std::begin(corners), std::end(corners));
+			}
+		}
+	}
+
+	// Normalized cone axis and sine of the spread as the shader unpacks them, no cone when the sine is 1
+	inline bool UnpackCone(const CullData& cullData, DirectX::XMVECTOR& axis, float& sinConeSpread)
+	{
+		uint32_t packedCone = cullData.NormalCone.c;
+		sinConeSpread = (packedCone >> 24) / 255.f;
+
+		axis = DirectX::XMVector3Normalize(DirectX::XMVectorSet(
+			((packedCone >> 0) & 0xff) / 255.f * 2.f - 1.f,
+			((packedCone >> 8) & 0xff) / 255.f * 2.f - 1.f,
+			((packedCone >> 16) & 0xff) / 255.f * 2.f - 1.f,
+			0.f));
+
+		return (packedCone >> 24) != 0xff;
+	}
+
+	// The separate scalar passes cull data was built with before they were fused into one kernel: the box, then the
+	// bottom distance and the bottom radius along the cone, each a loop over every point. The cone axis and spread
+	// are read back from the packed data, since the kernel no longer takes the axis from the normal box centre.
+	inline void LoadReferenceCullData(std::span<const DirectX::XMFLOAT3> points, const CullData& packed, CullData& cullData)
+	{
+		using DirectX::operator-;
+		using DirectX::operator*;
+
+		DirectX::XMFLOAT3 boxMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 boxMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (auto& p : points)
+		{
+			boxMin = { std::fmin(boxMin.x, p.x), std::fmin(boxMin.y, p.y), std::fmin(boxMin.z, p.z) };
+			boxMax = { std::fmax(boxMax.x, p.x), std::fmax(boxMax.y, p.y), std::fmax(boxMax.z, p.z) };
+		}
+
+		DirectX::BoundingBox box;
+		DirectX::BoundingBox::CreateFromPoints(box, DirectX::XMLoadFloat3(&boxMin), DirectX::XMLoadFloat3(&boxMax));
+
+		cullData.Center = box.Center;
+		cullData.Extent = box.Extents;
+		cullData.NormalCone = packed.NormalCone;
+		cullData.ApexOffset = 0.f;
+
+		DirectX::XMVECTOR normalCone;
+		float sinConeSpread;
+
+		if (!UnpackCone(packed, normalCone, sinConeSpread))
+		{
+			return;
+		}
+
+		float tanConeSpread = sinConeSpread / std::sqrt(1.f - sinConeSpread * sinConeSpread);
+		float bottomDist = FLT_MAX;
+
+		for (auto& p : points)
+		{
+			bottomDist = std::fmin(bottomDist, DirectX::XMVectorGetX(DirectX::XMVector3Dot(normalCone, DirectX::XMLoadFloat3(&p))));
+		}
+
+		DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&cullData.Center);
+		float centerToBottomDist = DirectX::XMVectorGetX(DirectX::XMVector3Dot(center, normalCone)) - bottomDist;
+		DirectX::XMVECTOR bottomCenter = center - centerToBottomDist * normalCone;
+		float radius = 0.f;
+
+		for (auto& p : points)
+		{
+			DirectX::XMVECTOR offset = DirectX::XMLoadFloat3(&p) - bottomCenter;
+			float height = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, normalCone));
+			radius = std::fmax(radius, DirectX::XMVectorGetX(DirectX::XMVector3Length(offset - normalCone * height)) - height * tanConeSpread);
+		}
+
+		cullData.ApexOffset = centerToBottomDist + radius / tanConeSpread;
+	}
+}
@@ -0,0 +1,131 @@
+#include "test.h"
+#include <utils/image_decoder.h>
+#include <utils/mip_chain.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t SYNTHETIC_SIZE = 1024;
+
+	void BuildSource(uint32_t seed, DirectX::ScratchImage& image)
+	{
+		image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, SYNTHETIC_SIZE, SYNTHETIC_SIZE, 1, 1);
+		auto* top = image.GetImage(0, 0, 0);
+
+		for (uint32_t y = 0; y < SYNTHETIC_SIZE; ++y)
+		{
+			for (uint32_t x = 0; x < SYNTHETIC_SIZE; ++x)
+			{
+				uint8_t* texel = top->pixels + y * top->rowPitch + 4 * x;
+				texel[0] = uint8_t(x * (seed + 1));
+				texel[1] = uint8_t(y * 3);
+				texel[2] = uint8_t((x ^ y) + seed);
+				texel[3] = 255;
+			}
+		}
+	}
+}
+
+// carol-mip-chain-bench [texture count] [threads] [texture dir]
+// Decodes the PNG and JPEG files of the directory, repeated up to the count, and builds their mip chains with one task
+// per texture as texture loads do. Without a directory, 1024x1024 synthetic images skip the decode.
+int main(int argc, char** argv)
+{
+	std::vector<std::string> files;
+	std::error_code ec;
+
+	if (argc > 3)
+	{
+		for (auto& entry : std::filesystem::directory_iterator(argv[3], ec))
+		{
+			auto extension = entry.path().extension();
+
+			if (extension == ".png" || extension == ".jpg" || extension == ".jpeg")
+			{
+				files.push_back(entry.path().string());
+			}
+		}
+
+		if (files.empty())
+		{
+			std::fprintf(stderr, "carol-mip-chain-bench: no png or jpg files in %s\n", argv[3]);
+			return 1;
+		}
+
+		std::ranges::sort(files);
+	}
+
+	uint32_t textureCount = argc > 1 ? std::atoi(argv[1]) : 64;
+	uint32_t threadCount = argc > 2 ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(threadCount);
+
+	std::vector<DirectX::ScratchImage> sources(files.empty() ? std::min(textureCount, 8u) : 0);
+
+	for (uint32_t i = 0; i < sources.size(); ++i)
+	{
+		BuildSource(i, sources[i]);
+	}
+
+	std::printf("%u %s textures, %u threads\n", textureCount, files.empty() ? "synthetic" : "decoded", Carol::gThreadPool->GetThreadCount());
+
+	std::pair<Carol::MipFilter, Carol::MipContent> runs[] =
+	{
+		{ Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_LINEAR },
+		{ Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_SRGB },
+		{ Carol::MIP_FILTER_KAISER, Carol::MIP_CONTENT_SRGB },
+		{ Carol::MIP_FILTER_KAISER, Carol::MIP_CONTENT_NORMAL }
+	};
+
+	const char* filterNames[] = { "box", "kaiser" };
+	const char* contentNames[] = { "linear", "srgb", "normal" };
+
+	for (auto [filter, content] : runs)
+	{
+		std::atomic<uint64_t> topBytes = 0;
+		std::atomic<uint32_t> failedCount = 0;
+		Carol::Stopwatch stopwatch;
+
+		Carol::gThreadPool->ParallelFor(textureCount, [&](uint32_t i)
+		{
+			DirectX::ScratchImage decoded;
+			DirectX::ScratchImage mipChain;
+
+			if (!files.empty() && FAILED(Carol::DecodeImage(files[i % files.size()], decoded)))
+			{
+				++failedCount;
+				return;
+			}
+
+			auto& source = files.empty() ? sources[i % sources.size()] : decoded;
+
+			if (FAILED(Carol::GenerateMipChain(*source.GetImage(0, 0, 0), filter, content, mipChain)))
+			{
+				++failedCount;
+				return;
+			}
+
+			topBytes += source.GetPixelsSize();
+		});
+
+		double milliseconds = stopwatch.Milliseconds();
+
+		std::printf("%-6s %-6s %10.1f ms %8.1f textures/s %8.1f MB/s %u failed\n",
+			filterNames[filter],
+			contentNames[content],
+			milliseconds,
+			textureCount * 1e3 / milliseconds,
+			topBytes / milliseconds / 1e3,
+			failedCount.load());
+	}
+
+	Carol::gThreadPool.reset();
+	return 0;
+}
@@ -0,0 +1,144 @@
+#include "test.h"
+#include <utils/mip_chain.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+	void BuildImage(uint32_t width, uint32_t height, DirectX::ScratchImage& image, auto&& getTexel)
+	{
+		image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+		auto* top = image.GetImage(0, 0, 0);
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				getTexel(x, y, top->pixels + y * top->rowPitch + 4 * x);
+			}
+		}
+	}
+
+	// Largest difference of a channel from the expected value over every texel of the level
+	int GetMaxError(const DirectX::Image& level, uint32_t channel, int expected)
+	{
+		int error = 0;
+
+		for (uint32_t y = 0; y < level.height; ++y)
+		{
+			for (uint32_t x = 0; x < level.width; ++x)
+			{
+				error = std::max(error, std::abs(level.pixels[y * level.rowPitch + 4 * x + channel] - expected));
+			}
+		}
+
+		return error;
+	}
+}
+
+int main()
+{
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(2);
+	DirectX::ScratchImage image;
+	DirectX::ScratchImage mipChain;
+
+	// Levels halve down to 1x1, odd sizes round down
+	BuildImage(250, 130, image, [](uint32_t x, uint32_t y, uint8_t* texel) { texel[0] = texel[1] = texel[2] = texel[3] = 255; });
+	CAROL_CHECK(SUCCEEDED(Carol::GenerateMipChain(*image.GetImage(0, 0, 0), Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_LINEAR, mipChain)));
+	CAROL_CHECK(mipChain.GetMetadata().mipLevels == 8);
+	CAROL_CHECK(mipChain.GetImage(1, 0, 0)->width == 125 && mipChain.GetImage(1, 0, 0)->height == 65);
+	CAROL_CHECK(mipChain.GetImage(7, 0, 0)->width == 1 && mipChain.GetImage(7, 0, 0)->height == 1);
+
+	// Flat colors stay flat under both filters and every content
+	BuildImage(64, 64, image, [](uint32_t x, uint32_t y, uint8_t* texel)
+	{
+		texel[0] = 100;
+		texel[1] = 150;
+		texel[2] = 200;
+		texel[3] = 255;
+	});
+
+	for (auto filter : { Carol::MIP_FILTER_BOX, Carol::MIP_FILTER_KAISER })
+	{
+		for (auto content : { Carol::MIP_CONTENT_LINEAR, Carol::MIP_CONTENT_SRGB })
+		{
+			CAROL_CHECK(SUCCEEDED(Carol::GenerateMipChain(*image.GetImage(0, 0, 0), filter, content, mipChain)));
+
+			for (uint32_t level = 0; level < mipChain.GetMetadata().mipLevels; ++level)
+			{
+				CAROL_CHECK(GetMaxError(*mipChain.GetImage(level, 0, 0), 0, 100) <= 1);
+				CAROL_CHECK(GetMaxError(*mipChain.GetImage(level, 0, 0), 2, 200) <= 1);
+			}
+		}
+	}
+
+	// A black and white checker averages to half the light, which sRGB stores as 188 rather than 128
+	BuildImage(64, 64, image, [](uint32_t x, uint32_t y, uint8_t* texel)
+	{
+		texel[0] = texel[1] = texel[2] = (x + y) % 2 ? 255 : 0;
+		texel[3] = 255;
+	});
+
+	CAROL_CHECK(SUCCEEDED(Carol::GenerateMipChain(*image.GetImage(0, 0, 0), Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_SRGB, mipChain)));
+	int srgbError = GetMaxError(*mipChain.GetImage(1, 0, 0), 0, 188);
+	CAROL_CHECK(srgbError <= 1);
+
+	CAROL_CHECK(SUCCEEDED(Carol::GenerateMipChain(*image.GetImage(0, 0, 0), Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_LINEAR, mipChain)));
+	CAROL_CHECK(GetMaxError(*mipChain.GetImage(1, 0, 0), 0, 128) <= 1);
+
+	// Normals keep unit length on every level
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> slope(-0.7f, 0.7f);
+
+	BuildImage(128, 128, image, [&](uint32_t x, uint32_t y, uint8_t* texel)
+	{
+		float nx = slope(random);
+		float ny = slope(random);
+		float nz = std::sqrt(std::max(0.f, 1.f - nx * nx - ny * ny));
+		texel[0] = uint8_t((nx * 0.5f + 0.5f) * 255.f + 0.5f);
+		texel[1] = uint8_t((ny * 0.5f + 0.5f) * 255.f + 0.5f);
+		texel[2] = uint8_t((nz * 0.5f + 0.5f) * 255.f + 0.5f);
+		texel[3] = 255;
+	});
+
+	float maxLengthError = 0.f;
+
+	for (auto filter : { Carol::MIP_FILTER_BOX, Carol::MIP_FILTER_KAISER })
+	{
+		CAROL_CHECK(SUCCEEDED(Carol::GenerateMipChain(*image.GetImage(0, 0, 0), filter, Carol::MIP_CONTENT_NORMAL, mipChain)));
+
+		for (uint32_t level = 1; level < mipChain.GetMetadata().mipLevels; ++level)
+		{
+			auto* mip = mipChain.GetImage(level, 0, 0);
+
+			for (uint32_t y = 0; y < mip->height; ++y)
+			{
+				for (uint32_t x = 0; x < mip->width; ++x)
+				{
+					const uint8_t* texel = mip->pixels + y * mip->rowPitch + 4 * x;
+					float nx = texel[0] / 127.5f - 1.f;
+					float ny = texel[1] / 127.5f - 1.f;
+					float nz = texel[2] / 127.5f - 1.f;
+					maxLengthError = std::max(maxLengthError, std::abs(std::sqrt(nx * nx + ny * ny + nz * nz) - 1.f));
+				}
+			}
+		}
+	}
+
+	// Within what 8 bits per channel can hold
+	CAROL_CHECK(maxLengthError < 0.02f);
+
+	// Only R8G8B8A8 sources are filtered
+	DirectX::ScratchImage rg8;
+	rg8.Initialize2D(DXGI_FORMAT_R8G8_UNORM, 16, 16, 1, 1);
+	CAROL_CHECK(Carol::GenerateMipChain(*rg8.GetImage(0, 0, 0), Carol::MIP_FILTER_BOX, Carol::MIP_CONTENT_LINEAR, mipChain) == E_INVALIDARG);
+
+	Carol::gThreadPool.reset();
+
+	std::printf("mip-chain-test: srgb checker error %d, normal length error %g, %d failed checks\n", srgbError, maxLengthError, gFailedChecks);
+	return gFailedChecks;
+}
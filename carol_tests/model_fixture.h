@@ -0,0 +1,54 @@
+#pragma once
+#include <scene/animation_asset.h>
+#include <scene/compressed_animation.h>
+#include <scene/model.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Carol
+{
+	// Skinned model built straight from a skeleton and clips, it neither imports a file nor touches the GPU
+	class TestModel : public Model
+	{
+	public:
+		TestModel(std::shared_ptr<const Skeleton> skeleton)
+		{
+			mSkinned = true;
+			mSkeleton = std::move(skeleton);
+		}
+
+		void AddAnimationClip(std::string name, std::shared_ptr<const CompressedAnimationClip> clip)
+		{
+			mAnimationClips[std::move(name)] = std::move(clip);
+		}
+
+		using Model::GetFinalTransforms;
+
+		std::span<const DirectX::XMFLOAT4X4> GetFinalTransforms()const
+		{
+			return mFinalTransforms;
+		}
+	};
+
+	// Bones hang off the bone a third of their index, each one unit above its parent in the bind pose
+	inline std::shared_ptr<const Skeleton> BuildTestSkeleton(uint32_t boneCount)
+	{
+		std::vector<int> hierarchy(boneCount, -1);
+		std::vector<DirectX::XMFLOAT4X4> offsets(boneCount);
+		std::vector<float> heights(boneCount, 0.f);
+
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			if (i > 0)
+			{
+				hierarchy[i] = (i - 1) / 3;
+				heights[i] = heights[hierarchy[i]] + 1.f;
+			}
+
+			DirectX::XMStoreFloat4x4(&offsets[i], DirectX::XMMatrixTranslation(0.f, -heights[i], 0.f));
+		}
+
+		return std::make_shared<const Skeleton>(hierarchy, offsets, Skeleton::Hash(hierarchy, offsets));
+	}
+}
@@ -0,0 +1,105 @@
+#include "test.h"
+#include <scene/animation_asset.h>
+#include <scene/assimp.h>
+#include <scene/texture.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+	constexpr uint32_t REPEAT_COUNT = 3;
+
+	// Imports through a pool task as the model loader does, so the per-mesh stage runs on the worker and the rest
+	// of the pool. The mesh cache is bypassed, every run imports the source.
+	double Import(std::string_view path, std::string_view textureDir, bool isSkinned, std::unique_ptr<Carol::Model>* keep = nullptr)
+	{
+		Carol::Stopwatch stopwatch;
+		Carol::ModelNode node;
+		std::unique_ptr<Carol::Model> model;
+
+		Carol::gThreadPool->Submit([&]()
+		{
+			model = std::make_unique<Carol::AssimpModel>(&node, path, textureDir, isSkinned);
+		}).get();
+
+		double milliseconds = stopwatch.Milliseconds();
+
+		if (keep)
+		{
+			*keep = std::move(model);
+		}
+
+		return milliseconds;
+	}
+}
+
+// carol-model-import-bench <model> <texture dir> [static|skinned] [max threads]
+// Import time of a model against the thread count, best of 3 runs each. Large multi-mesh assets show the scaling best.
+// Then imports the model again while another instance holds its skeleton and clips, the way repeated rigs load,
+// and prints the poses baked for the cull data of each clip.
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::fprintf(stderr, "usage: carol-model-import-bench <model> <texture dir> [static|skinned] [max threads]\n");
+		return 1;
+	}
+
+	std::string_view path = argv[1];
+	std::string_view textureDir = argv[2];
+	bool isSkinned = argc > 3 && std::string_view(argv[3]) == "skinned";
+	uint32_t maxThreadCount = argc > 4 ? std::atoi(argv[4]) : std::thread::hardware_concurrency();
+	maxThreadCount = std::max(maxThreadCount, 1u);
+
+	Carol::gAnimationAssetManager = std::make_unique<Carol::AnimationAssetManager>();
+	Carol::gTextureManager = std::make_unique<Carol::TextureManager>();
+
+	std::vector<uint32_t> threadCounts;
+
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(maxThreadCount);
+	double serialMilliseconds = 0.0;
+
+	for (auto threadCount : threadCounts)
+	{
+		Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(threadCount);
+		double milliseconds = Import(path, textureDir, isSkinned);
+
+		for (uint32_t i = 1; i < REPEAT_COUNT; ++i)
+		{
+			milliseconds = std::min(milliseconds, Import(path, textureDir, isSkinned));
+		}
+
+		serialMilliseconds = threadCount == 1 ? milliseconds : serialMilliseconds;
+		std::printf("%2u threads %10.1f ms %6.2fx speedup\n", threadCount, milliseconds, serialMilliseconds / milliseconds);
+	}
+
+	if (isSkinned)
+	{
+		std::unique_ptr<Carol::Model> instance;
+		double firstMilliseconds = Import(path, textureDir, isSkinned, &instance);
+		double repeatMilliseconds = Import(path, textureDir, isSkinned);
+
+		std::printf("first rig %10.1f ms, repeated rig %10.1f ms, %u skeletons and %u clips shared\n",
+			firstMilliseconds, repeatMilliseconds, Carol::gAnimationAssetManager->GetSkeletonsCount(), Carol::gAnimationAssetManager->GetAnimationClipsCount());
+
+		for (auto clipName : instance->GetAnimationClips())
+		{
+			if (auto* stats = instance->GetPoseSamplingStats(clipName))
+			{
+				std::printf("clip %.*s: %u poses sampled, %.4f max joint deviation\n", int(clipName.size()), clipName.data(), stats->SampleCount, stats->MaxDeviation);
+			}
+		}
+	}
+
+	Carol::gThreadPool.reset();
+	return 0;
+}
@@ -0,0 +1,205 @@
+#include "mesh_fixture.h"
+#include "test.h"
+#include <scene/animation_asset.h>
+#include <scene/mesh_cache.h>
+#include <scene/model_loader.h>
+#include <scene/texture.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t UPLOAD_BUDGET = 96 << 10;
+	// Frames the GPU runs behind the CPU
+	constexpr uint64_t GPU_LAG = 2;
+	constexpr uint32_t MAX_FRAME_COUNT = 10000;
+
+	class TestModel
+	{
+	public:
+		std::string Name;
+		std::vector<uint32_t> GridSizes;
+		std::string Texture;
+		bool FailUpload = false;
+	};
+
+	class UploadState
+	{
+	public:
+		uint32_t UploadCount = 0;
+		uint64_t FenceValue = 0;
+	};
+
+	// Records uploads instead of recording them on a command list. Models with a mesh named upload_error fail their last upload.
+	class FakeUploader : public Carol::ModelUploader
+	{
+	public:
+		virtual void Upload(Carol::Model* model, uint32_t idx)override
+		{
+			auto& state = mStates[model];
+
+			if (model->GetMeshes().contains("upload_error") && idx + 1 == model->GetUploadCount())
+			{
+				// The model may be freed once the loader drops it, a later one could reuse its address
+				mStates.erase(model);
+				throw std::runtime_error("upload failed");
+			}
+
+			// Uploads of a model go in order, each one once
+			CAROL_CHECK(idx == state.UploadCount);
+			++state.UploadCount;
+			state.FenceValue = mFenceValue;
+
+			mFrameBytes += model->GetUploadSize(idx);
+			++mFrameUploadCount;
+		}
+
+		virtual void AddModel(std::unique_ptr<Carol::ModelNode> node, std::unique_ptr<Carol::Model> model)override
+		{
+			auto& state = mStates[model.get()];
+
+			CAROL_CHECK(state.UploadCount == model->GetUploadCount());
+			CAROL_CHECK(state.FenceValue && state.FenceValue <= mCompletedFenceValue);
+
+			mAddedNames.push_back(node->Name);
+			mAddedModels.push_back(std::move(model));
+		}
+
+		uint64_t mFenceValue = 0;
+		uint64_t mCompletedFenceValue = 0;
+		uint64_t mFrameBytes = 0;
+		uint32_t mFrameUploadCount = 0;
+		std::vector<std::string> mAddedNames;
+
+	protected:
+		std::unordered_map<const Carol::Model*, UploadState> mStates;
+		std::vector<std::unique_ptr<Carol::Model>> mAddedModels;
+	};
+
+	// Writes a source file and the mesh cache ImportModel finds for it, so no model goes through Assimp
+	void WriteModel(const TestModel& testModel)
+	{
+		std::string path = testModel.Name + ".obj";
+		std::ofstream(path) << "# " << testModel.Name << '\n';
+
+		uint64_t key = Carol::GetMeshCacheKey(path, "", false);
+		Carol::MeshCacheWriter writer(key, false);
+		std::string texturePaths[] = { testModel.Texture, "", "", "" };
+		std::vector<std::unique_ptr<Carol::TestMesh>> meshes;
+
+		writer.WriteDependencies({});
+		writer.WriteSkeleton({}, {});
+		writer.WriteAnimationClips({});
+
+		for (uint32_t i = 0; i < testModel.GridSizes.size(); ++i)
+		{
+			std::vector<Carol::Vertex> vertices;
+			std::vector<uint32_t> indices;
+			Carol::BuildGridMesh(testModel.GridSizes[i], 0, vertices, indices);
+
+			auto& mesh = meshes.emplace_back(std::make_unique<Carol::TestMesh>(vertices, std::unordered_map<std::string, std::vector<std::vector<DirectX::XMFLOAT4X4>>>(), indices, false, false));
+			std::string meshName = i == 0 && testModel.FailUpload ? "upload_error" : "mesh" + std::to_string(i);
+
+			writer.WriteMesh(meshName, mesh->GetVertices(), mesh.get(), texturePaths);
+			writer.WriteNodeMesh(mesh.get());
+		}
+
+		CAROL_CHECK(writer.Save(Carol::GetMeshCachePath(key)));
+	}
+}
+
+int main()
+{
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(4);
+	Carol::gAnimationAssetManager = std::make_unique<Carol::AnimationAssetManager>();
+	Carol::gTextureManager = std::make_unique<Carol::TextureManager>();
+
+	auto tempDir = std::filesystem::temp_directory_path() / "carol-model-loader-test";
+	auto workingDir = std::filesystem::current_path();
+	std::filesystem::create_directories(tempDir);
+	std::filesystem::current_path(tempDir);
+	std::ofstream("broken.png") << "not an image";
+
+	// The large grid does not fit the budget and goes alone in its frame
+	std::vector<TestModel> testModels =
+	{
+		{ "small", { 4, 6 } },
+		{ "large", { 48, 8 } },
+		{ "many", { 5, 6, 7, 8, 9, 10, 11, 12 } },
+		{ "decode_error", { 6 }, "broken.png" },
+		{ "upload_error", { 16, 6 }, "", true }
+	};
+
+	std::vector<std::future<void>> loaded;
+	uint32_t frameCount = 1;
+	size_t addedCount = 0;
+
+	{
+		auto uploader = std::make_unique<FakeUploader>();
+		auto* fakeUploader = uploader.get();
+		Carol::ModelLoader loader(std::move(uploader), UPLOAD_BUDGET);
+
+		for (auto& testModel : testModels)
+		{
+			WriteModel(testModel);
+			loaded.push_back(loader.LoadModel(testModel.Name, testModel.Name + ".obj", "", DirectX::XMMatrixIdentity(), false));
+		}
+
+		for (; loader.GetPendingCount() && frameCount < MAX_FRAME_COUNT; ++frameCount)
+		{
+			uint64_t cpuFenceValue = frameCount;
+			fakeUploader->mFenceValue = cpuFenceValue + 1;
+			fakeUploader->mFrameBytes = 0;
+			fakeUploader->mFrameUploadCount = 0;
+
+			uint64_t uploadSize = loader.Upload(cpuFenceValue);
+			CAROL_CHECK(uploadSize == fakeUploader->mFrameBytes);
+			CAROL_CHECK(uploadSize <= UPLOAD_BUDGET || fakeUploader->mFrameUploadCount == 1);
+
+			fakeUploader->mCompletedFenceValue = cpuFenceValue + 1 > GPU_LAG ? cpuFenceValue + 1 - GPU_LAG : 0;
+			loader.Update(fakeUploader->mCompletedFenceValue);
+
+			// Imports run on the pool, frames are not waited for
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		CAROL_CHECK(loader.GetPendingCount() == 0);
+		addedCount = fakeUploader->mAddedNames.size();
+	}
+
+	for (uint32_t i = 0; i < testModels.size(); ++i)
+	{
+		CAROL_CHECK(loaded[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		bool failed = false;
+
+		try
+		{
+			loaded[i].get();
+		}
+		catch (...)
+		{
+			failed = true;
+		}
+
+		CAROL_CHECK(failed == (!testModels[i].Texture.empty() || testModels[i].FailUpload));
+	}
+
+	Carol::gTextureManager.reset();
+	Carol::gThreadPool.reset();
+	std::filesystem::current_path(workingDir);
+	std::filesystem::remove_all(tempDir);
+
+	// The decode error fails the import, the upload error a later frame. Neither model is added.
+	CAROL_CHECK(addedCount == 3);
+
+	std::printf("model-loader-test: %u frames, %zu of %zu models added, %d failed checks\n", frameCount, addedCount, testModels.size(), gFailedChecks);
+	return gFailedChecks;
+}
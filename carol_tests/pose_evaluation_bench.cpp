@@ -0,0 +1,99 @@
+#include "allocation_counter.h"
+#include "animation_fixture.h"
+#include "model_fixture.h"
+#include "test.h"
+#include <scene/timer.h>
+#include <utils/thread_pool.h>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace
+{
+	constexpr uint32_t CHARACTER_COUNT = 500;
+	constexpr uint32_t BONE_COUNT = 100;
+	constexpr uint32_t FRAME_COUNT = 200;
+}
+
+// carol-pose-evaluation-bench [max threads]
+// Evaluates 500 characters with 100-bone skeletons every frame the way ModelManager::Update does, on 1 thread up to the maximum
+int main(int argc, char** argv)
+{
+	uint32_t maxThreadCount = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+	maxThreadCount = std::max(maxThreadCount, 1u);
+
+	auto skeleton = Carol::BuildTestSkeleton(BONE_COUNT);
+	std::shared_ptr<const Carol::CompressedAnimationClip> clip = std::make_shared<Carol::CompressedAnimationClip>(Carol::BuildTestClip(BONE_COUNT, 10.f, 30.f));
+	std::vector<std::unique_ptr<Carol::TestModel>> models;
+
+	for (uint32_t i = 0; i < CHARACTER_COUNT; ++i)
+	{
+		auto& model = models.emplace_back(std::make_unique<Carol::TestModel>(skeleton));
+		model->AddAnimationClip("clip", clip);
+		model->SetAnimationClip("clip");
+	}
+
+	Carol::Timer timer;
+	timer.Reset();
+
+	std::printf("%u characters, %u bones\n", CHARACTER_COUNT, BONE_COUNT);
+	double serialMilliseconds = 0.0;
+
+	std::vector<uint32_t> threadCounts;
+
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(maxThreadCount);
+
+	for (auto threadCount : threadCounts)
+	{
+		// The calling thread takes part in the loop, so a pool of n - 1 workers runs on n threads
+		auto pool = threadCount > 1 ? std::make_unique<Carol::ThreadPool>(threadCount - 1) : nullptr;
+
+		auto update = [&]()
+		{
+			timer.Tick();
+
+			if (pool)
+			{
+				pool->ParallelFor(models.size(), [&](uint32_t i)
+				{
+					models[i]->Update(&timer);
+				});
+			}
+			else
+			{
+				for (auto& model : models)
+				{
+					model->Update(&timer);
+				}
+			}
+		};
+
+		// Arenas and pose buffers grow to their peak in the first frames
+		for (uint32_t frame = 0; frame < 10; ++frame)
+		{
+			update();
+		}
+
+		uint64_t allocationCount = gAllocationCount;
+		Carol::Stopwatch stopwatch;
+
+		for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame)
+		{
+			update();
+		}
+
+		double milliseconds = stopwatch.Milliseconds() / FRAME_COUNT;
+		double allocations = double(gAllocationCount - allocationCount) / FRAME_COUNT;
+		serialMilliseconds = threadCount == 1 ? milliseconds : serialMilliseconds;
+
+		std::printf("%2u threads %8.3f ms/frame %6.2fx speedup %5.1f%% efficiency %6.1f allocations/frame\n",
+			threadCount, milliseconds, serialMilliseconds / milliseconds, 100.0 * serialMilliseconds / milliseconds / threadCount, allocations);
+	}
+
+	return 0;
+}
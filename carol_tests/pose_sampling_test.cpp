@@ -0,0 +1,175 @@
+#include "model_fixture.h"
+#include "test.h"
+#include <scene/skinned_animation.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t BONE_COUNT = 40;
+	constexpr float CLIP_DURATION = 5.f;
+	constexpr float KEY_RATE = 60.f;
+
+	// Every bone swings about z in phase, so the extremes of the whole chain fall between fixed steps
+	Carol::AnimationClip BuildSwingClip(float amplitude, float frequency)
+	{
+		Carol::AnimationClip clip;
+		clip.BoneAnimations.resize(BONE_COUNT);
+
+		for (uint32_t i = 0; i < BONE_COUNT; ++i)
+		{
+			auto& bone = clip.BoneAnimations[i];
+
+			for (uint32_t k = 0; k <= CLIP_DURATION * KEY_RATE; ++k)
+			{
+				float t = k / KEY_RATE;
+				float angle = amplitude * std::sin(frequency * t);
+				DirectX::XMFLOAT4 q;
+				DirectX::XMStoreFloat4(&q, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.f, 0.f, 1.f, 0.f), angle));
+
+				bone.TranslationKeyframes.push_back({ t, { 0.f, 1.f, 0.f } });
+				bone.ScaleKeyframes.push_back({ t, { 1.f, 1.f, 1.f } });
+				bone.RotationQuatKeyframes.push_back({ t, q });
+			}
+		}
+
+		clip.CalcClipStartTime();
+		clip.CalcClipEndTime();
+		return clip;
+	}
+
+	class JointBounds
+	{
+	public:
+		DirectX::XMFLOAT3 Min = { FLT_MAX, FLT_MAX, FLT_MAX };
+		DirectX::XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	};
+
+	std::vector<DirectX::XMFLOAT3> GetBindJoints(const Carol::Skeleton& skeleton)
+	{
+		std::vector<DirectX::XMFLOAT3> joints(skeleton.Offsets.size());
+
+		for (uint32_t i = 0; i < joints.size(); ++i)
+		{
+			DirectX::XMStoreFloat3(&joints[i], DirectX::XMMatrixInverse(nullptr, DirectX::XMLoadFloat4x4(&skeleton.Offsets[i])).r[3]);
+		}
+
+		return joints;
+	}
+
+	void AddPose(JointBounds& bounds, std::span<const DirectX::XMFLOAT3> bindJoints, std::span<const DirectX::XMFLOAT4X4> pose)
+	{
+		for (uint32_t i = 0; i < pose.size(); ++i)
+		{
+			DirectX::XMFLOAT3 joint;
+			DirectX::XMStoreFloat3(&joint, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&bindJoints[i]), DirectX::XMLoadFloat4x4(&pose[i])));
+			bounds.Min = { std::min(bounds.Min.x, joint.x), std::min(bounds.Min.y, joint.y), std::min(bounds.Min.z, joint.z) };
+			bounds.Max = { std::max(bounds.Max.x, joint.x), std::max(bounds.Max.y, joint.y), std::max(bounds.Max.z, joint.z) };
+		}
+	}
+
+	// How far the exact bounds reach outside the sampled ones, 0 when the samples are conservative
+	float GetBoundsMiss(const JointBounds& sampled, const JointBounds& exact)
+	{
+		float miss = 0.f;
+		miss = std::max({ miss, sampled.Min.x - exact.Min.x, sampled.Min.y - exact.Min.y, sampled.Min.z - exact.Min.z });
+		miss = std::max({ miss, exact.Max.x - sampled.Max.x, exact.Max.y - sampled.Max.y, exact.Max.z - sampled.Max.z });
+		return miss;
+	}
+
+	class ClipResult
+	{
+	public:
+		Carol::PoseSamplingStats Stats;
+		uint32_t FixedSampleCount = 0;
+		float Miss = 0.f;
+		float FixedMiss = 0.f;
+	};
+
+	// Samples the clip adaptively and at the old fixed 0.1 s step, and compares both against dense sampling
+	ClipResult SampleClip(const Carol::TestModel& model, const Carol::Skeleton& skeleton, const Carol::AnimationClip& rawClip, const Carol::PoseSamplingSettings& settings)
+	{
+		Carol::CompressedAnimationClip clip(rawClip);
+		auto bindJoints = GetBindJoints(skeleton);
+		std::vector<std::vector<DirectX::XMFLOAT4X4>> frameTransforms;
+		std::vector<DirectX::XMFLOAT4X4> pose(BONE_COUNT);
+		Carol::AnimationCursor cursor;
+
+		ClipResult result;
+		result.Stats = model.SamplePoses(&clip, settings, frameTransforms);
+
+		JointBounds bounds;
+		JointBounds fixedBounds;
+		JointBounds exactBounds;
+
+		for (auto& frame : frameTransforms)
+		{
+			AddPose(bounds, bindJoints, frame);
+		}
+
+		for (float t = clip.GetClipStartTime(); t <= clip.GetClipEndTime(); t += 0.1f)
+		{
+			model.GetFinalTransforms(&clip, t, cursor, pose);
+			AddPose(fixedBounds, bindJoints, pose);
+			++result.FixedSampleCount;
+		}
+
+		for (float t = clip.GetClipStartTime(); t <= clip.GetClipEndTime(); t += 1.f / 960.f)
+		{
+			model.GetFinalTransforms(&clip, t, cursor, pose);
+			AddPose(exactBounds, bindJoints, pose);
+		}
+
+		result.Miss = GetBoundsMiss(bounds, exactBounds);
+		result.FixedMiss = GetBoundsMiss(fixedBounds, exactBounds);
+		return result;
+	}
+}
+
+int main()
+{
+	auto skeleton = Carol::BuildTestSkeleton(BONE_COUNT);
+	Carol::TestModel model(skeleton);
+	Carol::PoseSamplingSettings settings;
+
+	// Same measure of the skeleton SamplePoses scales the tolerance by
+	auto bindJoints = GetBindJoints(*skeleton);
+	float height = 0.f;
+
+	for (auto& joint : bindJoints)
+	{
+		height = std::max(height, joint.y);
+	}
+
+	float tolerance = settings.Tolerance * 0.5f * height;
+
+	auto idle = SampleClip(model, *skeleton, BuildSwingClip(0.02f, 1.f), settings);
+	auto fast = SampleClip(model, *skeleton, BuildSwingClip(0.5f, 6.f), settings);
+
+	// Idle clips only need the samples MaxInterval asks for, fast ones are refined
+	CAROL_CHECK(idle.Stats.SampleCount <= uint32_t(CLIP_DURATION / settings.MaxInterval) * 2 + 1);
+	CAROL_CHECK(idle.Stats.SampleCount < idle.FixedSampleCount);
+	CAROL_CHECK(fast.Stats.SampleCount > 4 * idle.Stats.SampleCount);
+
+	// Accepted intervals deviate less than the tolerance unless they hit MinInterval, which this clip does not need
+	CAROL_CHECK(idle.Stats.MaxDeviation <= tolerance);
+	CAROL_CHECK(fast.Stats.MaxDeviation <= tolerance);
+
+	// Bounds from the samples miss the exact ones by no more than the tolerance
+	CAROL_CHECK(idle.Miss <= tolerance);
+	CAROL_CHECK(fast.Miss <= tolerance);
+
+	// Deterministic for the cull data cache
+	auto fastAgain = SampleClip(model, *skeleton, BuildSwingClip(0.5f, 6.f), settings);
+	CAROL_CHECK(fastAgain.Stats.SampleCount == fast.Stats.SampleCount);
+	CAROL_CHECK(fastAgain.Stats.MaxDeviation == fast.Stats.MaxDeviation);
+
+	std::printf("pose-sampling-test: tolerance %g\n", tolerance);
+	std::printf("  idle %4u samples, deviation %g, bounds miss %g (fixed step %u samples, miss %g)\n",
+		idle.Stats.SampleCount, idle.Stats.MaxDeviation, idle.Miss, idle.FixedSampleCount, idle.FixedMiss);
+	std::printf("  fast %4u samples, deviation %g, bounds miss %g (fixed step %u samples, miss %g)\n",
+		fast.Stats.SampleCount, fast.Stats.MaxDeviation, fast.Miss, fast.FixedSampleCount, fast.FixedMiss);
+	std::printf("pose-sampling-test: %d failed checks\n", gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,154 @@
+#include "test.h"
+#include <utils/shader_archive.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t SYNTHETIC_SHADER_COUNT = 64;
+	constexpr uint32_t REPEAT_COUNT = 20;
+
+	// What Shader::Shader did per shader before the archive
+	std::vector<std::byte> ReadFile(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		std::vector<std::byte> bytecode(size_t(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytecode.data()), bytecode.size());
+
+		return bytecode;
+	}
+
+	// Blobs of 4 to 64 KB, about the size of the compiled engine shaders
+	std::vector<std::string> WriteSyntheticShaders(const std::filesystem::path& dir)
+	{
+		std::filesystem::create_directories(dir);
+		std::mt19937 random(3);
+		std::uniform_int_distribution<uint32_t> size(4 << 10, 64 << 10);
+		std::vector<std::string> paths;
+
+		for (uint32_t i = 0; i < SYNTHETIC_SHADER_COUNT; ++i)
+		{
+			std::vector<char> bytecode(size(random));
+			std::ranges::generate(bytecode, [&]() { return char(random()); });
+
+			auto& path = paths.emplace_back((dir / ("shader_" + std::to_string(i) + ".dxil")).generic_string());
+			std::ofstream(path, std::ios::binary).write(bytecode.data(), bytecode.size());
+		}
+
+		return paths;
+	}
+}
+
+// carol-shader-archive-bench [dxil directory]
+// Startup shader I/O: reading every shader file into its own buffer against mapping one archive and looking the shaders
+// up by name hash. Without a directory, 64 synthetic shaders are written to the temp directory. Files are in the
+// page cache after the first pass, so this measures the per-file cost rather than the disk.
+int main(int argc, char** argv)
+{
+	auto tempDir = std::filesystem::temp_directory_path() / "carol-shader-archive-bench";
+	std::vector<std::string> paths;
+	std::error_code ec;
+
+	if (argc > 1)
+	{
+		for (auto& entry : std::filesystem::directory_iterator(argv[1], ec))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".dxil")
+			{
+				paths.push_back(entry.path().generic_string());
+			}
+		}
+
+		std::ranges::sort(paths);
+	}
+	else
+	{
+		paths = WriteSyntheticShaders(tempDir / "dxil");
+	}
+
+	std::filesystem::create_directories(tempDir, ec);
+	std::string archivePath = (tempDir / "shader.pack").generic_string();
+
+	if (paths.empty() || !Carol::SaveShaderArchive(paths, archivePath))
+	{
+		std::fprintf(stderr, "carol-shader-archive-bench: no shaders to pack\n");
+		return 1;
+	}
+
+	uint64_t totalSize = 0;
+	uint32_t mismatchCount = 0;
+
+	// Both paths hand out the same bytes
+	{
+		Carol::ShaderArchive archive(archivePath);
+
+		for (auto& path : paths)
+		{
+			auto bytecode = ReadFile(path);
+			auto* entry = archive.Find(Carol::GetShaderNameHash(path));
+			auto view = entry ? archive.GetBytecode(*entry) : std::span<const uint8_t>();
+			mismatchCount += view.size() != bytecode.size() || std::memcmp(view.data(), bytecode.data(), view.size()) != 0;
+			totalSize += bytecode.size();
+		}
+	}
+
+	double fileMilliseconds = 1e30;
+	double archiveMilliseconds = 1e30;
+	double touchMilliseconds = 1e30;
+	uint64_t checksum = 0;
+
+	for (uint32_t repeat = 0; repeat < REPEAT_COUNT; ++repeat)
+	{
+		Carol::Stopwatch fileStopwatch;
+
+		for (auto& path : paths)
+		{
+			checksum += ReadFile(path).size();
+		}
+
+		fileMilliseconds = std::min(fileMilliseconds, fileStopwatch.Milliseconds());
+
+		Carol::Stopwatch archiveStopwatch;
+		Carol::ShaderArchive archive(archivePath);
+
+		for (auto& path : paths)
+		{
+			checksum += archive.GetBytecode(*archive.Find(Carol::GetShaderNameHash(path))).size();
+		}
+
+		archiveMilliseconds = std::min(archiveMilliseconds, archiveStopwatch.Milliseconds());
+
+		// The driver reads the whole blob when it builds the PSO, which faults in the mapped pages
+		Carol::Stopwatch touchStopwatch;
+
+		for (auto& path : paths)
+		{
+			auto bytecode = archive.GetBytecode(*archive.Find(Carol::GetShaderNameHash(path)));
+
+			for (size_t i = 0; i < bytecode.size(); i += 4096)
+			{
+				checksum += bytecode[i];
+			}
+		}
+
+		touchMilliseconds = std::min(touchMilliseconds, archiveMilliseconds + touchStopwatch.Milliseconds());
+	}
+
+	std::printf("%zu shaders, %.1f KB, %u mismatches (checksum %llu)\n", paths.size(), totalSize / 1024.0, mismatchCount, (unsigned long long)checksum);
+	std::printf("%-24s %8.3f ms\n", "ifstream per shader", fileMilliseconds);
+	std::printf("%-24s %8.3f ms  %.1fx faster\n", "mapped archive lookup", archiveMilliseconds, fileMilliseconds / archiveMilliseconds);
+	std::printf("%-24s %8.3f ms  %.1fx faster\n", "lookup and page in", touchMilliseconds, fileMilliseconds / touchMilliseconds);
+
+	if (argc <= 1)
+	{
+		std::filesystem::remove_all(tempDir, ec);
+	}
+
+	return mismatchCount != 0;
+}
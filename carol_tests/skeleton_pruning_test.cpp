@@ -0,0 +1,217 @@
+#include "test.h"
+#include <scene/animation_asset.h>
+#include <scene/assimp.h>
+#include <scene/compressed_animation.h>
+#include <scene/mesh.h>
+#include <scene/texture.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <assimp/scene.h>
+#include <cmath>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// The pruned skeleton in depth-first order: Root, Armature, Hips, Spine, Chest, LeftLeg, LeftFoot.
+	// Spine skins nothing but has a bone below it, ChestEnd and IKTarget are leaves without weights.
+	const std::vector<int> PRUNED_HIERARCHY = { -1, 0, 1, 2, 3, 2, 5 };
+	// Bones of the mesh in the order it lists them, which is not the order of the hierarchy
+	const char* MESH_BONES[] = { "LeftFoot", "Chest", "Hips", "LeftLeg" };
+	const int MESH_BONE_INDICES[] = { 6, 4, 2, 5 };
+
+	constexpr int HIPS_INDEX = 2;
+	constexpr int CHEST_INDEX = 4;
+
+	class TestAssimpModel : public Carol::AssimpModel
+	{
+	public:
+		using AssimpModel::AssimpModel;
+
+		const Carol::CompressedAnimationClip* GetClip(const std::string& clipName)const
+		{
+			return mAnimationClips.at(clipName).get();
+		}
+
+		std::span<const Carol::Vertex> GetVertices(const std::string& meshName)const
+		{
+			for (auto& upload : mUploads)
+			{
+				if (upload.Target == mMeshes.at(meshName).get())
+				{
+					return upload.Vertices;
+				}
+			}
+
+			return {};
+		}
+	};
+
+	aiNode* AddChild(aiNode* parent, const char* name)
+	{
+		auto* child = new aiNode(name);
+		parent->addChildren(1, &child);
+
+		return child;
+	}
+
+	// One triangle per bone of MESH_BONES, fully weighted to it. The offset of bone i moves it by i + 1 along x.
+	aiMesh* BuildMesh()
+	{
+		auto* mesh = new aiMesh();
+		uint32_t boneCount = std::size(MESH_BONES);
+		mesh->mName.Set("body");
+		mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+		mesh->mNumVertices = boneCount * 3;
+		mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+		mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+		mesh->mNumFaces = boneCount;
+		mesh->mFaces = new aiFace[boneCount];
+		mesh->mNumBones = boneCount;
+		mesh->mBones = new aiBone*[boneCount];
+
+		for (uint32_t i = 0; i < boneCount; ++i)
+		{
+			auto& face = mesh->mFaces[i];
+			face.mNumIndices = 3;
+			face.mIndices = new unsigned int[3] { i * 3, i * 3 + 1, i * 3 + 2 };
+
+			mesh->mVertices[i * 3] = aiVector3D(float(i), 0.f, 0.f);
+			mesh->mVertices[i * 3 + 1] = aiVector3D(float(i) + 1.f, 0.f, 0.f);
+			mesh->mVertices[i * 3 + 2] = aiVector3D(float(i), 1.f, 0.f);
+
+			auto* bone = mesh->mBones[i] = new aiBone();
+			bone->mName.Set(MESH_BONES[i]);
+			bone->mNumWeights = 3;
+			bone->mWeights = new aiVertexWeight[3];
+			aiMatrix4x4::Translation(aiVector3D(float(i) + 1.f, 0.f, 0.f), bone->mOffsetMatrix);
+
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				mesh->mNormals[i * 3 + j] = aiVector3D(0.f, 0.f, -1.f);
+				bone->mWeights[j] = aiVertexWeight(i * 3 + j, 1.f);
+			}
+		}
+
+		return mesh;
+	}
+
+	// Holds the translation over the second the clip lasts
+	aiNodeAnim* BuildChannel(const char* nodeName, const aiVector3D& translation)
+	{
+		auto* channel = new aiNodeAnim();
+		channel->mNodeName.Set(nodeName);
+		channel->mNumPositionKeys = 2;
+		channel->mPositionKeys = new aiVectorKey[2] { aiVectorKey(0.0, translation), aiVectorKey(1.0, translation) };
+		channel->mNumRotationKeys = 2;
+		channel->mRotationKeys = new aiQuatKey[2] { aiQuatKey(0.0, aiQuaternion(1.f, 0.f, 0.f, 0.f)), aiQuatKey(1.0, aiQuaternion(1.f, 0.f, 0.f, 0.f)) };
+		channel->mNumScalingKeys = 2;
+		channel->mScalingKeys = new aiVectorKey[2] { aiVectorKey(0.0, aiVector3D(1.f, 1.f, 1.f)), aiVectorKey(1.0, aiVector3D(1.f, 1.f, 1.f)) };
+
+		return channel;
+	}
+
+	// Root
+	//   body         mesh node
+	//   Armature
+	//     Hips       bone
+	//       Spine
+	//         Chest  bone
+	//           ChestEnd
+	//       LeftLeg  bone
+	//         LeftFoot bone
+	//     IKTarget   animated, skins nothing
+	void BuildScene(aiScene& scene)
+	{
+		scene.mRootNode = new aiNode("Root");
+		auto* body = AddChild(scene.mRootNode, "body");
+		body->mNumMeshes = 1;
+		body->mMeshes = new unsigned int[1] { 0 };
+
+		auto* armature = AddChild(scene.mRootNode, "Armature");
+		auto* hips = AddChild(armature, "Hips");
+		auto* chest = AddChild(AddChild(hips, "Spine"), "Chest");
+		AddChild(chest, "ChestEnd");
+		AddChild(AddChild(hips, "LeftLeg"), "LeftFoot");
+		AddChild(armature, "IKTarget");
+
+		scene.mNumMeshes = 1;
+		scene.mMeshes = new aiMesh*[1] { BuildMesh() };
+		scene.mNumMaterials = 1;
+		scene.mMaterials = new aiMaterial*[1] { new aiMaterial() };
+
+		auto* animation = new aiAnimation();
+		animation->mName.Set("walk");
+		animation->mDuration = 1.0;
+		animation->mTicksPerSecond = 1.0;
+		animation->mNumChannels = 4;
+		animation->mChannels = new aiNodeAnim*[4]
+		{
+			BuildChannel("Hips", aiVector3D(0.f, 1.f, 0.f)),
+			BuildChannel("Chest", aiVector3D(0.f, 2.f, 0.f)),
+			BuildChannel("ChestEnd", aiVector3D(0.f, 0.f, 9.f)),
+			BuildChannel("IKTarget", aiVector3D(0.f, 0.f, 7.f))
+		};
+
+		scene.mNumAnimations = 1;
+		scene.mAnimations = new aiAnimation*[1] { animation };
+	}
+}
+
+int main()
+{
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(2);
+	Carol::gAnimationAssetManager = std::make_unique<Carol::AnimationAssetManager>();
+	Carol::gTextureManager = std::make_unique<Carol::TextureManager>();
+
+	{
+		aiScene scene;
+		BuildScene(scene);
+
+		Carol::ModelNode rootNode;
+		TestAssimpModel model(&rootNode, &scene, "", true);
+		auto* skeleton = model.GetSkeleton();
+
+		// Ancestors of skinned bones are kept, leaves skinning nothing and the mesh node are removed
+		CAROL_CHECK(skeleton->Hierarchy == PRUNED_HIERARCHY);
+		CAROL_CHECK(skeleton->Offsets.size() == PRUNED_HIERARCHY.size());
+		CAROL_CHECK(rootNode.Meshes.size() == 1);
+
+		// Offsets and vertex weights land on the index of their bone in the pruned skeleton
+		auto vertices = model.GetVertices("body");
+		CAROL_CHECK(vertices.size() == std::size(MESH_BONES) * 3);
+
+		for (uint32_t i = 0; i < std::size(MESH_BONES) && vertices.size() == std::size(MESH_BONES) * 3; ++i)
+		{
+			CAROL_CHECK(skeleton->Offsets[MESH_BONE_INDICES[i]]._41 == i + 1.f);
+
+			for (uint32_t j = i * 3; j < i * 3 + 3; ++j)
+			{
+				CAROL_CHECK(vertices[j].BoneIndices.x == MESH_BONE_INDICES[i]);
+				CAROL_CHECK(vertices[j].Weights.x == 1.f);
+			}
+		}
+
+		// Channels of kept bones drive them, the ones of removed nodes move nothing
+		auto* clip = model.GetClip("walk");
+		std::vector<DirectX::XMFLOAT4X4> boneTransforms(PRUNED_HIERARCHY.size());
+		CAROL_CHECK(clip->GetBoneCount() == PRUNED_HIERARCHY.size());
+		clip->Interpolate(0.5f, boneTransforms);
+
+		CAROL_CHECK(std::abs(boneTransforms[HIPS_INDEX]._42 - 1.f) < 1e-3f);
+		CAROL_CHECK(std::abs(boneTransforms[CHEST_INDEX]._42 - 2.f) < 1e-3f);
+
+		for (auto& transform : boneTransforms)
+		{
+			CAROL_CHECK(std::abs(transform._43) < 1e-3f);
+		}
+	}
+
+	Carol::gTextureManager.reset();
+	Carol::gAnimationAssetManager.reset();
+	Carol::gThreadPool.reset();
+
+	std::printf("skeleton-pruning-test: %zu bones kept, %d failed checks\n", PRUNED_HIERARCHY.size(), gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+// Failed checks are reported and counted rather than aborting, so one run lists every failure.
+// Tests return the count from main, which ctest reports as a failure when it is not zero.
+inline int gFailedChecks = 0;
+
+#define CAROL_CHECK(condition) \
+	((condition) ? void(0) : (std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition), void(++gFailedChecks)))
+
+namespace Carol
+{
+	// Milliseconds since construction, for the benchmarks
+	class Stopwatch
+	{
+	public:
+		double Milliseconds()const
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+		}
+
+	protected:
+		std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+	};
+}
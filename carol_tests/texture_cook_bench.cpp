@@ -0,0 +1,139 @@
+#include "test.h"
+#include <scene/texture_cache.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* USAGE_NAMES[] = { "diffuse", "normal", "emissive", "metallic roughness" };
+
+	// Smooth gradients with some high frequency detail, normals are unit vectors encoded to unorm
+	void BuildSource(Carol::TextureUsage usage, uint32_t size, uint32_t seed, DirectX::ScratchImage& image)
+	{
+		image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, size, size, 1, 1);
+		auto* top = image.GetImage(0, 0, 0);
+
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			uint8_t* row = top->pixels + y * top->rowPitch;
+
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				float u = float(x) / size;
+				float v = float(y) / size;
+				uint8_t* texel = row + 4 * x;
+
+				if (usage == Carol::TEXTURE_USAGE_NORMAL)
+				{
+					float nx = 0.4f * std::sin(20.f * u + seed);
+					float ny = 0.4f * std::cos(17.f * v + seed);
+					float nz = std::sqrt(1.f - nx * nx - ny * ny);
+					texel[0] = uint8_t((nx * 0.5f + 0.5f) * 255.f + 0.5f);
+					texel[1] = uint8_t((ny * 0.5f + 0.5f) * 255.f + 0.5f);
+					texel[2] = uint8_t((nz * 0.5f + 0.5f) * 255.f + 0.5f);
+				}
+				else
+				{
+					texel[0] = uint8_t(128.f + 120.f * std::sin(13.f * u + seed));
+					texel[1] = uint8_t(128.f + 120.f * std::cos(11.f * v));
+					texel[2] = uint8_t((x ^ y) & 255);
+				}
+
+				texel[3] = 255;
+			}
+		}
+	}
+
+	// What the same texture takes uncompressed with its mips
+	uint64_t GetMippedRgbaSize(uint32_t size)
+	{
+		uint64_t bytes = 0;
+
+		for (uint64_t level = size; ; level = std::max<uint64_t>(level / 2, 1))
+		{
+			bytes += level * level * 4;
+
+			if (level == 1)
+			{
+				return bytes;
+			}
+		}
+	}
+}
+
+// carol-texture-cook-bench [textures per usage] [size] [threads]
+// Cooks square synthetic sources of every usage into the formats of the texture cache, one task per texture
+// like TextureManager::DecodeTextures, and reports cook time and the VRAM saved against RGBA8 with mips.
+int main(int argc, char** argv)
+{
+	uint32_t textureCount = argc > 1 ? std::atoi(argv[1]) : 8;
+	uint32_t size = argc > 2 ? std::atoi(argv[2]) : 1024;
+	uint32_t threadCount = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(threadCount);
+
+	std::printf("%u textures of %ux%u per usage, %u threads\n", textureCount, size, size, Carol::gThreadPool->GetThreadCount());
+	std::printf("%-20s %10s %10s %12s %12s %8s\n", "usage", "cook ms", "MB/s", "RGBA8 MB", "cooked MB", "saved");
+
+	double totalMilliseconds = 0.0;
+	uint64_t totalRgbaBytes = 0;
+	uint64_t totalCookedBytes = 0;
+
+	for (uint32_t usage = 0; usage < Carol::TEXTURE_USAGE_UNKNOWN; ++usage)
+	{
+		std::vector<DirectX::ScratchImage> sources(textureCount);
+		std::vector<DirectX::ScratchImage> cooked(textureCount);
+
+		for (uint32_t i = 0; i < textureCount; ++i)
+		{
+			BuildSource(Carol::TextureUsage(usage), size, i, sources[i]);
+		}
+
+		std::vector<HRESULT> results(textureCount);
+		Carol::Stopwatch stopwatch;
+
+		Carol::gThreadPool->ParallelFor(textureCount, [&](uint32_t i)
+		{
+			results[i] = Carol::CookTexture(sources[i], Carol::TextureUsage(usage), cooked[i]);
+		});
+
+		double milliseconds = stopwatch.Milliseconds();
+		uint64_t rgbaBytes = textureCount * GetMippedRgbaSize(size);
+		uint64_t cookedBytes = 0;
+
+		for (uint32_t i = 0; i < textureCount; ++i)
+		{
+			cookedBytes += SUCCEEDED(results[i]) ? cooked[i].GetPixelsSize() : 0;
+		}
+
+		uint32_t failedCount = std::ranges::count_if(results, [](HRESULT hr) { return FAILED(hr); });
+
+		std::printf("%-20s %10.1f %10.1f %12.1f %12.1f %7.1f%%%s\n",
+			USAGE_NAMES[usage],
+			milliseconds,
+			textureCount * double(size) * size * 4 / milliseconds / 1e3,
+			rgbaBytes / double(1 << 20),
+			cookedBytes / double(1 << 20),
+			100.0 * (1.0 - double(cookedBytes) / rgbaBytes),
+			failedCount ? " (failed cooks)" : "");
+
+		totalMilliseconds += milliseconds;
+		totalRgbaBytes += rgbaBytes;
+		totalCookedBytes += cookedBytes;
+	}
+
+	std::printf("%-20s %10.1f %10s %12.1f %12.1f %7.1f%%\n",
+		"total",
+		totalMilliseconds,
+		"",
+		totalRgbaBytes / double(1 << 20),
+		totalCookedBytes / double(1 << 20),
+		100.0 * (1.0 - double(totalCookedBytes) / totalRgbaBytes));
+
+	Carol::gThreadPool.reset();
+	return 0;
+}
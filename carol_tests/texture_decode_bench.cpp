@@ -0,0 +1,123 @@
+#include "test.h"
+#include <utils/image_decoder.h>
+#include <utils/thread_pool.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	bool IsImageFile(const std::filesystem::path& path)
+	{
+		auto extension = path.extension().string();
+		std::ranges::transform(extension, extension.begin(), [](char c) { return char(std::tolower(c)); });
+
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".dds";
+	}
+}
+
+// carol-texture-decode-bench <texture dir> [texture count] [max threads]
+// Decodes a scene of 500 textures by default, the images of the directory repeated until the count is reached,
+// with one task per texture like TextureManager::DecodeTextures. Images are dropped once decoded.
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: carol-texture-decode-bench <texture dir> [texture count] [max threads]\n");
+		return 1;
+	}
+
+	uint32_t textureCount = argc > 2 ? std::atoi(argv[2]) : 500;
+	uint32_t maxThreadCount = argc > 3 ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+	maxThreadCount = std::max(maxThreadCount, 1u);
+
+	std::vector<std::string> files;
+	std::error_code ec;
+
+	for (auto& entry : std::filesystem::directory_iterator(argv[1], ec))
+	{
+		if (entry.is_regular_file() && IsImageFile(entry.path()))
+		{
+			files.push_back(entry.path().string());
+		}
+	}
+
+	if (files.empty())
+	{
+		std::fprintf(stderr, "carol-texture-decode-bench: no png, jpg, tga or dds files in %s\n", argv[1]);
+		return 1;
+	}
+
+	std::ranges::sort(files);
+	std::vector<std::string_view> scene;
+
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		scene.push_back(files[i % files.size()]);
+	}
+
+	std::vector<uint32_t> threadCounts;
+
+	for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(maxThreadCount);
+	std::printf("%u textures from %zu files\n", textureCount, files.size());
+	double serialMilliseconds = 0.0;
+
+	for (auto threadCount : threadCounts)
+	{
+		std::atomic<uint64_t> decodedBytes = 0;
+		std::atomic<uint32_t> failedCount = 0;
+
+		auto decode = [&](uint32_t i)
+		{
+			DirectX::ScratchImage image;
+
+			if (SUCCEEDED(Carol::DecodeImage(scene[i], image)))
+			{
+				decodedBytes += image.GetPixelsSize();
+			}
+			else
+			{
+				++failedCount;
+			}
+		};
+
+		// The calling thread takes part in the loop, so a pool of n - 1 workers runs on n threads
+		auto pool = threadCount > 1 ? std::make_unique<Carol::ThreadPool>(threadCount - 1) : nullptr;
+		Carol::Stopwatch stopwatch;
+
+		if (pool)
+		{
+			pool->ParallelFor(scene.size(), decode);
+		}
+		else
+		{
+			for (uint32_t i = 0; i < scene.size(); ++i)
+			{
+				decode(i);
+			}
+		}
+
+		double milliseconds = stopwatch.Milliseconds();
+		serialMilliseconds = threadCount == 1 ? milliseconds : serialMilliseconds;
+
+		std::printf("%2u threads %10.1f ms %8.1f textures/s %8.1f MB/s decoded %6.2fx speedup %u failed\n",
+			threadCount,
+			milliseconds,
+			scene.size() * 1e3 / milliseconds,
+			decodedBytes / milliseconds / 1e3,
+			serialMilliseconds / milliseconds,
+			failedCount.load());
+	}
+
+	return 0;
+}
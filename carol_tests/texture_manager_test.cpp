@@ -0,0 +1,70 @@
+#include "test.h"
+#include <scene/texture.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	void WriteFile(const std::filesystem::path& path, const std::string& content)
+	{
+		std::ofstream(path, std::ios::binary).write(content.data(), content.size());
+	}
+}
+
+// Textures are only acquired, never decoded, so the files need not be images
+int main()
+{
+	auto tempDir = std::filesystem::temp_directory_path() / "carol-texture-manager-test";
+	std::filesystem::create_directories(tempDir / "copy");
+
+	std::string content(3000, 'a');
+	std::string path = (tempDir / "brick.png").generic_string();
+	std::string copyPath = (tempDir / "copy" / "brick.png").generic_string();
+	std::string otherPath = (tempDir / "stone.png").generic_string();
+
+	WriteFile(path, content);
+	WriteFile(copyPath, content);
+	WriteFile(otherPath, std::string(content.size(), 'b'));
+
+	{
+		Carol::TextureManager textureManager;
+
+		// The copy resolves to the texture of the first path, its bytes are counted once
+		auto* texture = textureManager.AcquireTexture(path, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		CAROL_CHECK(texture && textureManager.GetDuplicateBytes() == 0);
+		CAROL_CHECK(textureManager.AcquireTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE) == texture);
+		CAROL_CHECK(textureManager.GetDuplicateBytes() == content.size());
+
+		// Paths already loaded are not hashed again
+		CAROL_CHECK(textureManager.AcquireTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE) == texture);
+		CAROL_CHECK(textureManager.AcquireTexture(path, false, Carol::TEXTURE_USAGE_DIFFUSE) == texture);
+		CAROL_CHECK(textureManager.GetDuplicateBytes() == content.size());
+
+		// Other content, or the same content cooked for another usage, is a texture of its own
+		auto* otherTexture = textureManager.AcquireTexture(otherPath, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		auto* normalTexture = textureManager.AcquireTexture(copyPath, false, Carol::TEXTURE_USAGE_NORMAL);
+		CAROL_CHECK(otherTexture && otherTexture != texture);
+		CAROL_CHECK(normalTexture && normalTexture != texture);
+		CAROL_CHECK(textureManager.GetDuplicateBytes() == content.size());
+
+		// The shared texture lives until the last reference of either path is released
+		textureManager.UnloadTexture(path, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		textureManager.UnloadTexture(path, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		CAROL_CHECK(textureManager.FindTexture(path, false, Carol::TEXTURE_USAGE_DIFFUSE) == nullptr);
+		CAROL_CHECK(textureManager.FindTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE) == texture);
+
+		textureManager.UnloadTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		textureManager.UnloadTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE);
+		CAROL_CHECK(textureManager.FindTexture(copyPath, false, Carol::TEXTURE_USAGE_DIFFUSE) == nullptr);
+		CAROL_CHECK(textureManager.FindTexture(copyPath, false, Carol::TEXTURE_USAGE_NORMAL) == normalTexture);
+
+		textureManager.UnloadTexture(copyPath, false, Carol::TEXTURE_USAGE_NORMAL);
+		textureManager.UnloadTexture(otherPath, false, Carol::TEXTURE_USAGE_DIFFUSE);
+	}
+
+	std::filesystem::remove_all(tempDir);
+
+	std::printf("texture-manager-test: %d failed checks\n", gFailedChecks);
+	return gFailedChecks;
+}
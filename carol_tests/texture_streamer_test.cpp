@@ -0,0 +1,252 @@
+#include "test.h"
+#include <scene/texture_streamer.h>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t TEXTURE_COUNT = 64;
+	constexpr uint32_t TOP_SIZE = 1024;
+	constexpr uint32_t TAIL_MIP = 4;
+	constexpr uint64_t GPU_LATENCY = 2;
+
+	// Stands in for the GPU side, textures sample their committed range and uploads complete GPU_LATENCY frames later
+	class MockUploader : public Carol::TextureStreamingUploader
+	{
+	public:
+		MockUploader(const uint64_t& cpuFenceValue, const uint64_t& completedFenceValue)
+			:mCpuFenceValue(cpuFenceValue),
+			mCompletedFenceValue(completedFenceValue)
+		{
+		}
+
+		void Upload(uint32_t idx, uint32_t mostDetailedMip)override
+		{
+			auto& texture = GetTexture(idx);
+			CAROL_CHECK(!texture.Pending);
+
+			texture.Pending = true;
+			texture.PendingMip = mostDetailedMip;
+			texture.PendingFenceValue = mCpuFenceValue + 1;
+			++UploadCount;
+		}
+
+		void Commit(uint32_t idx)override
+		{
+			auto& texture = GetTexture(idx);
+			CAROL_CHECK(texture.Pending && !texture.Removed);
+			CAROL_CHECK(texture.PendingFenceValue <= mCompletedFenceValue);
+
+			texture.SampledMip = texture.PendingMip;
+			texture.Pending = false;
+			++CommitCount;
+		}
+
+		class Texture
+		{
+		public:
+			uint32_t SampledMip = TAIL_MIP;
+			uint32_t PendingMip = TAIL_MIP;
+			uint64_t PendingFenceValue = 0;
+			bool Pending = false;
+			bool Removed = false;
+		};
+
+		Texture& GetTexture(uint32_t idx)
+		{
+			if (idx >= Textures.size())
+			{
+				Textures.resize(idx + 1);
+			}
+
+			return Textures[idx];
+		}
+
+		std::vector<Texture> Textures;
+		uint32_t UploadCount = 0;
+		uint32_t CommitCount = 0;
+
+	private:
+		const uint64_t& mCpuFenceValue;
+		const uint64_t& mCompletedFenceValue;
+	};
+
+	// Sizes of the mips of an RGBA8 square
+	std::vector<uint64_t> GetMipSizes(uint32_t size)
+	{
+		std::vector<uint64_t> mipSizes;
+
+		for (; size > 0; size /= 2)
+		{
+			mipSizes.push_back(uint64_t(size) * size * 4);
+		}
+
+		return mipSizes;
+	}
+}
+
+int main()
+{
+	uint64_t cpuFenceValue = 1;
+	uint64_t completedFenceValue = 0;
+	auto uploader = std::make_unique<MockUploader>(cpuFenceValue, completedFenceValue);
+	auto* mock = uploader.get();
+
+	auto mipSizes = GetMipSizes(TOP_SIZE);
+	uint64_t fullSize = 0;
+	uint64_t tailSize = 0;
+
+	for (uint32_t mip = 0; mip < mipSizes.size(); ++mip)
+	{
+		fullSize += mipSizes[mip];
+		tailSize += mip >= TAIL_MIP ? mipSizes[mip] : 0;
+	}
+
+	Carol::TextureStreamingSettings settings;
+	settings.MemoryBudget = 48 << 20;
+	settings.UploadBudget = 8 << 20;
+	Carol::TextureStreamer streamer(std::move(uploader), settings);
+
+	for (uint32_t i = 0; i < TEXTURE_COUNT; ++i)
+	{
+		CAROL_CHECK(streamer.AddTexture(mipSizes, TAIL_MIP) == i);
+		mock->GetTexture(i);
+	}
+
+	// Only the tails load at first
+	CAROL_CHECK(streamer.GetResidentSize() == TEXTURE_COUNT * tailSize);
+
+	uint64_t maxResidentSize = 0;
+	uint64_t maxUploadSize = 0;
+
+	// One frame as the renderer runs it: commits, requests from the scene, then the uploads of the recorded frame
+	auto runFrame = [&](auto&& request)
+	{
+		streamer.Update(completedFenceValue);
+
+		for (uint32_t i = 0; i < mock->Textures.size(); ++i)
+		{
+			// Textures switch mips at commits only, never halfway through an upload
+			CAROL_CHECK(mock->Textures[i].Removed || streamer.GetResidentMip(i) == mock->Textures[i].SampledMip);
+		}
+
+		request();
+		uint64_t uploadSize = streamer.Upload(cpuFenceValue);
+
+		maxResidentSize = std::max(maxResidentSize, streamer.GetResidentSize());
+		maxUploadSize = std::max(maxUploadSize, uploadSize);
+		CAROL_CHECK(streamer.GetResidentSize() <= settings.MemoryBudget);
+		CAROL_CHECK(uploadSize <= std::max<uint64_t>(settings.UploadBudget, fullSize));
+
+		++cpuFenceValue;
+		completedFenceValue = cpuFenceValue > GPU_LATENCY ? cpuFenceValue - GPU_LATENCY : 0;
+	};
+
+	auto requestRange = [&](uint32_t first, uint32_t last, uint32_t mip)
+	{
+		return [&streamer, first, last, mip]()
+		{
+			for (uint32_t i = first; i < last; ++i)
+			{
+				streamer.RequestMip(i, mip);
+			}
+		};
+	};
+
+	// Eight textures fit in full. Uploads spread over frames under the upload budget and settle.
+	for (uint32_t frame = 0; frame < 32; ++frame)
+	{
+		runFrame(requestRange(0, 8, 0));
+	}
+
+	CAROL_CHECK(streamer.GetPendingCount() == 0);
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		CAROL_CHECK(streamer.GetResidentMip(i) == 0);
+	}
+
+	// The scene asks for every texture at full resolution, far over the budget
+	for (uint32_t frame = 0; frame < 32; ++frame)
+	{
+		runFrame(requestRange(0, TEXTURE_COUNT, 0));
+	}
+
+	uint32_t uploadCount = mock->UploadCount;
+
+	for (uint32_t frame = 0; frame < 8; ++frame)
+	{
+		runFrame(requestRange(0, TEXTURE_COUNT, 0));
+	}
+
+	// Steady requests do not thrash once the budget is full
+	CAROL_CHECK(mock->UploadCount == uploadCount);
+	CAROL_CHECK(streamer.GetResidentSize() + mipSizes[0] > settings.MemoryBudget / 2);
+
+	// Back to eight textures, the first four requested more recently than the others
+	for (uint32_t frame = 0; frame < 32; ++frame)
+	{
+		runFrame(requestRange(0, 8, 0));
+	}
+
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		runFrame(requestRange(0, 4, 0));
+	}
+
+	// New textures need room, the least recently requested go first
+	for (uint32_t frame = 0; frame < 32; ++frame)
+	{
+		runFrame(requestRange(8, 12, 0));
+	}
+
+	CAROL_CHECK(streamer.GetPendingCount() == 0);
+
+	for (uint32_t i = 8; i < 12; ++i)
+	{
+		CAROL_CHECK(streamer.GetResidentMip(i) == 0);
+	}
+
+	uint32_t olderEvictedCount = 0;
+	uint32_t recentEvictedCount = 0;
+
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		uint32_t& evictedCount = i < 4 ? recentEvictedCount : olderEvictedCount;
+		evictedCount += streamer.GetResidentMip(i) > 0;
+	}
+
+	CAROL_CHECK(olderEvictedCount > 0);
+	CAROL_CHECK(recentEvictedCount == 0 || olderEvictedCount == 4);
+
+	// Removed textures give their memory back, an upload in flight is dropped with them.
+	// The load waits for the evictions making room for it to commit first.
+	for (uint32_t frame = 0; frame < 8 && !mock->Textures[12].Pending; ++frame)
+	{
+		runFrame(requestRange(12, 13, 0));
+	}
+
+	CAROL_CHECK(mock->Textures[12].Pending);
+	uint32_t pendingCount = streamer.GetPendingCount();
+	uint64_t residentSize = streamer.GetResidentSize();
+	streamer.RemoveTexture(12);
+	mock->Textures[12].Removed = true;
+	CAROL_CHECK(streamer.GetResidentSize() < residentSize);
+	CAROL_CHECK(streamer.GetPendingCount() == pendingCount - 1);
+
+	for (uint32_t frame = 0; frame < 4; ++frame)
+	{
+		runFrame([]() {});
+	}
+
+	CAROL_CHECK(streamer.GetPendingCount() == 0);
+
+	std::printf("texture-streamer-test: peak %.1f of %.1f MB resident, peak upload %.1f MB, %u uploads, %u commits, %d failed checks\n",
+		maxResidentSize / double(1 << 20),
+		settings.MemoryBudget / double(1 << 20),
+		maxUploadSize / double(1 << 20),
+		mock->UploadCount,
+		mock->CommitCount,
+		gFailedChecks);
+	return gFailedChecks;
+}
@@ -0,0 +1,340 @@
+#include <scene/animation_asset.h>
+#include <scene/mesh_cache.h>
+#include <scene/model.h>
+#include <scene/scene_package.h>
+#include <scene/texture.h>
+#include <scene/texture_cache.h>
+#include <utils/cook_stats.h>
+#include <utils/exception.h>
+#include <utils/mapped_file.h>
+#include <utils/thread_pool.h>
+#include <global.h>
+#include <DirectXMath.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	class CookEntry
+	{
+	public:
+		std::string Name;
+		std::string Path;
+		std::string TextureDir;
+		bool Skinned = false;
+		DirectX::XMFLOAT4X4 World;
+	};
+
+	class CookedTexture
+	{
+	public:
+		std::string Path;
+		uint64_t ContentHash = 0;
+		Carol::TextureUsage Usage = Carol::TEXTURE_USAGE_UNKNOWN;
+		std::string CachePath;
+	};
+
+	class CookedModel
+	{
+	public:
+		uint64_t MeshCacheKey = 0;
+		std::string MeshCachePath;
+		std::vector<CookedTexture> Textures;
+		double Milliseconds = 0.0;
+	};
+
+	// One model per line: name path textureDir static|skinned [scale tx ty tz angle axisX axisY axisZ]
+	// Strings may be quoted, the angle is in degrees and lines starting with # are skipped
+	bool ReadManifest(const char* path, std::vector<CookEntry>& entries)
+	{
+		std::ifstream file{ std::filesystem::path(path) };
+
+		if (!file)
+		{
+			std::fprintf(stderr, "carol-cook: cannot read %s\n", path);
+			return false;
+		}
+
+		std::string line;
+
+		for (uint32_t lineNumber = 1; std::getline(file, line); ++lineNumber)
+		{
+			std::istringstream stream(line);
+			stream >> std::ws;
+
+			if (stream.eof() || stream.peek() == '#')
+			{
+				continue;
+			}
+
+			CookEntry entry;
+			std::string type;
+			bool valid = bool(stream >> std::quoted(entry.Name) >> std::quoted(entry.Path) >> std::quoted(entry.TextureDir) >> type);
+
+			float scale = 1.f;
+			float angle = 0.f;
+			DirectX::XMFLOAT3 translation = { 0.f, 0.f, 0.f };
+			DirectX::XMFLOAT3 axis = { 0.f, 1.f, 0.f };
+
+			// The transform is either complete or left out
+			if (valid && stream >> scale)
+			{
+				valid = bool(stream >> translation.x >> translation.y >> translation.z >> angle >> axis.x >> axis.y >> axis.z);
+			}
+			else
+			{
+				valid = valid && stream.eof();
+			}
+
+			if (!valid || (type != "static" && type != "skinned"))
+			{
+				std::fprintf(stderr, "carol-cook: %s:%u: expected name path textureDir static|skinned [scale tx ty tz angle ax ay az]\n", path, lineNumber);
+				return false;
+			}
+
+			// Composed like the load dialog of the engine
+			auto world = DirectX::XMMatrixScaling(scale, scale, scale)
+				* DirectX::XMMatrixRotationAxis(DirectX::XMLoadFloat3(&axis), DirectX::XM_PI * angle / 180.f)
+				* DirectX::XMMatrixTranslationFromVector(DirectX::XMLoadFloat3(&translation));
+			DirectX::XMStoreFloat4x4(&entry.World, world);
+			entry.Skinned = type == "skinned";
+
+			entries.push_back(std::move(entry));
+		}
+
+		return true;
+	}
+
+	// Runs on the thread pool, imports the model into the mesh and texture caches the engine loads from
+	CookedModel CookModel(const CookEntry& entry)
+	{
+		auto start = std::chrono::steady_clock::now();
+		CookedModel cooked;
+
+		// Assimp asserts on sources it cannot open
+		cooked.MeshCacheKey = Carol::GetMeshCacheKey(entry.Path, entry.TextureDir, entry.Skinned);
+		ThrowIfFailed(cooked.MeshCacheKey ? S_OK : E_INVALIDARG);
+		cooked.MeshCachePath = Carol::GetMeshCachePath(cooked.MeshCacheKey);
+
+		Carol::ModelNode node;
+		std::unique_ptr<Carol::MappedFile> cacheFile;
+		auto model = Carol::ImportModel(&node, entry.Path, entry.TextureDir, entry.Skinned, cacheFile);
+		ThrowIfFailed(Carol::IsMeshCacheValid(Carol::MappedFile(cooked.MeshCachePath).GetData(), cooked.MeshCacheKey) ? S_OK : E_FAIL);
+
+		std::set<std::pair<std::string, Carol::TextureUsage>> modelTextures;
+
+		for (auto& modelTexture : model->GetTextures())
+		{
+			auto* texture = Carol::gTextureManager->FindTexture(modelTexture.Path, false, modelTexture.Usage);
+
+			// Textures of unknown usage are not cooked, the engine decodes their sources
+			if (!modelTextures.emplace(modelTexture.Path, modelTexture.Usage).second || !texture || texture->mUsage == Carol::TEXTURE_USAGE_UNKNOWN || !texture->mContentHash)
+			{
+				continue;
+			}
+
+			auto& cookedTexture = cooked.Textures.emplace_back();
+			cookedTexture.Path = modelTexture.Path;
+			cookedTexture.ContentHash = texture->mContentHash;
+			cookedTexture.Usage = texture->mUsage;
+			cookedTexture.CachePath = Carol::GetTextureCachePath(Carol::GetTextureCacheKey(texture->mContentHash, texture->mUsage));
+			std::error_code ec;
+
+			// Loads never fail on an unwritable cache, the cooker has to
+			if (!std::filesystem::exists(cookedTexture.CachePath, ec))
+			{
+				ThrowIfFailed(texture->mImage && Carol::SaveTextureCache(*texture->mImage, cookedTexture.CachePath) ? S_OK : E_FAIL);
+			}
+		}
+
+		cooked.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		return cooked;
+	}
+
+	double ToMegabytes(uint64_t bytes)
+	{
+		return bytes / double(1 << 20);
+	}
+
+	void PrintStats(double packageMilliseconds, uint64_t packageBytes)
+	{
+		std::printf("%-16s %8s %12s %12s\n", "stage", "count", "thread ms", "MB");
+
+		for (uint32_t i = 0; i < Carol::COOK_STAGE_COUNT; ++i)
+		{
+			auto stage = Carol::CookStage(i);
+			auto stats = Carol::GetCookStageStats(stage);
+			std::printf("%-16.*s %8llu %12.1f %12.1f\n",
+				int(Carol::GetCookStageName(stage).size()),
+				Carol::GetCookStageName(stage).data(),
+				(unsigned long long)stats.Count,
+				stats.Nanoseconds / 1e6,
+				ToMegabytes(stats.Bytes));
+		}
+
+		if (packageBytes)
+		{
+			std::printf("%-16s %8u %12.1f %12.1f\n", "package", 1u, packageMilliseconds, ToMegabytes(packageBytes));
+		}
+
+		// Copies of one file under several paths are decoded, cooked and packed once
+		std::printf("textures: %.1f MB of sources duplicate a texture loaded from another path\n", ToMegabytes(Carol::gTextureManager->GetDuplicateBytes()));
+		std::printf("memory: %.1f MB peak resident, %.1f MB resident at exit\n", ToMegabytes(Carol::GetPeakMemoryUsage()), ToMegabytes(Carol::GetMemoryUsage()));
+	}
+}
+
+// carol-cook [-j threads] <manifest> [package]
+// Run from the directory the engine runs in. Every model and texture is cooked into the caches the engine loads from,
+// and the package is only written when it is given. Models are cooked in parallel, one per pool thread.
+int main(int argc, char** argv)
+{
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	std::vector<const char*> args;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::string_view(argv[i]) == "-j" && i + 1 < argc)
+		{
+			threadCount = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			args.push_back(argv[i]);
+		}
+	}
+
+	if (args.empty() || args.size() > 2)
+	{
+		std::fprintf(stderr, "usage: carol-cook [-j threads] <manifest> [package]\n");
+		return 1;
+	}
+
+	std::vector<CookEntry> entries;
+
+	if (!ReadManifest(args[0], entries))
+	{
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	Carol::gThreadPool = std::make_unique<Carol::ThreadPool>(threadCount);
+	Carol::gAnimationAssetManager = std::make_unique<Carol::AnimationAssetManager>();
+	Carol::gTextureManager = std::make_unique<Carol::TextureManager>();
+
+	// Entries importing the same source the same way are cooked once and packed as instances
+	std::map<std::tuple<std::string, std::string, bool>, uint32_t> sourceIndices;
+	std::vector<uint32_t> entrySources;
+	std::vector<const CookEntry*> sources;
+
+	for (auto& entry : entries)
+	{
+		auto [it, inserted] = sourceIndices.try_emplace({ entry.Path, entry.TextureDir, entry.Skinned }, uint32_t(sources.size()));
+
+		if (inserted)
+		{
+			sources.push_back(&entry);
+		}
+
+		entrySources.push_back(it->second);
+	}
+
+	std::vector<CookedModel> cooked(sources.size());
+	std::vector<std::future<void>> cooking;
+
+	for (uint32_t i = 0; i < sources.size(); ++i)
+	{
+		cooking.push_back(Carol::gThreadPool->Submit([&cooked, &sources, i]()
+		{
+			cooked[i] = CookModel(*sources[i]);
+		}));
+	}
+
+	std::vector<bool> failed(sources.size());
+	int result = 0;
+
+	for (uint32_t i = 0; i < sources.size(); ++i)
+	{
+		try
+		{
+			cooking[i].get();
+			std::printf("carol-cook: cooked %s in %.1f ms\n", sources[i]->Path.c_str(), cooked[i].Milliseconds);
+		}
+		catch (Carol::DxException& e)
+		{
+			std::fprintf(stderr, "carol-cook: %s: %s\n", sources[i]->Path.c_str(), e.ToString().c_str());
+			failed[i] = true;
+		}
+		catch (std::exception& e)
+		{
+			std::fprintf(stderr, "carol-cook: %s: %s\n", sources[i]->Path.c_str(), e.what());
+			failed[i] = true;
+		}
+
+		result |= failed[i];
+	}
+
+	double packageMilliseconds = 0.0;
+	uint64_t packageBytes = 0;
+
+	if (result == 0 && args.size() == 2)
+	{
+		// Added in manifest order whatever order the models finished in, so the same manifest gives the same package
+		auto packageStart = std::chrono::steady_clock::now();
+		Carol::ScenePackageWriter writer;
+		std::set<std::pair<std::string, Carol::TextureUsage>> packedTextures;
+
+		for (uint32_t i = 0; i < entries.size(); ++i)
+		{
+			auto& model = cooked[entrySources[i]];
+
+			for (auto& texture : model.Textures)
+			{
+				if (packedTextures.emplace(texture.Path, texture.Usage).second)
+				{
+					writer.AddTexture(texture.Path, texture.ContentHash, texture.Usage, texture.CachePath);
+				}
+			}
+
+			writer.AddModel(entries[i].Name, entries[i].World, model.MeshCacheKey, model.MeshCachePath);
+		}
+
+		if (writer.Save(args[1]))
+		{
+			std::error_code ec;
+			packageBytes = std::filesystem::file_size(args[1], ec);
+			packageMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - packageStart).count();
+			std::printf("carol-cook: packed %u models and %u textures into %s\n", writer.GetModelCount(), writer.GetTextureCount(), args[1]);
+		}
+		else
+		{
+			std::fprintf(stderr, "carol-cook: failed to write %s\n", args[1]);
+			result = 1;
+		}
+	}
+
+	std::printf("carol-cook: %zu models from %zu sources in %.1f ms on %u threads\n",
+		entries.size(),
+		sources.size(),
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+		Carol::gThreadPool->GetThreadCount());
+	PrintStats(packageMilliseconds, packageBytes);
+
+	Carol::gTextureManager.reset();
+	Carol::gAnimationAssetManager.reset();
+	Carol::gThreadPool.reset();
+
+	return result;
+}
@@ -0,0 +1,40 @@
+#include <utils/shader_archive.h>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// carol-shader-pack <dxil directory> <archive>
+// Run from the directory the engine runs in, shaders are named by the paths found here
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::fprintf(stderr, "usage: carol-shader-pack <dxil directory> <archive>\n");
+		return 1;
+	}
+
+	std::vector<std::string> paths;
+	std::error_code ec;
+
+	for (auto it = std::filesystem::directory_iterator(argv[1], ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+	{
+		if (it->is_regular_file(ec) && it->path().extension() == ".dxil")
+		{
+			paths.push_back(it->path().generic_string());
+		}
+	}
+
+	// Sorted so that the same shaders always give the same archive
+	std::ranges::sort(paths);
+
+	if (!Carol::SaveShaderArchive(paths, argv[2]))
+	{
+		std::fprintf(stderr, "carol-shader-pack: failed to pack %zu shaders into %s\n", paths.size(), argv[2]);
+		return 1;
+	}
+
+	std::printf("carol-shader-pack: packed %zu shaders into %s\n", paths.size(), argv[2]);
+	return 0;
+}